@@ -0,0 +1,102 @@
+#include "almondai/kernels.hpp"
+#include "almondai/optim_adamw.hpp"
+#include "almondai/thread_pool.hpp"
+
+#include "bench_support.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// One AdamW step over an output projection sized like the student's. Compares
+// the unfused per-element loop the optimizer used before the kernels with the
+// fused step for each moment precision, single-threaded and on a pool.
+// Bandwidth counts the parameter, gradient and both moments read and written.
+
+using namespace almondai;
+
+namespace {
+
+using Precision = AdamWOptimizer::MomentPrecision;
+
+const char* precision_name(Precision precision) {
+    switch (precision) {
+    case Precision::Float64:
+        return "fp64";
+    case Precision::Float32:
+        return "fp32";
+    case Precision::BFloat16:
+        return "bf16";
+    }
+    return "?";
+}
+
+std::size_t moment_bytes(Precision precision) {
+    switch (precision) {
+    case Precision::Float64:
+        return sizeof(double);
+    case Precision::Float32:
+        return sizeof(float);
+    case Precision::BFloat16:
+        return sizeof(std::uint16_t);
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8000 * 256;
+    const std::size_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4;
+
+    std::mt19937 rng(11);
+    std::normal_distribution<double> dist(0.0, 0.02);
+    std::vector<double> params(n);
+    std::vector<double> grads(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        params[i] = dist(rng);
+        grads[i] = dist(rng);
+    }
+    std::printf("isa %s, %zu parameters, %zu threads\n", kernels::isa_name(kernels::active_isa()), n, threads);
+
+    std::vector<double> m(n, 0.0);
+    std::vector<double> v(n, 0.0);
+    std::size_t t = 0;
+    const double loop = bench::best_seconds([&] {
+        ++t;
+        const double beta1 = 0.9;
+        const double beta2 = 0.98;
+        for (std::size_t i = 0; i < n; ++i) {
+            m[i] = beta1 * m[i] + (1.0 - beta1) * grads[i];
+            v[i] = beta2 * v[i] + (1.0 - beta2) * grads[i] * grads[i];
+            const double m_hat = m[i] / (1.0 - std::pow(beta1, static_cast<double>(t)));
+            const double v_hat = v[i] / (1.0 - std::pow(beta2, static_cast<double>(t)));
+            params[i] -= 3e-4 * (m_hat / (std::sqrt(v_hat) + 1e-8) + 0.01 * params[i]);
+        }
+        bench::keep(params[n - 1]);
+    });
+    const double loop_bytes = static_cast<double>(n * (2 * sizeof(double) + 2 * 2 * sizeof(double) + sizeof(double)));
+    std::printf("  unfused loop        %8.2f ms  %6.2f GB/s\n", loop * 1e3, loop_bytes / loop * 1e-9);
+
+    ThreadPool pool(threads);
+    for (const auto precision : {Precision::Float64, Precision::Float32, Precision::BFloat16}) {
+        AdamWOptimizer::Params config;
+        config.moment_precision = precision;
+        AdamWOptimizer optimizer(n, config);
+        const double bytes = static_cast<double>(n * (2 * sizeof(double) + sizeof(double) + 4 * moment_bytes(precision)));
+        const double serial = bench::best_seconds([&] {
+            optimizer.step(params, grads);
+            bench::keep(params[n - 1]);
+        });
+        optimizer.set_thread_pool(&pool);
+        const double parallel = bench::best_seconds([&] {
+            optimizer.step(params, grads);
+            bench::keep(params[n - 1]);
+        });
+        std::printf("  fused %s         %8.2f ms  %6.2f GB/s\n", precision_name(precision), serial * 1e3, bytes / serial * 1e-9);
+        std::printf("  fused %s, pool   %8.2f ms  %6.2f GB/s\n", precision_name(precision), parallel * 1e3, bytes / parallel * 1e-9);
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+
+// Timing helpers for the microbenchmarks. Each measurement runs `body` until
+// at least `min_seconds` have passed and reports the fastest run.
+
+namespace almondai::bench {
+
+template <typename Body>
+double best_seconds(Body&& body, double min_seconds = 0.5, std::size_t min_runs = 3) {
+    using clock = std::chrono::steady_clock;
+    double best = 1e30;
+    double total = 0.0;
+    for (std::size_t run = 0; run < min_runs || total < min_seconds; ++run) {
+        const auto start = clock::now();
+        body();
+        const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        best = std::min(best, elapsed);
+        total += elapsed;
+    }
+    return best;
+}
+
+// Keeps the optimizer from discarding a result: the empty asm claims to read
+// `value`, so the computation feeding it has to happen.
+inline void keep(double value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    volatile double sink = value;
+    (void)sink;
+#endif
+}
+
+// Fresh temporary directory made the working directory for its lifetime, for
+// benches that construct a ContinuousLearner (which keeps its state under
+// ./data). The previous working directory is restored and the tree removed.
+class ScratchDir {
+public:
+    explicit ScratchDir(const std::string& name)
+        : m_previous(std::filesystem::current_path()),
+          m_path(std::filesystem::temp_directory_path() / ("almondai_bench_" + name)) {
+        std::filesystem::remove_all(m_path);
+        std::filesystem::create_directories(m_path);
+        std::filesystem::current_path(m_path);
+    }
+    ~ScratchDir() {
+        std::error_code ignored;
+        std::filesystem::current_path(m_previous, ignored);
+        std::filesystem::remove_all(m_path, ignored);
+    }
+    ScratchDir(const ScratchDir&) = delete;
+    ScratchDir& operator=(const ScratchDir&) = delete;
+
+    const std::filesystem::path& path() const noexcept { return m_path; }
+
+private:
+    std::filesystem::path m_previous;
+    std::filesystem::path m_path;
+};
+
+} // namespace almondai::bench
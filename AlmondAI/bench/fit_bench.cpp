@@ -0,0 +1,86 @@
+#include "almondai/adapter.hpp"
+#include "almondai/governor.hpp"
+#include "almondai/tokenizer_coordinator.hpp"
+#include "almondai/train.hpp"
+
+#include "bench_support.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One fit() epoch over `samples` generated prompt/reply pairs (plus the seed
+// curriculum) in batches of `batch`, on the serial train_step path and
+// data-parallel with 1 to 8 worker threads. A warm-up fit ingests the
+// dataset's vocabulary, so timed runs only re-read the file and train;
+// weights keep moving between runs, which does not change the work per step.
+// Scaling past 1 thread needs as many cores, so the hardware thread count is
+// printed alongside.
+
+using namespace almondai;
+
+int main(int argc, char** argv) {
+    const std::size_t samples = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    const int batch = argc > 2 ? std::atoi(argv[2]) : 32;
+    const std::size_t hidden = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 128;
+
+    bench::ScratchDir scratch("fit");
+
+    static const char* const kWords[] = {
+        "window", "gradient", "shard", "token", "reply", "learner", "adapter", "teacher",
+        "student", "batch", "epoch", "reduce", "tree", "thread", "sample", "vocab",
+    };
+    std::mt19937 rng(17);
+    std::uniform_int_distribution<std::size_t> word(0, std::size(kWords) - 1);
+    std::uniform_int_distribution<std::size_t> length(4, 16);
+    const auto sentence = [&] {
+        std::string text;
+        for (std::size_t i = length(rng); i > 0; --i) {
+            text += kWords[word(rng)];
+            text += i > 1 ? " " : ".";
+        }
+        return text;
+    };
+    const std::string dataset = (scratch.path() / "fit.jsonl").string();
+    {
+        std::ofstream out(dataset);
+        for (std::size_t i = 0; i < samples; ++i) {
+            out << "{\"prompt\":\"" << sentence() << "\",\"teacher_output\":\"" << sentence() << "\"}\n";
+        }
+    }
+
+    ModelConfig config;
+    config.hidden_size = hidden;
+    StudentModel student{BaseDecoder(config)};
+    AdapterManager adapters;
+    adapters.register_adapter(Adapter("default", config.hidden_size, AdapterConfig()));
+    adapters.activate("default");
+    TokenizerCoordinator tokenizers;
+    ContinuousLearner learner(std::move(student), std::move(adapters), tokenizers, PolicyGovernor());
+    int batches = 0;
+    learner.fit(dataset, 1, batch, [&](int, double, double, double) { ++batches; });
+
+    std::printf("%zu samples (%d batches of %d with the seeds), hidden %zu, %u hardware threads\n",
+                samples, batches, batch, hidden, std::thread::hardware_concurrency());
+    double serial = 0.0;
+    double single = 0.0;
+    for (std::size_t threads : {0, 1, 2, 4, 8}) {
+        learner.set_fit_threads(threads);
+        const double seconds = bench::best_seconds([&] { learner.fit(dataset, 1, batch, {}); }, 1.0, 2);
+        if (threads == 0) {
+            serial = seconds;
+            std::printf("  serial train_step: %8.1f ms/epoch\n", seconds * 1e3);
+        } else {
+            if (threads == 1) {
+                single = seconds;
+            }
+            std::printf("  %zu fit thread(s):  %8.1f ms/epoch  (%.2fx vs 1 thread, %.2fx vs serial)\n",
+                        threads, seconds * 1e3, single / seconds, serial / seconds);
+        }
+    }
+    return 0;
+}
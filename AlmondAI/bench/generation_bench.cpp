@@ -0,0 +1,67 @@
+#include "almondai/generation_engine.hpp"
+
+#include "bench_support.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Decode throughput of GenerationEngine with `clients` threads each generating
+// `tokens` tokens at once, for batch limits from 1 (every request stepped on
+// its own, as before the engine) up to the number of clients. Runs without an
+// end token, so every request produces its full length. Sizes default to a
+// 32k vocabulary and 256-wide hidden state.
+
+using namespace almondai;
+
+int main(int argc, char** argv) {
+    const std::size_t clients = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+    const int tokens = argc > 2 ? std::atoi(argv[2]) : 16;
+    const std::size_t vocab = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 32768;
+    const std::size_t hidden = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 256;
+
+    ModelConfig config;
+    config.vocab_size = vocab;
+    config.hidden_size = hidden;
+    config.num_layers = 2;
+    const StudentModel student{BaseDecoder(config)};
+
+    std::printf("%zu clients x %d tokens, vocab %zu, hidden %zu\n", clients, tokens, vocab, hidden);
+    std::printf("%-10s %12s %12s %10s\n", "max_batch", "tokens/s", "mean batch", "speedup");
+    std::vector<std::size_t> limits;
+    for (std::size_t limit = 1; limit < clients; limit *= 4) {
+        limits.push_back(limit);
+    }
+    limits.push_back(clients);
+
+    double baseline = 0.0;
+    for (std::size_t max_batch : limits) {
+        GenerationEngine engine(student, GenerationEngine::Options{.max_batch = max_batch});
+        const double seconds = bench::best_seconds([&] {
+            std::vector<std::thread> threads;
+            for (std::size_t c = 0; c < clients; ++c) {
+                threads.emplace_back([&, c] {
+                    GenerationRequest request;
+                    request.prompt = {static_cast<int>(c % vocab), 1, 2, 3};
+                    request.max_tokens = tokens;
+                    request.sampling.top_k = 40;
+                    request.rng.seed(static_cast<unsigned>(c));
+                    bench::keep(static_cast<double>(engine.generate(std::move(request)).size()));
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        });
+        const auto stats = engine.stats();
+        const double throughput = static_cast<double>(clients) * tokens / seconds;
+        if (max_batch == 1) {
+            baseline = throughput;
+        }
+        std::printf("%-10zu %12.0f %12.2f %9.2fx\n", max_batch, throughput,
+                    static_cast<double>(stats.tokens) / static_cast<double>(stats.steps), throughput / baseline);
+    }
+    return 0;
+}
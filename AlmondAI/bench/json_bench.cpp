@@ -0,0 +1,101 @@
+#include "almondai/json.hpp"
+
+#include "bench_support.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+// Parse and dump throughput for the shapes JSON takes on our hot paths: a
+// weight array of doubles, an MCP request line and JSONL training samples.
+// Pass a JSONL file (e.g. data/training_seed.jsonl) to time its lines too.
+
+using namespace almondai;
+
+namespace {
+
+void report(const char* name, const std::vector<std::string>& documents) {
+    std::size_t bytes = 0;
+    for (const auto& document : documents) {
+        bytes += document.size();
+    }
+    std::vector<Json> parsed(documents.size());
+    const double parse_seconds = bench::best_seconds([&] {
+        for (std::size_t i = 0; i < documents.size(); ++i) {
+            parsed[i] = Json::parse(documents[i]);
+        }
+    });
+    std::string buffer;
+    const double dump_seconds = bench::best_seconds([&] {
+        for (const auto& value : parsed) {
+            buffer.clear();
+            value.dump_to(buffer);
+            bench::keep(static_cast<double>(buffer.size()));
+        }
+    });
+    const double megabytes = static_cast<double>(bytes) / 1e6;
+    std::printf("  %-22s %9.1f KB  parse %7.1f MB/s  dump %7.1f MB/s\n",
+                name, static_cast<double>(bytes) / 1e3, megabytes / parse_seconds, megabytes / dump_seconds);
+}
+
+std::vector<std::string> read_lines(const char* path) {
+    std::ifstream file(path);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);) {
+        if (!line.empty()) {
+            lines.push_back(std::move(line));
+        }
+    }
+    return lines;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::mt19937 rng(5);
+    std::normal_distribution<double> weight(0.0, 0.02);
+
+    JsonArray weights;
+    for (int i = 0; i < 200000; ++i) {
+        weights.emplace_back(Json(weight(rng)));
+    }
+    report("weights (200k doubles)", {Json(weights).dump()});
+
+    JsonObject params;
+    params["prompt"] = Json("Explain the difference between std::vector and std::deque in two sentences.");
+    params["max_tokens"] = Json(128);
+    params["temperature"] = Json(0.7);
+    JsonObject request;
+    request["jsonrpc"] = Json("2.0");
+    request["id"] = Json(42);
+    request["method"] = Json("model.generate");
+    request["params"] = Json(params);
+    report("MCP request lines", std::vector<std::string>(1000, Json(request).dump()));
+
+    std::vector<std::string> samples;
+    for (int i = 0; i < 2000; ++i) {
+        JsonObject provenance;
+        provenance["prompt_hash"] = Json("seed::sample_" + std::to_string(i));
+        provenance["source"] = Json("seed");
+        JsonObject sample;
+        sample["constraints"] = Json(JsonObject{});
+        sample["prompt"] = Json("Summarise item " + std::to_string(i) + " in one line.\nKeep \"quotes\" intact.");
+        sample["teacher_output"] = Json(std::string(120 + i % 200, 'x') + "\tdone.");
+        sample["provenance"] = Json(provenance);
+        samples.push_back(Json(sample).dump());
+    }
+    report("JSONL samples", samples);
+
+    if (argc > 1) {
+        const auto lines = read_lines(argv[1]);
+        if (lines.empty()) {
+            std::fprintf(stderr, "no lines in %s\n", argv[1]);
+            return 1;
+        }
+        report(argv[1], lines);
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "almondai/kernels.hpp"
+
+#include "bench_support.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Output projection shaped like the student's: a [hidden, vocab] weight times
+// `batch` contexts. Compares the column-order loop the decoder used before the
+// kernels with the blocked vecmat and the batched matmul on the active ISA
+// (cap it with ALMONDAI_KERNELS to compare paths).
+
+using namespace almondai;
+
+int main(int argc, char** argv) {
+    const std::size_t vocab = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8000;
+    const std::size_t hidden = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 256;
+    const std::size_t batch = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 32;
+
+    std::mt19937 rng(7);
+    std::normal_distribution<double> dist(0.0, 0.02);
+    std::vector<double> w(hidden * vocab);
+    std::vector<double> x(batch * hidden);
+    for (double& value : w) {
+        value = dist(rng);
+    }
+    for (double& value : x) {
+        value = dist(rng);
+    }
+    std::vector<double> y(batch * vocab);
+
+    const double column_order = bench::best_seconds([&] {
+        for (std::size_t b = 0; b < batch; ++b) {
+            for (std::size_t n = 0; n < vocab; ++n) {
+                double sum = 0.0;
+                for (std::size_t k = 0; k < hidden; ++k) {
+                    sum += x[b * hidden + k] * w[k * vocab + n];
+                }
+                y[b * vocab + n] = sum;
+            }
+        }
+        bench::keep(y[vocab - 1]);
+    });
+    const double per_row = bench::best_seconds([&] {
+        for (std::size_t b = 0; b < batch; ++b) {
+            kernels::vecmat(x.data() + b * hidden, w.data(), y.data() + b * vocab, hidden, vocab);
+        }
+        bench::keep(y[vocab - 1]);
+    });
+    const double batched = bench::best_seconds([&] {
+        kernels::matmul(x.data(), w.data(), y.data(), batch, hidden, vocab);
+        bench::keep(y[vocab - 1]);
+    });
+
+    const double flops = 2.0 * static_cast<double>(batch * hidden * vocab);
+    std::printf("isa %s, vocab %zu, hidden %zu, batch %zu\n",
+                kernels::isa_name(kernels::active_isa()), vocab, hidden, batch);
+    std::printf("  column-order loop  %8.2f ms  %6.2f GFLOP/s\n", column_order * 1e3, flops / column_order * 1e-9);
+    std::printf("  vecmat per row     %8.2f ms  %6.2f GFLOP/s\n", per_row * 1e3, flops / per_row * 1e-9);
+    std::printf("  batched matmul     %8.2f ms  %6.2f GFLOP/s\n", batched * 1e3, flops / batched * 1e-9);
+
+    const std::size_t n = 1 << 20;
+    std::vector<double> a(n, 0.5);
+    std::vector<double> c(n, 0.25);
+    const double dot_time = bench::best_seconds([&] { bench::keep(kernels::dot(a.data(), c.data(), n)); });
+    const double axpy_time = bench::best_seconds([&] {
+        kernels::axpy(1e-9, a.data(), c.data(), n);
+        bench::keep(c[n - 1]);
+    });
+    const double bytes = 2.0 * static_cast<double>(n * sizeof(double));
+    std::printf("  dot  (1M)          %8.3f ms  %6.2f GB/s\n", dot_time * 1e3, bytes / dot_time * 1e-9);
+    std::printf("  axpy (1M)          %8.3f ms  %6.2f GB/s\n", axpy_time * 1e3, 1.5 * bytes / axpy_time * 1e-9);
+    return 0;
+}
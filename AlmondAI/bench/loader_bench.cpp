@@ -0,0 +1,93 @@
+#include "almondai/adapter.hpp"
+#include "almondai/governor.hpp"
+#include "almondai/tokenizer_coordinator.hpp"
+#include "almondai/train.hpp"
+
+#include "bench_support.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+// Startup cost of a learner whose data/training_data.jsonl holds `samples`
+// generated prompt/reply pairs of `words` words each. The samples are loaded
+// by load_samples_from_file during construction: parsing the mapped file,
+// growing both vocabularies, then indexing every sample for retrieval. The
+// first construction starts cold; the second finds the line index sidecar,
+// saved vocabularies and retrieval metadata left by the first, as a restart
+// would. Each run reports the whole constructor and the part from the first
+// "samples" status on, which is the loader.
+
+using namespace almondai;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+void construct(const char* name, std::size_t samples, std::uintmax_t bytes) {
+    ModelConfig config;
+    config.hidden_size = 32;
+    StudentModel student{BaseDecoder(config)};
+    AdapterManager adapters;
+    adapters.register_adapter(Adapter("default", config.hidden_size, AdapterConfig()));
+    adapters.activate("default");
+    TokenizerCoordinator tokenizers;
+
+    clock_type::time_point samples_started{};
+    const auto on_status = [&](const LoadStatus& status) {
+        if (status.phase == "samples" && samples_started == clock_type::time_point{}) {
+            samples_started = clock_type::now();
+        }
+    };
+    const auto start = clock_type::now();
+    ContinuousLearner learner(std::move(student), std::move(adapters), tokenizers, PolicyGovernor(), on_status);
+    const auto end = clock_type::now();
+
+    const double total = std::chrono::duration<double>(end - start).count();
+    const double loading = std::chrono::duration<double>(end - samples_started).count();
+    std::printf("  %-5s constructor %8.1f ms  loader %8.1f ms  %8.0f samples/s  %7.1f MB/s\n",
+                name, total * 1e3, loading * 1e3, static_cast<double>(samples) / loading,
+                static_cast<double>(bytes) / loading / 1e6);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t samples = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    const std::size_t words = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 24;
+
+    bench::ScratchDir scratch("loader");
+
+    static const char* const kWords[] = {
+        "the", "student", "learns", "from", "teacher", "replies", "while", "serving", "requests",
+        "retrieval", "index", "vocabulary", "caf\xc3\xa9", "na\xc3\xafve", "\xe4\xb8\xad\xe6\x96\x87", "it\xe2\x80\x99s",
+    };
+    std::mt19937 rng(23);
+    std::uniform_int_distribution<std::size_t> word(0, std::size(kWords) - 1);
+    const auto sentence = [&](std::size_t serial) {
+        std::string text = "#" + std::to_string(serial);
+        for (std::size_t i = 0; i < words; ++i) {
+            text += ' ';
+            text += kWords[word(rng)];
+        }
+        return text;
+    };
+    std::filesystem::create_directories("data");
+    {
+        std::ofstream out("data/training_data.jsonl", std::ios::binary);
+        for (std::size_t i = 0; i < samples; ++i) {
+            out << "{\"prompt\":\"" << sentence(i) << "?\",\"teacher_output\":\"" << sentence(i) << ".\"}\n";
+        }
+    }
+    const auto bytes = std::filesystem::file_size("data/training_data.jsonl");
+    std::printf("%zu samples, %.1f MB\n", samples, static_cast<double>(bytes) / 1e6);
+
+    construct("cold", samples, bytes);
+    construct("warm", samples, bytes);
+    return 0;
+}
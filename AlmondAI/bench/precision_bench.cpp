@@ -0,0 +1,104 @@
+#include "almondai/trainer.hpp"
+
+#include "bench_support.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi")
+#else
+#include <sys/resource.h>
+#endif
+
+// Trainer::train_on_batch step time and peak resident memory with fp64 and
+// fp32 weight storage. Peak RSS only grows within a process, so each precision
+// runs in a child invocation of this binary (`precision_bench fp32 ...`) and
+// prints its own row. Sizes default to a 32k vocabulary, 128-wide hidden
+// state and batches of 8 prompt/reply pairs.
+
+using namespace almondai;
+
+namespace {
+
+double peak_rss_mib() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return static_cast<double>(counters.PeakWorkingSetSize) / (1024.0 * 1024.0);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<double>(usage.ru_maxrss) / (1024.0 * 1024.0);
+#else
+    return static_cast<double>(usage.ru_maxrss) / 1024.0;
+#endif
+#endif
+}
+
+void run(WeightPrecision precision, std::size_t vocab, std::size_t hidden, std::size_t batch_size) {
+    std::vector<TrainingExample> batch;
+    for (std::size_t i = 0; i < batch_size; ++i) {
+        const std::string n = std::to_string(i);
+        batch.push_back({Json(), "how does step " + n + " update the weights", Json(),
+                         "step " + n + " applies adamw to every layer and the output projection"});
+    }
+    BpeTokenizer tokenizer;
+    tokenizer.load("");
+    for (const auto& example : batch) {
+        tokenizer.ingest_training_pair(example.prompt, example.teacher_output);
+    }
+
+    ModelConfig config;
+    config.vocab_size = std::max(vocab, tokenizer.vocab_size());
+    config.hidden_size = hidden;
+    config.precision = precision;
+    StudentModel model{BaseDecoder(config)};
+    Trainer trainer(model, tokenizer, AdamWOptimizer(), WarmupCosineScheduler());
+    Trainer::Options options;
+    options.save_every = 0;
+    trainer.set_options(options);
+
+    // The first step allocates the optimizer moments.
+    trainer.train_on_batch(batch);
+    const double seconds = bench::best_seconds([&] { bench::keep(trainer.train_on_batch(batch).loss); });
+    std::printf("%-7s %12.1f %14.1f\n", precision_name(precision), seconds * 1e3, peak_rss_mib());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::optional<WeightPrecision> only = argc > 1 ? parse_precision(argv[1]) : std::nullopt;
+    const int first_size = only ? 2 : 1;
+    const std::size_t vocab = argc > first_size ? std::strtoul(argv[first_size], nullptr, 10) : 32768;
+    const std::size_t hidden = argc > first_size + 1 ? std::strtoul(argv[first_size + 1], nullptr, 10) : 128;
+    const std::size_t batch = argc > first_size + 2 ? std::strtoul(argv[first_size + 2], nullptr, 10) : 8;
+
+    if (only) {
+        run(*only, vocab, hidden, batch);
+        return 0;
+    }
+
+    std::printf("vocab %zu, hidden %zu, batch %zu\n", vocab, hidden, batch);
+    std::printf("%-7s %12s %14s\n", "weights", "ms/step", "peak RSS MiB");
+    std::fflush(stdout);
+    for (const char* name : {"fp64", "fp32"}) {
+        const std::string command = std::string("\"") + argv[0] + "\" " + name + " " + std::to_string(vocab) + " " +
+                                    std::to_string(hidden) + " " + std::to_string(batch);
+        if (std::system(command.c_str()) != 0) {
+            std::fprintf(stderr, "%s run failed\n", name);
+            return 1;
+        }
+    }
+    return 0;
+}
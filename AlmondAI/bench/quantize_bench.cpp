@@ -0,0 +1,75 @@
+#include "almondai/model.hpp"
+
+#include "bench_support.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+// Greedy decode throughput of one model stored as fp64, fp32, fp16 and int8.
+// Each run appends `tokens` tokens through a DecodeSession, evicting from the
+// front once the context window is full, so the time is the output projection
+// and layers rather than pooling. Also prints the weight bytes and the logit
+// drift quantize() measured. Sizes default to a 32k vocabulary and 256-wide
+// hidden state.
+
+using namespace almondai;
+
+namespace {
+
+int decode(const StudentModel& student, std::size_t tokens) {
+    const std::size_t window = student.base().config().context_length;
+    std::deque<int> context{1, 2, 3, 4};
+    auto session = student.start_session(std::vector<int>(context.begin(), context.end()));
+    int last = 0;
+    for (std::size_t i = 0; i < tokens; ++i) {
+        const auto logits = session.forward().logits;
+        last = static_cast<int>(std::max_element(logits.begin(), logits.end()) - logits.begin());
+        session.append(last);
+        context.push_back(last);
+        if (context.size() > window) {
+            session.evict(context.front());
+            context.pop_front();
+        }
+    }
+    return last;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t tokens = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    const std::size_t vocab = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 32768;
+    const std::size_t hidden = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 256;
+
+    ModelConfig config;
+    config.vocab_size = vocab;
+    config.hidden_size = hidden;
+    config.num_layers = 2;
+    const BaseDecoder base(config);
+    const std::size_t fp64_bytes = BaseDecoder(base).quantize(WeightPrecision::Float32).bytes_before;
+
+    std::printf("%zu tokens, vocab %zu, hidden %zu\n", tokens, vocab, hidden);
+    std::printf("%-7s %12s %12s %10s %14s\n", "weights", "tokens/s", "weight MB", "speedup", "max |dlogit|");
+    double baseline = 0.0;
+    for (WeightPrecision precision :
+         {WeightPrecision::Float64, WeightPrecision::Float32, WeightPrecision::Float16, WeightPrecision::Int8}) {
+        StudentModel student{base};
+        QuantizationReport report;
+        if (precision != WeightPrecision::Float64) {
+            report = student.base().quantize(precision);
+        }
+        const double seconds = bench::best_seconds([&] { bench::keep(decode(student, tokens)); });
+        const double throughput = static_cast<double>(tokens) / seconds;
+        if (precision == WeightPrecision::Float64) {
+            baseline = throughput;
+            report.bytes_after = fp64_bytes;
+        }
+        std::printf("%-7s %12.0f %12.1f %9.2fx %14.3g\n", precision_name(precision), throughput,
+                    static_cast<double>(report.bytes_after) / (1024.0 * 1024.0), throughput / baseline,
+                    report.max_abs_error);
+    }
+    return 0;
+}
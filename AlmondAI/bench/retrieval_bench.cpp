@@ -0,0 +1,204 @@
+#include "almondai/retrieval.hpp"
+
+#include "bench_support.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Synthetic corpus of Zipf-distributed CJK symbols (one word-tokenizer token
+// each). Ingests `documents` entries, a tenth of them re-using an earlier id,
+// then times top-3 queries against the postings index and against a full
+// scan that scores every live document, as the index did before postings.
+// Finally reports query throughput for 1 to 8 reader threads, alone and with
+// a writer re-ingesting existing ids, to show readers scale on snapshots.
+
+using namespace almondai;
+
+namespace {
+
+std::string utf8(char32_t codepoint) {
+    std::string out;
+    out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t documents = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::size_t queries = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+    constexpr std::size_t kSymbols = 2000;
+
+    std::mt19937 rng(99);
+    std::vector<double> weights(kSymbols);
+    for (std::size_t i = 0; i < kSymbols; ++i) {
+        weights[i] = 1.0 / static_cast<double>(i + 1);
+    }
+    std::discrete_distribution<std::size_t> symbol(weights.begin(), weights.end());
+    std::uniform_int_distribution<std::size_t> length(8, 48);
+    const auto make_text = [&](std::size_t size) {
+        std::string text;
+        for (std::size_t i = 0; i < size; ++i) {
+            text += utf8(static_cast<char32_t>(0x4E00 + symbol(rng)));
+        }
+        return text;
+    };
+
+    WordTokenizer tokenizer;
+    std::vector<std::string> alphabet;
+    for (std::size_t i = 0; i < kSymbols; ++i) {
+        alphabet.push_back(utf8(static_cast<char32_t>(0x4E00 + i)));
+    }
+    tokenizer.build_vocab(alphabet);
+
+    RetrievalIndex index(tokenizer);
+    ThreadPool pool;
+    std::vector<std::vector<std::pair<int, int>>> scan(documents - documents / 10);
+    std::vector<RetrievalIndex::PendingDocument> batch;
+    const auto ingest_start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < documents; ++i) {
+        // Every tenth ingest replaces an earlier document.
+        const std::size_t number = i % 10 == 9 ? i / 10 : i - i / 10;
+        std::string text = make_text(length(rng));
+        auto& counts = scan[number];
+        counts.clear();
+        for (int token : tokenizer.encode(text)) {
+            counts.emplace_back(token, 1);
+        }
+        std::sort(counts.begin(), counts.end());
+        std::size_t out = 0;
+        for (std::size_t j = 0; j < counts.size(); ++j) {
+            if (out > 0 && counts[out - 1].first == counts[j].first) {
+                ++counts[out - 1].second;
+            } else {
+                counts[out++] = counts[j];
+            }
+        }
+        counts.resize(out);
+        batch.push_back(RetrievalIndex::PendingDocument{"doc-" + std::to_string(number), std::move(text), {}});
+        if (batch.size() == 16384) {
+            index.ingest_documents(std::move(batch), pool);
+            batch.clear();
+        }
+    }
+    index.ingest_documents(std::move(batch), pool);
+    const double ingest_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - ingest_start).count();
+
+    std::vector<std::string> query_texts;
+    std::uniform_int_distribution<std::size_t> query_length(2, 6);
+    for (std::size_t q = 0; q < queries; ++q) {
+        query_texts.push_back(make_text(query_length(rng)));
+    }
+
+    const double indexed = bench::best_seconds([&] {
+        for (const auto& text : query_texts) {
+            bench::keep(index.query(text, 3).front().score);
+        }
+    }, 0.0, 1);
+
+    // Full scan with the same BM25 formula over every live document.
+    double total_length = 0.0;
+    std::vector<std::size_t> df(kSymbols + 16, 0);
+    std::vector<double> lengths(scan.size());
+    for (std::size_t d = 0; d < scan.size(); ++d) {
+        for (const auto& [token, count] : scan[d]) {
+            lengths[d] += count;
+            ++df[static_cast<std::size_t>(token)];
+        }
+        total_length += lengths[d];
+    }
+    const double avg_length = total_length / static_cast<double>(scan.size());
+    const std::size_t scanned_queries = std::min<std::size_t>(queries, 20);
+    const double scanned = bench::best_seconds([&] {
+        for (std::size_t q = 0; q < scanned_queries; ++q) {
+            const auto query_tokens = tokenizer.encode(query_texts[q]);
+            double best = 0.0;
+            for (std::size_t d = 0; d < scan.size(); ++d) {
+                const double norm = 1.2 * (0.25 + 0.75 * lengths[d] / avg_length);
+                double score = 0.0;
+                for (int token : query_tokens) {
+                    const auto found = std::lower_bound(scan[d].begin(), scan[d].end(), std::make_pair(token, 0));
+                    if (found != scan[d].end() && found->first == token) {
+                        const double n = static_cast<double>(df[static_cast<std::size_t>(token)]);
+                        const double idf = std::log(1.0 + (static_cast<double>(scan.size()) - n + 0.5) / (n + 0.5));
+                        score += idf * found->second * 2.2 / (found->second + norm);
+                    }
+                }
+                best = std::max(best, score);
+            }
+            bench::keep(best);
+        }
+    }, 0.0, 1);
+
+    std::printf("%zu ingests, %zu live documents, ingest %.1f s\n", documents, index.document_count(), ingest_seconds);
+    std::printf("  postings + MaxScore  %8.3f ms/query (%zu queries, top-3)\n",
+                indexed * 1e3 / static_cast<double>(queries), queries);
+    std::printf("  full scan            %8.3f ms/query (%zu queries)\n",
+                scanned * 1e3 / static_cast<double>(scanned_queries), scanned_queries);
+
+    // Every reader runs the whole query list; the writer replaces existing
+    // ids in small batches until the readers finish.
+    std::vector<std::string> replacements;
+    for (std::size_t i = 0; i < 4096; ++i) {
+        replacements.push_back(make_text(length(rng)));
+    }
+    std::printf("reader scaling (hardware threads: %u)\n", std::thread::hardware_concurrency());
+    for (const bool with_writer : {false, true}) {
+        for (const std::size_t readers : {1, 2, 4, 8}) {
+            std::atomic<bool> stop{false};
+            std::size_t replaced = 0;
+            std::thread writer;
+            if (with_writer) {
+                writer = std::thread([&] {
+                    ThreadPool writer_pool(1);
+                    while (!stop.load()) {
+                        std::vector<RetrievalIndex::PendingDocument> update;
+                        for (std::size_t j = 0; j < 64; ++j, ++replaced) {
+                            update.push_back(RetrievalIndex::PendingDocument{
+                                "doc-" + std::to_string((replaced * 7919) % scan.size()),
+                                replacements[replaced % replacements.size()],
+                                {}});
+                        }
+                        index.ingest_documents(std::move(update), writer_pool);
+                    }
+                });
+            }
+            const auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            for (std::size_t r = 0; r < readers; ++r) {
+                threads.emplace_back([&] {
+                    for (const auto& text : query_texts) {
+                        bench::keep(index.query(text, 3).front().score);
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            stop.store(true);
+            if (writer.joinable()) {
+                writer.join();
+            }
+            std::printf("  %zu reader(s)%-14s %10.0f queries/s", readers, with_writer ? " + writer" : "",
+                        static_cast<double>(readers * queries) / seconds);
+            if (with_writer) {
+                std::printf("  (%zu re-ingests)", replaced);
+            }
+            std::printf("\n");
+        }
+    }
+    return 0;
+}
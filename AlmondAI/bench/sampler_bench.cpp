@@ -0,0 +1,106 @@
+#include "almondai/sampler.hpp"
+
+#include "bench_support.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Time per drawn token for a top-k and a top-p setting at 8k, 32k and 256k
+// vocabularies, on peaked and near-flat logits. Compares Sampler's radix
+// select with the sort-based path it replaced: fresh vectors for every draw,
+// the whole vocabulary sorted by probability, then a discrete_distribution
+// over the kept tokens.
+
+using namespace almondai;
+
+namespace {
+
+int sort_sample(const std::vector<double>& logits, const SamplerSettings& settings, std::mt19937& rng) {
+    const double temperature = std::max(settings.temperature, 1e-3);
+    const double max_logit = *std::max_element(logits.begin(), logits.end());
+    std::vector<double> probabilities(logits.size());
+    double sum = 0.0;
+    for (std::size_t i = 0; i < logits.size(); ++i) {
+        probabilities[i] = std::exp((logits[i] - max_logit) / temperature);
+        sum += probabilities[i];
+    }
+    for (double& probability : probabilities) {
+        probability /= sum;
+    }
+
+    std::vector<std::size_t> order(probabilities.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+        return probabilities[lhs] > probabilities[rhs];
+    });
+    const std::size_t top_k = settings.top_k == 0 ? order.size() : std::min(settings.top_k, order.size());
+    std::vector<std::size_t> allowed;
+    std::vector<double> weights;
+    double cumulative = 0.0;
+    for (std::size_t i = 0; i < top_k; ++i) {
+        allowed.push_back(order[i]);
+        weights.push_back(probabilities[order[i]]);
+        cumulative += probabilities[order[i]];
+        if (cumulative >= settings.top_p) {
+            break;
+        }
+    }
+    std::discrete_distribution<std::size_t> draw(weights.begin(), weights.end());
+    return static_cast<int>(allowed[draw(rng)]);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8;
+
+    struct Setting {
+        const char* name;
+        SamplerSettings sampling;
+    };
+    const Setting settings[] = {
+        {"top-k 40", SamplerSettings{.temperature = 0.9, .top_k = 40}},
+        {"top-p 0.95", SamplerSettings{.temperature = 0.9, .top_p = 0.95}},
+    };
+    struct Shape {
+        const char* name;
+        double spread;
+    };
+    const Shape shapes[] = {{"peaked", 4.0}, {"flat", 0.05}};
+
+    std::printf("%-8s %-7s %-11s %12s %12s %9s\n", "vocab", "logits", "setting", "sort us/tok", "radix us/tok", "speedup");
+    for (std::size_t vocab : {std::size_t{8192}, std::size_t{32768}, std::size_t{262144}}) {
+        for (const Shape& shape : shapes) {
+            std::mt19937 rng(static_cast<unsigned>(vocab));
+            std::normal_distribution<double> logit(0.0, shape.spread);
+            std::vector<std::vector<double>> batch(rows, std::vector<double>(vocab));
+            for (auto& row : batch) {
+                for (double& value : row) {
+                    value = logit(rng);
+                }
+            }
+            for (const Setting& setting : settings) {
+                Sampler sampler;
+                const double sorted = bench::best_seconds([&] {
+                    for (const auto& row : batch) {
+                        bench::keep(sort_sample(row, setting.sampling, rng));
+                    }
+                });
+                const double radix = bench::best_seconds([&] {
+                    for (const auto& row : batch) {
+                        bench::keep(sampler.sample(row, setting.sampling, rng));
+                    }
+                });
+                const double per_row = 1e6 / static_cast<double>(rows);
+                std::printf("%-8zu %-7s %-11s %12.1f %12.1f %8.1fx\n", vocab, shape.name, setting.name,
+                            sorted * per_row, radix * per_row, sorted / radix);
+            }
+        }
+    }
+    return 0;
+}
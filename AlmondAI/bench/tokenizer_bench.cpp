@@ -0,0 +1,119 @@
+#include "almondai/tokenizer_bpe.hpp"
+#include "almondai/tokenizer_word.hpp"
+
+#include "bench_support.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// BpeTokenizer::encode throughput in tokens per second, first with the
+// character pieces ingesting the corpus adds to the fallback vocabulary, then
+// with a vocabulary file holding every corpus word and its "##" suffixes, so
+// the trie walks find long pieces. WordTokenizer::encode (one token per code
+// point) follows on the same texts, and on a mixed Latin-1, CJK and emoji
+// corpus whose short ASCII runs keep leaving the SSE2 scan. Pass a JSONL or
+// text file to encode its lines instead of the synthetic corpus.
+
+using namespace almondai;
+
+namespace {
+
+template <typename Tokenizer>
+void report(const char* name, const Tokenizer& tokenizer, const std::vector<std::string>& texts) {
+    std::size_t tokens = 0;
+    for (const auto& text : texts) {
+        tokens += tokenizer.encode(text).size();
+    }
+    const double seconds = bench::best_seconds([&] {
+        for (const auto& text : texts) {
+            bench::keep(static_cast<double>(tokenizer.encode(text).size()));
+        }
+    });
+    std::printf("  %-28s vocab %6zu  %8zu tokens  %6.2f Mtok/s\n",
+                name, tokenizer.vocab_size(), tokens, static_cast<double>(tokens) / seconds / 1e6);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<std::string> texts;
+    if (argc > 1) {
+        std::ifstream file(argv[1]);
+        for (std::string line; std::getline(file, line);) {
+            texts.push_back(std::move(line));
+        }
+    } else {
+        static const char* kWords[] = {"template", "typename", "vector", "allocator", "constexpr", "iterator",
+                                       "the", "model", "learns", "from", "teacher", "outputs", "quickly",
+                                       "std::move", "value->next", "size()", "tokens[i]", "x == y"};
+        std::mt19937 rng(3);
+        std::uniform_int_distribution<std::size_t> word(0, std::size(kWords) - 1);
+        for (int i = 0; i < 4000; ++i) {
+            std::string text;
+            for (int w = 0; w < 24; ++w) {
+                text += kWords[word(rng)];
+                text += w % 8 == 7 ? '\n' : ' ';
+            }
+            texts.push_back(std::move(text));
+        }
+    }
+
+    BpeTokenizer characters;
+    characters.load("");
+    for (const auto& text : texts) {
+        characters.ingest_training_pair(text, std::string());
+    }
+    report("character pieces", characters, texts);
+
+    std::set<std::string> pieces;
+    for (const auto& text : texts) {
+        std::istringstream stream(text);
+        for (std::string w; stream >> w;) {
+            pieces.insert(w);
+            for (std::size_t start = 1; start + 1 < w.size(); ++start) {
+                pieces.insert("##" + w.substr(start));
+            }
+        }
+    }
+    const auto vocab_path = std::filesystem::temp_directory_path() / "almondai_tokenizer_bench_vocab.txt";
+    {
+        std::ofstream vocab(vocab_path);
+        for (const auto& piece : pieces) {
+            vocab << piece << '\n';
+        }
+    }
+    BpeTokenizer words;
+    words.load(vocab_path);
+    for (const auto& text : texts) {
+        words.ingest_training_pair(text, std::string());
+    }
+    std::filesystem::remove(vocab_path);
+    report("word and suffix pieces", words, texts);
+
+    WordTokenizer code_points;
+    code_points.build_vocab(texts);
+    report("word tokenizer", code_points, texts);
+
+    static const char* kMixed[] = {"caf\xc3\xa9", "na\xc3\xafve", "stra\xc3\x9f" "e", "\xe4\xb8\xad\xe6\x96\x87",
+                                   "\xe6\xa8\xa1\xe5\x9e\x8b", "\xf0\x9f\x98\x80", "it\xe2\x80\x99s", "token", "x"};
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<std::size_t> mixed_word(0, std::size(kMixed) - 1);
+    std::vector<std::string> mixed;
+    for (std::size_t i = 0; i < texts.size(); ++i) {
+        std::string text;
+        for (int w = 0; w < 24; ++w) {
+            text += kMixed[mixed_word(rng)];
+            text += ' ';
+        }
+        mixed.push_back(std::move(text));
+    }
+    code_points.build_vocab(mixed);
+    report("word tokenizer, mixed script", code_points, mixed);
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include "trainer.hpp"
 #include "tokenizer_coordinator.hpp"
 #include "governor.hpp"
+#include "near_duplicate.hpp"
 
 #include <filesystem>
 #include <functional>
@@ -66,7 +67,9 @@ private:
     std::filesystem::path m_mutation_ledger_path;
     std::filesystem::path m_telemetry_ledger_path;
 
-    std::deque<std::string> m_recent_outputs;
+    // Index ids of the most recent accepted outputs, oldest first.
+    std::deque<std::size_t> m_recent_outputs;
+    NearDuplicateIndex m_recent_index;
     std::size_t m_pending_since_train = 0;
     std::size_t m_last_eval_step = 0;
     double m_best_eval_perplexity = std::numeric_limits<double>::infinity();
@@ -84,7 +87,7 @@ private:
     GateDecision gate_sample(const TrainingExample& sample) const;
     bool violates_forbidden_regex(const std::string& text) const;
     bool contains_pii(const std::string& text) const;
-    double max_similarity_against_recent(const std::string& text) const;
+    double max_similarity_against_recent(const std::string& text, double threshold) const;
     void remember_output(const std::string& text);
     std::uint64_t fnv1a_hash(const std::string& text) const;
     void record_mutation_decision(const TrainingExample& sample, const GateDecision& decision);
@@ -3,6 +3,7 @@
 #include "../json.hpp"
 #include "../net/http.hpp"
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -14,9 +15,21 @@ struct Message {
     std::string text;
 };
 
+using DeltaCallback = std::function<void(const std::string&)>;
+
 struct Backend {
     virtual ~Backend() = default;
     virtual std::string complete(const std::vector<Message>& messages) = 0;
+
+    // Calls on_delta with each piece of the reply as it arrives and returns the
+    // whole reply. Backends without incremental output deliver it in one piece.
+    virtual std::string complete_stream(const std::vector<Message>& messages, const DeltaCallback& on_delta) {
+        std::string reply = complete(messages);
+        if (!reply.empty()) {
+            on_delta(reply);
+        }
+        return reply;
+    }
 };
 
 using BackendPtr = std::unique_ptr<Backend>;
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "model.hpp"
+#include "tokenizer_coordinator.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace almondai {
+
+// Background writer for student weights and tokenizer files. Callers report
+// every state change; a snapshot of the weights and tokenizer vocabularies is
+// taken and queued only when the policy says a write is due, and a queued snapshot that has not started is replaced by a
+// newer one. Files are written to a temporary sibling and renamed into place.
+class CheckpointWriter {
+public:
+    struct Targets {
+        std::filesystem::path json_weights;
+        std::filesystem::path binary_weights;
+        TokenizerCoordinator* tokenizers = nullptr;
+    };
+
+    struct Policy {
+        std::size_t step_interval = 100;
+        std::chrono::milliseconds time_interval{60000};
+        // Versioned tokenizer snapshots (*.stepNNNNNN) kept per file.
+        std::size_t retention = 5;
+    };
+
+    struct Status {
+        std::size_t writes_completed = 0;
+        std::optional<std::size_t> last_step;
+        bool last_write_ok = true;
+        bool dirty = false;
+    };
+
+    explicit CheckpointWriter(Targets targets);
+    CheckpointWriter(Targets targets, Policy policy);
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    void set_policy(Policy policy);
+
+    // Returns true when a snapshot was queued.
+    bool request(const BaseDecoder& decoder, std::optional<std::size_t> step);
+    // Snapshots immediately and blocks until that snapshot is on disk.
+    bool flush(const BaseDecoder& decoder, std::optional<std::size_t> step);
+
+    Status status() const;
+
+private:
+    struct Job {
+        BaseDecoder snapshot;
+        std::optional<TokenizerCoordinator::Snapshot> tokenizers;
+        std::optional<std::size_t> step;
+        std::size_t generation = 0;
+    };
+
+    Targets m_targets;
+    Policy m_policy;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_work_ready;
+    std::condition_variable m_work_done;
+    std::optional<Job> m_pending;
+    bool m_stopping = false;
+    bool m_dirty = false;
+    std::size_t m_next_generation = 1;
+    std::size_t m_completed_generation = 0;
+    std::size_t m_writes_completed = 0;
+    bool m_last_write_ok = true;
+    std::optional<std::size_t> m_last_step;
+    std::size_t m_last_queued_step = 0;
+    std::chrono::steady_clock::time_point m_last_queued_at;
+    std::thread m_worker;
+
+    std::size_t enqueue_locked(const BaseDecoder& decoder, std::optional<std::size_t> step);
+    void run();
+    bool write(const Job& job) const;
+};
+
+} // namespace almondai
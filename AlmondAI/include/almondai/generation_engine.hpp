@@ -0,0 +1,89 @@
+#pragma once
+
+#include "model.hpp"
+#include "sampler.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace almondai {
+
+struct GenerationRequest {
+    std::vector<int> prompt;
+    int max_tokens = 128;
+    // `eos_token` is not drawn until this many tokens have been generated.
+    int min_tokens = 0;
+    int eos_token = -1;
+    SamplerSettings sampling;
+    std::mt19937 rng;
+};
+
+// Decodes concurrent requests against one student model together. Each step
+// pools every active sequence, runs the whole batch through the layers and the
+// output projection as one matrix product, then samples each row with that
+// request's own settings. Requests join and leave between steps, so a short
+// request never waits for a long one to finish.
+//
+// The model is read without locking: callers must keep it unchanged while any
+// of their requests are being generated.
+class GenerationEngine {
+public:
+    struct Options {
+        // Sequences stepped together; further requests wait for a free row.
+        std::size_t max_batch = 32;
+    };
+
+    struct Stats {
+        std::size_t requests = 0;
+        std::size_t steps = 0;
+        std::size_t tokens = 0;
+        std::size_t peak_batch = 0;
+    };
+
+    explicit GenerationEngine(const StudentModel& model);
+    GenerationEngine(const StudentModel& model, Options options);
+    ~GenerationEngine();
+
+    GenerationEngine(const GenerationEngine&) = delete;
+    GenerationEngine& operator=(const GenerationEngine&) = delete;
+
+    // Blocks until the request finishes and returns the generated tokens,
+    // without the end token. `on_token` runs on the calling thread as tokens
+    // arrive; if it throws, the request is dropped before the exception
+    // propagates.
+    std::vector<int> generate(GenerationRequest request, const std::function<void(int)>& on_token = {});
+
+    Stats stats() const;
+
+private:
+    struct Sequence;
+
+    const StudentModel* m_model;
+    Options m_options;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_work_ready;
+    std::deque<std::shared_ptr<Sequence>> m_waiting;
+    bool m_stopping = false;
+    Stats m_stats;
+
+    // Touched only by the worker.
+    Sampler m_sampler;
+    std::vector<double> m_pooled;
+    std::vector<double> m_logits;
+
+    std::thread m_worker;
+
+    void run();
+    // Advances every sequence by one token; returns the tokens appended.
+    std::size_t step(const std::vector<std::shared_ptr<Sequence>>& active);
+};
+
+} // namespace almondai
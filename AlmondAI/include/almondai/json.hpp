@@ -46,22 +46,19 @@ public:
     std::string& as_string() { return std::get<std::string>(m_value); }
 
     std::string dump() const {
-        std::ostringstream oss;
-        dump_internal(oss);
-        return oss.str();
+        std::string out;
+        dump_to(out);
+        return out;
     }
 
+    // Appends the serialized value, so hot loops can reuse one buffer.
+    // Numbers use the shortest representation that round-trips exactly.
+    void dump_to(std::string& out) const;
+
     static Json parse(std::string_view text);
 
 private:
     Value m_value;
-
-    void dump_internal(std::ostringstream& oss) const;
-    static void skip_ws(std::string_view text, std::size_t& pos);
-    static Json parse_value(std::string_view text, std::size_t& pos);
-    static Json parse_string(std::string_view text, std::size_t& pos);
-    static Json parse_array(std::string_view text, std::size_t& pos);
-    static Json parse_object(std::string_view text, std::size_t& pos);
 };
 
 } // namespace almondai
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "mapped_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace almondai {
+
+// Line index over an append-only JSONL file. The byte offset, length and
+// FNV-1a hash of every complete line are kept in a binary sidecar next to the
+// file (<file>.idx), so paging to line N is a lookup instead of a scan. Each
+// access checks the file against the index: appended lines are indexed
+// incrementally, anything else (truncation, a rewrite) rebuilds it.
+//
+// The learner's own files are shared through shared(): every reader of a path
+// gets one instance, and with it one memory mapping of the file. Other files
+// (e.g. paths named by a client) get a private instance with
+// persist_sidecar = false, which indexes in memory and writes nothing next to
+// the file.
+class JsonlIndex {
+public:
+    struct Record {
+        std::uint64_t offset = 0;
+        // Excludes the newline.
+        std::uint32_t length = 0;
+        std::uint64_t hash = 0;
+    };
+
+    struct Line {
+        // Zero-based line number, counting empty lines.
+        std::size_t number = 0;
+        std::string text;
+        // False for a final line with no newline after it.
+        bool terminated = true;
+    };
+
+    using LineVisitor = std::function<void(std::size_t number, std::string_view text)>;
+
+    explicit JsonlIndex(std::filesystem::path path, bool persist_sidecar = true);
+
+    JsonlIndex(const JsonlIndex&) = delete;
+    JsonlIndex& operator=(const JsonlIndex&) = delete;
+
+    // At most kMaxShared instances are kept; beyond that the least recently
+    // requested ones nobody else holds are dropped, releasing their mappings.
+    static constexpr std::size_t kMaxShared = 8;
+    static std::shared_ptr<JsonlIndex> shared(const std::filesystem::path& path);
+    static std::filesystem::path sidecar_path(const std::filesystem::path& path);
+
+    const std::filesystem::path& path() const noexcept { return m_path; }
+
+    // False when the file does not exist or cannot be read.
+    bool exists();
+    // A trailing line without a newline counts, as it does for std::getline.
+    std::size_t line_count();
+    std::size_t non_empty_count();
+    std::optional<Record> record(std::size_t line);
+
+    // Up to `count` lines starting at line `first`.
+    std::vector<Line> read(std::size_t first, std::size_t count);
+    // Visits every line of the current contents without holding the index
+    // lock, so `visit` may append to the same file; appended lines are not
+    // visited.
+    void for_each(const LineVisitor& visit);
+    // The current contents, or null when the file cannot be read. The mapping
+    // stays valid for as long as it is held, appends included.
+    std::shared_ptr<const MappedFile> contents();
+
+    // Appends `line` plus a newline and indexes it.
+    bool append(std::string_view line);
+
+private:
+    std::filesystem::path m_path;
+    bool m_persist_sidecar = true;
+    std::mutex m_mutex;
+    std::shared_ptr<const MappedFile> m_mapping;
+    std::uintmax_t m_file_size = 0;
+    std::filesystem::file_time_type m_file_time{};
+    bool m_present = false;
+    bool m_sidecar_loaded = false;
+    std::vector<Record> m_records;
+    // A final line without a newline; never written to the sidecar.
+    std::optional<Record> m_tail;
+    std::size_t m_non_empty = 0;
+    // Records already in the sidecar; a stale sidecar is rewritten in full.
+    std::size_t m_persisted = 0;
+    bool m_sidecar_stale = false;
+
+    bool sync_locked();
+    std::size_t line_count_locked() const;
+    const Record* record_locked(std::size_t line) const;
+    void load_sidecar_locked();
+    void write_sidecar_locked();
+    void reset_locked();
+};
+
+} // namespace almondai
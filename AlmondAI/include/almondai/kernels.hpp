@@ -0,0 +1,104 @@
+#pragma once
+
+#include "tensor.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace almondai::kernels {
+
+enum class Isa {
+    Scalar,
+    Avx2,
+    Avx512
+};
+
+// Instruction set picked at first use from CPU feature detection. Setting
+// ALMONDAI_KERNELS=scalar|avx2|avx512 caps the selection for debugging.
+Isa active_isa() noexcept;
+const char* isa_name(Isa isa) noexcept;
+
+// Row-major kernels. vecmat and matmul accumulate every output element over k in
+// ascending order with separate multiply and add, so all ISA paths and the
+// batched and single-row variants produce identical results. dot sums in eight
+// interleaved lanes folded pairwise, on every path; it matches across ISAs but
+// differs from a sequential loop by rounding.
+
+// y[n] = sum_k x[k] * w[k * cols + n]
+void vecmat(const double* x, const double* w, double* y, std::size_t rows, std::size_t cols);
+// y[m * cols + n] = sum_k x[m * inner + k] * w[k * cols + n]
+void matmul(const double* x, const double* w, double* y,
+            std::size_t batch, std::size_t inner, std::size_t cols);
+double dot(const double* a, const double* b, std::size_t n);
+// y += alpha * x
+void axpy(double alpha, const double* x, double* y, std::size_t n);
+
+// fp32 storage variants. Values are widened to double and all arithmetic is
+// done in double, so vecmat, matmul and dot over float weights equal the fp64
+// kernels on the widened weights, on every ISA path. Updates to float storage
+// round once on store.
+void vecmat(const double* x, const float* w, double* y, std::size_t rows, std::size_t cols);
+void matmul(const double* x, const float* w, double* y,
+            std::size_t batch, std::size_t inner, std::size_t cols);
+double dot(const float* a, const double* b, std::size_t n);
+void axpy(double alpha, const double* x, float* y, std::size_t n);
+
+// Per-step AdamW constants; bias corrections are 1 - beta^t, computed once per step.
+struct AdamWStep {
+    double learning_rate = 0.0;
+    double beta1 = 0.9;
+    double beta2 = 0.999;
+    double epsilon = 1e-8;
+    double weight_decay = 0.0;
+    double bias_correction1 = 1.0;
+    double bias_correction2 = 1.0;
+};
+
+// Fused AdamW update over n parameters. Moment math is done in double; the
+// fp32 and bf16 overloads round the stored moments (bf16 to nearest even) and
+// float parameters are rounded after the update.
+// Every ISA path performs the same operations, so results match the scalar path.
+void adamw_step(const AdamWStep& step, double* params, const double* grads, double* m, double* v, std::size_t n);
+void adamw_step(const AdamWStep& step, double* params, const double* grads, float* m, float* v, std::size_t n);
+void adamw_step_bf16(const AdamWStep& step, double* params, const double* grads,
+                     std::uint16_t* m, std::uint16_t* v, std::size_t n);
+void adamw_step(const AdamWStep& step, float* params, const double* grads, double* m, double* v, std::size_t n);
+void adamw_step(const AdamWStep& step, float* params, const double* grads, float* m, float* v, std::size_t n);
+void adamw_step_bf16(const AdamWStep& step, float* params, const double* grads,
+                     std::uint16_t* m, std::uint16_t* v, std::size_t n);
+
+// y[i] = exp((x[i] - shift) * scale), returning the sum of y; x and y may
+// alias. Arguments below -708 give 0. Every ISA path computes the same
+// elements and the same sum.
+double exp_sum(const double* x, double shift, double scale, double* y, std::size_t n);
+
+double bf16_to_double(std::uint16_t value) noexcept;
+std::uint16_t double_to_bf16(double value) noexcept;
+
+// Weight-only quantized kernels. Int8 weights carry one float scale per
+// kQuantGroup consecutive elements of a row, laid out [rows, ceil(cols / kQuantGroup)].
+// Dequantized values are exact in double, so matmul_q8 and matmul_f16 give the
+// same results as matmul on the dequantized weights, on every ISA path.
+inline constexpr std::size_t kQuantGroup = 64;
+
+// y = dequantized x, where x and scales start on a group boundary.
+void dequantize_q8(const std::int8_t* x, const float* scales, double* y, std::size_t n);
+void dequantize_f16(const std::uint16_t* x, double* y, std::size_t n);
+// matmul over an int8 or fp16 [inner, cols] weight.
+void matmul_q8(const double* x, const std::int8_t* w, const float* scales, double* y,
+               std::size_t batch, std::size_t inner, std::size_t cols);
+void matmul_f16(const double* x, const std::uint16_t* w, double* y,
+                std::size_t batch, std::size_t inner, std::size_t cols);
+
+// IEEE binary16, rounded to nearest even and saturated at +-65504.
+double fp16_to_double(std::uint16_t value) noexcept;
+std::uint16_t double_to_fp16(double value) noexcept;
+
+// Tensor overloads for a rank-2 fp64 or fp32 weight of shape [inner, cols].
+template <typename T>
+void vecmat(std::span<const double> x, const BasicTensor<T>& weight, std::span<double> y);
+template <typename T>
+void matmul(std::span<const double> x, std::size_t batch, const BasicTensor<T>& weight, std::span<double> y);
+
+} // namespace almondai::kernels
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+namespace almondai {
+
+// Read-only view of a file. Uses mmap/MapViewOfFile where available and falls
+// back to reading the file into an owned buffer otherwise.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::filesystem::path& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::filesystem::path& path);
+    void close() noexcept;
+
+    bool is_open() const noexcept { return m_data != nullptr || m_open_empty; }
+    bool is_mapped() const noexcept { return m_mapped; }
+    const char* data() const noexcept { return m_data; }
+    std::size_t size() const noexcept { return m_size; }
+    std::string_view view() const noexcept { return std::string_view(m_data, m_size); }
+
+private:
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_mapped = false;
+    bool m_open_empty = false;
+    std::vector<char> m_fallback;
+#if defined(_WIN32)
+    void* m_file_handle = nullptr;
+    void* m_mapping_handle = nullptr;
+#endif
+
+    void move_from(MappedFile& other) noexcept;
+};
+
+} // namespace almondai
@@ -2,6 +2,7 @@
 
 #include "json.hpp"
 #include "chat/backend.hpp"
+#include "teacher_cache.hpp"
 
 #include <string>
 #include <optional>
@@ -21,14 +22,25 @@ public:
     std::optional<Request> read_request(std::istream& in) const;
     void send_response(std::ostream& out, const std::string& id, const Json& result) const;
     void send_error(std::ostream& out, const std::string& id, const std::string& message) const;
+    // Partial output for a streaming request; the final response follows as usual.
+    // `reset` tells the client to discard the deltas received so far.
+    void send_delta(std::ostream& out, const std::string& id, const std::string& delta, bool reset = false) const;
 
     Json call(const std::string& method, Json params);
 
     void set_chat_backend(chat::Backend* backend) noexcept { m_chat_backend = backend; }
     chat::Backend* chat_backend() const noexcept { return m_chat_backend; }
 
+    // gpt.generate answers repeated prompts from `cache` when one is set.
+    void set_teacher_cache(TeacherCache* cache, std::string scope) {
+        m_teacher_cache = cache;
+        m_teacher_scope = std::move(scope);
+    }
+
 private:
     chat::Backend* m_chat_backend = nullptr;
+    TeacherCache* m_teacher_cache = nullptr;
+    std::string m_teacher_scope;
 };
 
 } // namespace almondai
@@ -1,8 +1,10 @@
 #pragma once
 
+#include "quantize.hpp"
 #include "tensor.hpp"
 
 #include <vector>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <optional>
@@ -15,6 +17,9 @@ struct ModelConfig {
     std::size_t num_layers = 2;
     std::size_t context_length = 256;
     double learning_rate = 1e-3;
+    // Storage of the trainable weights, Float64 or Float32. Activations,
+    // gradients and every sum stay in double either way.
+    WeightPrecision precision = WeightPrecision::Float64;
 };
 
 class Adapter;
@@ -33,34 +38,115 @@ public:
     };
 
     ForwardResult forward(const std::vector<int>& tokens) const;
+    // Runs many contexts through each layer as one matrix product.
+    std::vector<ForwardResult> forward(std::span<const std::vector<int>> batch) const;
+    // Runs the layers, adapter and projection on an already mean-pooled embedding.
+    ForwardResult forward_pooled(std::vector<double> pooled) const;
+    // Batched forward_pooled over `count` rows of pooled embeddings that only
+    // keeps the logits, as a count x vocab matrix.
+    void forward_pooled(std::vector<double> pooled, std::size_t count, std::vector<double>& logits) const;
+    // `row` is scratch for dequantizing a quantized embedding row; reuse one
+    // buffer across calls so the hot path does not allocate per token.
+    void accumulate_embedding(int token, std::vector<double>& sum, std::vector<double>& row) const;
+    void remove_embedding(int token, std::vector<double>& sum, std::vector<double>& row) const;
     std::vector<double> apply_gradients(const std::vector<double>& hidden,
                                        const std::vector<double>& grad_logits);
 
-    const std::vector<Tensor>& weights() const noexcept { return m_weights; }
-    std::vector<Tensor>& mutable_weights() noexcept { return m_weights; }
-    Tensor& output_projection() noexcept { return m_weights.back(); }
-    const Tensor& output_projection() const noexcept { return m_weights.back(); }
+    // Calls `visitor` with the weight list in its storage type, a
+    // std::vector<Tensor> or a std::vector<FloatTensor>. The output projection
+    // is the last entry. Tensors are empty while the decoder is quantized.
+    template <typename Visitor>
+    decltype(auto) visit_weights(Visitor&& visitor) {
+        if (m_config.precision == WeightPrecision::Float32) {
+            return visitor(m_weights_f32);
+        }
+        return visitor(m_weights);
+    }
+    template <typename Visitor>
+    decltype(auto) visit_weights(Visitor&& visitor) const {
+        if (m_config.precision == WeightPrecision::Float32) {
+            return visitor(m_weights_f32);
+        }
+        return visitor(m_weights);
+    }
+    // Converts the trainable weights between fp64 and fp32 storage. Loading
+    // and vocabulary growth keep the current storage type.
+    void set_precision(WeightPrecision precision);
 
     bool save_weights(const std::string& path) const;
     bool load_weights(const std::string& path);
+    bool save_weights_binary(const std::string& path) const;
+    bool load_weights_binary(const std::string& path);
     void resize_vocab(std::size_t new_vocab_size);
 
     void attach_adapter(const Adapter* adapter);
     const Adapter* active_adapter() const noexcept { return m_active_adapter; }
 
+    // Swaps the weights for an fp16 or int8 copy and frees the trainable
+    // tensors. The decoder then only runs inference: saving returns false and
+    // training, vocabulary growth and require_trainable() throw until weights
+    // are loaded again. Float32 calls set_precision() instead and stays
+    // trainable. The report compares logits on fixed probe contexts.
+    QuantizationReport quantize(WeightPrecision precision);
+    WeightPrecision precision() const noexcept;
+    bool quantized() const noexcept { return !m_quantized.empty(); }
+    void require_trainable() const;
+
 private:
     ModelConfig m_config;
     std::vector<Tensor> m_weights;
+    // Holds the weights instead of m_weights with fp32 storage.
+    std::vector<FloatTensor> m_weights_f32;
+    // Parallel to the weights when quantized.
+    std::vector<QuantizedMatrix> m_quantized;
     const Adapter* m_active_adapter = nullptr;
 
     std::vector<double> forward_layer(std::size_t layer, const std::vector<double>& input) const;
+    // Runs `count` rows through every layer in place.
+    void forward_layers(std::vector<double>& activations, std::size_t count) const;
+    // y = x * m_weights[index] for `count` rows, from whichever copy is live.
+    void multiply(std::size_t index, const double* x, std::size_t count, double* y) const;
+    std::size_t projection_index() const;
 };
 
+// Incremental decode state: keeps the running embedding sum of the context so each
+// appended token costs O(hidden) before the layers instead of re-pooling the prefix.
+// Produces the same logits as BaseDecoder::forward on the full token list.
+class DecodeSession {
+public:
+    explicit DecodeSession(const BaseDecoder& decoder);
+
+    void reset();
+    void append(int token);
+    void append(const std::vector<int>& tokens);
+    // Drops a token that left the front of the context window. Subtraction can
+    // drift slightly from a fresh sum; callers that evict often should reset().
+    void evict(int token);
+    BaseDecoder::ForwardResult forward() const;
+    // Writes the mean-pooled context embedding (zeros for an empty context).
+    void pooled(std::span<double> out) const;
+
+    std::size_t token_count() const noexcept { return m_token_count; }
+
+private:
+    const BaseDecoder* m_decoder;
+    std::vector<double> m_embedding_sum;
+    std::vector<double> m_row;
+    std::size_t m_token_count = 0;
+};
+
+// True when the file starts with the binary checkpoint magic.
+bool is_binary_checkpoint(const std::string& path);
+// Converts between the JSON and binary checkpoint formats; the output format is
+// the opposite of whatever the input file contains.
+bool convert_checkpoint(const std::string& input_path, const std::string& output_path);
+
 class StudentModel {
 public:
     explicit StudentModel(BaseDecoder base);
 
     BaseDecoder::ForwardResult forward(const std::vector<int>& tokens) const;
+    DecodeSession start_session(const std::vector<int>& prompt) const;
     std::vector<double> update(const std::vector<double>& hidden,
                                const std::vector<double>& grad_logits);
 
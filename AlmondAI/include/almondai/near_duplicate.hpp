@@ -0,0 +1,75 @@
+#pragma once
+
+#include "tokenizer_bpe.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace almondai {
+
+// MinHash + LSH banding index over token-id sets. Candidates come from band
+// collisions and are verified with exact Jaccard, so reported similarities are
+// exact; pairs far below the band threshold may be missed.
+class NearDuplicateIndex {
+public:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    struct Options {
+        std::size_t bands = 32;
+        std::size_t rows_per_band = 4;
+        std::uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    };
+
+    struct Match {
+        std::size_t id = npos;
+        double similarity = 0.0;
+    };
+
+    NearDuplicateIndex();
+    explicit NearDuplicateIndex(Options options);
+
+    // Sorted, deduplicated BPE ids of text without padding and EOS markers.
+    static std::vector<int> token_set(const BpeTokenizer& tokenizer, std::string_view text);
+
+    // Entries may be any token ids; they are sorted and deduplicated on insert.
+    // Ids of erased entries are reused.
+    std::size_t insert(std::vector<int> tokens);
+    void erase(std::size_t id);
+    void clear();
+
+    std::size_t size() const noexcept { return m_live; }
+
+    Match nearest(std::vector<int> tokens) const;
+    Match nearest_to(std::size_t id) const;
+    // Like nearest, but scans every live entry unless an LSH candidate is
+    // already above threshold. The result is the true nearest entry whenever
+    // its similarity is at most threshold; linear in size(), so meant for
+    // small indexes.
+    Match nearest_exact(std::vector<int> tokens, double threshold) const;
+
+private:
+    struct Entry {
+        std::vector<int> tokens;
+        std::vector<std::uint64_t> band_keys;
+        bool live = false;
+    };
+
+    Options m_options;
+    std::vector<std::uint64_t> m_hash_seeds;
+    std::vector<Entry> m_entries;
+    std::vector<std::size_t> m_free;
+    std::vector<std::unordered_map<std::uint64_t, std::vector<std::size_t>>> m_buckets;
+    std::size_t m_live = 0;
+
+    std::vector<std::uint64_t> band_keys(const std::vector<int>& tokens) const;
+    std::size_t store(std::vector<int> tokens, std::vector<std::uint64_t> keys);
+    Match best_candidate(const std::vector<int>& tokens,
+                         const std::vector<std::uint64_t>& keys,
+                         std::size_t exclude) const;
+};
+
+} // namespace almondai
@@ -1,15 +1,82 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 namespace almondai::net {
 
+using HeaderList = std::vector<std::pair<std::string, std::string>>;
+using ChunkCallback = std::function<void(std::string_view)>;
+
+struct HttpResponse {
+    long status = 0;
+    std::string body;
+    double latency_ms = 0.0;
+    bool reused_connection = false;
+};
+
+struct HttpClientStats {
+    std::size_t requests = 0;
+    std::size_t failures = 0;
+    std::size_t in_flight = 0;
+    std::size_t connections_opened = 0;
+    std::size_t connections_reused = 0;
+    double total_latency_ms = 0.0;
+    double max_latency_ms = 0.0;
+};
+
+// Persistent client driven by one curl_multi event-loop thread. Connections are
+// kept alive and reused per host, and DNS results and TLS sessions are shared
+// across transfers, so repeated calls to the same backend skip the handshake.
+class HttpClient {
+public:
+    struct Options {
+        long max_connections_per_host = 8;
+        long max_total_connections = 64;
+    };
+
+    HttpClient();
+    explicit HttpClient(Options options);
+    ~HttpClient();
+
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    // Process-wide client used by post_json.
+    static HttpClient& shared();
+
+    // Transfer errors and non-2xx statuses surface as std::runtime_error from the future.
+    std::future<HttpResponse> post_async(std::string url,
+                                         std::string body,
+                                         const HeaderList& headers,
+                                         long timeout_ms = -1);
+    HttpResponse post(std::string url, std::string body, const HeaderList& headers, long timeout_ms = -1);
+    // Delivers a 2xx body to on_chunk as it arrives instead of collecting it in
+    // HttpResponse::body. on_chunk runs on the client's event-loop thread and
+    // should return quickly; an exception from it aborts the transfer and is
+    // rethrown here.
+    HttpResponse post_stream(std::string url,
+                             std::string body,
+                             const HeaderList& headers,
+                             ChunkCallback on_chunk,
+                             long timeout_ms = -1);
+
+    HttpClientStats stats() const;
+
+private:
+    struct State;
+    std::unique_ptr<State> m_state;
+};
+
 std::string post_json(const std::string& url,
                       const std::string& body,
-                      const std::vector<std::pair<std::string, std::string>>& headers,
+                      const HeaderList& headers,
                       long timeout_ms = -1);
 
 } // namespace almondai::net
-
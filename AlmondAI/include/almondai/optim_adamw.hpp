@@ -1,18 +1,34 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 
 namespace almondai {
 
+class ThreadPool;
+
+namespace kernels {
+struct AdamWStep;
+}
+
 class AdamWOptimizer {
 public:
+    // Storage type of the first and second moments. Updates are computed in
+    // double either way; narrower types trade precision for 2x/4x less state.
+    enum class MomentPrecision {
+        Float64,
+        Float32,
+        BFloat16
+    };
+
     struct Params {
         double learning_rate = 3e-4;
         double beta1 = 0.9;
         double beta2 = 0.98;
         double epsilon = 1e-8;
         double weight_decay = 0.01;
+        MomentPrecision moment_precision = MomentPrecision::Float64;
     };
 
     AdamWOptimizer() = default;
@@ -20,22 +36,50 @@ public:
     AdamWOptimizer(std::size_t parameter_count, Params params);
 
     void reset(std::size_t parameter_count);
-    void set_params(Params params) { m_params = params; }
+    // Changing moment_precision converts the existing moments.
+    void set_params(Params params);
     const Params& params() const noexcept { return m_params; }
 
+    // Steps over large parameter vectors are split across the pool; the pool is
+    // not owned and must outlive the optimizer or be cleared first.
+    void set_thread_pool(ThreadPool* pool) noexcept { m_pool = pool; }
+
+    // fp32 parameters are updated in double and rounded once per step.
     void step(std::vector<double>& parameters,
               const std::vector<double>& gradients,
               double learning_rate_scale = 1.0);
+    void step(std::vector<float>& parameters,
+              const std::vector<double>& gradients,
+              double learning_rate_scale = 1.0);
 
     void zero_state();
     std::size_t step_index() const noexcept { return m_step; }
+    std::size_t state_bytes() const noexcept;
 
 private:
     Params m_params;
+    std::size_t m_parameter_count = 0;
     std::vector<double> m_moment1;
     std::vector<double> m_moment2;
+    std::vector<float> m_moment1_f32;
+    std::vector<float> m_moment2_f32;
+    std::vector<std::uint16_t> m_moment1_bf16;
+    std::vector<std::uint16_t> m_moment2_bf16;
     std::size_t m_step = 0;
+    ThreadPool* m_pool = nullptr;
+
+    void allocate_state();
+    std::vector<double> export_moments(bool second) const;
+    template <typename Param>
+    void step_parameters(std::vector<Param>& parameters,
+                         const std::vector<double>& gradients,
+                         double learning_rate_scale);
+    template <typename Param>
+    void update_range(const kernels::AdamWStep& constants,
+                      Param* parameters,
+                      const double* gradients,
+                      std::size_t begin,
+                      std::size_t end);
 };
 
 } // namespace almondai
-
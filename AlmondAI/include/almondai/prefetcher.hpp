@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace almondai {
+
+// Fetches results for a fixed sequence of items on a few worker threads while
+// the caller consumes them in order; train.self_loop uses it to request
+// teacher outputs ahead of training. At most `depth` fetches run or wait ahead
+// of the consumer, and fetch starts are at least `spacing` apart.
+template <typename Result>
+class Prefetcher {
+public:
+    using Fetch = std::function<Result(std::size_t item)>;
+
+    Prefetcher(std::size_t count, std::size_t depth, std::chrono::milliseconds spacing, Fetch fetch)
+        : m_fetch(std::move(fetch)),
+          m_spacing(spacing),
+          m_count(count),
+          m_slots(std::max<std::size_t>(depth, 1)) {
+        const std::size_t workers = std::min(m_slots.size(), count);
+        m_workers.reserve(workers);
+        for (std::size_t i = 0; i < workers; ++i) {
+            m_workers.emplace_back([this] { worker_loop(); });
+        }
+    }
+
+    ~Prefetcher() {
+        {
+            std::scoped_lock lock(m_mutex);
+            m_stopping = true;
+        }
+        m_space_freed.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    Prefetcher(const Prefetcher&) = delete;
+    Prefetcher& operator=(const Prefetcher&) = delete;
+
+    // Blocks until the next item in sequence has been fetched. Rethrows
+    // whatever the fetch threw.
+    Result next() {
+        std::unique_lock lock(m_mutex);
+        if (m_consumed >= m_count) {
+            throw std::out_of_range("prefetch exhausted");
+        }
+        Slot& slot = m_slots[m_consumed % m_slots.size()];
+        m_result_ready.wait(lock, [&] { return slot.outcome || slot.error; });
+        Slot taken = std::exchange(slot, Slot{});
+        ++m_consumed;
+        lock.unlock();
+        // A worker may be waiting out the spacing on the same condition.
+        m_space_freed.notify_all();
+        if (taken.error) {
+            std::rethrow_exception(taken.error);
+        }
+        return std::move(*taken.outcome);
+    }
+
+private:
+    struct Slot {
+        std::optional<Result> outcome;
+        std::exception_ptr error;
+    };
+
+    void worker_loop() {
+        std::unique_lock lock(m_mutex);
+        while (true) {
+            m_space_freed.wait(lock, [&] {
+                return m_stopping || m_claimed >= m_count || m_claimed < m_consumed + m_slots.size();
+            });
+            if (m_stopping || m_claimed >= m_count) {
+                return;
+            }
+            const std::size_t item = m_claimed++;
+            const auto start = std::max(std::chrono::steady_clock::now(), m_next_start);
+            m_next_start = start + m_spacing;
+            if (m_space_freed.wait_until(lock, start, [&] { return m_stopping; })) {
+                return;
+            }
+            lock.unlock();
+
+            Slot result;
+            try {
+                result.outcome = m_fetch(item);
+            } catch (...) {
+                result.error = std::current_exception();
+            }
+
+            lock.lock();
+            m_slots[item % m_slots.size()] = std::move(result);
+            m_result_ready.notify_one();
+        }
+    }
+
+    Fetch m_fetch;
+    std::chrono::milliseconds m_spacing;
+    std::size_t m_count;
+
+    std::mutex m_mutex;
+    std::condition_variable m_space_freed;
+    std::condition_variable m_result_ready;
+    std::vector<Slot> m_slots;
+    std::size_t m_claimed = 0;
+    std::size_t m_consumed = 0;
+    std::chrono::steady_clock::time_point m_next_start{};
+    bool m_stopping = false;
+    std::vector<std::thread> m_workers;
+};
+
+} // namespace almondai
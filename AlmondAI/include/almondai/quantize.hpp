@@ -0,0 +1,70 @@
+#pragma once
+
+#include "tensor.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace almondai {
+
+// Float64 and Float32 are trainable storage; Float16 and Int8 are read-only
+// quantized copies.
+enum class WeightPrecision {
+    Float64,
+    Float32,
+    Float16,
+    Int8
+};
+
+const char* precision_name(WeightPrecision precision) noexcept;
+// Accepts "fp64", "fp32", "fp16" and "int8" (case-insensitive).
+std::optional<WeightPrecision> parse_precision(std::string_view name);
+
+// Read-only copy of a rank-2 weight in fp16, or in int8 with one scale per
+// kernels::kQuantGroup consecutive columns of each row (absmax / 127).
+class QuantizedMatrix {
+public:
+    QuantizedMatrix() = default;
+    template <typename T>
+    QuantizedMatrix(const BasicTensor<T>& weight, WeightPrecision precision);
+
+    std::size_t rows() const noexcept { return m_rows; }
+    std::size_t cols() const noexcept { return m_cols; }
+    WeightPrecision precision() const noexcept { return m_precision; }
+    std::size_t bytes() const noexcept;
+
+    // y = x * W for `batch` rows of x.
+    void matmul(const double* x, double* y, std::size_t batch) const;
+    // y = W[row]
+    void dequantize_row(std::size_t row, double* y) const;
+
+private:
+    std::size_t m_rows = 0;
+    std::size_t m_cols = 0;
+    WeightPrecision m_precision = WeightPrecision::Int8;
+    std::vector<std::int8_t> m_int8;
+    std::vector<float> m_scales;
+    std::vector<std::uint16_t> m_fp16;
+};
+
+// Logit drift measured on fixed probe contexts when a decoder is quantized.
+struct QuantizationReport {
+    WeightPrecision precision = WeightPrecision::Float64;
+    std::size_t bytes_before = 0;
+    std::size_t bytes_after = 0;
+    std::size_t probes = 0;
+    double max_abs_error = 0.0;
+    double rms_error = 0.0;
+    // rms_error over the rms of the fp64 logits.
+    double relative_rms_error = 0.0;
+    // Share of probes whose most likely token is unchanged.
+    double top1_agreement = 1.0;
+
+    std::string summary() const;
+};
+
+} // namespace almondai
@@ -1,24 +1,35 @@
 #pragma once
 
+#include "thread_pool.hpp"
 #include "tokenizer_word.hpp"
 
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
+#include <memory>
 #include <mutex>
 #include <filesystem>
 
 namespace almondai {
 
+// Lightweight hit; fetch the document tokens with RetrievalIndex::tokens_for when needed.
 struct RetrievalResult {
     std::string document_id;
     double score = 0.0;
-    std::vector<int> tokens;
     std::vector<std::string> tags;
 };
 
 class RetrievalIndex {
 public:
+    struct PendingDocument {
+        std::string id;
+        std::string text;
+        std::vector<std::string> tags;
+    };
+
     explicit RetrievalIndex(const WordTokenizer& tokenizer);
     RetrievalIndex(const RetrievalIndex&) = delete;
     RetrievalIndex& operator=(const RetrievalIndex&) = delete;
@@ -28,6 +39,11 @@ public:
     void ingest_document(const std::string& id,
                          const std::string& text,
                          const std::vector<std::string>& tags = {});
+    // Same as calling ingest_document for each entry in order, except that an
+    // entry replaced by a later one with the same id is never added. Texts are
+    // encoded on `pool` and the batch is published as a single segment.
+    // Returns how many documents are new or differ from the ones they replace.
+    std::size_t ingest_documents(std::vector<PendingDocument> documents, ThreadPool& pool);
     std::vector<RetrievalResult> query(const std::string& text, std::size_t top_k = 3) const;
 
     double hit_rate() const;
@@ -35,17 +51,66 @@ public:
     void save_metadata(const std::filesystem::path& path) const;
     void load_metadata(const std::filesystem::path& path);
     std::vector<std::string> tags_for(const std::string& document_id) const;
+    std::vector<int> tokens_for(const std::string& document_id) const;
+    std::size_t document_count() const;
 
 private:
+    struct Posting {
+        std::uint32_t doc = 0;
+        std::uint32_t tf = 0;
+    };
+
+    struct Document {
+        std::string id;
+        std::vector<int> tokens;
+        std::vector<std::string> tags;
+    };
+
+    // Immutable once published. Documents are numbered in ingestion order and the
+    // term dictionary is stored CSR-style: postings for terms[i] occupy
+    // postings[offsets[i], offsets[i + 1]), sorted by doc number. Both the id table
+    // and the dictionary are sorted so merges are linear.
+    struct Segment {
+        // Shared so merges relink documents without copying their tokens.
+        std::vector<std::shared_ptr<const Document>> documents;
+        std::vector<std::pair<std::string_view, std::uint32_t>> ids;
+        std::vector<int> terms;
+        std::vector<std::uint32_t> offsets;
+        std::vector<std::uint32_t> max_tf;
+        std::vector<Posting> postings;
+
+        const std::uint32_t* find_number(const std::string& id) const;
+        std::size_t find_term(int token) const;
+    };
+
+    struct SegmentView {
+        std::shared_ptr<const Segment> segment;
+        // Copy-on-write tombstones for documents re-ingested into a newer segment.
+        std::shared_ptr<const std::vector<bool>> deleted;
+        std::size_t deleted_count = 0;
+    };
+
+    // Readers load the current snapshot and never block on writers. Segments are
+    // ordered oldest first; document frequencies include tombstoned documents until
+    // the owning segment is merged.
+    struct Snapshot {
+        std::vector<SegmentView> segments;
+        std::size_t total_documents = 0;
+        std::size_t live_documents = 0;
+        std::size_t live_token_total = 0;
+    };
+
     const WordTokenizer& m_tokenizer;
-    mutable std::mutex m_mutex;
-    std::unordered_map<std::string, std::unordered_map<int, int>> m_term_counts;
-    std::unordered_map<int, int> m_document_frequency;
-    std::unordered_map<std::string, std::vector<int>> m_cached_tokens;
-    std::unordered_map<std::string, std::vector<std::string>> m_document_tags;
-    mutable std::size_t m_query_count = 0;
-    mutable std::size_t m_hit_count = 0;
+    std::mutex m_write_mutex;
+    std::atomic<std::shared_ptr<const Snapshot>> m_snapshot;
+    mutable std::atomic<std::size_t> m_query_count{0};
+    mutable std::atomic<std::size_t> m_hit_count{0};
+
+    std::shared_ptr<const Snapshot> snapshot() const;
+    static std::shared_ptr<const Segment> build_segment(std::vector<Document> documents);
+    static const Document* find_live(const Snapshot& snapshot, const std::string& id);
+    static void tombstone(Snapshot& snapshot, const std::string& id);
+    static void merge_segments(Snapshot& snapshot);
 };
 
 } // namespace almondai
-
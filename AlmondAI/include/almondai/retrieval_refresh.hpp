@@ -6,7 +6,8 @@
 
 namespace almondai {
 
-void refresh_retrieval_index(const std::vector<TrainingExample>& dataset, BpeTokenizer& tokenizer);
+// Fraction of prompts that share at least one token with another prompt.
+double refresh_retrieval_index(const std::vector<TrainingExample>& dataset, BpeTokenizer& tokenizer);
 
 } // namespace almondai
 
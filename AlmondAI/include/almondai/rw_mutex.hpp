@@ -0,0 +1,39 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace almondai {
+
+// Reader/writer lock that stops admitting new readers once a writer is
+// waiting, so a steady stream of overlapping readers cannot hold a writer off
+// indefinitely: the writer waits only for the readers already inside.
+// std::shared_mutex leaves that policy unspecified and glibc prefers readers.
+// Meets the SharedMutex requirements, so std::shared_lock and
+// std::unique_lock work with it. Not recursive: a thread that already shares
+// the lock must not take it again while a writer could be waiting.
+class WriterPreferringMutex {
+public:
+    WriterPreferringMutex() = default;
+    WriterPreferringMutex(const WriterPreferringMutex&) = delete;
+    WriterPreferringMutex& operator=(const WriterPreferringMutex&) = delete;
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    void lock_shared();
+    bool try_lock_shared();
+    void unlock_shared();
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_reader_gate;
+    std::condition_variable m_writer_gate;
+    std::size_t m_readers = 0;
+    std::size_t m_writers_waiting = 0;
+    bool m_writer = false;
+};
+
+} // namespace almondai
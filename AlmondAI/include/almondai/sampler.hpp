@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace almondai {
+
+struct SamplerSettings {
+    double temperature = 1.0;
+    // Zero keeps every token.
+    std::size_t top_k = 0;
+    // Smallest set of most likely tokens holding this share of the probability.
+    double top_p = 1.0;
+    // Drops tokens less likely than min_p times the most likely one.
+    double min_p = 0.0;
+    // Logits of tokens in the history are divided by this when positive and
+    // multiplied by it when negative.
+    double repetition_penalty = 1.0;
+};
+
+// Draws the next token from a row of logits. The scratch buffers grow to the
+// largest vocabulary seen and are reused across calls, so keep one sampler per
+// generation loop. The top-k and top-p cuts are found by a radix select over
+// the weights rather than by sorting the vocabulary.
+class Sampler {
+public:
+    // `history` takes the repetition penalty; `suppressed`, when not negative,
+    // is never drawn unless it is the only token.
+    int sample(std::span<const double> logits,
+               const SamplerSettings& settings,
+               std::mt19937& rng,
+               std::span<const int> history = {},
+               int suppressed = -1);
+
+private:
+    // Tokens heavier than `weight` are kept, plus the first `ties` tokens
+    // (in vocabulary order) that weigh exactly `weight`.
+    struct Cut {
+        double weight = 0.0;
+        std::size_t ties = 0;
+        double kept = 0.0;
+    };
+
+    std::vector<double> m_weights;
+    std::vector<double> m_bucket_mass;
+    std::vector<std::uint32_t> m_bucket_count;
+    std::vector<double> m_boundary;
+
+    // The cut for at most `top_k` tokens, the fewest that hold `mass`, and
+    // none lighter than `floor`.
+    Cut find_cut(std::size_t top_k, double mass, double floor);
+};
+
+} // namespace almondai
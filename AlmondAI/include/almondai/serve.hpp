@@ -4,32 +4,115 @@
 #include "mcp.hpp"
 #include "buildparse.hpp"
 #include "chat/backend.hpp"
+#include "generation_engine.hpp"
+#include "rw_mutex.hpp"
+#include "teacher_cache.hpp"
 
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
 #include <istream>
+#include <map>
+#include <mutex>
 #include <ostream>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace almondai {
 
+struct LatencyHistogram {
+    // Upper bounds in milliseconds; the final bucket collects everything slower.
+    static constexpr std::array<double, 13> kBoundsMs{1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000};
+
+    std::array<std::size_t, kBoundsMs.size() + 1> buckets{};
+    std::size_t count = 0;
+    double total_ms = 0.0;
+    double max_ms = 0.0;
+
+    void record(double ms);
+    // Upper bound of the bucket holding the given quantile (max_ms for the overflow bucket).
+    double quantile_ms(double q) const;
+};
+
+// Requests are read on the caller's thread and dispatched to two lanes:
+// read-only methods run concurrently on a worker pool, everything that mutates
+// the learner runs one at a time on a writer thread. Handlers lock the learner
+// state only around local work: readers share it while they read, the writer
+// takes it exclusively for each mutation step (one ingest, train step or
+// publish) and neither holds it across teacher or backend calls. Responses are written as each request completes, so clients must match them
+// by id rather than by order.
 class Service {
 public:
+    struct Options {
+        std::size_t reader_threads = 4;
+        // Requests read but not yet answered; reading pauses at the limit.
+        std::size_t max_in_flight = 64;
+        TeacherCache::Options teacher_cache;
+        // Concurrent local generations share decode steps; how many run at
+        // once is bounded by reader_threads.
+        GenerationEngine::Options generation;
+    };
+
     Service(ContinuousLearner& learner, MCPBridge bridge);
+    Service(ContinuousLearner& learner, MCPBridge bridge, Options options);
+    ~Service();
+
+    Service(const Service&) = delete;
+    Service& operator=(const Service&) = delete;
 
+    // Returns after every request read from `in` has been answered. Not reentrant.
     void run(std::istream& in, std::ostream& out);
 
     void set_chat_backend(chat::Backend* backend, std::string route_label = std::string());
     chat::Backend* chat_backend() const noexcept { return m_chat_backend; }
 
+    std::map<std::string, LatencyHistogram> latency_stats() const;
+    TeacherCache& teacher_cache() noexcept { return m_teacher_cache; }
+
 private:
+    struct Job {
+        MCPBridge::Request request;
+        std::ostream* out = nullptr;
+    };
+
     ContinuousLearner* m_learner;
     MCPBridge m_bridge;
     chat::Backend* m_chat_backend = nullptr;
     std::string m_chat_route;
+    Options m_options;
+    TeacherCache m_teacher_cache;
+    GenerationEngine m_generation;
+
+    // Guards the learner. Only the writer thread mutates it, so the writer
+    // reads without the lock and locks exclusively per mutation step. Readers
+    // share it for a whole local generation (the engine reads the model
+    // unlocked), so it must admit a waiting writer ahead of new readers.
+    WriterPreferringMutex m_state_mutex;
+    std::mutex m_output_mutex;
 
-    JsonObject handle_request(const MCPBridge::Request& request);
+    mutable std::mutex m_queue_mutex;
+    std::condition_variable m_reader_ready;
+    std::condition_variable m_writer_ready;
+    std::condition_variable m_slot_freed;
+    std::deque<Job> m_read_queue;
+    std::deque<Job> m_write_queue;
+    std::size_t m_in_flight = 0;
+    bool m_stopping = false;
+    std::map<std::string, LatencyHistogram> m_latency;
+    std::vector<std::thread> m_readers;
+    std::thread m_writer;
+
+    void start_workers();
+    void worker_loop(std::deque<Job>& queue, std::condition_variable& ready);
+    void execute(Job& job);
+    void dispatch(const MCPBridge::Request& request, std::ostream& out);
+
+    JsonObject handle_request(const MCPBridge::Request& request, std::ostream& out);
+    JsonObject handle_service_stats() const;
     void handle_trainer_fit(const MCPBridge::Request& request, std::ostream& out);
     void handle_train_self_loop(const MCPBridge::Request& request, std::ostream& out);
 };
 
 } // namespace almondai
-
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "json.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace almondai {
+
+// Remembers teacher replies so repeated prompts skip the remote backend.
+// Recent entries live in an in-memory LRU; every entry is also appended to a
+// JSONL store that is re-indexed on construction and compacted once it grows
+// past the size cap. Keys are stable across runs (FNV-1a over the scope,
+// prompt and serialized constraints).
+class TeacherCache {
+public:
+    struct Options {
+        // Empty disables persistence.
+        std::filesystem::path store_path{"data/teacher_cache.jsonl"};
+        std::size_t max_memory_entries = 4096;
+        std::size_t max_store_bytes = 64u << 20;
+        // Zero keeps entries forever.
+        std::chrono::seconds ttl{std::chrono::hours(24 * 7)};
+    };
+
+    struct Entry {
+        std::string output;
+        std::string source;
+        std::int64_t created_at = 0;
+    };
+
+    struct Stats {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t memory_entries = 0;
+        std::size_t stored_entries = 0;
+        std::size_t store_bytes = 0;
+    };
+
+    TeacherCache();
+    explicit TeacherCache(Options options);
+
+    TeacherCache(const TeacherCache&) = delete;
+    TeacherCache& operator=(const TeacherCache&) = delete;
+
+    // `scope` separates teachers (e.g. the backend route) so switching backends
+    // does not serve another model's answers. `message` is the exact user
+    // message sent to the teacher, constraints and retrieval context included.
+    static std::string make_key(std::string_view scope, std::string_view message);
+
+    std::optional<Entry> lookup(const std::string& key);
+    void store(const std::string& key, std::string output, std::string source);
+    void clear();
+
+    Stats stats() const;
+
+private:
+    using LruList = std::list<std::pair<std::string, Entry>>;
+
+    Options m_options;
+    mutable std::mutex m_mutex;
+    LruList m_lru;
+    std::unordered_map<std::string, LruList::iterator> m_memory;
+    // Byte offset of the newest record for each key in the store.
+    std::unordered_map<std::string, std::uint64_t> m_offsets;
+    std::uint64_t m_store_bytes = 0;
+    std::fstream m_store;
+    std::size_t m_hits = 0;
+    std::size_t m_misses = 0;
+
+    bool expired(const Entry& entry) const;
+    void remember_locked(const std::string& key, Entry entry);
+    std::optional<Entry> read_record_locked(std::uint64_t offset);
+    void load_store_locked();
+    void compact_locked();
+    bool open_store_locked();
+};
+
+} // namespace almondai
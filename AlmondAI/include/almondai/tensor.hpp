@@ -12,32 +12,42 @@
 
 namespace almondai {
 
-class Tensor {
+// Dense row-major storage. Reductions such as l2_norm accumulate in double
+// whatever the element type.
+template <typename T>
+class BasicTensor {
 public:
-    Tensor() = default;
-    Tensor(std::vector<std::size_t> shape, double fill = 0.0)
+    using value_type = T;
+
+    BasicTensor() = default;
+    BasicTensor(std::vector<std::size_t> shape, T fill = T(0))
         : m_shape(std::move(shape)), m_data(size_from_shape(m_shape), fill) {}
 
-    Tensor(std::initializer_list<std::size_t> shape, double fill = 0.0)
-        : Tensor(std::vector<std::size_t>(shape), fill) {}
+    BasicTensor(std::initializer_list<std::size_t> shape, T fill = T(0))
+        : BasicTensor(std::vector<std::size_t>(shape), fill) {}
+
+    // Element-wise conversion, rounding to nearest when narrowing.
+    template <typename U>
+    explicit BasicTensor(const BasicTensor<U>& other)
+        : m_shape(other.shape()), m_data(other.vector().begin(), other.vector().end()) {}
 
     std::size_t size() const noexcept { return m_data.size(); }
 
     const std::vector<std::size_t>& shape() const noexcept { return m_shape; }
 
-    double* data() noexcept { return m_data.data(); }
-    const double* data() const noexcept { return m_data.data(); }
+    T* data() noexcept { return m_data.data(); }
+    const T* data() const noexcept { return m_data.data(); }
 
-    double& operator[](std::size_t index) { return m_data.at(index); }
-    const double& operator[](std::size_t index) const { return m_data.at(index); }
+    T& operator[](std::size_t index) { return m_data.at(index); }
+    const T& operator[](std::size_t index) const { return m_data.at(index); }
 
-    double& at(std::size_t index) { return m_data.at(index); }
-    const double& at(std::size_t index) const { return m_data.at(index); }
+    T& at(std::size_t index) { return m_data.at(index); }
+    const T& at(std::size_t index) const { return m_data.at(index); }
 
-    std::vector<double>& vector() noexcept { return m_data; }
-    const std::vector<double>& vector() const noexcept { return m_data; }
+    std::vector<T>& vector() noexcept { return m_data; }
+    const std::vector<T>& vector() const noexcept { return m_data; }
 
-    Tensor& operator+=(const Tensor& other) {
+    BasicTensor& operator+=(const BasicTensor& other) {
         require_same_shape(other);
         for (std::size_t i = 0; i < m_data.size(); ++i) {
             m_data[i] += other.m_data[i];
@@ -45,7 +55,7 @@ public:
         return *this;
     }
 
-    Tensor& operator-=(const Tensor& other) {
+    BasicTensor& operator-=(const BasicTensor& other) {
         require_same_shape(other);
         for (std::size_t i = 0; i < m_data.size(); ++i) {
             m_data[i] -= other.m_data[i];
@@ -53,30 +63,30 @@ public:
         return *this;
     }
 
-    Tensor& operator*=(double scalar) {
-        for (double& value : m_data) {
-            value *= scalar;
+    BasicTensor& operator*=(double scalar) {
+        for (T& value : m_data) {
+            value = static_cast<T>(value * scalar);
         }
         return *this;
     }
 
-    static Tensor zeros(std::initializer_list<std::size_t> shape) {
-        return Tensor(shape, 0.0);
+    static BasicTensor zeros(std::initializer_list<std::size_t> shape) {
+        return BasicTensor(shape, T(0));
     }
 
-    static Tensor random(std::initializer_list<std::size_t> shape, double scale = 0.02);
+    static BasicTensor random(std::initializer_list<std::size_t> shape, double scale = 0.02);
 
     double l2_norm() const {
         double sum = 0.0;
-        for (double value : m_data) {
-            sum += value * value;
+        for (T value : m_data) {
+            sum += static_cast<double>(value) * static_cast<double>(value);
         }
         return std::sqrt(sum);
     }
 
 private:
     std::vector<std::size_t> m_shape;
-    std::vector<double> m_data;
+    std::vector<T> m_data;
 
     static std::size_t size_from_shape(const std::vector<std::size_t>& shape) {
         if (shape.empty()) {
@@ -85,12 +95,18 @@ private:
         return std::accumulate(shape.begin(), shape.end(), std::size_t{1}, std::multiplies<>());
     }
 
-    void require_same_shape(const Tensor& other) const {
+    void require_same_shape(const BasicTensor& other) const {
         if (m_shape != other.m_shape) {
             throw std::invalid_argument("tensor shape mismatch");
         }
     }
 };
 
-} // namespace almondai
+// Instantiated in tensor.cpp.
+extern template class BasicTensor<double>;
+extern template class BasicTensor<float>;
 
+using Tensor = BasicTensor<double>;
+using FloatTensor = BasicTensor<float>;
+
+} // namespace almondai
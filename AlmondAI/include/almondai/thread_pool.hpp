@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace almondai {
+
+// Fixed set of workers for fork/join loops. The calling thread takes part in
+// every parallel_for, so a pool of size 1 runs everything inline.
+class ThreadPool {
+public:
+    // 0 selects std::thread::hardware_concurrency().
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads that execute tasks, including the caller.
+    std::size_t size() const noexcept { return m_workers.size() + 1; }
+
+    // Calls task(i) for every i in [0, count) and returns once all calls have
+    // finished. The first exception thrown by a task is rethrown here.
+    // Not reentrant: tasks must not call parallel_for on the same pool.
+    void parallel_for(std::size_t count, const std::function<void(std::size_t)>& task);
+
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_finished;
+    const std::function<void(std::size_t)>* m_task = nullptr;
+    std::size_t m_count = 0;
+    std::atomic<std::size_t> m_next{0};
+    std::size_t m_generation = 0;
+    std::size_t m_busy = 0;
+    std::exception_ptr m_error;
+    bool m_stopping = false;
+
+    void worker_loop();
+    void drain(const std::function<void(std::size_t)>& task, std::size_t count);
+};
+
+// Sums `count` contributions of `size` doubles on `pool`. Items are split into
+// one contiguous shard per thread, accumulate(item, sum) adds an item into its
+// shard's buffer, and the buffers are then added pairwise in a tree. The total
+// is left in, and returned as, buffers.front(); callers keep `buffers` so
+// repeated calls reuse the allocations. Differs from a serial sum only by
+// rounding.
+std::vector<double>& sharded_sum(ThreadPool& pool,
+                                 std::size_t count,
+                                 std::size_t size,
+                                 std::vector<std::vector<double>>& buffers,
+                                 const std::function<void(std::size_t, std::vector<double>&)>& accumulate);
+
+} // namespace almondai
@@ -1,8 +1,15 @@
 #pragma once
 
+#include "thread_pool.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <filesystem>
+#include <memory>
 #include <optional>
 #include <regex>
+#include <span>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -11,49 +18,112 @@
 
 namespace almondai {
 
+// Byte-level prefix tree over the WordPiece vocabulary. Every token is stored
+// verbatim under the word-initial root, and "##" pieces are also stored without
+// their prefix under the continuation root, so one walk from any position finds
+// the longest piece that can start there. Insertion is incremental.
+class WordPieceTrie {
+public:
+    struct Match {
+        std::size_t length = 0;
+        int id = -1;
+    };
+
+    WordPieceTrie();
+
+    void clear();
+    void insert(std::string_view token, int id);
+
+    // Longest vocabulary piece at text[start..) that ends on a UTF-8 character
+    // boundary; length 0 when nothing matches.
+    Match longest_match(std::string_view text, std::size_t start, bool continuation) const;
+    // Exact lookup; -1 when absent.
+    int find(std::string_view piece, bool continuation) const;
+
+private:
+    struct Node {
+        int token_id = -1;
+        int first_child = -1;
+        int next_sibling = -1;
+        unsigned char byte = 0;
+    };
+
+    std::vector<Node> m_nodes;
+    // Direct child table for the two roots, where fan-out is widest.
+    std::array<std::array<int, 256>, 2> m_root_children{};
+
+    int child(int node, unsigned char byte) const;
+    int add_child(int node, unsigned char byte);
+    void insert_at(int root, std::string_view key, int id);
+};
+
+// Readers (encode, decode, lookups) work on an immutable vocabulary snapshot
+// and never take a lock. load() and ingest_training_pair() build the next
+// version off to the side and publish it atomically; ingestion only copies
+// the vocabulary when a pair actually introduces new tokens.
 class BpeTokenizer {
 public:
     static constexpr int PAD_ID = 0;
     static constexpr int EOS_ID = 1;
     static constexpr int UNK_ID = 2;
 
+    struct Vocabulary {
+        std::vector<std::string> id_to_token;
+        std::unordered_map<std::string, int> token_to_id;
+        WordPieceTrie trie;
+        // Tokens recorded as merges, in the order they were added.
+        std::vector<std::string> merges;
+    };
+
     BpeTokenizer();
 
     bool load(const std::filesystem::path& vocab_path,
               const std::filesystem::path& merges_path = {});
 
     std::size_t ingest_training_pair(std::string_view prompt, std::string_view teacher_output);
+    // Bulk form for loading a corpus, adding tokens exactly as ingesting the
+    // texts one at a time would. The texts are checked on `pool`; since the
+    // pieces chosen for a word depend on what is already known, a text is
+    // checked again in order whenever the vocabulary grew since its check.
+    std::size_t ingest_texts(std::span<const std::string_view> texts, ThreadPool& pool);
 
     [[nodiscard]] std::vector<int> encode(std::string_view text) const;
     [[nodiscard]] std::string decode(const std::vector<int>& tokens) const;
 
     [[nodiscard]] std::size_t vocab_size() const;
-    [[nodiscard]] bool ready() const noexcept { return m_ready; }
+    [[nodiscard]] bool ready() const noexcept { return snapshot() != nullptr; }
 
     int token_to_id(std::string_view token) const;
     std::string id_to_token(int id) const;
 
     void save_vocab(const std::filesystem::path& path) const;
     void save_merges(const std::filesystem::path& path) const;
+    static void save_vocab(const Vocabulary& vocab, const std::filesystem::path& path);
+    static void save_merges(const Vocabulary& vocab, const std::filesystem::path& path);
+
+    // Null until load() succeeds.
+    std::shared_ptr<const Vocabulary> snapshot() const;
 
 private:
     std::filesystem::path m_vocab_path;
-    bool m_ready = false;
-    std::vector<std::string> m_id_to_token;
-    std::unordered_map<std::string, int> m_token_to_id;
     std::unordered_map<std::string, int> m_required_token_ids;
-    std::vector<std::string> m_recorded_merges;
-    mutable std::mutex m_mutex;
+    mutable std::mutex m_write_mutex;
+    // Null until load() succeeds.
+    std::atomic<std::shared_ptr<const Vocabulary>> m_vocab;
 
+    void publish(Vocabulary vocab);
     static bool is_whitespace(std::string_view token);
     static bool is_punctuation(std::string_view token);
     static std::vector<std::string> segment_text(std::string_view text);
-    static std::vector<std::string> wordpiece_tokens(std::string_view token,
-                                                     const std::unordered_map<std::string, int>& vocab,
+    static std::vector<std::string> wordpiece_tokens(const Vocabulary& vocab,
+                                                     std::string_view token,
                                                      std::vector<std::string>& new_tokens);
-    bool ensure_token(const std::string& token, bool record = true);
-    void ensure_tokens_for(std::string_view text);
-    std::vector<std::string> tokenize_segment(std::string_view segment, bool ensure_new_tokens) const;
+    static void wordpiece_ids(const Vocabulary& vocab, std::string_view token, std::vector<int>& ids);
+    static bool adds_tokens(const Vocabulary& vocab, std::string_view text);
+    static void rebuild_trie(Vocabulary& vocab);
+    bool ensure_token(Vocabulary& vocab, const std::string& token, bool record = true);
+    void ensure_tokens_for(Vocabulary& vocab, std::string_view text);
+    std::vector<std::string> tokenize_segment(Vocabulary& vocab, std::string_view segment);
 };
 
 } // namespace almondai
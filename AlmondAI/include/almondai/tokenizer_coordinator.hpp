@@ -5,8 +5,11 @@
 #include "tokenizer_word.hpp"
 
 #include <filesystem>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
+#include <span>
 #include <string_view>
 
 namespace almondai {
@@ -25,6 +28,14 @@ public:
         bool student_resized = false;
     };
 
+    // Vocabulary versions captured together, for writing after the fact.
+    struct Snapshot {
+        std::shared_ptr<const WordTokenizer::Vocabulary> word;
+        std::shared_ptr<const BpeTokenizer::Vocabulary> bpe;
+        // Whether either vocabulary changed since the previous capture.
+        bool dirty = false;
+    };
+
     TokenizerCoordinator() = default;
 
     WordTokenizer& word() noexcept { return m_word_tokenizer; }
@@ -35,24 +46,42 @@ public:
     void set_persistence(PersistenceConfig config);
     const PersistenceConfig& persistence() const noexcept { return m_paths; }
 
+    // Both ingest forms throw, leaving the vocabularies untouched, while the
+    // student is quantized.
     IngestResult ingest_training_pair(StudentModel& student,
                                       std::string_view prompt,
                                       std::string_view teacher_output);
+    // Bulk form for loading a dataset; `texts` holds the prompt and reply of
+    // every pair in order, and the student is resized once at the end.
+    IngestResult ingest_texts(StudentModel& student, std::span<const std::string_view> texts, ThreadPool& pool);
 
     void sync_student_vocab(StudentModel& student);
 
+    // Writes the vocab/merges files if they changed, or unconditionally when a
+    // version is given, in which case a .stepNNNNNN copy is kept alongside.
     void persist(std::optional<std::size_t> version = std::nullopt) const;
+    // Captures both vocabularies and clears the changed flag; persisting the
+    // result later writes exactly this state, whatever was ingested since.
+    Snapshot capture() const;
+    void persist(const Snapshot& snapshot, std::optional<std::size_t> version) const;
+    // Deletes all but the newest `keep` versioned copies of each file.
+    void prune_versions(std::size_t keep) const;
 
 private:
     WordTokenizer m_word_tokenizer;
     BpeTokenizer m_bpe_tokenizer;
     PersistenceConfig m_paths;
     mutable std::mutex m_mutex;
+    // Serialises file writes, which happen outside m_mutex.
+    mutable std::mutex m_persist_mutex;
     mutable bool m_dirty = false;
 
     static void ensure_parent_directory(const std::filesystem::path& path);
     void resize_student_if_needed(StudentModel& student, IngestResult& result);
-    void persist_locked(std::optional<std::size_t> version) const;
+    static void persist_file(const std::filesystem::path& path,
+                             std::optional<std::size_t> version,
+                             const std::function<void(const std::filesystem::path&)>& save);
+    static std::filesystem::path version_path(const std::filesystem::path& path, std::size_t version);
 };
 
 } // namespace almondai
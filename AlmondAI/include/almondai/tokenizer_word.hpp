@@ -1,5 +1,11 @@
 #pragma once
 
+#include "thread_pool.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <span>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -17,8 +23,23 @@ struct TokenizerConfig {
     bool normalize_nfkc = false;
 };
 
+// Encoding reads an immutable vocabulary snapshot and never blocks. Writers
+// serialise on a mutex, collect the tokens a call would add and publish them
+// as one new snapshot, so ingestion can run alongside serving.
 class WordTokenizer {
 public:
+    struct Vocabulary {
+        TokenizerConfig config;
+        std::unordered_map<std::string, int> token_to_id;
+        std::vector<std::string> id_to_token;
+        // Ids of single code point tokens, keyed by code point: a direct table
+        // across the BMP and a map above it. -1 marks an absent code point.
+        std::vector<int> bmp_ids;
+        std::unordered_map<char32_t, int> astral_ids;
+        // Id for each ASCII byte after normalisation, refreshed on publish.
+        std::array<int, 128> ascii_ids{};
+    };
+
     WordTokenizer();
     WordTokenizer(const WordTokenizer&) = delete;
     WordTokenizer& operator=(const WordTokenizer&) = delete;
@@ -32,6 +53,10 @@ public:
     // Ingests a prompt/reply training pair directly into the vocabulary.
     // Returns the number of new tokens that were added.
     std::size_t ingest_training_pair(std::string_view prompt, std::string_view teacher_output);
+    // Bulk form for loading a corpus: the texts are scanned on `pool` and new
+    // tokens are added in order of first appearance, so ids come out as if
+    // the texts had been ingested one at a time.
+    std::size_t ingest_texts(std::span<const std::string_view> texts, ThreadPool& pool);
 
     std::vector<int> encode(const std::string& text) const;
     std::string decode(const std::vector<int>& tokens) const;
@@ -39,21 +64,28 @@ public:
     int token_id(const std::string& token) const;
 
     void save_vocab(const std::string& path) const;
+    static void save_vocab(const Vocabulary& vocab, const std::string& path);
     void load_vocab(const std::string& path);
 
-    const std::unordered_map<std::string, int>& vocab() const noexcept { return m_token_to_id; }
+    std::shared_ptr<const Vocabulary> snapshot() const;
     std::size_t vocab_size() const;
 
 private:
-    TokenizerConfig m_config;
-    std::unordered_map<std::string, int> m_token_to_id;
-    std::vector<std::string> m_id_to_token;
-    mutable std::mutex m_mutex;
+    std::mutex m_write_mutex;
+    std::atomic<std::shared_ptr<const Vocabulary>> m_vocab;
 
-    std::string normalize(const std::string& token) const;
-    void consume_text(std::string_view text, std::unordered_set<std::string>& newly_added);
+    static char32_t normalize(const TokenizerConfig& config, char32_t codepoint);
+    static int codepoint_id(const Vocabulary& vocab, char32_t codepoint);
+    static void add_token(Vocabulary& vocab, std::string token);
+    static void index_token(Vocabulary& vocab, const std::string& token, int id);
+    static void reindex(Vocabulary& vocab);
+    static void consume_text(const Vocabulary& vocab,
+                             std::string_view text,
+                             std::unordered_set<char32_t>& newly_added,
+                             std::vector<std::string>& pending);
     static std::string codepoint_to_utf8(char32_t codepoint);
-    void ensure_special_tokens();
+    static void ensure_special_tokens(Vocabulary& vocab);
+    void publish(Vocabulary vocab);
 };
 
 } // namespace almondai
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "model.hpp"
+#include "checkpoint_writer.hpp"
 #include "adapter.hpp"
 #include "tokenizer_coordinator.hpp"
 #include "ingest.hpp"
@@ -8,11 +9,15 @@
 #include "eval.hpp"
 #include "governor.hpp"
 #include "json.hpp"
+#include "optim_adamw.hpp"
+#include "thread_pool.hpp"
 
 #include <optional>
 #include <fstream>
 #include <filesystem>
 #include <functional>
+#include <memory>
+#include <span>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -40,6 +45,11 @@ struct LoadStatus {
 
 using LoadStatusCallback = std::function<void(const LoadStatus&)>;
 
+// Runs one fit() mutation: a dataset line's vocabulary ingest, a serial train
+// step or a parallel batch. Callers use it to lock the learner per step
+// rather than for the whole run.
+using FitStepGuard = std::function<void(const std::function<void()>&)>;
+
 class ContinuousLearner {
 public:
     ContinuousLearner(StudentModel student,
@@ -47,6 +57,7 @@ public:
                       TokenizerCoordinator& tokenizers,
                       PolicyGovernor governor,
                       LoadStatusCallback load_callback = LoadStatusCallback());
+    ~ContinuousLearner();
 
     std::optional<CuratedSample> ingest(const std::string& prompt,
                                          const std::string& teacher_output,
@@ -60,7 +71,23 @@ public:
     void fit(const std::string& path,
              int epochs,
              int batch,
-             std::function<void(int, double, double, double)> on_batch);
+             std::function<void(int, double, double, double)> on_batch,
+             FitStepGuard guard = FitStepGuard());
+    // 0 keeps fit() on the per-sample train_step path, which applies plain SGD
+    // at the model's configured learning rate; the schedule fit() reports to
+    // on_batch is informational there. Any other value makes fit()
+    // data-parallel: each batch is sharded across that many threads and the
+    // reduced gradient feeds a single AdamW step on the output projection at
+    // the scheduled learning rate. The two modes therefore train differently
+    // and are not expected to reach the same weights. Both record student
+    // responses, accuracy and per-sample trace events.
+    void set_fit_threads(std::size_t threads);
+    std::size_t fit_threads() const noexcept { return m_fit_threads; }
+
+    // Writes the current weights and tokenizer files now and waits for the write.
+    bool flush_checkpoint();
+    CheckpointWriter::Status checkpoint_status() const { return m_checkpoints.status(); }
+    void set_checkpoint_policy(CheckpointWriter::Policy policy) { m_checkpoints.set_policy(policy); }
 
     void promote_adapter(const std::string& name);
     void rollback_adapter();
@@ -72,6 +99,9 @@ public:
     RetrievalIndex& retrieval() { return m_retrieval; }
     PolicyGovernor& governor() { return m_governor; }
 
+    // Where accepted samples are appended (data/training_data.jsonl).
+    static const std::filesystem::path& training_data_path();
+
     const CuratedSample* recall_sample(const std::string& document_id) const;
     std::vector<std::string> prompts_for_tags(const std::vector<std::string>& required_tags) const;
     void set_load_status_callback(LoadStatusCallback callback);
@@ -91,11 +121,17 @@ private:
     std::ofstream m_log_file;
     std::size_t m_step = 0;
     LoadStatusCallback m_load_status_callback;
+    CheckpointWriter m_checkpoints;
+    std::size_t m_fit_threads = 0;
+    std::unique_ptr<ThreadPool> m_fit_pool;
+    AdamWOptimizer m_fit_optimizer;
+    std::vector<std::vector<double>> m_fit_gradients;
 
     void log_stats(const TrainingStats& stats);
     void load_persistent_data();
+    // Parses the persisted samples once, refreshing the vocabulary and the
+    // retrieval index from them.
     void load_samples_from_file(const std::filesystem::path& path, std::size_t total_samples_hint);
-    void consume_training_data_for_vocab(const std::filesystem::path& path);
     void persist_sample(const CuratedSample& sample);
     std::string derive_document_id(const CuratedSample& sample, std::size_t index) const;
     void report_load_status(std::string_view phase,
@@ -103,6 +139,8 @@ private:
                             std::size_t completed = 0,
                             std::size_t total = 0);
     void persist_state(std::optional<std::size_t> version = std::nullopt);
+    // Returns the summed loss over the batch.
+    double train_batch_parallel(std::span<const CuratedSample> batch, double learning_rate, std::size_t& prompt_tokens);
 };
 
 } // namespace almondai
@@ -28,6 +28,7 @@ struct TrainingReport {
     std::size_t tokens = 0;
     double loss = 0.0;
     double perplexity = 0.0;
+    double tokens_per_second = 0.0;
     bool checkpoint_saved = false;
 };
 
@@ -1,6 +1,7 @@
 #include "../include/almondai/autopilot.hpp"
 
 #include "../include/almondai/json.hpp"
+#include "../include/almondai/jsonl_index.hpp"
 #include "../include/almondai/retrieval_refresh.hpp"
 #include "../include/almondai/train.hpp"
 
@@ -60,18 +61,6 @@ std::string timestamp_now() {
     return oss.str();
 }
 
-std::unordered_set<int> token_set(const BpeTokenizer& tokenizer, const std::string& text) {
-    std::unordered_set<int> set;
-    auto tokens = tokenizer.encode(text);
-    for (int id : tokens) {
-        if (id <= BpeTokenizer::PAD_ID || id == BpeTokenizer::EOS_ID) {
-            continue;
-        }
-        set.insert(id);
-    }
-    return set;
-}
-
 std::vector<std::string> extract_tags_from_json(const Json& value) {
     std::vector<std::string> tags;
     if (!value.is_array()) {
@@ -184,7 +173,8 @@ void Autopilot::run_warmup_epochs(const std::vector<TrainingExample>& seed_data)
             std::ostringstream oss;
             oss << "Warmup step " << report.step << " trained on " << report.tokens << " tokens (loss="
                 << std::fixed << std::setprecision(4) << report.loss << ", ppl=" << std::setprecision(3)
-                << report.perplexity << ')';
+                << report.perplexity << ", " << std::setprecision(1)
+                << report.tokens_per_second << " tok/s)";
             log(oss.str());
         }
         log("Warmup epoch " + std::to_string(epoch + 1) + "/3 finished");
@@ -196,19 +186,14 @@ void Autopilot::run_warmup_epochs(const std::vector<TrainingExample>& seed_data)
 
 std::vector<TrainingExample> Autopilot::load_jsonl(const std::filesystem::path& path) const {
     std::vector<TrainingExample> data;
-    std::ifstream file(path);
-    if (!file) {
-        return data;
-    }
-    std::string line;
-    while (std::getline(file, line)) {
+    JsonlIndex::shared(path)->for_each([&](std::size_t, std::string_view line) {
         if (line.empty()) {
-            continue;
+            return;
         }
         try {
             Json parsed = Json::parse(line);
             if (!parsed.is_object()) {
-                continue;
+                return;
             }
             const auto& obj = parsed.as_object();
             TrainingExample example;
@@ -231,23 +216,19 @@ std::vector<TrainingExample> Autopilot::load_jsonl(const std::filesystem::path&
             data.push_back(std::move(example));
         } catch (...) {
         }
-    }
+    });
     return data;
 }
 
 void Autopilot::append_training_record(const TrainingExample& sample) {
-    std::filesystem::create_directories(m_training_path.parent_path());
-    std::ofstream file(m_training_path, std::ios::app);
-    if (!file) {
-        log("Failed to append training record: unable to open " + m_training_path.string());
-        return;
-    }
     JsonObject obj;
     obj["constraints"] = sample.constraints;
     obj["prompt"] = Json(sample.prompt);
     obj["provenance"] = sample.provenance;
     obj["teacher_output"] = Json(sample.teacher_output);
-    file << Json(obj).dump() << '\n';
+    if (!JsonlIndex::shared(m_training_path)->append(Json(obj).dump())) {
+        log("Failed to append training record: unable to open " + m_training_path.string());
+    }
 }
 
 bool Autopilot::violates_forbidden_regex(const std::string& text) const {
@@ -260,45 +241,22 @@ bool Autopilot::contains_pii(const std::string& text) const {
            std::regex_search(text, private_key_regex());
 }
 
-double Autopilot::max_similarity_against_recent(const std::string& text) const {
+double Autopilot::max_similarity_against_recent(const std::string& text, double threshold) const {
     if (m_recent_outputs.empty()) {
         return 0.0;
     }
-    const auto candidate = token_set(m_tokenizer, text);
-    if (candidate.empty()) {
-        return 0.0;
-    }
-    double max_similarity = 0.0;
-    for (const auto& previous : m_recent_outputs) {
-        const auto other = token_set(m_tokenizer, previous);
-        if (other.empty()) {
-            continue;
-        }
-        std::size_t intersection = 0;
-        for (int token : candidate) {
-            if (other.find(token) != other.end()) {
-                ++intersection;
-            }
-        }
-        std::size_t union_size = candidate.size() + other.size() - intersection;
-        if (union_size == 0) {
-            continue;
-        }
-        double similarity = static_cast<double>(intersection) / static_cast<double>(union_size);
-        max_similarity = std::max(max_similarity, similarity);
-        if (max_similarity > 0.92) {
-            break;
-        }
-    }
-    return max_similarity;
+    // An LSH miss alone would report a moderately similar output as fully
+    // novel, so below the rejection threshold the recent window is scanned.
+    return m_recent_index.nearest_exact(NearDuplicateIndex::token_set(m_tokenizer, text), threshold).similarity;
 }
 
 void Autopilot::remember_output(const std::string& text) {
     if (text.empty()) {
         return;
     }
-    m_recent_outputs.push_back(text);
+    m_recent_outputs.push_back(m_recent_index.insert(NearDuplicateIndex::token_set(m_tokenizer, text)));
     while (m_recent_outputs.size() > 512) {
+        m_recent_index.erase(m_recent_outputs.front());
         m_recent_outputs.pop_front();
     }
 }
@@ -347,8 +305,6 @@ Autopilot::GateDecision Autopilot::gate_sample(const TrainingExample& sample) co
         decision.reasons.emplace_back("quality:output_too_short");
     }
 
-    decision.similarity = max_similarity_against_recent(sample.teacher_output);
-
     const auto tags = sample_tags(sample);
     double similarity_threshold = 0.92;
     if (!m_curriculum_priority.empty()) {
@@ -359,6 +315,7 @@ Autopilot::GateDecision Autopilot::gate_sample(const TrainingExample& sample) co
             }
         }
     }
+    decision.similarity = max_similarity_against_recent(sample.teacher_output, similarity_threshold);
     if (decision.similarity > similarity_threshold) {
         decision.accepted = false;
         decision.reasons.emplace_back("quality:recent_similarity");
@@ -443,7 +400,8 @@ void Autopilot::maybe_train() {
         std::ostringstream oss;
         oss << "Training step " << report.step << " processed " << report.tokens << " tokens (loss="
             << std::fixed << std::setprecision(4) << report.loss << ", ppl=" << std::setprecision(3)
-            << report.perplexity << ')';
+            << report.perplexity << ", " << std::setprecision(1)
+            << report.tokens_per_second << " tok/s)";
         if (report.checkpoint_saved) {
             oss << " [checkpoint saved]";
             m_tokenizers.persist(report.step);
@@ -98,6 +98,55 @@ std::string flatten_content(const Json& node) {
     return {};
 }
 
+// Reply text from a non-streamed chat.completions response.
+std::string extract_completion(const Json& parsed) {
+    if (parsed.is_object()) {
+        const auto& obj = parsed.as_object();
+        if (auto choices_it = obj.find("choices"); choices_it != obj.end() && choices_it->second.is_array()) {
+            const auto& choices = choices_it->second.as_array();
+            if (!choices.empty() && choices.front().is_object()) {
+                const auto& choice = choices.front().as_object();
+                if (auto msg_it = choice.find("message"); msg_it != choice.end()) {
+                    const auto& message_node = msg_it->second;
+                    if (message_node.is_object()) {
+                        const auto& message = message_node.as_object();
+                        if (auto content_it = message.find("content"); content_it != message.end()) {
+                            const std::string content = strip(flatten_content(content_it->second));
+                            if (!content.empty()) {
+                                return content;
+                            }
+                        }
+                        if (auto text_it = message.find("text"); text_it != message.end()) {
+                            const std::string text = strip(flatten_content(text_it->second));
+                            if (!text.empty()) {
+                                return text;
+                            }
+                        }
+                    } else {
+                        const std::string message_text = strip(flatten_content(message_node));
+                        if (!message_text.empty()) {
+                            return message_text;
+                        }
+                    }
+                }
+                if (auto delta_it = choice.find("delta"); delta_it != choice.end() && delta_it->second.is_object()) {
+                    const auto& delta = delta_it->second.as_object();
+                    if (auto content_it = delta.find("content"); content_it != delta.end()) {
+                        const std::string content = strip(flatten_content(content_it->second));
+                        if (!content.empty()) {
+                            return content;
+                        }
+                    }
+                }
+                if (auto text_it = choice.find("text"); text_it != choice.end() && text_it->second.is_string()) {
+                    return strip(text_it->second.as_string());
+                }
+            }
+        }
+    }
+    return {};
+}
+
 } // namespace
 
 namespace almondai::chat {
@@ -260,63 +309,99 @@ public:
             throw std::runtime_error("openai backend requires at least one message");
         }
 
-        JsonObject payload;
-        payload["model"] = Json(m_model);
-        payload["messages"] = Json(serialize_chat_messages(messages));
+        const std::string response = almondai::net::post_json(m_endpoint, build_body(messages, false), headers());
+        return extract_completion(Json::parse(response));
+    }
 
-        const std::string body = Json(payload).dump();
-        std::vector<std::pair<std::string, std::string>> headers;
-        if (!m_api_key.empty()) {
-            headers.emplace_back("Authorization", "Bearer " + m_api_key);
+    std::string complete_stream(const std::vector<Message>& messages, const DeltaCallback& on_delta) override {
+        if (messages.empty()) {
+            throw std::runtime_error("openai backend requires at least one message");
         }
 
-        const std::string response = almondai::net::post_json(m_endpoint, body, headers);
-        Json parsed = Json::parse(response);
-        if (parsed.is_object()) {
-            const auto& obj = parsed.as_object();
-            if (auto choices_it = obj.find("choices"); choices_it != obj.end() && choices_it->second.is_array()) {
-                const auto& choices = choices_it->second.as_array();
-                if (!choices.empty() && choices.front().is_object()) {
-                    const auto& choice = choices.front().as_object();
-                    if (auto msg_it = choice.find("message"); msg_it != choice.end()) {
-                        const auto& message_node = msg_it->second;
-                        if (message_node.is_object()) {
-                            const auto& message = message_node.as_object();
-                            if (auto content_it = message.find("content"); content_it != message.end()) {
-                                const std::string content = strip(flatten_content(content_it->second));
-                                if (!content.empty()) {
-                                    return content;
-                                }
-                            }
-                            if (auto text_it = message.find("text"); text_it != message.end()) {
-                                const std::string text = strip(flatten_content(text_it->second));
-                                if (!text.empty()) {
-                                    return text;
-                                }
-                            }
-                        } else {
-                            const std::string message_text = strip(flatten_content(message_node));
-                            if (!message_text.empty()) {
-                                return message_text;
-                            }
-                        }
-                    }
+        // Server-sent events: "data: {chunk}" lines terminated by "data: [DONE]".
+        // Servers that ignore "stream" answer with one ordinary JSON document,
+        // which is parsed once the transfer ends.
+        std::string pending;
+        std::string raw;
+        std::string reply;
+        bool saw_event = false;
+        auto handle_line = [&](std::string line) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.rfind("data:", 0) != 0) {
+                return;
+            }
+            saw_event = true;
+            std::string data = strip(line.substr(5));
+            if (data.empty() || data == "[DONE]") {
+                return;
+            }
+            Json chunk = Json::parse(data);
+            std::string delta;
+            if (chunk.is_object()) {
+                const auto& obj = chunk.as_object();
+                if (auto choices_it = obj.find("choices"); choices_it != obj.end() && choices_it->second.is_array()
+                    && !choices_it->second.as_array().empty() && choices_it->second.as_array().front().is_object()) {
+                    const auto& choice = choices_it->second.as_array().front().as_object();
                     if (auto delta_it = choice.find("delta"); delta_it != choice.end() && delta_it->second.is_object()) {
-                        const auto& delta = delta_it->second.as_object();
-                        if (auto content_it = delta.find("content"); content_it != delta.end()) {
-                            const std::string content = strip(flatten_content(content_it->second));
-                            if (!content.empty()) {
-                                return content;
-                            }
+                        const auto& delta_obj = delta_it->second.as_object();
+                        if (auto content_it = delta_obj.find("content"); content_it != delta_obj.end()) {
+                            delta = flatten_content(content_it->second);
                         }
                     }
-                    if (auto text_it = choice.find("text"); text_it != choice.end() && text_it->second.is_string()) {
-                        return strip(text_it->second.as_string());
-                    }
                 }
             }
+            if (!delta.empty()) {
+                reply += delta;
+                on_delta(delta);
+            }
+        };
+
+        almondai::net::HttpClient::shared().post_stream(
+            m_endpoint, build_body(messages, true), headers(), [&](std::string_view chunk) {
+                if (!saw_event) {
+                    raw.append(chunk);
+                }
+                pending.append(chunk);
+                std::size_t start = 0;
+                for (std::size_t newline = pending.find('\n'); newline != std::string::npos;
+                     newline = pending.find('\n', start)) {
+                    handle_line(pending.substr(start, newline - start));
+                    start = newline + 1;
+                }
+                pending.erase(0, start);
+            });
+        if (!pending.empty()) {
+            handle_line(std::move(pending));
         }
-        return {};
+        if (!saw_event) {
+            std::string whole = extract_completion(Json::parse(raw));
+            if (!whole.empty()) {
+                on_delta(whole);
+            }
+            return whole;
+        }
+        return strip(reply);
+    }
+
+private:
+    std::string build_body(const std::vector<Message>& messages, bool stream) const {
+        JsonObject payload;
+        payload["model"] = Json(m_model);
+        payload["messages"] = Json(serialize_chat_messages(messages));
+        if (stream) {
+            payload["stream"] = Json(true);
+        }
+        return Json(payload).dump();
+    }
+
+    almondai::net::HeaderList headers() const {
+        almondai::net::HeaderList headers;
+        if (!m_api_key.empty()) {
+            headers.emplace_back("Authorization", "Bearer " + m_api_key);
+        }
+        return headers;
     }
 
 private:
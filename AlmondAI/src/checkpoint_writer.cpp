@@ -0,0 +1,162 @@
+#include "../include/almondai/checkpoint_writer.hpp"
+
+#include <system_error>
+#include <utility>
+
+namespace almondai {
+
+namespace {
+
+std::filesystem::path temporary_sibling(const std::filesystem::path& path) {
+    std::filesystem::path temp = path;
+    temp += ".tmp";
+    return temp;
+}
+
+template <typename Writer>
+bool write_atomically(const std::filesystem::path& path, Writer&& writer) {
+    if (path.empty()) {
+        return true;
+    }
+    std::error_code ec;
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path(), ec);
+    }
+    const auto temp = temporary_sibling(path);
+    if (!writer(temp.string())) {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+CheckpointWriter::CheckpointWriter(Targets targets) : CheckpointWriter(std::move(targets), Policy{}) {}
+
+CheckpointWriter::CheckpointWriter(Targets targets, Policy policy)
+    : m_targets(std::move(targets)),
+      m_policy(policy),
+      m_last_queued_at(std::chrono::steady_clock::now()),
+      m_worker([this] { run(); }) {}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::scoped_lock lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_ready.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+void CheckpointWriter::set_policy(Policy policy) {
+    std::scoped_lock lock(m_mutex);
+    m_policy = policy;
+}
+
+bool CheckpointWriter::request(const BaseDecoder& decoder, std::optional<std::size_t> step) {
+    std::unique_lock lock(m_mutex);
+    m_dirty = true;
+    const auto now = std::chrono::steady_clock::now();
+    const bool step_due = step && *step >= m_last_queued_step + m_policy.step_interval;
+    const bool time_due = now - m_last_queued_at >= m_policy.time_interval;
+    if (!step_due && !time_due) {
+        return false;
+    }
+    enqueue_locked(decoder, step);
+    lock.unlock();
+    m_work_ready.notify_one();
+    return true;
+}
+
+bool CheckpointWriter::flush(const BaseDecoder& decoder, std::optional<std::size_t> step) {
+    std::unique_lock lock(m_mutex);
+    const std::size_t generation = enqueue_locked(decoder, step);
+    m_work_ready.notify_one();
+    m_work_done.wait(lock, [&] { return m_completed_generation >= generation; });
+    return m_last_write_ok;
+}
+
+CheckpointWriter::Status CheckpointWriter::status() const {
+    std::scoped_lock lock(m_mutex);
+    Status status;
+    status.writes_completed = m_writes_completed;
+    status.last_step = m_last_step;
+    status.last_write_ok = m_last_write_ok;
+    status.dirty = m_dirty;
+    return status;
+}
+
+std::size_t CheckpointWriter::enqueue_locked(const BaseDecoder& decoder, std::optional<std::size_t> step) {
+    // Copying the weights is the only real work done on the caller's thread;
+    // the tokenizer vocabularies are immutable and captured by reference.
+    const std::size_t generation = m_next_generation++;
+    std::optional<TokenizerCoordinator::Snapshot> tokenizers;
+    if (m_targets.tokenizers) {
+        tokenizers = m_targets.tokenizers->capture();
+        // A replaced job may have held the only record of a change.
+        if (m_pending && m_pending->tokenizers) {
+            tokenizers->dirty = tokenizers->dirty || m_pending->tokenizers->dirty;
+        }
+    }
+    m_pending.reset();
+    m_pending.emplace(Job{decoder, std::move(tokenizers), step, generation});
+    m_dirty = false;
+    if (step) {
+        m_last_queued_step = *step;
+    }
+    m_last_queued_at = std::chrono::steady_clock::now();
+    return generation;
+}
+
+void CheckpointWriter::run() {
+    std::unique_lock lock(m_mutex);
+    while (true) {
+        m_work_ready.wait(lock, [this] { return m_pending.has_value() || m_stopping; });
+        if (!m_pending) {
+            return;
+        }
+        Job job = std::move(*m_pending);
+        m_pending.reset();
+        lock.unlock();
+        const bool ok = write(job);
+        lock.lock();
+        m_completed_generation = job.generation;
+        m_last_write_ok = ok;
+        ++m_writes_completed;
+        if (ok && job.step) {
+            m_last_step = job.step;
+        }
+        m_work_done.notify_all();
+    }
+}
+
+bool CheckpointWriter::write(const Job& job) const {
+    bool ok = write_atomically(m_targets.json_weights, [&](const std::string& path) {
+        return job.snapshot.save_weights(path);
+    });
+    ok = write_atomically(m_targets.binary_weights, [&](const std::string& path) {
+        return job.snapshot.save_weights_binary(path);
+    }) && ok;
+    if (m_targets.tokenizers && job.tokenizers) {
+        m_targets.tokenizers->persist(*job.tokenizers, job.step);
+        if (job.step) {
+            std::size_t retention = 0;
+            {
+                std::scoped_lock lock(m_mutex);
+                retention = m_policy.retention;
+            }
+            m_targets.tokenizers->prune_versions(retention);
+        }
+    }
+    return ok;
+}
+
+} // namespace almondai
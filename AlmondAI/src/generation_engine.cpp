@@ -0,0 +1,238 @@
+#include "../include/almondai/generation_engine.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+namespace almondai {
+
+namespace {
+
+// The next token for a sequence, or -1 once it has ended.
+int choose_token(Sampler& sampler,
+                 GenerationRequest& request,
+                 std::span<const double> logits,
+                 const std::vector<int>& generated) {
+    const bool allow_eos = generated.size() >= static_cast<std::size_t>(std::max(request.min_tokens, 0));
+    int next = sampler.sample(logits, request.sampling, request.rng, generated, allow_eos ? -1 : request.eos_token);
+    if (next == request.eos_token && !allow_eos) {
+        // The sampler only returns a suppressed token when nothing else is drawable.
+        double best = std::numeric_limits<double>::lowest();
+        next = -1;
+        for (std::size_t idx = 0; idx < logits.size(); ++idx) {
+            if (static_cast<int>(idx) != request.eos_token && logits[idx] > best) {
+                best = logits[idx];
+                next = static_cast<int>(idx);
+            }
+        }
+    }
+    return next == request.eos_token ? -1 : next;
+}
+
+} // namespace
+
+struct GenerationEngine::Sequence {
+    Sequence(GenerationRequest request_in, const BaseDecoder& decoder, bool streaming_in)
+        : request(std::move(request_in)), session(decoder), streaming(streaming_in) {
+        session.append(request.prompt);
+        generated.reserve(static_cast<std::size_t>(request.max_tokens));
+    }
+
+    // Owned by the worker while the sequence is active.
+    GenerationRequest request;
+    DecodeSession session;
+    std::vector<int> generated;
+    std::size_t published = 0;
+    bool finished = false;
+
+    // Guarded by the engine mutex.
+    bool streaming;
+    bool cancelled = false;
+    bool done = false;
+    std::vector<int> pending;
+    std::exception_ptr error;
+    std::condition_variable ready;
+};
+
+GenerationEngine::GenerationEngine(const StudentModel& model) : GenerationEngine(model, Options{}) {}
+
+GenerationEngine::GenerationEngine(const StudentModel& model, Options options)
+    : m_model(&model), m_options(options) {
+    m_options.max_batch = std::max<std::size_t>(1, m_options.max_batch);
+    m_worker = std::thread([this] { run(); });
+}
+
+GenerationEngine::~GenerationEngine() {
+    {
+        std::scoped_lock lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_ready.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+std::vector<int> GenerationEngine::generate(GenerationRequest request, const std::function<void(int)>& on_token) {
+    if (request.max_tokens <= 0) {
+        return {};
+    }
+    auto sequence = std::make_shared<Sequence>(std::move(request), m_model->base(), static_cast<bool>(on_token));
+
+    std::unique_lock lock(m_mutex);
+    if (m_stopping) {
+        throw std::runtime_error("generation engine stopped");
+    }
+    m_waiting.push_back(sequence);
+    ++m_stats.requests;
+    m_work_ready.notify_one();
+
+    std::exception_ptr callback_error;
+    while (true) {
+        sequence->ready.wait(lock, [&] { return sequence->done || !sequence->pending.empty(); });
+        if (sequence->pending.empty()) {
+            break;
+        }
+        std::vector<int> tokens;
+        tokens.swap(sequence->pending);
+        lock.unlock();
+        try {
+            for (int token : tokens) {
+                on_token(token);
+            }
+        } catch (...) {
+            callback_error = std::current_exception();
+        }
+        lock.lock();
+        if (callback_error) {
+            // Keep waiting until the worker lets go: it is still reading the model.
+            sequence->cancelled = true;
+            sequence->streaming = false;
+            sequence->pending.clear();
+        }
+    }
+    lock.unlock();
+
+    if (callback_error) {
+        std::rethrow_exception(callback_error);
+    }
+    if (sequence->error) {
+        std::rethrow_exception(sequence->error);
+    }
+    return std::move(sequence->generated);
+}
+
+GenerationEngine::Stats GenerationEngine::stats() const {
+    std::scoped_lock lock(m_mutex);
+    return m_stats;
+}
+
+void GenerationEngine::run() {
+    std::vector<std::shared_ptr<Sequence>> active;
+    auto retire = [](Sequence& sequence) {
+        sequence.done = true;
+        sequence.ready.notify_all();
+    };
+
+    std::unique_lock lock(m_mutex);
+    while (true) {
+        m_work_ready.wait(lock, [&] { return m_stopping || !active.empty() || !m_waiting.empty(); });
+        if (m_stopping) {
+            const auto error = std::make_exception_ptr(std::runtime_error("generation engine stopped"));
+            for (auto& sequence : active) {
+                sequence->error = error;
+                retire(*sequence);
+            }
+            for (auto& sequence : m_waiting) {
+                sequence->error = error;
+                retire(*sequence);
+            }
+            m_waiting.clear();
+            return;
+        }
+
+        while (!m_waiting.empty() && active.size() < m_options.max_batch) {
+            active.push_back(std::move(m_waiting.front()));
+            m_waiting.pop_front();
+        }
+        std::erase_if(active, [&](const auto& sequence) {
+            if (sequence->cancelled) {
+                retire(*sequence);
+            }
+            return sequence->cancelled;
+        });
+        if (active.empty()) {
+            continue;
+        }
+        m_stats.peak_batch = std::max(m_stats.peak_batch, active.size());
+
+        lock.unlock();
+        std::exception_ptr error;
+        std::size_t produced = 0;
+        try {
+            produced = step(active);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        ++m_stats.steps;
+        m_stats.tokens += produced;
+        for (auto& sequence : active) {
+            if (error) {
+                sequence->error = error;
+                sequence->finished = true;
+            } else if (sequence->streaming && sequence->published < sequence->generated.size()) {
+                sequence->pending.insert(sequence->pending.end(),
+                                         sequence->generated.begin() + static_cast<std::ptrdiff_t>(sequence->published),
+                                         sequence->generated.end());
+                sequence->published = sequence->generated.size();
+                if (!sequence->finished) {
+                    sequence->ready.notify_all();
+                }
+            }
+            if (sequence->finished) {
+                retire(*sequence);
+            }
+        }
+        std::erase_if(active, [](const auto& sequence) { return sequence->finished; });
+    }
+}
+
+std::size_t GenerationEngine::step(const std::vector<std::shared_ptr<Sequence>>& active) {
+    const BaseDecoder& decoder = m_model->base();
+    const std::size_t hidden = decoder.config().hidden_size;
+    const std::size_t vocab = decoder.config().vocab_size;
+    const std::size_t count = active.size();
+
+    m_pooled.resize(count * hidden);
+    for (std::size_t r = 0; r < count; ++r) {
+        active[r]->session.pooled(std::span<double>(m_pooled.data() + r * hidden, hidden));
+    }
+    decoder.forward_pooled(m_pooled, count, m_logits);
+
+    std::size_t produced = 0;
+    for (std::size_t r = 0; r < count; ++r) {
+        Sequence& sequence = *active[r];
+        const std::span<double> logits(m_logits.data() + r * vocab, vocab);
+        if (sequence.session.token_count() == 0) {
+            // Matches BaseDecoder::forward on an empty context.
+            std::fill(logits.begin(), logits.end(), 0.0);
+        }
+        const int next = choose_token(m_sampler, sequence.request, logits, sequence.generated);
+        if (next < 0) {
+            sequence.finished = true;
+            continue;
+        }
+        sequence.generated.push_back(next);
+        sequence.session.append(next);
+        ++produced;
+        sequence.finished = sequence.generated.size() >= static_cast<std::size_t>(sequence.request.max_tokens);
+    }
+    return produced;
+}
+
+} // namespace almondai
@@ -205,9 +205,10 @@ namespace almondai {
         static const std::regex email(
             R"(([A-Za-z0-9._%+\-]+@[A-Za-z0-9.\-]+\.[A-Za-z]{2,}))",
             std::regex::ECMAScript);
-        // E.164-ish, avoid IDs
+        // E.164-ish, avoid IDs. std::regex has no lookbehind, so the leading
+        // boundary is matched as a non-digit instead.
         static const std::regex phone(
-            R"((?<!\d)(?:\+?\d{1,3}[\s\-]?)?(?:\(?\d{3}\)?[\s\-]?)\d{3}[\s\-]?\d{4}(?!\d))",
+            R"((?:^|\D)(?:\+?\d{1,3}[\s\-]?)?(?:\(?\d{3}\)?[\s\-]?)\d{3}[\s\-]?\d{4}(?!\d))",
             std::regex::ECMAScript);
         return std::regex_search(text, email) || std::regex_search(text, phone);
     }
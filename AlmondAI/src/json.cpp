@@ -1,258 +1,369 @@
 #include "../include/almondai/json.hpp"
 
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <stdexcept>
-#include <iomanip>
+#include <system_error>
 #include <type_traits>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ALMONDAI_JSON_SSE2 1
+#include <emmintrin.h>
+#endif
+
 namespace almondai {
 
-void Json::dump_internal(std::ostringstream& oss) const {
-    std::visit([
-                   &oss](const auto& value) {
-                       using T = std::decay_t<decltype(value)>;
-                       if constexpr (std::is_same_v<T, std::nullptr_t>) {
-                           oss << "null";
-                       } else if constexpr (std::is_same_v<T, bool>) {
-                           oss << (value ? "true" : "false");
-                       } else if constexpr (std::is_same_v<T, double>) {
-                           oss << value;
-                       } else if constexpr (std::is_same_v<T, std::string>) {
-                           oss << '"';
-                           for (char c : value) {
-                               switch (c) {
-                               case '"': oss << "\\\""; break;
-                               case '\\': oss << "\\\\"; break;
-                               case '\n': oss << "\\n"; break;
-                               case '\r': oss << "\\r"; break;
-                               case '\t': oss << "\\t"; break;
-                               default:
-                                   if (static_cast<unsigned char>(c) < 0x20) {
-                                       oss << "\\u" << std::hex << std::setw(4) << std::setfill('0')
-                                           << static_cast<int>(static_cast<unsigned char>(c)) << std::dec
-                                           << std::setfill(' ');
-                                   } else {
-                                       oss << c;
-                                   }
-                               }
-                           }
-                           oss << '"';
-                       } else if constexpr (std::is_same_v<T, JsonArray>) {
-                           oss << '[';
-                           bool first = true;
-                           for (const auto& item : value) {
-                               if (!first) {
-                                   oss << ',';
-                               }
-                               first = false;
-                               item.dump_internal(oss);
-                           }
-                           oss << ']';
-                       } else if constexpr (std::is_same_v<T, JsonObject>) {
-                           oss << '{';
-                           bool first = true;
-                           for (const auto& [key, val] : value) {
-                               if (!first) {
-                                   oss << ',';
-                               }
-                               first = false;
-                               oss << '"' << key << '"' << ':';
-                               val.dump_internal(oss);
-                           }
-                           oss << '}';
-                       }
-                   },
-               m_value);
-}
+namespace {
 
-void Json::skip_ws(std::string_view text, std::size_t& pos) {
-    while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
-        ++pos;
+// Length of the leading run of bytes that need no escaping in a JSON string
+// (anything but '"', '\\' and control characters).
+std::size_t plain_run(const char* data, std::size_t size) {
+    std::size_t i = 0;
+#ifdef ALMONDAI_JSON_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(0x20);
+    for (; i + 16 <= size; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        // Unsigned saturating subtract: zero exactly when the byte is >= 0x20,
+        // which a signed compare would get wrong for UTF-8 bytes.
+        const __m128i printable = _mm_cmpeq_epi8(_mm_subs_epu8(space, chunk), _mm_setzero_si128());
+        const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                             _mm_andnot_si128(printable, _mm_set1_epi8(-1)));
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+        if (mask != 0) {
+            return i + static_cast<std::size_t>(std::countr_zero(mask));
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+        if (c == '"' || c == '\\' || c < 0x20) {
+            return i;
+        }
     }
+    return size;
 }
 
-Json Json::parse(std::string_view text) {
-    std::size_t pos = 0;
-    skip_ws(text, pos);
-    Json value = parse_value(text, pos);
-    skip_ws(text, pos);
-    if (pos != text.size()) {
-        throw std::runtime_error("unexpected trailing characters in JSON");
+void append_escaped(std::string& out, std::string_view text) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    out.push_back('"');
+    while (!text.empty()) {
+        const std::size_t run = plain_run(text.data(), text.size());
+        out.append(text.data(), run);
+        if (run == text.size()) {
+            break;
+        }
+        const char c = text[run];
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default: {
+            const auto code = static_cast<unsigned char>(c);
+            const char escape[6] = {'\\', 'u', '0', '0', kHex[code >> 4], kHex[code & 0xF]};
+            out.append(escape, sizeof(escape));
+        }
+        }
+        text.remove_prefix(run + 1);
     }
-    return value;
+    out.push_back('"');
 }
 
-Json Json::parse_value(std::string_view text, std::size_t& pos) {
-    skip_ws(text, pos);
-    if (pos >= text.size()) {
-        throw std::runtime_error("unexpected end of JSON");
-    }
-    const char c = text[pos];
-    if (c == '"') {
-        return parse_string(text, pos);
-    }
-    if (c == '[') {
-        return parse_array(text, pos);
+void append_number(std::string& out, double value) {
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+void append_utf8(std::string& out, std::uint32_t code) {
+    if (code <= 0x7F) {
+        out.push_back(static_cast<char>(code));
+    } else if (code <= 0x7FF) {
+        out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code <= 0xFFFF) {
+        out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
     }
-    if (c == '{') {
-        return parse_object(text, pos);
+}
+
+class Parser {
+public:
+    explicit Parser(std::string_view text) : m_cur(text.data()), m_end(text.data() + text.size()) {}
+
+    Json parse_document() {
+        skip_ws();
+        Json value = parse_value();
+        skip_ws();
+        if (m_cur != m_end) {
+            throw std::runtime_error("unexpected trailing characters in JSON");
+        }
+        return value;
     }
-    if (std::isdigit(static_cast<unsigned char>(c)) || c == '-') {
-        std::size_t start = pos;
-        ++pos;
-        while (pos < text.size() && (std::isdigit(static_cast<unsigned char>(text[pos])) || text[pos] == '.' || text[pos] == 'e' || text[pos] == 'E' || text[pos] == '+' || text[pos] == '-')) {
-            ++pos;
+
+private:
+    const char* m_cur;
+    const char* m_end;
+
+    void skip_ws() {
+        while (m_cur != m_end && (*m_cur == ' ' || *m_cur == '\n' || *m_cur == '\r' || *m_cur == '\t')) {
+            ++m_cur;
         }
-        return Json(std::stod(std::string(text.substr(start, pos - start))));
     }
-    if (text.substr(pos, 4) == "true") {
-        pos += 4;
-        return Json(true);
+
+    bool consume_literal(std::string_view literal) {
+        if (static_cast<std::size_t>(m_end - m_cur) >= literal.size()
+            && std::memcmp(m_cur, literal.data(), literal.size()) == 0) {
+            m_cur += literal.size();
+            return true;
+        }
+        return false;
     }
-    if (text.substr(pos, 5) == "false") {
-        pos += 5;
-        return Json(false);
+
+    Json parse_value() {
+        skip_ws();
+        if (m_cur == m_end) {
+            throw std::runtime_error("unexpected end of JSON");
+        }
+        const char c = *m_cur;
+        if (c == '"') {
+            std::string text;
+            parse_string(text);
+            return Json(std::move(text));
+        }
+        if (c == '[') {
+            return parse_array();
+        }
+        if (c == '{') {
+            return parse_object();
+        }
+        if ((c >= '0' && c <= '9') || c == '-') {
+            return parse_number();
+        }
+        if (consume_literal("true")) {
+            return Json(true);
+        }
+        if (consume_literal("false")) {
+            return Json(false);
+        }
+        if (consume_literal("null")) {
+            return Json(nullptr);
+        }
+        throw std::runtime_error("invalid JSON token");
     }
-    if (text.substr(pos, 4) == "null") {
-        pos += 4;
-        return Json(nullptr);
+
+    Json parse_number() {
+        double value = 0.0;
+        const auto result = std::from_chars(m_cur, m_end, value);
+        if (result.ec == std::errc::invalid_argument) {
+            throw std::runtime_error("invalid JSON number");
+        }
+        // Out-of-range values leave ptr past the number; keep the old
+        // std::stod behaviour of rejecting them.
+        if (result.ec == std::errc::result_out_of_range) {
+            throw std::out_of_range("JSON number out of range");
+        }
+        m_cur = result.ptr;
+        return Json(value);
     }
-    throw std::runtime_error("invalid JSON token");
-}
 
-Json Json::parse_string(std::string_view text, std::size_t& pos) {
-    if (text[pos] != '"') {
-        throw std::runtime_error("expected string");
+    unsigned parse_hex4() {
+        if (m_end - m_cur < 4) {
+            throw std::runtime_error("invalid unicode escape");
+        }
+        unsigned code = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char h = *m_cur++;
+            code <<= 4;
+            if (h >= '0' && h <= '9') {
+                code |= static_cast<unsigned>(h - '0');
+            } else if (h >= 'a' && h <= 'f') {
+                code |= static_cast<unsigned>(h - 'a' + 10);
+            } else if (h >= 'A' && h <= 'F') {
+                code |= static_cast<unsigned>(h - 'A' + 10);
+            } else {
+                throw std::runtime_error("invalid unicode escape");
+            }
+        }
+        return code;
     }
-    ++pos;
-    std::string result;
-    bool closed = false;
-    while (pos < text.size()) {
-        char c = text[pos++];
-        if (c == '"') {
-            closed = true;
-            break;
+
+    void parse_string(std::string& out) {
+        if (m_cur == m_end || *m_cur != '"') {
+            throw std::runtime_error("expected string");
         }
-        if (c == '\\') {
-            if (pos >= text.size()) {
+        ++m_cur;
+        while (true) {
+            // Copy everything up to the next quote or backslash in one go.
+            // Raw control characters are accepted, as before.
+            std::size_t run = plain_run(m_cur, static_cast<std::size_t>(m_end - m_cur));
+            while (m_cur + run != m_end && static_cast<unsigned char>(m_cur[run]) < 0x20) {
+                run += 1 + plain_run(m_cur + run + 1, static_cast<std::size_t>(m_end - m_cur - run - 1));
+            }
+            out.append(m_cur, run);
+            m_cur += run;
+            if (m_cur == m_end) {
+                throw std::runtime_error("unterminated string");
+            }
+            if (*m_cur++ == '"') {
+                return;
+            }
+            if (m_cur == m_end) {
                 throw std::runtime_error("invalid escape");
             }
-            char esc = text[pos++];
-            switch (esc) {
-            case '"': result.push_back('"'); break;
-            case '\\': result.push_back('\\'); break;
-            case '/': result.push_back('/'); break;
-            case 'b': result.push_back('\b'); break;
-            case 'f': result.push_back('\f'); break;
-            case 'n': result.push_back('\n'); break;
-            case 'r': result.push_back('\r'); break;
-            case 't': result.push_back('\t'); break;
+            switch (*m_cur++) {
+            case '"': out.push_back('"'); break;
+            case '\\': out.push_back('\\'); break;
+            case '/': out.push_back('/'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
             case 'u': {
-                if (pos + 4 > text.size()) {
-                    throw std::runtime_error("invalid unicode escape");
-                }
-                // Minimal handling: read hex and keep as UTF-8 by encoding as bytes if <= 0x7F.
-                unsigned code = 0;
-                for (int i = 0; i < 4; ++i) {
-                    char h = text[pos++];
-                    code <<= 4;
-                    if (h >= '0' && h <= '9') {
-                        code |= static_cast<unsigned>(h - '0');
-                    } else if (h >= 'a' && h <= 'f') {
-                        code |= static_cast<unsigned>(h - 'a' + 10);
-                    } else if (h >= 'A' && h <= 'F') {
-                        code |= static_cast<unsigned>(h - 'A' + 10);
-                    } else {
-                        throw std::runtime_error("invalid unicode escape");
-                    }
-                }
-                if (code <= 0x7F) {
-                    result.push_back(static_cast<char>(code));
-                } else {
-                    // Basic UTF-8 encoding for BMP subset.
-                    if (code <= 0x7FF) {
-                        result.push_back(static_cast<char>(0xC0 | ((code >> 6) & 0x1F)));
-                        result.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                std::uint32_t code = parse_hex4();
+                if (code >= 0xD800 && code <= 0xDBFF && m_end - m_cur >= 6 && m_cur[0] == '\\' && m_cur[1] == 'u') {
+                    const char* rewind = m_cur;
+                    m_cur += 2;
+                    const unsigned low = parse_hex4();
+                    if (low >= 0xDC00 && low <= 0xDFFF) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
                     } else {
-                        result.push_back(static_cast<char>(0xE0 | ((code >> 12) & 0x0F)));
-                        result.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
-                        result.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                        m_cur = rewind;
                     }
                 }
+                append_utf8(out, code);
                 break;
             }
             default:
                 throw std::runtime_error("invalid escape");
             }
-        } else {
-            result.push_back(c);
         }
     }
-    if (!closed) {
-        throw std::runtime_error("unterminated string");
-    }
-    return Json(result);
-}
 
-Json Json::parse_array(std::string_view text, std::size_t& pos) {
-    if (text[pos] != '[') {
-        throw std::runtime_error("expected array");
-    }
-    ++pos;
-    JsonArray arr;
-    skip_ws(text, pos);
-    if (pos < text.size() && text[pos] == ']') {
-        ++pos;
-        return Json(arr);
-    }
-    while (pos < text.size()) {
-        arr.emplace_back(parse_value(text, pos));
-        skip_ws(text, pos);
-        if (pos < text.size() && text[pos] == ',') {
-            ++pos;
-            continue;
+    Json parse_array() {
+        ++m_cur;
+        JsonArray arr;
+        skip_ws();
+        if (m_cur != m_end && *m_cur == ']') {
+            ++m_cur;
+            return Json(std::move(arr));
         }
-        if (pos < text.size() && text[pos] == ']') {
-            ++pos;
-            break;
+        // An unterminated array reaches parse_value at the end and throws.
+        while (true) {
+            arr.emplace_back(parse_value());
+            skip_ws();
+            if (m_cur != m_end && *m_cur == ',') {
+                ++m_cur;
+                continue;
+            }
+            if (m_cur != m_end && *m_cur == ']') {
+                ++m_cur;
+                break;
+            }
+            throw std::runtime_error("expected comma or closing bracket");
         }
-        throw std::runtime_error("expected comma or closing bracket");
+        return Json(std::move(arr));
     }
-    return Json(arr);
-}
 
-Json Json::parse_object(std::string_view text, std::size_t& pos) {
-    if (text[pos] != '{') {
-        throw std::runtime_error("expected object");
-    }
-    ++pos;
-    JsonObject obj;
-    skip_ws(text, pos);
-    if (pos < text.size() && text[pos] == '}') {
-        ++pos;
-        return Json(obj);
-    }
-    while (pos < text.size()) {
-        skip_ws(text, pos);
-        Json key = parse_string(text, pos);
-        skip_ws(text, pos);
-        if (pos >= text.size() || text[pos] != ':') {
-            throw std::runtime_error("expected colon");
-        }
-        ++pos;
-        obj.emplace(key.as_string(), parse_value(text, pos));
-        skip_ws(text, pos);
-        if (pos < text.size() && text[pos] == ',') {
-            ++pos;
-            continue;
+    Json parse_object() {
+        ++m_cur;
+        JsonObject obj;
+        skip_ws();
+        if (m_cur != m_end && *m_cur == '}') {
+            ++m_cur;
+            return Json(std::move(obj));
         }
-        if (pos < text.size() && text[pos] == '}') {
-            ++pos;
-            break;
+        std::string key;
+        while (true) {
+            skip_ws();
+            key.clear();
+            parse_string(key);
+            skip_ws();
+            if (m_cur == m_end || *m_cur != ':') {
+                throw std::runtime_error("expected colon");
+            }
+            ++m_cur;
+            Json value = parse_value();
+            // Our own writer emits keys in sorted order, so hinting at the end
+            // makes each insertion constant time for documents we produced.
+            // Duplicate keys keep the first value, as emplace did.
+            if (obj.empty() || obj.rbegin()->first < key) {
+                obj.emplace_hint(obj.end(), key, std::move(value));
+            } else {
+                obj.emplace(key, std::move(value));
+            }
+            skip_ws();
+            if (m_cur != m_end && *m_cur == ',') {
+                ++m_cur;
+                continue;
+            }
+            if (m_cur != m_end && *m_cur == '}') {
+                ++m_cur;
+                break;
+            }
+            throw std::runtime_error("expected comma or closing brace");
         }
-        throw std::runtime_error("expected comma or closing brace");
+        return Json(std::move(obj));
     }
-    return Json(obj);
+};
+
+} // namespace
+
+void Json::dump_to(std::string& out) const {
+    std::visit(
+        [&out](const auto& value) {
+            using T = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<T, std::nullptr_t>) {
+                out += "null";
+            } else if constexpr (std::is_same_v<T, bool>) {
+                out += value ? "true" : "false";
+            } else if constexpr (std::is_same_v<T, double>) {
+                append_number(out, value);
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                append_escaped(out, value);
+            } else if constexpr (std::is_same_v<T, JsonArray>) {
+                out.push_back('[');
+                bool first = true;
+                for (const auto& item : value) {
+                    if (!first) {
+                        out.push_back(',');
+                    }
+                    first = false;
+                    item.dump_to(out);
+                }
+                out.push_back(']');
+            } else if constexpr (std::is_same_v<T, JsonObject>) {
+                out.push_back('{');
+                bool first = true;
+                for (const auto& [key, val] : value) {
+                    if (!first) {
+                        out.push_back(',');
+                    }
+                    first = false;
+                    append_escaped(out, key);
+                    out.push_back(':');
+                    val.dump_to(out);
+                }
+                out.push_back('}');
+            }
+        },
+        m_value);
 }
 
-} // namespace almondai
+Json Json::parse(std::string_view text) {
+    return Parser(text).parse_document();
+}
 
+} // namespace almondai
@@ -0,0 +1,357 @@
+#include "../include/almondai/jsonl_index.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <system_error>
+#include <utility>
+
+namespace almondai {
+
+namespace {
+
+constexpr char kSidecarMagic[8] = {'A', 'L', 'M', 'D', 'J', 'I', 'D', 'X'};
+constexpr std::uint32_t kSidecarVersion = 1;
+constexpr std::size_t kSidecarHeaderSize = 8 + 4 + 4;
+constexpr std::uint32_t kSidecarRecordSize = 8 + 4 + 8;
+
+std::uint64_t fnv1a(std::string_view text) {
+    std::uint64_t hash = 1469598103934665603ull;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename T>
+void append_pod(std::string& buffer, const T& value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    buffer.append(bytes, sizeof(T));
+}
+
+template <typename T>
+bool read_pod(const char* data, std::size_t size, std::size_t& offset, T& value) {
+    if (offset + sizeof(T) > size) {
+        return false;
+    }
+    std::memcpy(&value, data + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+std::uint64_t end_of(const JsonlIndex::Record& record) {
+    return record.offset + record.length + 1;
+}
+
+bool matches(std::string_view view, const JsonlIndex::Record& record) {
+    return end_of(record) <= view.size() && view[record.offset + record.length] == '\n'
+           && fnv1a(view.substr(record.offset, record.length)) == record.hash;
+}
+
+} // namespace
+
+JsonlIndex::JsonlIndex(std::filesystem::path path, bool persist_sidecar)
+    : m_path(std::move(path)), m_persist_sidecar(persist_sidecar) {}
+
+std::shared_ptr<JsonlIndex> JsonlIndex::shared(const std::filesystem::path& path) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::path key = fs::weakly_canonical(path, ec);
+    if (ec || key.empty()) {
+        key = fs::absolute(path, ec);
+        if (ec || key.empty()) {
+            key = path;
+        }
+    }
+    struct Slot {
+        std::shared_ptr<JsonlIndex> index;
+        std::uint64_t last_used = 0;
+    };
+    static std::mutex registry_mutex;
+    static std::map<std::string, Slot> registry;
+    static std::uint64_t clock = 0;
+    std::scoped_lock lock(registry_mutex);
+    auto& slot = registry[key.string()];
+    slot.last_used = ++clock;
+    if (!slot.index) {
+        slot.index = std::make_shared<JsonlIndex>(key);
+    }
+    auto index = slot.index;
+    while (registry.size() > kMaxShared) {
+        auto oldest = registry.end();
+        for (auto it = registry.begin(); it != registry.end(); ++it) {
+            const bool idle = it->second.index.use_count() == 1;
+            if (idle && (oldest == registry.end() || it->second.last_used < oldest->second.last_used)) {
+                oldest = it;
+            }
+        }
+        if (oldest == registry.end()) {
+            break;
+        }
+        registry.erase(oldest);
+    }
+    return index;
+}
+
+std::filesystem::path JsonlIndex::sidecar_path(const std::filesystem::path& path) {
+    std::filesystem::path sidecar = path;
+    sidecar += ".idx";
+    return sidecar;
+}
+
+bool JsonlIndex::exists() {
+    std::scoped_lock lock(m_mutex);
+    return sync_locked();
+}
+
+std::size_t JsonlIndex::line_count() {
+    std::scoped_lock lock(m_mutex);
+    sync_locked();
+    return line_count_locked();
+}
+
+std::size_t JsonlIndex::non_empty_count() {
+    std::scoped_lock lock(m_mutex);
+    sync_locked();
+    return m_non_empty + (m_tail && m_tail->length > 0 ? 1 : 0);
+}
+
+std::optional<JsonlIndex::Record> JsonlIndex::record(std::size_t line) {
+    std::scoped_lock lock(m_mutex);
+    sync_locked();
+    if (const Record* found = record_locked(line)) {
+        return *found;
+    }
+    return std::nullopt;
+}
+
+std::vector<JsonlIndex::Line> JsonlIndex::read(std::size_t first, std::size_t count) {
+    std::scoped_lock lock(m_mutex);
+    std::vector<Line> lines;
+    if (!sync_locked()) {
+        return lines;
+    }
+    const std::size_t total = line_count_locked();
+    if (first >= total) {
+        return lines;
+    }
+    const std::size_t last = count > total - first ? total : first + count;
+    lines.reserve(last - first);
+    const std::string_view view = m_mapping->view();
+    for (std::size_t n = first; n < last; ++n) {
+        const Record* found = record_locked(n);
+        lines.push_back(Line{n, std::string(view.substr(found->offset, found->length)), n < m_records.size()});
+    }
+    return lines;
+}
+
+void JsonlIndex::for_each(const LineVisitor& visit) {
+    const auto mapping = contents();
+    if (!mapping) {
+        return;
+    }
+    const std::string_view view = mapping->view();
+    std::size_t number = 0;
+    std::size_t pos = 0;
+    while (pos < view.size()) {
+        const std::size_t newline = view.find('\n', pos);
+        const std::size_t end = newline == std::string_view::npos ? view.size() : newline;
+        visit(number++, view.substr(pos, end - pos));
+        pos = end + 1;
+    }
+}
+
+std::shared_ptr<const MappedFile> JsonlIndex::contents() {
+    std::scoped_lock lock(m_mutex);
+    if (!sync_locked()) {
+        return nullptr;
+    }
+    return m_mapping;
+}
+
+bool JsonlIndex::append(std::string_view line) {
+    std::scoped_lock lock(m_mutex);
+    std::error_code ec;
+    if (m_path.has_parent_path()) {
+        std::filesystem::create_directories(m_path.parent_path(), ec);
+    }
+    {
+        std::ofstream out(m_path, std::ios::app | std::ios::binary);
+        if (!out) {
+            return false;
+        }
+        out.write(line.data(), static_cast<std::streamsize>(line.size()));
+        out.put('\n');
+        out.flush();
+        if (!out) {
+            return false;
+        }
+    }
+    sync_locked();
+    return true;
+}
+
+bool JsonlIndex::sync_locked() {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const auto size = fs::file_size(m_path, ec);
+    if (ec) {
+        reset_locked();
+        return false;
+    }
+    const auto time = fs::last_write_time(m_path, ec);
+    if (m_present && size == m_file_size && time == m_file_time) {
+        return true;
+    }
+    if (!m_sidecar_loaded && m_persist_sidecar) {
+        load_sidecar_locked();
+        m_sidecar_loaded = true;
+    }
+
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(m_path)) {
+        reset_locked();
+        return false;
+    }
+    const std::string_view view = mapping->view();
+
+    // Spot-check the indexed prefix; a mismatch means the file was rewritten.
+    if (!m_records.empty() && (!matches(view, m_records.front()) || !matches(view, m_records.back()))) {
+        m_records.clear();
+        m_non_empty = 0;
+        m_sidecar_stale = true;
+    }
+
+    std::size_t pos = m_records.empty() ? 0 : static_cast<std::size_t>(end_of(m_records.back()));
+    m_tail.reset();
+    while (pos < view.size()) {
+        const std::size_t newline = view.find('\n', pos);
+        const std::size_t end = newline == std::string_view::npos ? view.size() : newline;
+        const std::size_t length = std::min<std::size_t>(end - pos, std::numeric_limits<std::uint32_t>::max());
+        Record record{pos, static_cast<std::uint32_t>(length), fnv1a(view.substr(pos, end - pos))};
+        if (newline == std::string_view::npos) {
+            m_tail = record;
+            break;
+        }
+        if (record.length > 0) {
+            ++m_non_empty;
+        }
+        m_records.push_back(record);
+        pos = end + 1;
+    }
+
+    m_mapping = std::move(mapping);
+    m_file_size = size;
+    m_file_time = time;
+    m_present = true;
+    if (m_persist_sidecar && (m_sidecar_stale || m_persisted < m_records.size())) {
+        write_sidecar_locked();
+    }
+    return true;
+}
+
+std::size_t JsonlIndex::line_count_locked() const {
+    return m_records.size() + (m_tail ? 1 : 0);
+}
+
+const JsonlIndex::Record* JsonlIndex::record_locked(std::size_t line) const {
+    if (line < m_records.size()) {
+        return &m_records[line];
+    }
+    if (line == m_records.size() && m_tail) {
+        return &*m_tail;
+    }
+    return nullptr;
+}
+
+void JsonlIndex::load_sidecar_locked() {
+    m_records.clear();
+    m_non_empty = 0;
+    m_persisted = 0;
+    m_sidecar_stale = true;
+
+    MappedFile sidecar;
+    if (!sidecar.open(sidecar_path(m_path)) || sidecar.size() < kSidecarHeaderSize) {
+        return;
+    }
+    const char* data = sidecar.data();
+    const std::size_t size = sidecar.size();
+    if (std::memcmp(data, kSidecarMagic, sizeof(kSidecarMagic)) != 0) {
+        return;
+    }
+    std::size_t offset = sizeof(kSidecarMagic);
+    std::uint32_t version = 0;
+    std::uint32_t record_size = 0;
+    if (!read_pod(data, size, offset, version) || !read_pod(data, size, offset, record_size)
+        || version != kSidecarVersion || record_size != kSidecarRecordSize
+        || (size - offset) % kSidecarRecordSize != 0) {
+        return;
+    }
+    m_records.reserve((size - offset) / kSidecarRecordSize);
+    std::uint64_t expected_offset = 0;
+    while (offset < size) {
+        Record record;
+        read_pod(data, size, offset, record.offset);
+        read_pod(data, size, offset, record.length);
+        read_pod(data, size, offset, record.hash);
+        if (record.offset != expected_offset) {
+            m_records.clear();
+            m_non_empty = 0;
+            return;
+        }
+        expected_offset = end_of(record);
+        if (record.length > 0) {
+            ++m_non_empty;
+        }
+        m_records.push_back(record);
+    }
+    m_persisted = m_records.size();
+    m_sidecar_stale = false;
+}
+
+void JsonlIndex::write_sidecar_locked() {
+    const bool rewrite = m_sidecar_stale || m_persisted > m_records.size();
+    std::string buffer;
+    const std::size_t first = rewrite ? 0 : m_persisted;
+    buffer.reserve((rewrite ? kSidecarHeaderSize : 0) + (m_records.size() - first) * kSidecarRecordSize);
+    if (rewrite) {
+        buffer.append(kSidecarMagic, sizeof(kSidecarMagic));
+        append_pod(buffer, kSidecarVersion);
+        append_pod(buffer, kSidecarRecordSize);
+    }
+    for (std::size_t i = first; i < m_records.size(); ++i) {
+        append_pod(buffer, m_records[i].offset);
+        append_pod(buffer, m_records[i].length);
+        append_pod(buffer, m_records[i].hash);
+    }
+
+    // The sidecar is only an accelerator: if it cannot be written the index
+    // stays in memory and is rebuilt from the file next time.
+    const auto mode = std::ios::binary | (rewrite ? std::ios::trunc : std::ios::app);
+    std::ofstream out(sidecar_path(m_path), mode);
+    if (!out) {
+        return;
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    if (out) {
+        m_persisted = m_records.size();
+        m_sidecar_stale = false;
+    }
+}
+
+void JsonlIndex::reset_locked() {
+    m_mapping.reset();
+    m_present = false;
+    m_file_size = 0;
+    m_records.clear();
+    m_tail.reset();
+    m_non_empty = 0;
+    // Re-read the sidecar if the file reappears.
+    m_sidecar_loaded = false;
+}
+
+} // namespace almondai
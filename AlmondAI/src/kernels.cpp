@@ -0,0 +1,1006 @@
+#include "../include/almondai/kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ALMONDAI_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define ALMONDAI_TARGET(isa)
+#else
+#define ALMONDAI_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace {
+
+using almondai::kernels::Isa;
+
+// Output columns processed per tile; 256 doubles keep a weight row segment and the
+// matching output segment of a few batch rows resident in L1.
+constexpr std::size_t kColumnBlock = 256;
+
+// From this many batch rows, quantized matmuls dequantize each weight row
+// segment once and reuse it; smaller batches convert inside the axpy.
+constexpr std::size_t kDequantizeBatch = 4;
+
+using AxpyFn = void (*)(double, const double*, double*, std::size_t);
+using DotFn = double (*)(const double*, const double*, std::size_t);
+using AxpyF32Fn = void (*)(double, const float*, double*, std::size_t);
+using AxpyIntoF32Fn = void (*)(double, const double*, float*, std::size_t);
+using DotF32Fn = double (*)(const float*, const double*, std::size_t);
+struct AdamWConstants;
+template <typename Param, typename Moment>
+using AdamWFn = void (*)(const AdamWConstants&, Param*, const double*, Moment*, Moment*, std::size_t);
+using ExpSumFn = double (*)(const double*, double, double, double*, std::size_t);
+using DequantizeQ8Fn = void (*)(const std::int8_t*, const float*, double*, std::size_t);
+using DequantizeF16Fn = void (*)(const std::uint16_t*, double*, std::size_t);
+using AxpyQ8Fn = void (*)(double, const std::int8_t*, const float*, double*, std::size_t);
+using AxpyF16Fn = void (*)(double, const std::uint16_t*, double*, std::size_t);
+
+void axpy_scalar(double alpha, const double* x, double* y, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        y[i] += x[i] * alpha;
+    }
+}
+
+// dot accumulates element i into lane i % 8 and folds the lanes in the order
+// the AVX2 and AVX-512 registers reduce in, so every path returns the same bits.
+double fold_dot_lanes(const double* lanes) {
+    return ((lanes[0] + lanes[4]) + (lanes[1] + lanes[5])) + ((lanes[2] + lanes[6]) + (lanes[3] + lanes[7]));
+}
+
+double dot_scalar(const double* a, const double* b, std::size_t n) {
+    double lanes[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    for (std::size_t i = 0; i < n; ++i) {
+        lanes[i % 8] += a[i] * b[i];
+    }
+    return fold_dot_lanes(lanes);
+}
+
+void axpy_f32_scalar(double alpha, const float* x, double* y, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        y[i] += static_cast<double>(x[i]) * alpha;
+    }
+}
+
+void axpy_into_f32_scalar(double alpha, const double* x, float* y, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        y[i] = static_cast<float>(static_cast<double>(y[i]) + x[i] * alpha);
+    }
+}
+
+double dot_f32_scalar(const float* a, const double* b, std::size_t n) {
+    double lanes[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    for (std::size_t i = 0; i < n; ++i) {
+        lanes[i % 8] += static_cast<double>(a[i]) * b[i];
+    }
+    return fold_dot_lanes(lanes);
+}
+
+// Scalar reference for one AdamW element; the vector paths mirror these operations.
+struct AdamWConstants {
+    double lr;
+    double beta1;
+    double beta2;
+    double one_minus_beta1;
+    double one_minus_beta2;
+    double epsilon;
+    double weight_decay;
+    double bias_correction1;
+    double bias_correction2;
+
+    explicit AdamWConstants(const almondai::kernels::AdamWStep& step)
+        : lr(step.learning_rate),
+          beta1(step.beta1),
+          beta2(step.beta2),
+          one_minus_beta1(1.0 - step.beta1),
+          one_minus_beta2(1.0 - step.beta2),
+          epsilon(step.epsilon),
+          weight_decay(step.weight_decay),
+          bias_correction1(step.bias_correction1),
+          bias_correction2(step.bias_correction2) {}
+};
+
+inline void adamw_element(const AdamWConstants& c, double& param, double grad, double& m, double& v) {
+    m = c.beta1 * m + c.one_minus_beta1 * grad;
+    v = c.beta2 * v + c.one_minus_beta2 * (grad * grad);
+    const double m_hat = m / c.bias_correction1;
+    const double v_hat = v / c.bias_correction2;
+    const double update = m_hat / (std::sqrt(v_hat) + c.epsilon);
+    param -= c.lr * (update + c.weight_decay * param);
+}
+
+std::uint16_t to_bf16(float value) {
+    std::uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    bits += 0x7fffu + ((bits >> 16) & 1u);
+    return static_cast<std::uint16_t>(bits >> 16);
+}
+
+float from_bf16(std::uint16_t value) {
+    const std::uint32_t bits = static_cast<std::uint32_t>(value) << 16;
+    float result = 0.0f;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Exact for every finite half: the exponent and mantissa move into a float and
+// the 2^112 factor rebiases the exponent (subnormal halves become normal floats).
+// The quantizer never stores infinities or NaNs.
+float from_fp16(std::uint16_t value) {
+    const std::uint32_t bits = static_cast<std::uint32_t>(value & 0x7fffu) << 13;
+    float magnitude = 0.0f;
+    std::memcpy(&magnitude, &bits, sizeof(magnitude));
+    magnitude *= 0x1p112f;
+    return (value & 0x8000u) != 0 ? -magnitude : magnitude;
+}
+
+// Dequantized values are exact in double (a float scale times a 7-bit integer,
+// or a half), so the quantized matmul equals matmul on the dequantized weights.
+void dequantize_q8_scalar(const std::int8_t* x, const float* scales, double* y, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        y[i] = static_cast<double>(x[i]) * static_cast<double>(scales[i / almondai::kernels::kQuantGroup]);
+    }
+}
+
+void dequantize_f16_scalar(const std::uint16_t* x, double* y, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        y[i] = static_cast<double>(from_fp16(x[i]));
+    }
+}
+
+void axpy_q8_scalar(double alpha, const std::int8_t* x, const float* scales, double* y, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        y[i] += static_cast<double>(x[i]) * static_cast<double>(scales[i / almondai::kernels::kQuantGroup]) * alpha;
+    }
+}
+
+void axpy_f16_scalar(double alpha, const std::uint16_t* x, double* y, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        y[i] += static_cast<double>(from_fp16(x[i])) * alpha;
+    }
+}
+
+// `Param` is double or float; float parameters are updated in double and
+// rounded on store.
+template <typename Param>
+void adamw_f64_scalar(const AdamWConstants& c, Param* p, const double* g, double* m, double* v, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        double p_i = p[i];
+        adamw_element(c, p_i, g[i], m[i], v[i]);
+        p[i] = static_cast<Param>(p_i);
+    }
+}
+
+template <typename Param>
+void adamw_f32_scalar(const AdamWConstants& c, Param* p, const double* g, float* m, float* v, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        double p_i = p[i];
+        double m_i = m[i];
+        double v_i = v[i];
+        adamw_element(c, p_i, g[i], m_i, v_i);
+        p[i] = static_cast<Param>(p_i);
+        m[i] = static_cast<float>(m_i);
+        v[i] = static_cast<float>(v_i);
+    }
+}
+
+template <typename Param>
+void adamw_bf16_scalar(const AdamWConstants& c, Param* p, const double* g,
+                       std::uint16_t* m, std::uint16_t* v, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        double p_i = p[i];
+        double m_i = from_bf16(m[i]);
+        double v_i = from_bf16(v[i]);
+        adamw_element(c, p_i, g[i], m_i, v_i);
+        p[i] = static_cast<Param>(p_i);
+        m[i] = to_bf16(static_cast<float>(m_i));
+        v[i] = to_bf16(static_cast<float>(v_i));
+    }
+}
+
+// exp() by reduction to r = a - k ln2 with |r| <= ln2 / 2 (ln2 split in two for
+// an exact k ln2) and a degree-13 Taylor polynomial in r, accurate to a few
+// ulp. Arguments below kExpMin give 0; the vector paths evaluate the same
+// expression lane by lane.
+constexpr double kExpMin = -708.0;
+constexpr double kExpMax = 709.0;
+constexpr double kExpLog2e = 1.4426950408889634;
+constexpr double kExpLn2Hi = 6.93147180369123816490e-01;
+constexpr double kExpLn2Lo = 1.90821492927058770002e-10;
+constexpr double kExpCoefficients[] = {
+    1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0, 1.0 / 362880.0,
+    1.0 / 40320.0, 1.0 / 5040.0, 1.0 / 720.0, 1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 0.5, 1.0, 1.0};
+
+double exp_element(double a) {
+    if (!(a >= kExpMin)) {
+        return 0.0;
+    }
+    a = std::min(a, kExpMax);
+    const double k = std::nearbyint(a * kExpLog2e);
+    const double r = (a - k * kExpLn2Hi) - k * kExpLn2Lo;
+    double poly = kExpCoefficients[0];
+    for (std::size_t c = 1; c < std::size(kExpCoefficients); ++c) {
+        poly = poly * r + kExpCoefficients[c];
+    }
+    const std::uint64_t bits = static_cast<std::uint64_t>(static_cast<std::int64_t>(k) + 1023) << 52;
+    double scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return poly * scale;
+}
+
+// The sum runs in four interleaved lanes so it matches the AVX2 path.
+double exp_sum_scalar(const double* x, double shift, double scale, double* y, std::size_t n) {
+    double lanes[4] = {0.0, 0.0, 0.0, 0.0};
+    for (std::size_t i = 0; i < n; ++i) {
+        y[i] = exp_element((x[i] - shift) * scale);
+        lanes[i % 4] += y[i];
+    }
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+#if defined(ALMONDAI_KERNELS_X86)
+
+ALMONDAI_TARGET("avx2")
+double exp_sum_avx2(const double* x, double shift, double scale, double* y, std::size_t n) {
+    const __m256d shift_v = _mm256_set1_pd(shift);
+    const __m256d scale_v = _mm256_set1_pd(scale);
+    const __m256d min_v = _mm256_set1_pd(kExpMin);
+    const __m256d max_v = _mm256_set1_pd(kExpMax);
+    const __m256d log2e = _mm256_set1_pd(kExpLog2e);
+    const __m256d ln2_hi = _mm256_set1_pd(kExpLn2Hi);
+    const __m256d ln2_lo = _mm256_set1_pd(kExpLn2Lo);
+    // Adding 1.5 * 2^52 leaves k + 1023 in the low mantissa bits.
+    const __m256d exponent_bias = _mm256_set1_pd(6755399441055744.0 + 1023.0);
+    __m256d acc = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d a = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(x + i), shift_v), scale_v);
+        const __m256d in_range = _mm256_cmp_pd(a, min_v, _CMP_GE_OQ);
+        a = _mm256_max_pd(_mm256_min_pd(a, max_v), min_v);
+        const __m256d k = _mm256_round_pd(_mm256_mul_pd(a, log2e), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        const __m256d r = _mm256_sub_pd(_mm256_sub_pd(a, _mm256_mul_pd(k, ln2_hi)), _mm256_mul_pd(k, ln2_lo));
+        __m256d poly = _mm256_set1_pd(kExpCoefficients[0]);
+        for (std::size_t c = 1; c < std::size(kExpCoefficients); ++c) {
+            poly = _mm256_add_pd(_mm256_mul_pd(poly, r), _mm256_set1_pd(kExpCoefficients[c]));
+        }
+        const __m256i bits = _mm256_slli_epi64(_mm256_castpd_si256(_mm256_add_pd(k, exponent_bias)), 52);
+        const __m256d value = _mm256_and_pd(_mm256_mul_pd(poly, _mm256_castsi256_pd(bits)), in_range);
+        _mm256_storeu_pd(y + i, value);
+        acc = _mm256_add_pd(acc, value);
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, acc);
+    for (; i < n; ++i) {
+        y[i] = exp_element((x[i] - shift) * scale);
+        lanes[i % 4] += y[i];
+    }
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+ALMONDAI_TARGET("avx2")
+void axpy_avx2(double alpha, const double* x, double* y, std::size_t n) {
+    const __m256d a = _mm256_set1_pd(alpha);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d y0 = _mm256_loadu_pd(y + i);
+        __m256d y1 = _mm256_loadu_pd(y + i + 4);
+        y0 = _mm256_add_pd(y0, _mm256_mul_pd(_mm256_loadu_pd(x + i), a));
+        y1 = _mm256_add_pd(y1, _mm256_mul_pd(_mm256_loadu_pd(x + i + 4), a));
+        _mm256_storeu_pd(y + i, y0);
+        _mm256_storeu_pd(y + i + 4, y1);
+    }
+    for (; i + 4 <= n; i += 4) {
+        const __m256d y0 = _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(_mm256_loadu_pd(x + i), a));
+        _mm256_storeu_pd(y + i, y0);
+    }
+    for (; i < n; ++i) {
+        y[i] += x[i] * alpha;
+    }
+}
+
+ALMONDAI_TARGET("avx2")
+double dot_avx2(const double* a, const double* b, std::size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    alignas(32) double lanes[8];
+    _mm256_store_pd(lanes, acc0);
+    _mm256_store_pd(lanes + 4, acc1);
+    for (; i < n; ++i) {
+        lanes[i % 8] += a[i] * b[i];
+    }
+    return fold_dot_lanes(lanes);
+}
+
+// Four doubles from either storage type; float loads widen exactly and float
+// stores round to nearest, as the scalar casts do.
+ALMONDAI_TARGET("avx2")
+inline __m256d load_pd4(const double* source) {
+    return _mm256_loadu_pd(source);
+}
+
+ALMONDAI_TARGET("avx2")
+inline __m256d load_pd4(const float* source) {
+    return _mm256_cvtps_pd(_mm_loadu_ps(source));
+}
+
+ALMONDAI_TARGET("avx2")
+inline void store_pd4(double* target, __m256d value) {
+    _mm256_storeu_pd(target, value);
+}
+
+ALMONDAI_TARGET("avx2")
+inline void store_pd4(float* target, __m256d value) {
+    _mm_storeu_ps(target, _mm256_cvtpd_ps(value));
+}
+
+ALMONDAI_TARGET("avx2")
+void axpy_f32_avx2(double alpha, const float* x, double* y, std::size_t n) {
+    const __m256d a = _mm256_set1_pd(alpha);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 wide = _mm256_loadu_ps(x + i);
+        const __m256d x0 = _mm256_cvtps_pd(_mm256_castps256_ps128(wide));
+        const __m256d x1 = _mm256_cvtps_pd(_mm256_extractf128_ps(wide, 1));
+        _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(x0, a)));
+        _mm256_storeu_pd(y + i + 4, _mm256_add_pd(_mm256_loadu_pd(y + i + 4), _mm256_mul_pd(x1, a)));
+    }
+    for (; i < n; ++i) {
+        y[i] += static_cast<double>(x[i]) * alpha;
+    }
+}
+
+ALMONDAI_TARGET("avx2")
+void axpy_into_f32_avx2(double alpha, const double* x, float* y, std::size_t n) {
+    const __m256d a = _mm256_set1_pd(alpha);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        store_pd4(y + i, _mm256_add_pd(load_pd4(y + i), _mm256_mul_pd(_mm256_loadu_pd(x + i), a)));
+    }
+    for (; i < n; ++i) {
+        y[i] = static_cast<float>(static_cast<double>(y[i]) + x[i] * alpha);
+    }
+}
+
+ALMONDAI_TARGET("avx2")
+double dot_f32_avx2(const float* a, const double* b, std::size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(load_pd4(a + i), _mm256_loadu_pd(b + i)));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(load_pd4(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    alignas(32) double lanes[8];
+    _mm256_store_pd(lanes, acc0);
+    _mm256_store_pd(lanes + 4, acc1);
+    for (; i < n; ++i) {
+        lanes[i % 8] += static_cast<double>(a[i]) * b[i];
+    }
+    return fold_dot_lanes(lanes);
+}
+
+ALMONDAI_TARGET("avx512f")
+void axpy_avx512(double alpha, const double* x, double* y, std::size_t n) {
+    const __m512d a = _mm512_set1_pd(alpha);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512d y0 = _mm512_loadu_pd(y + i);
+        __m512d y1 = _mm512_loadu_pd(y + i + 8);
+        y0 = _mm512_add_pd(y0, _mm512_mul_pd(_mm512_loadu_pd(x + i), a));
+        y1 = _mm512_add_pd(y1, _mm512_mul_pd(_mm512_loadu_pd(x + i + 8), a));
+        _mm512_storeu_pd(y + i, y0);
+        _mm512_storeu_pd(y + i + 8, y1);
+    }
+    if (i < n) {
+        const __mmask8 full = 0xff;
+        for (; i < n; i += 8) {
+            const std::size_t remaining = n - i;
+            const __mmask8 mask = remaining >= 8 ? full : static_cast<__mmask8>((1u << remaining) - 1u);
+            const __m512d y0 = _mm512_maskz_loadu_pd(mask, y + i);
+            const __m512d x0 = _mm512_maskz_loadu_pd(mask, x + i);
+            _mm512_mask_storeu_pd(y + i, mask, _mm512_add_pd(y0, _mm512_mul_pd(x0, a)));
+        }
+    }
+}
+
+ALMONDAI_TARGET("avx512f")
+double dot_avx512(const double* a, const double* b, std::size_t n) {
+    __m512d acc = _mm512_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm512_add_pd(acc, _mm512_mul_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+    }
+    alignas(64) double lanes[8];
+    _mm512_store_pd(lanes, acc);
+    for (; i < n; ++i) {
+        lanes[i % 8] += a[i] * b[i];
+    }
+    return fold_dot_lanes(lanes);
+}
+
+ALMONDAI_TARGET("avx2")
+inline void adamw_lanes_avx2(const AdamWConstants& c, __m256d& param, __m256d grad, __m256d& m, __m256d& v) {
+    m = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(c.beta1), m), _mm256_mul_pd(_mm256_set1_pd(c.one_minus_beta1), grad));
+    v = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(c.beta2), v),
+                      _mm256_mul_pd(_mm256_set1_pd(c.one_minus_beta2), _mm256_mul_pd(grad, grad)));
+    const __m256d m_hat = _mm256_div_pd(m, _mm256_set1_pd(c.bias_correction1));
+    const __m256d v_hat = _mm256_div_pd(v, _mm256_set1_pd(c.bias_correction2));
+    const __m256d update = _mm256_div_pd(m_hat, _mm256_add_pd(_mm256_sqrt_pd(v_hat), _mm256_set1_pd(c.epsilon)));
+    const __m256d decay = _mm256_mul_pd(_mm256_set1_pd(c.weight_decay), param);
+    param = _mm256_sub_pd(param, _mm256_mul_pd(_mm256_set1_pd(c.lr), _mm256_add_pd(update, decay)));
+}
+
+template <typename Param>
+ALMONDAI_TARGET("avx2")
+void adamw_f64_avx2(const AdamWConstants& c, Param* p, const double* g, double* m, double* v, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d param = load_pd4(p + i);
+        __m256d m_i = _mm256_loadu_pd(m + i);
+        __m256d v_i = _mm256_loadu_pd(v + i);
+        adamw_lanes_avx2(c, param, _mm256_loadu_pd(g + i), m_i, v_i);
+        store_pd4(p + i, param);
+        _mm256_storeu_pd(m + i, m_i);
+        _mm256_storeu_pd(v + i, v_i);
+    }
+    adamw_f64_scalar(c, p + i, g + i, m + i, v + i, n - i);
+}
+
+template <typename Param>
+ALMONDAI_TARGET("avx2")
+void adamw_f32_avx2(const AdamWConstants& c, Param* p, const double* g, float* m, float* v, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d param = load_pd4(p + i);
+        __m256d m_i = load_pd4(m + i);
+        __m256d v_i = load_pd4(v + i);
+        adamw_lanes_avx2(c, param, _mm256_loadu_pd(g + i), m_i, v_i);
+        store_pd4(p + i, param);
+        store_pd4(m + i, m_i);
+        store_pd4(v + i, v_i);
+    }
+    adamw_f32_scalar(c, p + i, g + i, m + i, v + i, n - i);
+}
+
+// Eight int8 weights as two vectors of doubles.
+ALMONDAI_TARGET("avx2")
+inline void load_q8x8(const std::int8_t* source, __m256d& low, __m256d& high) {
+    std::int64_t raw = 0;
+    std::memcpy(&raw, source, sizeof(raw));
+    const __m256i wide = _mm256_cvtepi8_epi32(_mm_cvtsi64_si128(raw));
+    low = _mm256_cvtepi32_pd(_mm256_castsi256_si128(wide));
+    high = _mm256_cvtepi32_pd(_mm256_extracti128_si256(wide, 1));
+}
+
+ALMONDAI_TARGET("avx2")
+void dequantize_q8_avx2(const std::int8_t* x, const float* scales, double* y, std::size_t n) {
+    constexpr std::size_t kGroup = almondai::kernels::kQuantGroup;
+    for (std::size_t start = 0; start < n; start += kGroup) {
+        const double scale = static_cast<double>(scales[start / kGroup]);
+        const __m256d scale_v = _mm256_set1_pd(scale);
+        const std::size_t end = std::min(n, start + kGroup);
+        std::size_t i = start;
+        for (; i + 8 <= end; i += 8) {
+            __m256d low;
+            __m256d high;
+            load_q8x8(x + i, low, high);
+            _mm256_storeu_pd(y + i, _mm256_mul_pd(low, scale_v));
+            _mm256_storeu_pd(y + i + 4, _mm256_mul_pd(high, scale_v));
+        }
+        for (; i < end; ++i) {
+            y[i] = static_cast<double>(x[i]) * scale;
+        }
+    }
+}
+
+ALMONDAI_TARGET("avx2")
+void axpy_q8_avx2(double alpha, const std::int8_t* x, const float* scales, double* y, std::size_t n) {
+    constexpr std::size_t kGroup = almondai::kernels::kQuantGroup;
+    const __m256d alpha_v = _mm256_set1_pd(alpha);
+    for (std::size_t start = 0; start < n; start += kGroup) {
+        const double scale = static_cast<double>(scales[start / kGroup]);
+        const __m256d scale_v = _mm256_set1_pd(scale);
+        const std::size_t end = std::min(n, start + kGroup);
+        std::size_t i = start;
+        for (; i + 8 <= end; i += 8) {
+            __m256d low;
+            __m256d high;
+            load_q8x8(x + i, low, high);
+            low = _mm256_mul_pd(_mm256_mul_pd(low, scale_v), alpha_v);
+            high = _mm256_mul_pd(_mm256_mul_pd(high, scale_v), alpha_v);
+            _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), low));
+            _mm256_storeu_pd(y + i + 4, _mm256_add_pd(_mm256_loadu_pd(y + i + 4), high));
+        }
+        for (; i < end; ++i) {
+            y[i] += static_cast<double>(x[i]) * scale * alpha;
+        }
+    }
+}
+
+// F16C converts finite halves exactly, so these match the scalar from_fp16.
+ALMONDAI_TARGET("avx2,f16c")
+inline __m256 load_fp16x8(const std::uint16_t* source) {
+    return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source)));
+}
+
+ALMONDAI_TARGET("avx2,f16c")
+void dequantize_f16_f16c(const std::uint16_t* x, double* y, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 value = load_fp16x8(x + i);
+        _mm256_storeu_pd(y + i, _mm256_cvtps_pd(_mm256_castps256_ps128(value)));
+        _mm256_storeu_pd(y + i + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(value, 1)));
+    }
+    for (; i < n; ++i) {
+        y[i] = static_cast<double>(from_fp16(x[i]));
+    }
+}
+
+ALMONDAI_TARGET("avx2,f16c")
+void axpy_f16_f16c(double alpha, const std::uint16_t* x, double* y, std::size_t n) {
+    const __m256d alpha_v = _mm256_set1_pd(alpha);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 value = load_fp16x8(x + i);
+        const __m256d low = _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(value)), alpha_v);
+        const __m256d high = _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(value, 1)), alpha_v);
+        _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), low));
+        _mm256_storeu_pd(y + i + 4, _mm256_add_pd(_mm256_loadu_pd(y + i + 4), high));
+    }
+    for (; i < n; ++i) {
+        y[i] += static_cast<double>(from_fp16(x[i])) * alpha;
+    }
+}
+
+ALMONDAI_TARGET("avx2")
+inline __m256d load_bf16x4(const std::uint16_t* source) {
+    const __m128i raw = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source));
+    const __m128i widened = _mm_slli_epi32(_mm_cvtepu16_epi32(raw), 16);
+    return _mm256_cvtps_pd(_mm_castsi128_ps(widened));
+}
+
+ALMONDAI_TARGET("avx2")
+inline void store_bf16x4(std::uint16_t* target, __m256d value) {
+    __m128i bits = _mm_castps_si128(_mm256_cvtpd_ps(value));
+    const __m128i lsb = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(1));
+    bits = _mm_add_epi32(bits, _mm_add_epi32(lsb, _mm_set1_epi32(0x7fff)));
+    bits = _mm_srli_epi32(bits, 16);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(target), _mm_packus_epi32(bits, bits));
+}
+
+template <typename Param>
+ALMONDAI_TARGET("avx2")
+void adamw_bf16_avx2(const AdamWConstants& c, Param* p, const double* g,
+                     std::uint16_t* m, std::uint16_t* v, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d param = load_pd4(p + i);
+        __m256d m_i = load_bf16x4(m + i);
+        __m256d v_i = load_bf16x4(v + i);
+        adamw_lanes_avx2(c, param, _mm256_loadu_pd(g + i), m_i, v_i);
+        store_pd4(p + i, param);
+        store_bf16x4(m + i, m_i);
+        store_bf16x4(v + i, v_i);
+    }
+    adamw_bf16_scalar(c, p + i, g + i, m + i, v + i, n - i);
+}
+
+ALMONDAI_TARGET("avx512f")
+void adamw_f64_avx512(const AdamWConstants& c, double* p, const double* g, double* m, double* v, std::size_t n) {
+    const __m512d beta1 = _mm512_set1_pd(c.beta1);
+    const __m512d beta2 = _mm512_set1_pd(c.beta2);
+    const __m512d one_minus_beta1 = _mm512_set1_pd(c.one_minus_beta1);
+    const __m512d one_minus_beta2 = _mm512_set1_pd(c.one_minus_beta2);
+    const __m512d bias_correction1 = _mm512_set1_pd(c.bias_correction1);
+    const __m512d bias_correction2 = _mm512_set1_pd(c.bias_correction2);
+    const __m512d epsilon = _mm512_set1_pd(c.epsilon);
+    const __m512d weight_decay = _mm512_set1_pd(c.weight_decay);
+    const __m512d lr = _mm512_set1_pd(c.lr);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m512d grad = _mm512_loadu_pd(g + i);
+        __m512d param = _mm512_loadu_pd(p + i);
+        __m512d m_i = _mm512_add_pd(_mm512_mul_pd(beta1, _mm512_loadu_pd(m + i)), _mm512_mul_pd(one_minus_beta1, grad));
+        __m512d v_i = _mm512_add_pd(_mm512_mul_pd(beta2, _mm512_loadu_pd(v + i)),
+                                    _mm512_mul_pd(one_minus_beta2, _mm512_mul_pd(grad, grad)));
+        const __m512d m_hat = _mm512_div_pd(m_i, bias_correction1);
+        const __m512d v_hat = _mm512_div_pd(v_i, bias_correction2);
+        // The unmasked sqrt passes an uninitialised source through GCC 12's
+        // header and trips -Wmaybe-uninitialized; the all-lanes mask is identical.
+        const __m512d update = _mm512_div_pd(m_hat, _mm512_add_pd(_mm512_maskz_sqrt_pd(0xFF, v_hat), epsilon));
+        const __m512d decay = _mm512_mul_pd(weight_decay, param);
+        param = _mm512_sub_pd(param, _mm512_mul_pd(lr, _mm512_add_pd(update, decay)));
+        _mm512_storeu_pd(p + i, param);
+        _mm512_storeu_pd(m + i, m_i);
+        _mm512_storeu_pd(v + i, v_i);
+    }
+    adamw_f64_scalar(c, p + i, g + i, m + i, v + i, n - i);
+}
+
+bool cpu_supports(Isa isa) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int regs[4] = {};
+    __cpuid(regs, 0);
+    if (regs[0] < 7) {
+        return false;
+    }
+    __cpuid(regs, 1);
+    const bool osxsave = (regs[2] & (1 << 27)) != 0;
+    const bool avx = (regs[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) {
+        return false;
+    }
+    const unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(regs, 7, 0);
+    if (isa == Isa::Avx2) {
+        return (xcr0 & 0x6) == 0x6 && (regs[1] & (1 << 5)) != 0;
+    }
+    if (isa == Isa::Avx512) {
+        return (xcr0 & 0xe6) == 0xe6 && (regs[1] & (1 << 16)) != 0;
+    }
+    return true;
+#else
+    __builtin_cpu_init();
+    if (isa == Isa::Avx2) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (isa == Isa::Avx512) {
+        return __builtin_cpu_supports("avx512f");
+    }
+    return true;
+#endif
+}
+
+bool cpu_supports_f16c() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int regs[4] = {};
+    __cpuid(regs, 1);
+    return (regs[2] & (1 << 29)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("f16c");
+#endif
+}
+
+#endif
+
+std::string read_environment_variable(const char* name) {
+#ifdef _WIN32
+    size_t required = 0;
+    char* buffer = nullptr;
+    if (_dupenv_s(&buffer, &required, name) != 0 || !buffer) {
+        return {};
+    }
+    std::string value(buffer);
+    std::free(buffer);
+    return value;
+#else
+    if (const char* raw = std::getenv(name)) {
+        return std::string(raw);
+    }
+    return {};
+#endif
+}
+
+Isa detect_isa() {
+    Isa cap = Isa::Avx512;
+    const std::string requested = read_environment_variable("ALMONDAI_KERNELS");
+    if (requested == "scalar") {
+        cap = Isa::Scalar;
+    } else if (requested == "avx2") {
+        cap = Isa::Avx2;
+    }
+#if defined(ALMONDAI_KERNELS_X86)
+    if (cap == Isa::Avx512 && cpu_supports(Isa::Avx512)) {
+        return Isa::Avx512;
+    }
+    if (cap != Isa::Scalar && cpu_supports(Isa::Avx2)) {
+        return Isa::Avx2;
+    }
+#endif
+    return Isa::Scalar;
+}
+
+struct KernelTable {
+    Isa isa = Isa::Scalar;
+    AxpyFn axpy = axpy_scalar;
+    DotFn dot = dot_scalar;
+    AxpyF32Fn axpy_f32 = axpy_f32_scalar;
+    AxpyIntoF32Fn axpy_into_f32 = axpy_into_f32_scalar;
+    DotF32Fn dot_f32 = dot_f32_scalar;
+    AdamWFn<double, double> adamw_f64 = adamw_f64_scalar<double>;
+    AdamWFn<double, float> adamw_f32 = adamw_f32_scalar<double>;
+    AdamWFn<double, std::uint16_t> adamw_bf16 = adamw_bf16_scalar<double>;
+    // fp32 parameters.
+    AdamWFn<float, double> float_adamw_f64 = adamw_f64_scalar<float>;
+    AdamWFn<float, float> float_adamw_f32 = adamw_f32_scalar<float>;
+    AdamWFn<float, std::uint16_t> float_adamw_bf16 = adamw_bf16_scalar<float>;
+    ExpSumFn exp_sum = exp_sum_scalar;
+    DequantizeQ8Fn dequantize_q8 = dequantize_q8_scalar;
+    DequantizeF16Fn dequantize_f16 = dequantize_f16_scalar;
+    AxpyQ8Fn axpy_q8 = axpy_q8_scalar;
+    AxpyF16Fn axpy_f16 = axpy_f16_scalar;
+};
+
+const KernelTable& kernel_table() {
+    static const KernelTable table = [] {
+        KernelTable resolved;
+        resolved.isa = detect_isa();
+#if defined(ALMONDAI_KERNELS_X86)
+        if (resolved.isa == Isa::Avx512) {
+            resolved.axpy = axpy_avx512;
+            resolved.dot = dot_avx512;
+            resolved.adamw_f64 = adamw_f64_avx512;
+        } else if (resolved.isa == Isa::Avx2) {
+            resolved.axpy = axpy_avx2;
+            resolved.dot = dot_avx2;
+            resolved.adamw_f64 = adamw_f64_avx2<double>;
+        }
+        if (resolved.isa != Isa::Scalar) {
+            // The fp32, narrow-moment, exp and quantized paths only have AVX2
+            // versions, and the fp16 ones also need F16C.
+            resolved.axpy_f32 = axpy_f32_avx2;
+            resolved.axpy_into_f32 = axpy_into_f32_avx2;
+            resolved.dot_f32 = dot_f32_avx2;
+            resolved.adamw_f32 = adamw_f32_avx2<double>;
+            resolved.adamw_bf16 = adamw_bf16_avx2<double>;
+            resolved.float_adamw_f64 = adamw_f64_avx2<float>;
+            resolved.float_adamw_f32 = adamw_f32_avx2<float>;
+            resolved.float_adamw_bf16 = adamw_bf16_avx2<float>;
+            resolved.exp_sum = exp_sum_avx2;
+            resolved.dequantize_q8 = dequantize_q8_avx2;
+            resolved.axpy_q8 = axpy_q8_avx2;
+            if (cpu_supports_f16c()) {
+                resolved.dequantize_f16 = dequantize_f16_f16c;
+                resolved.axpy_f16 = axpy_f16_f16c;
+            }
+        }
+#endif
+        return resolved;
+    }();
+    return table;
+}
+
+// Row-major tiles over output columns; `axpy_fn` widens Weight rows to double.
+template <typename Weight, typename Axpy>
+void matmul_tiles(const double* x, const Weight* w, double* y,
+                  std::size_t batch, std::size_t inner, std::size_t cols, Axpy axpy_fn) {
+    for (std::size_t col = 0; col < cols; col += kColumnBlock) {
+        const std::size_t width = std::min(kColumnBlock, cols - col);
+        for (std::size_t m = 0; m < batch; ++m) {
+            std::fill_n(y + m * cols + col, width, 0.0);
+        }
+        for (std::size_t k = 0; k < inner; ++k) {
+            const Weight* row = w + k * cols + col;
+            for (std::size_t m = 0; m < batch; ++m) {
+                axpy_fn(x[m * inner + k], row, y + m * cols + col, width);
+            }
+        }
+    }
+}
+
+template <typename T>
+void require_rank2(const almondai::BasicTensor<T>& weight) {
+    if (weight.shape().size() != 2) {
+        throw std::invalid_argument("kernel weight must be rank 2");
+    }
+}
+
+} // namespace
+
+namespace almondai::kernels {
+
+Isa active_isa() noexcept {
+    return kernel_table().isa;
+}
+
+const char* isa_name(Isa isa) noexcept {
+    switch (isa) {
+    case Isa::Avx512:
+        return "avx512";
+    case Isa::Avx2:
+        return "avx2";
+    case Isa::Scalar:
+        break;
+    }
+    return "scalar";
+}
+
+void vecmat(const double* x, const double* w, double* y, std::size_t rows, std::size_t cols) {
+    matmul(x, w, y, 1, rows, cols);
+}
+
+void matmul(const double* x, const double* w, double* y,
+            std::size_t batch, std::size_t inner, std::size_t cols) {
+    matmul_tiles(x, w, y, batch, inner, cols, kernel_table().axpy);
+}
+
+double dot(const double* a, const double* b, std::size_t n) {
+    return kernel_table().dot(a, b, n);
+}
+
+void axpy(double alpha, const double* x, double* y, std::size_t n) {
+    kernel_table().axpy(alpha, x, y, n);
+}
+
+void vecmat(const double* x, const float* w, double* y, std::size_t rows, std::size_t cols) {
+    matmul(x, w, y, 1, rows, cols);
+}
+
+void matmul(const double* x, const float* w, double* y,
+            std::size_t batch, std::size_t inner, std::size_t cols) {
+    matmul_tiles(x, w, y, batch, inner, cols, kernel_table().axpy_f32);
+}
+
+double dot(const float* a, const double* b, std::size_t n) {
+    return kernel_table().dot_f32(a, b, n);
+}
+
+void axpy(double alpha, const double* x, float* y, std::size_t n) {
+    kernel_table().axpy_into_f32(alpha, x, y, n);
+}
+
+void adamw_step(const AdamWStep& step, double* params, const double* grads, double* m, double* v, std::size_t n) {
+    kernel_table().adamw_f64(AdamWConstants(step), params, grads, m, v, n);
+}
+
+void adamw_step(const AdamWStep& step, double* params, const double* grads, float* m, float* v, std::size_t n) {
+    kernel_table().adamw_f32(AdamWConstants(step), params, grads, m, v, n);
+}
+
+void adamw_step_bf16(const AdamWStep& step, double* params, const double* grads,
+                     std::uint16_t* m, std::uint16_t* v, std::size_t n) {
+    kernel_table().adamw_bf16(AdamWConstants(step), params, grads, m, v, n);
+}
+
+void adamw_step(const AdamWStep& step, float* params, const double* grads, double* m, double* v, std::size_t n) {
+    kernel_table().float_adamw_f64(AdamWConstants(step), params, grads, m, v, n);
+}
+
+void adamw_step(const AdamWStep& step, float* params, const double* grads, float* m, float* v, std::size_t n) {
+    kernel_table().float_adamw_f32(AdamWConstants(step), params, grads, m, v, n);
+}
+
+void adamw_step_bf16(const AdamWStep& step, float* params, const double* grads,
+                     std::uint16_t* m, std::uint16_t* v, std::size_t n) {
+    kernel_table().float_adamw_bf16(AdamWConstants(step), params, grads, m, v, n);
+}
+
+double exp_sum(const double* x, double shift, double scale, double* y, std::size_t n) {
+    return kernel_table().exp_sum(x, shift, scale, y, n);
+}
+
+void dequantize_q8(const std::int8_t* x, const float* scales, double* y, std::size_t n) {
+    kernel_table().dequantize_q8(x, scales, y, n);
+}
+
+void dequantize_f16(const std::uint16_t* x, double* y, std::size_t n) {
+    kernel_table().dequantize_f16(x, y, n);
+}
+
+void matmul_q8(const double* x, const std::int8_t* w, const float* scales, double* y,
+               std::size_t batch, std::size_t inner, std::size_t cols) {
+    static_assert(kColumnBlock % kQuantGroup == 0, "column tiles must start on a scale group");
+    const KernelTable& table = kernel_table();
+    const std::size_t groups = (cols + kQuantGroup - 1) / kQuantGroup;
+    double row[kColumnBlock];
+    for (std::size_t col = 0; col < cols; col += kColumnBlock) {
+        const std::size_t width = std::min(kColumnBlock, cols - col);
+        for (std::size_t m = 0; m < batch; ++m) {
+            std::fill_n(y + m * cols + col, width, 0.0);
+        }
+        for (std::size_t k = 0; k < inner; ++k) {
+            const std::int8_t* weights = w + k * cols + col;
+            const float* row_scales = scales + k * groups + col / kQuantGroup;
+            if (batch < kDequantizeBatch) {
+                for (std::size_t m = 0; m < batch; ++m) {
+                    table.axpy_q8(x[m * inner + k], weights, row_scales, y + m * cols + col, width);
+                }
+                continue;
+            }
+            table.dequantize_q8(weights, row_scales, row, width);
+            for (std::size_t m = 0; m < batch; ++m) {
+                table.axpy(x[m * inner + k], row, y + m * cols + col, width);
+            }
+        }
+    }
+}
+
+void matmul_f16(const double* x, const std::uint16_t* w, double* y,
+                std::size_t batch, std::size_t inner, std::size_t cols) {
+    const KernelTable& table = kernel_table();
+    double row[kColumnBlock];
+    for (std::size_t col = 0; col < cols; col += kColumnBlock) {
+        const std::size_t width = std::min(kColumnBlock, cols - col);
+        for (std::size_t m = 0; m < batch; ++m) {
+            std::fill_n(y + m * cols + col, width, 0.0);
+        }
+        for (std::size_t k = 0; k < inner; ++k) {
+            const std::uint16_t* weights = w + k * cols + col;
+            if (batch < kDequantizeBatch) {
+                for (std::size_t m = 0; m < batch; ++m) {
+                    table.axpy_f16(x[m * inner + k], weights, y + m * cols + col, width);
+                }
+                continue;
+            }
+            table.dequantize_f16(weights, row, width);
+            for (std::size_t m = 0; m < batch; ++m) {
+                table.axpy(x[m * inner + k], row, y + m * cols + col, width);
+            }
+        }
+    }
+}
+
+double fp16_to_double(std::uint16_t value) noexcept {
+    return from_fp16(value);
+}
+
+std::uint16_t double_to_fp16(double value) noexcept {
+    const std::uint16_t sign = std::signbit(value) ? 0x8000u : 0u;
+    const double magnitude = std::fabs(value);
+    if (!(magnitude < 65504.0)) {
+        // Saturate (NaN included) rather than store values the kernels cannot read.
+        return static_cast<std::uint16_t>(sign | (std::isnan(value) ? 0u : 0x7bffu));
+    }
+    if (magnitude < 0x1p-14) {
+        // Subnormal: a multiple of 2^-24; rounding up to 1024 lands on the smallest normal.
+        return static_cast<std::uint16_t>(sign | static_cast<std::uint16_t>(std::nearbyint(magnitude * 0x1p24)));
+    }
+    int exponent = 0;
+    std::frexp(magnitude, &exponent);
+    const double mantissa = std::nearbyint((std::ldexp(magnitude, 1 - exponent) - 1.0) * 1024.0);
+    // A mantissa that rounds up to 1024 carries into the exponent.
+    const auto bits = static_cast<std::uint32_t>(exponent - 1 + 15) * 1024u + static_cast<std::uint32_t>(mantissa);
+    return static_cast<std::uint16_t>(sign | std::min<std::uint32_t>(bits, 0x7bffu));
+}
+
+double bf16_to_double(std::uint16_t value) noexcept {
+    return from_bf16(value);
+}
+
+std::uint16_t double_to_bf16(double value) noexcept {
+    return to_bf16(static_cast<float>(value));
+}
+
+template <typename T>
+void vecmat(std::span<const double> x, const BasicTensor<T>& weight, std::span<double> y) {
+    require_rank2(weight);
+    const std::size_t inner = weight.shape()[0];
+    const std::size_t cols = weight.shape()[1];
+    if (x.size() != inner || y.size() != cols) {
+        throw std::invalid_argument("vecmat dimension mismatch");
+    }
+    vecmat(x.data(), weight.data(), y.data(), inner, cols);
+}
+
+template <typename T>
+void matmul(std::span<const double> x, std::size_t batch, const BasicTensor<T>& weight, std::span<double> y) {
+    require_rank2(weight);
+    const std::size_t inner = weight.shape()[0];
+    const std::size_t cols = weight.shape()[1];
+    if (x.size() != batch * inner || y.size() != batch * cols) {
+        throw std::invalid_argument("matmul dimension mismatch");
+    }
+    matmul(x.data(), weight.data(), y.data(), batch, inner, cols);
+}
+
+template void vecmat(std::span<const double>, const BasicTensor<double>&, std::span<double>);
+template void vecmat(std::span<const double>, const BasicTensor<float>&, std::span<double>);
+template void matmul(std::span<const double>, std::size_t, const BasicTensor<double>&, std::span<double>);
+template void matmul(std::span<const double>, std::size_t, const BasicTensor<float>&, std::span<double>);
+
+} // namespace almondai::kernels
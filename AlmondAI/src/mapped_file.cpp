@@ -0,0 +1,140 @@
+#include "../include/almondai/mapped_file.hpp"
+
+#include <fstream>
+#include <system_error>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace almondai {
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+    open(path);
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    move_from(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        move_from(other);
+    }
+    return *this;
+}
+
+void MappedFile::move_from(MappedFile& other) noexcept {
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+    m_mapped = std::exchange(other.m_mapped, false);
+    m_open_empty = std::exchange(other.m_open_empty, false);
+    m_fallback = std::move(other.m_fallback);
+    if (!m_mapped && !m_fallback.empty()) {
+        m_data = m_fallback.data();
+    }
+#if defined(_WIN32)
+    m_file_handle = std::exchange(other.m_file_handle, nullptr);
+    m_mapping_handle = std::exchange(other.m_mapping_handle, nullptr);
+#endif
+}
+
+bool MappedFile::open(const std::filesystem::path& path) {
+    close();
+
+    std::error_code ec;
+    const auto file_size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return false;
+    }
+    if (file_size == 0) {
+        m_open_empty = true;
+        return true;
+    }
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr) {
+            void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (view != nullptr) {
+                m_file_handle = file;
+                m_mapping_handle = mapping;
+                m_data = static_cast<const char*>(view);
+                m_size = static_cast<std::size_t>(file_size);
+                m_mapped = true;
+                return true;
+            }
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+    }
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        void* view = ::mmap(nullptr, static_cast<std::size_t>(file_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view != MAP_FAILED) {
+            m_data = static_cast<const char*>(view);
+            m_size = static_cast<std::size_t>(file_size);
+            m_mapped = true;
+            return true;
+        }
+    }
+#endif
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    m_fallback.resize(static_cast<std::size_t>(file_size));
+    in.read(m_fallback.data(), static_cast<std::streamsize>(m_fallback.size()));
+    if (static_cast<std::size_t>(in.gcount()) != m_fallback.size()) {
+        m_fallback.clear();
+        return false;
+    }
+    m_data = m_fallback.data();
+    m_size = m_fallback.size();
+    return true;
+}
+
+void MappedFile::close() noexcept {
+    if (m_mapped && m_data != nullptr) {
+#if defined(_WIN32)
+        UnmapViewOfFile(m_data);
+        if (m_mapping_handle != nullptr) {
+            CloseHandle(m_mapping_handle);
+        }
+        if (m_file_handle != nullptr) {
+            CloseHandle(m_file_handle);
+        }
+        m_mapping_handle = nullptr;
+        m_file_handle = nullptr;
+#else
+        ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_open_empty = false;
+    m_fallback.clear();
+}
+
+} // namespace almondai
@@ -29,7 +29,10 @@ std::string trim_whitespace(const std::string& text) {
     return std::string(begin, end);
 }
 
-JsonObject call_gpt(Json params, almondai::chat::Backend* backend) {
+JsonObject call_gpt(Json params,
+                    almondai::chat::Backend* backend,
+                    almondai::TeacherCache* cache,
+                    const std::string& cache_scope) {
     std::string prompt;
     Json constraints;
     if (params.is_object()) {
@@ -57,6 +60,22 @@ JsonObject call_gpt(Json params, almondai::chat::Backend* backend) {
         return fallback;
     }
 
+    std::string cache_key;
+    if (cache) {
+        cache_key = almondai::TeacherCache::make_key(cache_scope, augmented);
+        if (auto hit = cache->lookup(cache_key)) {
+            JsonObject provenance;
+            provenance["source"] = Json("chat_backend");
+            provenance["status"] = Json("remote");
+            provenance["cache"] = Json("hit");
+
+            JsonObject payload;
+            payload["output"] = Json(hit->output);
+            payload["provenance"] = Json(provenance);
+            return payload;
+        }
+    }
+
     try {
         std::vector<almondai::chat::Message> conversation;
         conversation.push_back({"system", "You are AlmondAI's teacher model. Provide thorough, safe answers suitable for fine-tuning."});
@@ -70,6 +89,10 @@ JsonObject call_gpt(Json params, almondai::chat::Backend* backend) {
         JsonObject provenance;
         provenance["source"] = Json("chat_backend");
         provenance["status"] = Json("remote");
+        if (cache) {
+            cache->store(cache_key, reply, "chat_backend");
+            provenance["cache"] = Json("miss");
+        }
 
         JsonObject payload;
         payload["output"] = Json(reply);
@@ -135,12 +158,23 @@ void MCPBridge::send_error(std::ostream& out, const std::string& id, const std::
     out << Json(obj).dump() << '\n';
 }
 
+void MCPBridge::send_delta(std::ostream& out, const std::string& id, const std::string& delta, bool reset) const {
+    JsonObject obj;
+    obj["jsonrpc"] = Json("2.0");
+    obj["id"] = Json(id);
+    obj["delta"] = Json(delta);
+    if (reset) {
+        obj["reset"] = Json(true);
+    }
+    out << Json(obj).dump() << '\n';
+}
+
 Json MCPBridge::call(const std::string& method, Json params) {
     JsonObject response;
     response["method"] = Json(method);
     response["params"] = params;
     if (method == "gpt.generate") {
-        response["result"] = Json(call_gpt(std::move(params), m_chat_backend));
+        response["result"] = Json(call_gpt(std::move(params), m_chat_backend, m_teacher_cache, m_teacher_scope));
     }
     return Json(response);
 }
@@ -1,16 +1,22 @@
 #include "../include/almondai/model.hpp"
 #include "../include/almondai/adapter.hpp"
 #include "../include/almondai/json.hpp"
+#include "../include/almondai/kernels.hpp"
+#include "../include/almondai/mapped_file.hpp"
 
 #include <random>
 #include <atomic>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 #include <chrono>
 #include <cmath>
 #include <algorithm>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
 #include <functional>
+#include <type_traits>
 #include <variant>
 
 namespace {
@@ -44,6 +50,110 @@ std::vector<std::size_t> json_to_shape(const almondai::Json& value) {
     return shape;
 }
 
+// Binary checkpoint layout (little-endian, version 1):
+//   header   magic[8] version:u32 endian:u32 vocab:u64 hidden:u64 layers:u64
+//            context:u64 learning_rate:f64 tensor_count:u64
+//   table    tensor_count x { dtype:u32 rank:u32 dims:u64[4] offset:u64 bytes:u64 }
+//   payload  raw tensor data, each tensor aligned to kBinaryAlignment bytes
+// Tensors are written in the decoder's storage type and converted on load.
+constexpr char kBinaryMagic[8] = {'A', 'L', 'M', 'D', 'C', 'K', 'P', 'T'};
+constexpr std::uint32_t kBinaryVersion = 1;
+constexpr std::uint32_t kBinaryEndianTag = 0x01020304u;
+constexpr std::uint32_t kDtypeFloat64 = 1;
+constexpr std::uint32_t kDtypeFloat32 = 2;
+constexpr std::size_t kBinaryMaxRank = 4;
+constexpr std::size_t kBinaryAlignment = 64;
+constexpr std::size_t kBinaryHeaderSize = 8 + 4 + 4 + 8 * 4 + 8 + 8;
+constexpr std::size_t kBinaryEntrySize = 4 + 4 + 8 * kBinaryMaxRank + 8 + 8;
+
+template <typename T>
+void append_pod(std::string& buffer, const T& value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    buffer.append(bytes, sizeof(T));
+}
+
+template <typename T>
+bool read_pod(const char* data, std::size_t size, std::size_t& offset, T& value) {
+    if (offset + sizeof(T) > size) {
+        return false;
+    }
+    std::memcpy(&value, data + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+// Stores a * b in `product`, failing instead of wrapping around.
+bool checked_multiply(std::uint64_t a, std::uint64_t b, std::uint64_t& product) {
+    if (a != 0 && b > std::numeric_limits<std::uint64_t>::max() / a) {
+        return false;
+    }
+    product = a * b;
+    return true;
+}
+
+std::size_t align_up(std::size_t value, std::size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+template <typename T>
+constexpr std::uint32_t dtype_of() {
+    return std::is_same_v<T, float> ? kDtypeFloat32 : kDtypeFloat64;
+}
+
+std::size_t dtype_size(std::uint32_t dtype) {
+    switch (dtype) {
+    case kDtypeFloat64:
+        return sizeof(double);
+    case kDtypeFloat32:
+        return sizeof(float);
+    default:
+        return 0;
+    }
+}
+
+// Copies `count` checkpoint values of type `dtype` into `target`, converting
+// when the checkpoint was written with the other storage type.
+template <typename T>
+void read_payload(const char* source, std::uint32_t dtype, T* target, std::size_t count) {
+    if (dtype == dtype_of<T>()) {
+        std::memcpy(target, source, count * sizeof(T));
+        return;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        if (dtype == kDtypeFloat32) {
+            float value = 0.0f;
+            std::memcpy(&value, source + i * sizeof(float), sizeof(float));
+            target[i] = static_cast<T>(value);
+        } else {
+            double value = 0.0;
+            std::memcpy(&value, source + i * sizeof(double), sizeof(double));
+            target[i] = static_cast<T>(value);
+        }
+    }
+}
+
+template <typename To, typename From>
+std::vector<almondai::BasicTensor<To>> convert_weights(std::vector<almondai::BasicTensor<From>>& weights) {
+    std::vector<almondai::BasicTensor<To>> converted;
+    converted.reserve(weights.size());
+    for (auto& weight : weights) {
+        converted.emplace_back(weight);
+        weight = almondai::BasicTensor<From>();
+    }
+    weights.clear();
+    return converted;
+}
+
+template <typename T>
+std::size_t weight_bytes(const std::vector<almondai::BasicTensor<T>>& weights) {
+    std::size_t bytes = 0;
+    for (const auto& weight : weights) {
+        bytes += weight.size() * sizeof(T);
+    }
+    return bytes;
+}
+
 std::mt19937 create_rng() {
     static std::atomic<std::uint64_t> counter{0};
     const auto now = std::chrono::high_resolution_clock::now().time_since_epoch().count();
@@ -64,22 +174,27 @@ BaseDecoder::BaseDecoder(ModelConfig config) : m_config(config) {
     if (m_config.vocab_size == 0) {
         m_config.vocab_size = 4;
     }
-    m_weights.reserve(m_config.num_layers + 2);
-    m_weights.emplace_back(std::vector<std::size_t>{m_config.vocab_size, m_config.hidden_size}, 0.0);
-    for (std::size_t i = 0; i < m_config.num_layers; ++i) {
-        m_weights.emplace_back(std::vector<std::size_t>{m_config.hidden_size, m_config.hidden_size}, 0.0);
+    if (m_config.precision != WeightPrecision::Float64 && m_config.precision != WeightPrecision::Float32) {
+        throw std::invalid_argument("decoder weights are stored in fp64 or fp32; quantize() for inference");
     }
-    m_weights.emplace_back(std::vector<std::size_t>{m_config.hidden_size, m_config.vocab_size}, 0.0);
-
     const auto seed = static_cast<unsigned>(
         std::chrono::high_resolution_clock::now().time_since_epoch().count());
     std::mt19937 rng(seed);
     std::normal_distribution<double> dist(0.0, 0.02);
-    for (auto& weight : m_weights) {
-        for (double& value : weight.vector()) {
-            value = dist(rng);
+    visit_weights([&](auto& weights) {
+        using Element = typename std::remove_cvref_t<decltype(weights)>::value_type::value_type;
+        weights.reserve(m_config.num_layers + 2);
+        weights.emplace_back(std::vector<std::size_t>{m_config.vocab_size, m_config.hidden_size}, 0.0);
+        for (std::size_t i = 0; i < m_config.num_layers; ++i) {
+            weights.emplace_back(std::vector<std::size_t>{m_config.hidden_size, m_config.hidden_size}, 0.0);
         }
-    }
+        weights.emplace_back(std::vector<std::size_t>{m_config.hidden_size, m_config.vocab_size}, 0.0);
+        for (auto& weight : weights) {
+            for (auto& value : weight.vector()) {
+                value = static_cast<Element>(dist(rng));
+            }
+        }
+    });
 }
 
 void BaseDecoder::set_learning_rate(double lr) noexcept {
@@ -87,28 +202,71 @@ void BaseDecoder::set_learning_rate(double lr) noexcept {
 }
 
 BaseDecoder::ForwardResult BaseDecoder::forward(const std::vector<int>& tokens) const {
-    ForwardResult result;
-    result.hidden.assign(m_config.hidden_size, 0.0);
-    result.pre_adapter_hidden.assign(m_config.hidden_size, 0.0);
-    result.logits.assign(m_config.vocab_size, 0.0);
-
     if (tokens.empty()) {
+        ForwardResult result;
+        result.hidden.assign(m_config.hidden_size, 0.0);
+        result.pre_adapter_hidden.assign(m_config.hidden_size, 0.0);
+        result.logits.assign(m_config.vocab_size, 0.0);
         return result;
     }
-    const auto& embedding = m_weights.front().vector();
+    std::vector<double> pooled(m_config.hidden_size, 0.0);
+    std::vector<double> row;
     for (int token : tokens) {
-        std::size_t index = static_cast<std::size_t>(std::max(token, 0));
-        if (index >= m_config.vocab_size) {
-            index = 0;
+        accumulate_embedding(token, pooled, row);
+    }
+    const double inv = 1.0 / static_cast<double>(tokens.size());
+    for (double& value : pooled) {
+        value *= inv;
+    }
+    return forward_pooled(std::move(pooled));
+}
+
+void BaseDecoder::accumulate_embedding(int token, std::vector<double>& sum, std::vector<double>& row) const {
+    std::size_t index = static_cast<std::size_t>(std::max(token, 0));
+    if (index >= m_config.vocab_size) {
+        index = 0;
+    }
+    if (quantized()) {
+        row.resize(m_config.hidden_size);
+        m_quantized.front().dequantize_row(index, row.data());
+        for (std::size_t h = 0; h < m_config.hidden_size; ++h) {
+            sum[h] += row[h];
         }
+        return;
+    }
+    visit_weights([&](const auto& weights) {
+        const auto* embedding = weights.front().data() + index * m_config.hidden_size;
         for (std::size_t h = 0; h < m_config.hidden_size; ++h) {
-            result.hidden[h] += embedding[index * m_config.hidden_size + h];
+            sum[h] += embedding[h];
         }
+    });
+}
+
+void BaseDecoder::remove_embedding(int token, std::vector<double>& sum, std::vector<double>& row) const {
+    std::size_t index = static_cast<std::size_t>(std::max(token, 0));
+    if (index >= m_config.vocab_size) {
+        index = 0;
     }
-    const double inv = 1.0 / static_cast<double>(tokens.size());
-    for (double& value : result.hidden) {
-        value *= inv;
+    if (quantized()) {
+        row.resize(m_config.hidden_size);
+        m_quantized.front().dequantize_row(index, row.data());
+        for (std::size_t h = 0; h < m_config.hidden_size; ++h) {
+            sum[h] -= row[h];
+        }
+        return;
     }
+    visit_weights([&](const auto& weights) {
+        const auto* embedding = weights.front().data() + index * m_config.hidden_size;
+        for (std::size_t h = 0; h < m_config.hidden_size; ++h) {
+            sum[h] -= embedding[h];
+        }
+    });
+}
+
+BaseDecoder::ForwardResult BaseDecoder::forward_pooled(std::vector<double> pooled) const {
+    ForwardResult result;
+    result.hidden = std::move(pooled);
+    result.logits.assign(m_config.vocab_size, 0.0);
 
     for (std::size_t layer = 1; layer <= m_config.num_layers; ++layer) {
         result.hidden = forward_layer(layer, result.hidden);
@@ -123,47 +281,234 @@ BaseDecoder::ForwardResult BaseDecoder::forward(const std::vector<int>& tokens)
         }
     }
 
-    const Tensor& projection = m_weights.back();
-    const auto& proj_data = projection.vector();
-    for (std::size_t v = 0; v < m_config.vocab_size; ++v) {
-        double sum = 0.0;
-        for (std::size_t h = 0; h < m_config.hidden_size; ++h) {
-            sum += proj_data[h * m_config.vocab_size + v] * result.hidden[h];
+    multiply(projection_index(), result.hidden.data(), 1, result.logits.data());
+    return result;
+}
+
+std::vector<BaseDecoder::ForwardResult> BaseDecoder::forward(std::span<const std::vector<int>> batch) const {
+    const std::size_t hidden = m_config.hidden_size;
+    const std::size_t vocab = m_config.vocab_size;
+    std::vector<ForwardResult> results(batch.size());
+    std::vector<std::size_t> rows;
+    rows.reserve(batch.size());
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        if (batch[i].empty()) {
+            results[i].hidden.assign(hidden, 0.0);
+            results[i].pre_adapter_hidden.assign(hidden, 0.0);
+            results[i].logits.assign(vocab, 0.0);
+        } else {
+            rows.push_back(i);
         }
-        result.logits[v] = sum;
     }
-    return result;
+    if (rows.empty()) {
+        return results;
+    }
+
+    const std::size_t count = rows.size();
+    std::vector<double> activations(count * hidden, 0.0);
+    std::vector<double> pooled(hidden);
+    std::vector<double> row;
+    for (std::size_t r = 0; r < count; ++r) {
+        const auto& tokens = batch[rows[r]];
+        std::fill(pooled.begin(), pooled.end(), 0.0);
+        for (int token : tokens) {
+            accumulate_embedding(token, pooled, row);
+        }
+        const double inv = 1.0 / static_cast<double>(tokens.size());
+        for (std::size_t h = 0; h < hidden; ++h) {
+            activations[r * hidden + h] = pooled[h] * inv;
+        }
+    }
+
+    forward_layers(activations, count);
+
+    for (std::size_t r = 0; r < count; ++r) {
+        ForwardResult& result = results[rows[r]];
+        result.pre_adapter_hidden.assign(activations.begin() + static_cast<std::ptrdiff_t>(r * hidden),
+                                         activations.begin() + static_cast<std::ptrdiff_t>((r + 1) * hidden));
+        result.hidden = result.pre_adapter_hidden;
+        if (m_active_adapter != nullptr) {
+            const std::vector<double> delta = m_active_adapter->project(result.pre_adapter_hidden);
+            for (std::size_t h = 0; h < hidden; ++h) {
+                result.hidden[h] += delta[h];
+                activations[r * hidden + h] = result.hidden[h];
+            }
+        }
+    }
+
+    std::vector<double> logits(count * vocab, 0.0);
+    multiply(projection_index(), activations.data(), count, logits.data());
+    for (std::size_t r = 0; r < count; ++r) {
+        results[rows[r]].logits.assign(logits.begin() + static_cast<std::ptrdiff_t>(r * vocab),
+                                       logits.begin() + static_cast<std::ptrdiff_t>((r + 1) * vocab));
+    }
+    return results;
+}
+
+void BaseDecoder::forward_pooled(std::vector<double> pooled, std::size_t count, std::vector<double>& logits) const {
+    const std::size_t hidden = m_config.hidden_size;
+    logits.assign(count * m_config.vocab_size, 0.0);
+    if (count == 0) {
+        return;
+    }
+    forward_layers(pooled, count);
+    if (m_active_adapter != nullptr) {
+        std::vector<double> row(hidden);
+        for (std::size_t r = 0; r < count; ++r) {
+            const auto begin = pooled.begin() + static_cast<std::ptrdiff_t>(r * hidden);
+            std::copy(begin, begin + static_cast<std::ptrdiff_t>(hidden), row.begin());
+            const std::vector<double> delta = m_active_adapter->project(row);
+            for (std::size_t h = 0; h < hidden; ++h) {
+                pooled[r * hidden + h] += delta[h];
+            }
+        }
+    }
+    multiply(projection_index(), pooled.data(), count, logits.data());
+}
+
+void BaseDecoder::forward_layers(std::vector<double>& activations, std::size_t count) const {
+    std::vector<double> next(count * m_config.hidden_size, 0.0);
+    for (std::size_t layer = 1; layer <= m_config.num_layers; ++layer) {
+        multiply(layer, activations.data(), count, next.data());
+        for (double& value : next) {
+            value = std::tanh(value);
+        }
+        activations.swap(next);
+    }
 }
 
 std::vector<double> BaseDecoder::forward_layer(std::size_t layer, const std::vector<double>& input) const {
-    const Tensor& weight = m_weights[layer];
     std::vector<double> output(m_config.hidden_size, 0.0);
-    const auto& data = weight.vector();
-    for (std::size_t h = 0; h < m_config.hidden_size; ++h) {
-        double sum = 0.0;
-        for (std::size_t in = 0; in < m_config.hidden_size; ++in) {
-            sum += data[in * m_config.hidden_size + h] * input[in];
-        }
-        output[h] = std::tanh(sum);
+    multiply(layer, input.data(), 1, output.data());
+    for (double& value : output) {
+        value = std::tanh(value);
     }
     return output;
 }
 
+void BaseDecoder::multiply(std::size_t index, const double* x, std::size_t count, double* y) const {
+    if (quantized()) {
+        m_quantized[index].matmul(x, y, count);
+        return;
+    }
+    visit_weights([&](const auto& weights) {
+        const auto& weight = weights[index];
+        kernels::matmul(std::span<const double>(x, count * weight.shape()[0]), count, weight,
+                        std::span<double>(y, count * weight.shape()[1]));
+    });
+}
+
+QuantizationReport BaseDecoder::quantize(WeightPrecision precision) {
+    QuantizationReport report;
+    report.precision = precision;
+    if (precision == WeightPrecision::Float64 || precision == m_config.precision || quantized()) {
+        return report;
+    }
+
+    // Short contexts spread over the vocabulary by a fixed stride.
+    constexpr std::size_t kProbes = 64;
+    constexpr std::size_t kProbeLength = 4;
+    std::vector<std::vector<int>> probes(kProbes);
+    std::size_t token = 0;
+    for (auto& probe : probes) {
+        for (std::size_t i = 0; i < kProbeLength; ++i) {
+            token = (token + 7919) % m_config.vocab_size;
+            probe.push_back(static_cast<int>(token));
+        }
+    }
+    const std::vector<ForwardResult> reference = forward(probes);
+
+    report.bytes_before = visit_weights([](const auto& weights) { return weight_bytes(weights); });
+    if (precision == WeightPrecision::Float32) {
+        set_precision(precision);
+        report.bytes_after = weight_bytes(m_weights_f32);
+    } else {
+        std::vector<QuantizedMatrix> quantized;
+        visit_weights([&](auto& weights) {
+            quantized.reserve(weights.size());
+            for (auto& weight : weights) {
+                quantized.emplace_back(weight, precision);
+                report.bytes_after += quantized.back().bytes();
+                weight = std::remove_reference_t<decltype(weight)>();
+            }
+        });
+        m_quantized = std::move(quantized);
+    }
+
+    const std::vector<ForwardResult> results = forward(probes);
+    double squared_error = 0.0;
+    double squared_reference = 0.0;
+    std::size_t agreeing = 0;
+    std::size_t values = 0;
+    for (std::size_t p = 0; p < probes.size(); ++p) {
+        const auto& expected = reference[p].logits;
+        const auto& actual = results[p].logits;
+        for (std::size_t i = 0; i < expected.size(); ++i) {
+            const double error = actual[i] - expected[i];
+            report.max_abs_error = std::max(report.max_abs_error, std::fabs(error));
+            squared_error += error * error;
+            squared_reference += expected[i] * expected[i];
+        }
+        values += expected.size();
+        if (std::max_element(expected.begin(), expected.end()) - expected.begin()
+            == std::max_element(actual.begin(), actual.end()) - actual.begin()) {
+            ++agreeing;
+        }
+    }
+    report.probes = probes.size();
+    report.rms_error = values ? std::sqrt(squared_error / static_cast<double>(values)) : 0.0;
+    report.relative_rms_error = squared_reference > 0.0 ? std::sqrt(squared_error / squared_reference) : 0.0;
+    report.top1_agreement = probes.empty() ? 1.0 : static_cast<double>(agreeing) / static_cast<double>(probes.size());
+    return report;
+}
+
+WeightPrecision BaseDecoder::precision() const noexcept {
+    return quantized() ? m_quantized.front().precision() : m_config.precision;
+}
+
+void BaseDecoder::set_precision(WeightPrecision precision) {
+    if (precision != WeightPrecision::Float64 && precision != WeightPrecision::Float32) {
+        throw std::invalid_argument("decoder weights are stored in fp64 or fp32; quantize() for inference");
+    }
+    if (precision == m_config.precision) {
+        return;
+    }
+    require_trainable();
+    if (precision == WeightPrecision::Float32) {
+        m_weights_f32 = convert_weights<float>(m_weights);
+    } else {
+        m_weights = convert_weights<double>(m_weights_f32);
+    }
+    m_config.precision = precision;
+}
+
+std::size_t BaseDecoder::projection_index() const {
+    return visit_weights([](const auto& weights) { return weights.size() - 1; });
+}
+
+void BaseDecoder::require_trainable() const {
+    if (quantized()) {
+        throw std::runtime_error(std::string("student weights are quantized to ") + precision_name(precision())
+                                 + " for inference; training is disabled");
+    }
+}
+
 std::vector<double> BaseDecoder::apply_gradients(const std::vector<double>& hidden,
                                                  const std::vector<double>& grad_logits) {
+    require_trainable();
     if (hidden.size() != m_config.hidden_size || grad_logits.size() != m_config.vocab_size) {
         return std::vector<double>(m_config.hidden_size, 0.0);
     }
-    Tensor& projection = m_weights.back();
-    auto& proj = projection.vector();
+    const std::size_t vocab = m_config.vocab_size;
     std::vector<double> grad_hidden(m_config.hidden_size, 0.0);
-    for (std::size_t h = 0; h < m_config.hidden_size; ++h) {
-        for (std::size_t v = 0; v < m_config.vocab_size; ++v) {
-            const std::size_t idx = h * m_config.vocab_size + v;
-            grad_hidden[h] += proj[idx] * grad_logits[v];
-            proj[idx] -= m_config.learning_rate * hidden[h] * grad_logits[v];
+    visit_weights([&](auto& weights) {
+        auto* proj = weights.back().data();
+        for (std::size_t h = 0; h < m_config.hidden_size; ++h) {
+            auto* row = proj + h * vocab;
+            grad_hidden[h] = kernels::dot(row, grad_logits.data(), vocab);
+            kernels::axpy(-m_config.learning_rate * hidden[h], grad_logits.data(), row, vocab);
         }
-    }
+    });
     return grad_hidden;
 }
 
@@ -172,6 +517,9 @@ void BaseDecoder::attach_adapter(const Adapter* adapter) {
 }
 
 bool BaseDecoder::save_weights(const std::string& path) const {
+    if (quantized()) {
+        return false;
+    }
     std::ofstream file(path, std::ios::trunc);
     if (!file) {
         return false;
@@ -186,26 +534,31 @@ bool BaseDecoder::save_weights(const std::string& path) const {
     root["config"] = Json(cfg);
 
     JsonArray weights;
-    for (const auto& tensor : m_weights) {
-        JsonObject tensor_obj;
-        JsonArray shape;
-        for (std::size_t dim : tensor.shape()) {
-            shape.emplace_back(Json(static_cast<int>(dim)));
-        }
-        tensor_obj["shape"] = Json(shape);
-        JsonArray data;
-        for (double value : tensor.vector()) {
-            data.emplace_back(Json(value));
+    visit_weights([&](const auto& tensors) {
+        for (const auto& tensor : tensors) {
+            JsonObject tensor_obj;
+            JsonArray shape;
+            for (std::size_t dim : tensor.shape()) {
+                shape.emplace_back(Json(static_cast<int>(dim)));
+            }
+            tensor_obj["shape"] = Json(shape);
+            JsonArray data;
+            for (double value : tensor.vector()) {
+                data.emplace_back(Json(value));
+            }
+            tensor_obj["data"] = Json(data);
+            weights.emplace_back(Json(tensor_obj));
         }
-        tensor_obj["data"] = Json(data);
-        weights.emplace_back(Json(tensor_obj));
-    }
+    });
     root["weights"] = Json(weights);
     file << Json(root).dump();
     return true;
 }
 
 bool BaseDecoder::load_weights(const std::string& path) {
+    if (is_binary_checkpoint(path)) {
+        return load_weights_binary(path);
+    }
     std::ifstream file(path);
     if (!file) {
         return false;
@@ -269,7 +622,12 @@ bool BaseDecoder::load_weights(const std::string& path) {
             loaded.emplace_back(std::move(tensor));
         }
         if (!loaded.empty()) {
-            m_weights = std::move(loaded);
+            if (m_config.precision == WeightPrecision::Float32) {
+                m_weights_f32 = convert_weights<float>(loaded);
+            } else {
+                m_weights = std::move(loaded);
+            }
+            m_quantized.clear();
         }
     } catch (...) {
         return false;
@@ -277,40 +635,255 @@ bool BaseDecoder::load_weights(const std::string& path) {
     return true;
 }
 
+bool BaseDecoder::save_weights_binary(const std::string& path) const {
+    if (quantized()) {
+        return false;
+    }
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+
+    return visit_weights([&](const auto& weights) {
+        using Element = typename std::remove_cvref_t<decltype(weights)>::value_type::value_type;
+        std::string header;
+        header.append(kBinaryMagic, sizeof(kBinaryMagic));
+        append_pod(header, kBinaryVersion);
+        append_pod(header, kBinaryEndianTag);
+        append_pod(header, static_cast<std::uint64_t>(m_config.vocab_size));
+        append_pod(header, static_cast<std::uint64_t>(m_config.hidden_size));
+        append_pod(header, static_cast<std::uint64_t>(m_config.num_layers));
+        append_pod(header, static_cast<std::uint64_t>(m_config.context_length));
+        append_pod(header, m_config.learning_rate);
+        append_pod(header, static_cast<std::uint64_t>(weights.size()));
+
+        std::size_t offset = align_up(kBinaryHeaderSize + kBinaryEntrySize * weights.size(), kBinaryAlignment);
+        std::vector<std::size_t> offsets;
+        offsets.reserve(weights.size());
+        for (const auto& tensor : weights) {
+            const auto& shape = tensor.shape();
+            if (shape.size() > kBinaryMaxRank) {
+                return false;
+            }
+            const std::size_t bytes = tensor.size() * sizeof(Element);
+            append_pod(header, dtype_of<Element>());
+            append_pod(header, static_cast<std::uint32_t>(shape.size()));
+            for (std::size_t d = 0; d < kBinaryMaxRank; ++d) {
+                append_pod(header, static_cast<std::uint64_t>(d < shape.size() ? shape[d] : 0));
+            }
+            append_pod(header, static_cast<std::uint64_t>(offset));
+            append_pod(header, static_cast<std::uint64_t>(bytes));
+            offsets.push_back(offset);
+            offset = align_up(offset + bytes, kBinaryAlignment);
+        }
+
+        file.write(header.data(), static_cast<std::streamsize>(header.size()));
+        std::size_t written = header.size();
+        const std::string padding(kBinaryAlignment, '\0');
+        for (std::size_t i = 0; i < weights.size(); ++i) {
+            file.write(padding.data(), static_cast<std::streamsize>(offsets[i] - written));
+            const std::size_t bytes = weights[i].size() * sizeof(Element);
+            file.write(reinterpret_cast<const char*>(weights[i].data()), static_cast<std::streamsize>(bytes));
+            written = offsets[i] + bytes;
+        }
+        return static_cast<bool>(file);
+    });
+}
+
+bool BaseDecoder::load_weights_binary(const std::string& path) {
+    MappedFile mapped(path);
+    if (!mapped.is_open()) {
+        return false;
+    }
+    const char* data = mapped.data();
+    const std::size_t size = mapped.size();
+    if (size < kBinaryHeaderSize || std::memcmp(data, kBinaryMagic, sizeof(kBinaryMagic)) != 0) {
+        return false;
+    }
+
+    std::size_t cursor = sizeof(kBinaryMagic);
+    std::uint32_t version = 0;
+    std::uint32_t endian = 0;
+    std::uint64_t vocab = 0;
+    std::uint64_t hidden = 0;
+    std::uint64_t layers = 0;
+    std::uint64_t context = 0;
+    double learning_rate = 0.0;
+    std::uint64_t tensor_count = 0;
+    read_pod(data, size, cursor, version);
+    read_pod(data, size, cursor, endian);
+    read_pod(data, size, cursor, vocab);
+    read_pod(data, size, cursor, hidden);
+    read_pod(data, size, cursor, layers);
+    read_pod(data, size, cursor, context);
+    read_pod(data, size, cursor, learning_rate);
+    read_pod(data, size, cursor, tensor_count);
+    if (version != kBinaryVersion || endian != kBinaryEndianTag) {
+        return false;
+    }
+    // Bound the table by the file before trusting any count or shape in it.
+    if (tensor_count < 2 || tensor_count - 2 != layers
+        || tensor_count > (size - kBinaryHeaderSize) / kBinaryEntrySize) {
+        return false;
+    }
+
+    const bool loaded = visit_weights([&](auto& weights) {
+        using TensorType = typename std::remove_cvref_t<decltype(weights)>::value_type;
+        std::vector<TensorType> loaded_weights;
+        loaded_weights.reserve(static_cast<std::size_t>(tensor_count));
+        for (std::uint64_t t = 0; t < tensor_count; ++t) {
+            std::uint32_t dtype = 0;
+            std::uint32_t rank = 0;
+            std::uint64_t dims[kBinaryMaxRank] = {};
+            std::uint64_t offset = 0;
+            std::uint64_t bytes = 0;
+            read_pod(data, size, cursor, dtype);
+            read_pod(data, size, cursor, rank);
+            for (auto& dim : dims) {
+                read_pod(data, size, cursor, dim);
+            }
+            read_pod(data, size, cursor, offset);
+            read_pod(data, size, cursor, bytes);
+            if (dtype_size(dtype) == 0 || rank != 2 || offset > size || bytes > size - offset) {
+                return false;
+            }
+            // Embedding [vocab, hidden], layers [hidden, hidden], projection [hidden, vocab].
+            const std::uint64_t expected_rows = t == 0 ? vocab : hidden;
+            const std::uint64_t expected_cols = t + 1 == tensor_count ? vocab : hidden;
+            std::uint64_t elements = 0;
+            std::uint64_t payload = 0;
+            if (dims[0] != expected_rows || dims[1] != expected_cols
+                || !checked_multiply(dims[0], dims[1], elements)
+                || !checked_multiply(elements, dtype_size(dtype), payload) || payload != bytes) {
+                return false;
+            }
+            TensorType tensor({static_cast<std::size_t>(dims[0]), static_cast<std::size_t>(dims[1])});
+            read_payload(data + offset, dtype, tensor.data(), tensor.size());
+            loaded_weights.emplace_back(std::move(tensor));
+        }
+        weights = std::move(loaded_weights);
+        return true;
+    });
+    if (!loaded) {
+        return false;
+    }
+
+    m_config.vocab_size = static_cast<std::size_t>(vocab);
+    m_config.hidden_size = static_cast<std::size_t>(hidden);
+    m_config.num_layers = static_cast<std::size_t>(layers);
+    m_config.context_length = static_cast<std::size_t>(context);
+    m_config.learning_rate = learning_rate;
+    m_quantized.clear();
+    return true;
+}
+
 void BaseDecoder::resize_vocab(std::size_t new_vocab_size) {
     if (new_vocab_size <= m_config.vocab_size || new_vocab_size == 0) {
         return;
     }
+    require_trainable();
     const std::size_t old_vocab = m_config.vocab_size;
     std::mt19937 rng = create_rng();
     std::normal_distribution<double> dist(0.0, 0.02);
 
-    Tensor new_embedding({new_vocab_size, m_config.hidden_size}, 0.0);
-    const auto& old_embedding = m_weights.front().vector();
-    auto& embed_data = new_embedding.vector();
-    const std::size_t old_embed_size = old_vocab * m_config.hidden_size;
-    std::copy(old_embedding.begin(), old_embedding.begin() + std::min(old_embed_size, embed_data.size()), embed_data.begin());
-    for (std::size_t v = old_vocab; v < new_vocab_size; ++v) {
+    visit_weights([&](auto& weights) {
+        using TensorType = typename std::remove_cvref_t<decltype(weights)>::value_type;
+        using Element = typename TensorType::value_type;
+
+        TensorType new_embedding({new_vocab_size, m_config.hidden_size}, 0.0);
+        const auto& old_embedding = weights.front().vector();
+        auto& embed_data = new_embedding.vector();
+        const std::size_t old_embed_size = old_vocab * m_config.hidden_size;
+        std::copy(old_embedding.begin(), old_embedding.begin() + std::min(old_embed_size, embed_data.size()), embed_data.begin());
+        for (std::size_t v = old_vocab; v < new_vocab_size; ++v) {
+            for (std::size_t h = 0; h < m_config.hidden_size; ++h) {
+                embed_data[v * m_config.hidden_size + h] = static_cast<Element>(dist(rng));
+            }
+        }
+
+        TensorType new_projection({m_config.hidden_size, new_vocab_size}, 0.0);
+        const auto& old_projection = weights.back().vector();
+        auto& proj_data = new_projection.vector();
         for (std::size_t h = 0; h < m_config.hidden_size; ++h) {
-            embed_data[v * m_config.hidden_size + h] = dist(rng);
+            for (std::size_t v = 0; v < old_vocab; ++v) {
+                proj_data[h * new_vocab_size + v] = old_projection[h * old_vocab + v];
+            }
+            for (std::size_t v = old_vocab; v < new_vocab_size; ++v) {
+                proj_data[h * new_vocab_size + v] = static_cast<Element>(dist(rng));
+            }
         }
+
+        weights.front() = std::move(new_embedding);
+        weights.back() = std::move(new_projection);
+    });
+    m_config.vocab_size = new_vocab_size;
+}
+
+DecodeSession::DecodeSession(const BaseDecoder& decoder)
+    : m_decoder(&decoder), m_embedding_sum(decoder.config().hidden_size, 0.0) {}
+
+void DecodeSession::reset() {
+    m_embedding_sum.assign(m_decoder->config().hidden_size, 0.0);
+    m_token_count = 0;
+}
+
+void DecodeSession::append(int token) {
+    m_decoder->accumulate_embedding(token, m_embedding_sum, m_row);
+    ++m_token_count;
+}
+
+void DecodeSession::append(const std::vector<int>& tokens) {
+    for (int token : tokens) {
+        append(token);
     }
+}
 
-    Tensor new_projection({m_config.hidden_size, new_vocab_size}, 0.0);
-    const auto& old_projection = m_weights.back().vector();
-    auto& proj_data = new_projection.vector();
-    for (std::size_t h = 0; h < m_config.hidden_size; ++h) {
-        for (std::size_t v = 0; v < old_vocab; ++v) {
-            proj_data[h * new_vocab_size + v] = old_projection[h * old_vocab + v];
-        }
-        for (std::size_t v = old_vocab; v < new_vocab_size; ++v) {
-            proj_data[h * new_vocab_size + v] = dist(rng);
-        }
+void DecodeSession::evict(int token) {
+    if (m_token_count == 0) {
+        return;
     }
+    m_decoder->remove_embedding(token, m_embedding_sum, m_row);
+    --m_token_count;
+}
 
-    m_weights.front() = std::move(new_embedding);
-    m_weights.back() = std::move(new_projection);
-    m_config.vocab_size = new_vocab_size;
+BaseDecoder::ForwardResult DecodeSession::forward() const {
+    if (m_token_count == 0) {
+        return m_decoder->forward(std::vector<int>{});
+    }
+    std::vector<double> mean(m_embedding_sum.size());
+    pooled(mean);
+    return m_decoder->forward_pooled(std::move(mean));
+}
+
+void DecodeSession::pooled(std::span<double> out) const {
+    if (m_token_count == 0) {
+        std::fill(out.begin(), out.end(), 0.0);
+        return;
+    }
+    const double inv = 1.0 / static_cast<double>(m_token_count);
+    for (std::size_t h = 0; h < m_embedding_sum.size(); ++h) {
+        out[h] = m_embedding_sum[h] * inv;
+    }
+}
+
+bool is_binary_checkpoint(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    char magic[sizeof(kBinaryMagic)] = {};
+    file.read(magic, sizeof(magic));
+    return file.gcount() == static_cast<std::streamsize>(sizeof(magic))
+        && std::memcmp(magic, kBinaryMagic, sizeof(magic)) == 0;
+}
+
+bool convert_checkpoint(const std::string& input_path, const std::string& output_path) {
+    const bool from_binary = is_binary_checkpoint(input_path);
+    BaseDecoder decoder(ModelConfig{});
+    if (!decoder.load_weights(input_path)) {
+        return false;
+    }
+    return from_binary ? decoder.save_weights(output_path) : decoder.save_weights_binary(output_path);
 }
 
 StudentModel::StudentModel(BaseDecoder base) : m_base(std::move(base)) {}
@@ -319,6 +892,12 @@ BaseDecoder::ForwardResult StudentModel::forward(const std::vector<int>& tokens)
     return m_base.forward(tokens);
 }
 
+DecodeSession StudentModel::start_session(const std::vector<int>& prompt) const {
+    DecodeSession session(m_base);
+    session.append(prompt);
+    return session;
+}
+
 std::vector<double> StudentModel::update(const std::vector<double>& hidden,
                                          const std::vector<double>& grad_logits) {
     return m_base.apply_gradients(hidden, grad_logits);
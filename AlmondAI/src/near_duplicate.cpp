@@ -0,0 +1,208 @@
+#include "../include/almondai/near_duplicate.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+
+namespace almondai {
+
+namespace {
+
+std::uint64_t mix64(std::uint64_t value) {
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+void normalise(std::vector<int>& tokens) {
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+}
+
+double jaccard(const std::vector<int>& a, const std::vector<int>& b) {
+    if (a.empty() || b.empty()) {
+        return 0.0;
+    }
+    std::size_t intersection = 0;
+    auto left = a.begin();
+    auto right = b.begin();
+    while (left != a.end() && right != b.end()) {
+        if (*left < *right) {
+            ++left;
+        } else if (*right < *left) {
+            ++right;
+        } else {
+            ++intersection;
+            ++left;
+            ++right;
+        }
+    }
+    const std::size_t union_size = a.size() + b.size() - intersection;
+    return static_cast<double>(intersection) / static_cast<double>(union_size);
+}
+
+} // namespace
+
+NearDuplicateIndex::NearDuplicateIndex() : NearDuplicateIndex(Options{}) {}
+
+NearDuplicateIndex::NearDuplicateIndex(Options options) : m_options(options) {
+    if (m_options.bands == 0 || m_options.rows_per_band == 0) {
+        throw std::invalid_argument("NearDuplicateIndex requires at least one band and row");
+    }
+    const std::size_t hashes = m_options.bands * m_options.rows_per_band;
+    m_hash_seeds.reserve(hashes);
+    std::uint64_t state = m_options.seed;
+    for (std::size_t i = 0; i < hashes; ++i) {
+        state = mix64(state);
+        m_hash_seeds.push_back(state);
+    }
+    m_buckets.resize(m_options.bands);
+}
+
+std::vector<int> NearDuplicateIndex::token_set(const BpeTokenizer& tokenizer, std::string_view text) {
+    auto tokens = tokenizer.encode(text);
+    tokens.erase(std::remove_if(tokens.begin(), tokens.end(), [](int id) {
+                     return id <= BpeTokenizer::PAD_ID || id == BpeTokenizer::EOS_ID;
+                 }),
+                 tokens.end());
+    normalise(tokens);
+    return tokens;
+}
+
+std::vector<std::uint64_t> NearDuplicateIndex::band_keys(const std::vector<int>& tokens) const {
+    if (tokens.empty()) {
+        return {};
+    }
+    std::vector<std::uint64_t> signature(m_hash_seeds.size(), std::numeric_limits<std::uint64_t>::max());
+    for (int token : tokens) {
+        const auto value = static_cast<std::uint64_t>(static_cast<std::uint32_t>(token));
+        for (std::size_t h = 0; h < m_hash_seeds.size(); ++h) {
+            signature[h] = std::min(signature[h], mix64(value ^ m_hash_seeds[h]));
+        }
+    }
+    std::vector<std::uint64_t> keys(m_options.bands);
+    for (std::size_t band = 0; band < m_options.bands; ++band) {
+        std::uint64_t key = band;
+        for (std::size_t row = 0; row < m_options.rows_per_band; ++row) {
+            key = mix64(key ^ signature[band * m_options.rows_per_band + row]);
+        }
+        keys[band] = key;
+    }
+    return keys;
+}
+
+std::size_t NearDuplicateIndex::store(std::vector<int> tokens, std::vector<std::uint64_t> keys) {
+    std::size_t id = 0;
+    if (!m_free.empty()) {
+        id = m_free.back();
+        m_free.pop_back();
+    } else {
+        id = m_entries.size();
+        m_entries.emplace_back();
+    }
+    for (std::size_t band = 0; band < keys.size(); ++band) {
+        m_buckets[band][keys[band]].push_back(id);
+    }
+    Entry& entry = m_entries[id];
+    entry.tokens = std::move(tokens);
+    entry.band_keys = std::move(keys);
+    entry.live = true;
+    ++m_live;
+    return id;
+}
+
+std::size_t NearDuplicateIndex::insert(std::vector<int> tokens) {
+    normalise(tokens);
+    auto keys = band_keys(tokens);
+    return store(std::move(tokens), std::move(keys));
+}
+
+void NearDuplicateIndex::erase(std::size_t id) {
+    if (id >= m_entries.size() || !m_entries[id].live) {
+        return;
+    }
+    Entry& entry = m_entries[id];
+    for (std::size_t band = 0; band < entry.band_keys.size(); ++band) {
+        auto it = m_buckets[band].find(entry.band_keys[band]);
+        if (it == m_buckets[band].end()) {
+            continue;
+        }
+        auto& members = it->second;
+        members.erase(std::remove(members.begin(), members.end(), id), members.end());
+        if (members.empty()) {
+            m_buckets[band].erase(it);
+        }
+    }
+    entry = Entry{};
+    m_free.push_back(id);
+    --m_live;
+}
+
+void NearDuplicateIndex::clear() {
+    m_entries.clear();
+    m_free.clear();
+    for (auto& bucket : m_buckets) {
+        bucket.clear();
+    }
+    m_live = 0;
+}
+
+NearDuplicateIndex::Match NearDuplicateIndex::best_candidate(const std::vector<int>& tokens,
+                                                             const std::vector<std::uint64_t>& keys,
+                                                             std::size_t exclude) const {
+    Match best;
+    std::unordered_set<std::size_t> seen;
+    for (std::size_t band = 0; band < keys.size(); ++band) {
+        auto it = m_buckets[band].find(keys[band]);
+        if (it == m_buckets[band].end()) {
+            continue;
+        }
+        for (std::size_t candidate : it->second) {
+            if (candidate == exclude || !seen.insert(candidate).second) {
+                continue;
+            }
+            const double similarity = jaccard(tokens, m_entries[candidate].tokens);
+            if (similarity > best.similarity) {
+                best.id = candidate;
+                best.similarity = similarity;
+            }
+        }
+    }
+    return best;
+}
+
+NearDuplicateIndex::Match NearDuplicateIndex::nearest(std::vector<int> tokens) const {
+    normalise(tokens);
+    return best_candidate(tokens, band_keys(tokens), npos);
+}
+
+NearDuplicateIndex::Match NearDuplicateIndex::nearest_exact(std::vector<int> tokens, double threshold) const {
+    normalise(tokens);
+    Match best = best_candidate(tokens, band_keys(tokens), npos);
+    if (best.similarity > threshold) {
+        return best;
+    }
+    for (std::size_t id = 0; id < m_entries.size(); ++id) {
+        if (!m_entries[id].live) {
+            continue;
+        }
+        const double similarity = jaccard(tokens, m_entries[id].tokens);
+        if (similarity > best.similarity) {
+            best.id = id;
+            best.similarity = similarity;
+        }
+    }
+    return best;
+}
+
+NearDuplicateIndex::Match NearDuplicateIndex::nearest_to(std::size_t id) const {
+    if (id >= m_entries.size() || !m_entries[id].live) {
+        return {};
+    }
+    const Entry& entry = m_entries[id];
+    return best_candidate(entry.tokens, entry.band_keys, id);
+}
+
+} // namespace almondai
@@ -2,12 +2,22 @@
 
 #include <curl/curl.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <deque>
+#include <exception>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
+#if LIBCURL_VERSION_NUM < 0x074400
+#error "AlmondAI requires libcurl 7.68 or newer (curl_multi_poll/curl_multi_wakeup)"
+#endif
+
 namespace {
 
 class CurlGlobal {
@@ -22,6 +32,10 @@ public:
     ~CurlGlobal() {
         curl_global_cleanup();
     }
+
+    static void ensure() {
+        static CurlGlobal global;
+    }
 };
 
 size_t write_callback(char* ptr, size_t size, size_t nmemb, void* userdata) {
@@ -66,64 +80,324 @@ long resolve_timeout(long timeout_ms) {
     return resolved;
 }
 
+
+std::string describe_failure(const std::string& url, const std::string& reason) {
+    std::ostringstream oss;
+    oss << "[http] POST " << url << " failed " << reason;
+    return oss.str();
+}
+
 } // namespace
 
 namespace almondai::net {
 
-std::string post_json(const std::string& url,
-                      const std::string& body,
-                      const std::vector<std::pair<std::string, std::string>>& headers,
-                      long timeout_ms) {
-    CurlGlobal global_guard;
+struct HttpClient::State {
+    struct Transfer {
+        std::string url;
+        std::string body;
+        curl_slist* headers = nullptr;
+        long timeout_ms = 0;
+        std::string response;
+        std::promise<HttpResponse> promise;
+        CURL* handle = nullptr;
+        ChunkCallback on_chunk;
+        std::exception_ptr chunk_error;
+    };
 
-    const long resolved_timeout = resolve_timeout(timeout_ms);
+    Options options;
+    CURLM* multi = nullptr;
+    CURLSH* share = nullptr;
+    std::thread loop;
 
-    CURL* handle = curl_easy_init();
-    if (!handle) {
-        throw std::runtime_error("curl_easy_init failed");
+    mutable std::mutex mutex;
+    std::deque<std::unique_ptr<Transfer>> submitted;
+    bool stopping = false;
+    HttpClientStats stats;
+
+    // Owned by the loop thread.
+    std::vector<std::unique_ptr<Transfer>> active;
+    std::vector<CURL*> idle_handles;
+
+    static std::unique_ptr<Transfer> make_transfer(std::string url,
+                                                   std::string body,
+                                                   const HeaderList& headers,
+                                                   long timeout_ms);
+    static std::size_t stream_callback(char* ptr, std::size_t size, std::size_t nmemb, void* userdata);
+
+    std::future<HttpResponse> submit(std::unique_ptr<Transfer> transfer);
+    void run();
+    void start(std::unique_ptr<Transfer> transfer);
+    void finish(CURL* handle, CURLcode code);
+    void fail_all(const std::string& reason);
+};
+
+std::size_t HttpClient::State::stream_callback(char* ptr, std::size_t size, std::size_t nmemb, void* userdata) {
+    auto* transfer = static_cast<Transfer*>(userdata);
+    const std::size_t total = size * nmemb;
+    long status = 0;
+    curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &status);
+    if (status < 200 || status >= 300) {
+        // Error bodies are kept whole for the exception message.
+        transfer->response.append(ptr, total);
+        return total;
     }
+    try {
+        transfer->on_chunk(std::string_view(ptr, total));
+    } catch (...) {
+        transfer->chunk_error = std::current_exception();
+        return 0;
+    }
+    return total;
+}
 
-    std::string response;
-    curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+void HttpClient::State::start(std::unique_ptr<Transfer> transfer) {
+    CURL* handle = nullptr;
+    if (!idle_handles.empty()) {
+        handle = idle_handles.back();
+        idle_handles.pop_back();
+        curl_easy_reset(handle);
+    } else {
+        handle = curl_easy_init();
+    }
+    if (!handle) {
+        transfer->promise.set_exception(std::make_exception_ptr(
+            std::runtime_error(describe_failure(transfer->url, "curl_easy_init failed"))));
+        curl_slist_free_all(transfer->headers);
+        std::scoped_lock lock(mutex);
+        ++stats.failures;
+        --stats.in_flight;
+        return;
+    }
+    curl_easy_setopt(handle, CURLOPT_SHARE, share);
+    curl_easy_setopt(handle, CURLOPT_URL, transfer->url.c_str());
     curl_easy_setopt(handle, CURLOPT_POST, 1L);
-    curl_easy_setopt(handle, CURLOPT_POSTFIELDS, body.c_str());
-    curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE, static_cast<long>(body.size()));
-    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(handle, CURLOPT_WRITEDATA, &response);
-    curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, resolved_timeout);
-    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS, resolved_timeout);
-
-    struct curl_slist* header_list = nullptr;
-    header_list = curl_slist_append(header_list, "Content-Type: application/json");
-    for (const auto& header : headers) {
-        const std::string line = header.first + ": " + header.second;
-        header_list = curl_slist_append(header_list, line.c_str());
+    curl_easy_setopt(handle, CURLOPT_POSTFIELDS, transfer->body.c_str());
+    curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE, static_cast<long>(transfer->body.size()));
+    if (transfer->on_chunk) {
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, stream_callback);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, transfer.get());
+    } else {
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &transfer->response);
     }
-    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, header_list);
+    curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, transfer->timeout_ms);
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS, transfer->timeout_ms);
+    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, transfer->headers);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(handle, CURLOPT_PRIVATE, transfer.get());
+    transfer->handle = handle;
+    curl_multi_add_handle(multi, handle);
+    active.push_back(std::move(transfer));
+}
 
-    const CURLcode code = curl_easy_perform(handle);
-    long status = 0;
-    if (code == CURLE_OK) {
-        curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &status);
+void HttpClient::State::finish(CURL* handle, CURLcode code) {
+    auto it = std::find_if(active.begin(), active.end(), [handle](const auto& transfer) {
+        return transfer->handle == handle;
+    });
+    curl_multi_remove_handle(multi, handle);
+    if (it == active.end()) {
+        curl_easy_cleanup(handle);
+        return;
     }
+    std::unique_ptr<Transfer> transfer = std::move(*it);
+    active.erase(it);
 
-    curl_slist_free_all(header_list);
-    curl_easy_cleanup(handle);
+    HttpResponse response;
+    long connects = 0;
+    double total_seconds = 0.0;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response.status);
+    curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &connects);
+    curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME, &total_seconds);
+    response.latency_ms = total_seconds * 1000.0;
+    response.reused_connection = code == CURLE_OK && connects == 0;
+    response.body = std::move(transfer->response);
+    curl_slist_free_all(transfer->headers);
+    idle_handles.push_back(handle);
 
+    std::string error;
     if (code != CURLE_OK) {
-        std::ostringstream oss;
-        oss << "[http] POST " << url << " failed " << curl_easy_strerror(code);
-        throw std::runtime_error(oss.str());
+        error = describe_failure(transfer->url, curl_easy_strerror(code));
+    } else if (response.status < 200 || response.status >= 300) {
+        error = describe_failure(transfer->url, std::to_string(response.status));
     }
+    {
+        std::scoped_lock lock(mutex);
+        --stats.in_flight;
+        stats.total_latency_ms += response.latency_ms;
+        stats.max_latency_ms = std::max(stats.max_latency_ms, response.latency_ms);
+        stats.connections_opened += static_cast<std::size_t>(connects);
+        if (response.reused_connection) {
+            ++stats.connections_reused;
+        }
+        if (!error.empty() || transfer->chunk_error) {
+            ++stats.failures;
+        }
+    }
+    if (transfer->chunk_error) {
+        transfer->promise.set_exception(transfer->chunk_error);
+    } else if (error.empty()) {
+        transfer->promise.set_value(std::move(response));
+    } else {
+        transfer->promise.set_exception(std::make_exception_ptr(std::runtime_error(error)));
+    }
+}
 
-    if (status < 200 || status >= 300) {
-        std::ostringstream oss;
-        oss << "[http] POST " << url << " failed " << status;
-        throw std::runtime_error(oss.str());
+void HttpClient::State::fail_all(const std::string& reason) {
+    std::deque<std::unique_ptr<Transfer>> pending;
+    {
+        std::scoped_lock lock(mutex);
+        pending.swap(submitted);
+    }
+    for (auto& transfer : active) {
+        curl_multi_remove_handle(multi, transfer->handle);
+        idle_handles.push_back(transfer->handle);
+        pending.push_back(std::move(transfer));
     }
+    active.clear();
+    for (auto& transfer : pending) {
+        curl_slist_free_all(transfer->headers);
+        transfer->promise.set_exception(std::make_exception_ptr(
+            std::runtime_error(describe_failure(transfer->url, reason))));
+    }
+    std::scoped_lock lock(mutex);
+    stats.failures += pending.size();
+    stats.in_flight = 0;
+}
 
-    return response;
+std::future<HttpResponse> HttpClient::State::submit(std::unique_ptr<Transfer> transfer) {
+    auto future = transfer->promise.get_future();
+    {
+        std::scoped_lock lock(mutex);
+        if (stopping) {
+            curl_slist_free_all(transfer->headers);
+            throw std::runtime_error(describe_failure(transfer->url, "client shutting down"));
+        }
+        submitted.push_back(std::move(transfer));
+        ++stats.requests;
+        ++stats.in_flight;
+    }
+    curl_multi_wakeup(multi);
+    return future;
 }
 
-} // namespace almondai::net
+void HttpClient::State::run() {
+    while (true) {
+        std::deque<std::unique_ptr<Transfer>> incoming;
+        {
+            std::scoped_lock lock(mutex);
+            if (stopping) {
+                break;
+            }
+            incoming.swap(submitted);
+        }
+        for (auto& transfer : incoming) {
+            start(std::move(transfer));
+        }
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+        int queued = 0;
+        while (CURLMsg* message = curl_multi_info_read(multi, &queued)) {
+            if (message->msg == CURLMSG_DONE) {
+                finish(message->easy_handle, message->data.result);
+            }
+        }
+        curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+    }
+    fail_all("client shutting down");
+}
+
+HttpClient::HttpClient() : HttpClient(Options{}) {}
+
+HttpClient::HttpClient(Options options) : m_state(std::make_unique<State>()) {
+    CurlGlobal::ensure();
+    m_state->options = options;
+    m_state->multi = curl_multi_init();
+    m_state->share = curl_share_init();
+    if (!m_state->multi || !m_state->share) {
+        if (m_state->multi) {
+            curl_multi_cleanup(m_state->multi);
+        }
+        if (m_state->share) {
+            curl_share_cleanup(m_state->share);
+        }
+        throw std::runtime_error("curl multi/share init failed");
+    }
+    // Only the loop thread touches easy handles, so the share needs no lock callbacks.
+    curl_share_setopt(m_state->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(m_state->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_multi_setopt(m_state->multi, CURLMOPT_MAX_HOST_CONNECTIONS, options.max_connections_per_host);
+    curl_multi_setopt(m_state->multi, CURLMOPT_MAXCONNECTS, options.max_total_connections);
+    m_state->loop = std::thread([state = m_state.get()] { state->run(); });
+}
+
+HttpClient::~HttpClient() {
+    {
+        std::scoped_lock lock(m_state->mutex);
+        m_state->stopping = true;
+    }
+    curl_multi_wakeup(m_state->multi);
+    m_state->loop.join();
+    for (CURL* handle : m_state->idle_handles) {
+        curl_easy_cleanup(handle);
+    }
+    curl_multi_cleanup(m_state->multi);
+    curl_share_cleanup(m_state->share);
+}
+
+HttpClient& HttpClient::shared() {
+    static HttpClient client;
+    return client;
+}
 
+std::unique_ptr<HttpClient::State::Transfer> HttpClient::State::make_transfer(std::string url,
+                                                                              std::string body,
+                                                                              const HeaderList& headers,
+                                                                              long timeout_ms) {
+    auto transfer = std::make_unique<Transfer>();
+    transfer->url = std::move(url);
+    transfer->body = std::move(body);
+    transfer->timeout_ms = resolve_timeout(timeout_ms);
+    transfer->headers = curl_slist_append(nullptr, "Content-Type: application/json");
+    for (const auto& header : headers) {
+        const std::string line = header.first + ": " + header.second;
+        transfer->headers = curl_slist_append(transfer->headers, line.c_str());
+    }
+    return transfer;
+}
+
+std::future<HttpResponse> HttpClient::post_async(std::string url,
+                                                 std::string body,
+                                                 const HeaderList& headers,
+                                                 long timeout_ms) {
+    return m_state->submit(State::make_transfer(std::move(url), std::move(body), headers, timeout_ms));
+}
+
+HttpResponse HttpClient::post(std::string url, std::string body, const HeaderList& headers, long timeout_ms) {
+    return post_async(std::move(url), std::move(body), headers, timeout_ms).get();
+}
+
+HttpResponse HttpClient::post_stream(std::string url,
+                                     std::string body,
+                                     const HeaderList& headers,
+                                     ChunkCallback on_chunk,
+                                     long timeout_ms) {
+    auto transfer = State::make_transfer(std::move(url), std::move(body), headers, timeout_ms);
+    transfer->on_chunk = std::move(on_chunk);
+    return m_state->submit(std::move(transfer)).get();
+}
+
+HttpClientStats HttpClient::stats() const {
+    std::scoped_lock lock(m_state->mutex);
+    return m_state->stats;
+}
+
+std::string post_json(const std::string& url,
+                      const std::string& body,
+                      const HeaderList& headers,
+                      long timeout_ms) {
+    return HttpClient::shared().post(url, body, headers, timeout_ms).body;
+}
+
+} // namespace almondai::net
@@ -1,11 +1,21 @@
 #include "../include/almondai/optim_adamw.hpp"
 
+#include "../include/almondai/kernels.hpp"
+#include "../include/almondai/thread_pool.hpp"
+
 #include <algorithm>
 #include <cmath>
 #include <stdexcept>
 
 namespace almondai {
 
+namespace {
+
+// Below this many parameters per chunk the fork/join cost outweighs the step.
+constexpr std::size_t kParallelChunk = 1 << 16;
+
+} // namespace
+
 AdamWOptimizer::AdamWOptimizer(std::size_t parameter_count)
     : AdamWOptimizer(parameter_count, Params{}) {}
 
@@ -15,45 +25,161 @@ AdamWOptimizer::AdamWOptimizer(std::size_t parameter_count, Params params)
 }
 
 void AdamWOptimizer::reset(std::size_t parameter_count) {
-    m_moment1.assign(parameter_count, 0.0);
-    m_moment2.assign(parameter_count, 0.0);
+    m_parameter_count = parameter_count;
+    allocate_state();
     m_step = 0;
 }
 
+void AdamWOptimizer::allocate_state() {
+    m_moment1.clear();
+    m_moment2.clear();
+    m_moment1_f32.clear();
+    m_moment2_f32.clear();
+    m_moment1_bf16.clear();
+    m_moment2_bf16.clear();
+    switch (m_params.moment_precision) {
+    case MomentPrecision::Float64:
+        m_moment1.assign(m_parameter_count, 0.0);
+        m_moment2.assign(m_parameter_count, 0.0);
+        break;
+    case MomentPrecision::Float32:
+        m_moment1_f32.assign(m_parameter_count, 0.0f);
+        m_moment2_f32.assign(m_parameter_count, 0.0f);
+        break;
+    case MomentPrecision::BFloat16:
+        m_moment1_bf16.assign(m_parameter_count, 0);
+        m_moment2_bf16.assign(m_parameter_count, 0);
+        break;
+    }
+}
+
+std::vector<double> AdamWOptimizer::export_moments(bool second) const {
+    switch (m_params.moment_precision) {
+    case MomentPrecision::Float64:
+        return second ? m_moment2 : m_moment1;
+    case MomentPrecision::Float32: {
+        const auto& source = second ? m_moment2_f32 : m_moment1_f32;
+        return std::vector<double>(source.begin(), source.end());
+    }
+    case MomentPrecision::BFloat16: {
+        const auto& source = second ? m_moment2_bf16 : m_moment1_bf16;
+        std::vector<double> values(source.size());
+        std::transform(source.begin(), source.end(), values.begin(), kernels::bf16_to_double);
+        return values;
+    }
+    }
+    return {};
+}
+
+void AdamWOptimizer::set_params(Params params) {
+    if (params.moment_precision == m_params.moment_precision) {
+        m_params = params;
+        return;
+    }
+    const auto first = export_moments(false);
+    const auto second = export_moments(true);
+    m_params = params;
+    allocate_state();
+    for (std::size_t i = 0; i < std::min(first.size(), m_parameter_count); ++i) {
+        switch (m_params.moment_precision) {
+        case MomentPrecision::Float64:
+            m_moment1[i] = first[i];
+            m_moment2[i] = second[i];
+            break;
+        case MomentPrecision::Float32:
+            m_moment1_f32[i] = static_cast<float>(first[i]);
+            m_moment2_f32[i] = static_cast<float>(second[i]);
+            break;
+        case MomentPrecision::BFloat16:
+            m_moment1_bf16[i] = kernels::double_to_bf16(first[i]);
+            m_moment2_bf16[i] = kernels::double_to_bf16(second[i]);
+            break;
+        }
+    }
+}
+
 void AdamWOptimizer::zero_state() {
-    std::fill(m_moment1.begin(), m_moment1.end(), 0.0);
-    std::fill(m_moment2.begin(), m_moment2.end(), 0.0);
+    allocate_state();
     m_step = 0;
 }
 
+std::size_t AdamWOptimizer::state_bytes() const noexcept {
+    return m_moment1.size() * sizeof(double) * 2
+        + m_moment1_f32.size() * sizeof(float) * 2
+        + m_moment1_bf16.size() * sizeof(std::uint16_t) * 2;
+}
+
+template <typename Param>
+void AdamWOptimizer::update_range(const kernels::AdamWStep& constants,
+                                  Param* parameters,
+                                  const double* gradients,
+                                  std::size_t begin,
+                                  std::size_t end) {
+    const std::size_t count = end - begin;
+    switch (m_params.moment_precision) {
+    case MomentPrecision::Float64:
+        kernels::adamw_step(constants, parameters + begin, gradients + begin,
+                            m_moment1.data() + begin, m_moment2.data() + begin, count);
+        break;
+    case MomentPrecision::Float32:
+        kernels::adamw_step(constants, parameters + begin, gradients + begin,
+                            m_moment1_f32.data() + begin, m_moment2_f32.data() + begin, count);
+        break;
+    case MomentPrecision::BFloat16:
+        kernels::adamw_step_bf16(constants, parameters + begin, gradients + begin,
+                                 m_moment1_bf16.data() + begin, m_moment2_bf16.data() + begin, count);
+        break;
+    }
+}
+
 void AdamWOptimizer::step(std::vector<double>& parameters,
                           const std::vector<double>& gradients,
                           double learning_rate_scale) {
+    step_parameters(parameters, gradients, learning_rate_scale);
+}
+
+void AdamWOptimizer::step(std::vector<float>& parameters,
+                          const std::vector<double>& gradients,
+                          double learning_rate_scale) {
+    step_parameters(parameters, gradients, learning_rate_scale);
+}
+
+template <typename Param>
+void AdamWOptimizer::step_parameters(std::vector<Param>& parameters,
+                                     const std::vector<double>& gradients,
+                                     double learning_rate_scale) {
     if (parameters.size() != gradients.size()) {
         throw std::invalid_argument("adamw parameter/gradient size mismatch");
     }
-    if (m_moment1.size() != parameters.size()) {
+    if (m_parameter_count != parameters.size()) {
         reset(parameters.size());
     }
 
     ++m_step;
-    const double lr = m_params.learning_rate * learning_rate_scale;
-    const double bias_correction1 = 1.0 - std::pow(m_params.beta1, static_cast<double>(m_step));
-    const double bias_correction2 = 1.0 - std::pow(m_params.beta2, static_cast<double>(m_step));
-
-    for (std::size_t i = 0; i < parameters.size(); ++i) {
-        const double grad = gradients[i];
-        m_moment1[i] = m_params.beta1 * m_moment1[i] + (1.0 - m_params.beta1) * grad;
-        m_moment2[i] = m_params.beta2 * m_moment2[i] + (1.0 - m_params.beta2) * (grad * grad);
+    kernels::AdamWStep constants;
+    constants.learning_rate = m_params.learning_rate * learning_rate_scale;
+    constants.beta1 = m_params.beta1;
+    constants.beta2 = m_params.beta2;
+    constants.epsilon = m_params.epsilon;
+    constants.weight_decay = m_params.weight_decay;
+    constants.bias_correction1 = 1.0 - std::pow(m_params.beta1, static_cast<double>(m_step));
+    constants.bias_correction2 = 1.0 - std::pow(m_params.beta2, static_cast<double>(m_step));
 
-        const double m_hat = m_moment1[i] / bias_correction1;
-        const double v_hat = m_moment2[i] / bias_correction2;
-        const double denom = std::sqrt(v_hat) + m_params.epsilon;
-        const double update = m_hat / denom;
-        const double decay = m_params.weight_decay * parameters[i];
-        parameters[i] -= lr * (update + decay);
+    const std::size_t count = parameters.size();
+    const std::size_t chunks = m_pool ? std::min(m_pool->size() * 4, count / kParallelChunk) : 0;
+    if (chunks <= 1) {
+        update_range(constants, parameters.data(), gradients.data(), 0, count);
+        return;
     }
+    // Chunk sizes are rounded up to whole vectors.
+    const std::size_t chunk = ((count + chunks - 1) / chunks + 7) & ~std::size_t{7};
+    m_pool->parallel_for(chunks, [&](std::size_t index) {
+        const std::size_t begin = std::min(count, index * chunk);
+        const std::size_t end = std::min(count, begin + chunk);
+        if (begin < end) {
+            update_range(constants, parameters.data(), gradients.data(), begin, end);
+        }
+    });
 }
 
 } // namespace almondai
-
@@ -0,0 +1,123 @@
+#include "../include/almondai/quantize.hpp"
+#include "../include/almondai/kernels.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace almondai {
+
+const char* precision_name(WeightPrecision precision) noexcept {
+    switch (precision) {
+    case WeightPrecision::Float32:
+        return "fp32";
+    case WeightPrecision::Float16:
+        return "fp16";
+    case WeightPrecision::Int8:
+        return "int8";
+    case WeightPrecision::Float64:
+        break;
+    }
+    return "fp64";
+}
+
+std::optional<WeightPrecision> parse_precision(std::string_view name) {
+    std::string lowered(name);
+    std::transform(lowered.begin(), lowered.end(), lowered.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    if (lowered == "fp64" || lowered == "double") {
+        return WeightPrecision::Float64;
+    }
+    if (lowered == "fp32" || lowered == "float") {
+        return WeightPrecision::Float32;
+    }
+    if (lowered == "fp16" || lowered == "half") {
+        return WeightPrecision::Float16;
+    }
+    if (lowered == "int8") {
+        return WeightPrecision::Int8;
+    }
+    return std::nullopt;
+}
+
+template <typename T>
+QuantizedMatrix::QuantizedMatrix(const BasicTensor<T>& weight, WeightPrecision precision) : m_precision(precision) {
+    if (weight.shape().size() != 2) {
+        throw std::invalid_argument("quantized weight must be rank 2");
+    }
+    m_rows = weight.shape()[0];
+    m_cols = weight.shape()[1];
+    const T* data = weight.data();
+
+    if (precision == WeightPrecision::Float16) {
+        m_fp16.resize(weight.size());
+        for (std::size_t i = 0; i < weight.size(); ++i) {
+            m_fp16[i] = kernels::double_to_fp16(static_cast<double>(data[i]));
+        }
+        return;
+    }
+    if (precision != WeightPrecision::Int8) {
+        throw std::invalid_argument("unsupported quantized precision");
+    }
+
+    const std::size_t groups = (m_cols + kernels::kQuantGroup - 1) / kernels::kQuantGroup;
+    m_int8.resize(weight.size());
+    m_scales.resize(m_rows * groups);
+    for (std::size_t r = 0; r < m_rows; ++r) {
+        for (std::size_t g = 0; g < groups; ++g) {
+            const std::size_t begin = r * m_cols + g * kernels::kQuantGroup;
+            const std::size_t end = r * m_cols + std::min(m_cols, (g + 1) * kernels::kQuantGroup);
+            double absmax = 0.0;
+            for (std::size_t i = begin; i < end; ++i) {
+                absmax = std::max(absmax, std::fabs(static_cast<double>(data[i])));
+            }
+            const float scale = static_cast<float>(absmax / 127.0);
+            m_scales[r * groups + g] = scale;
+            const double inverse = scale > 0.0f ? 1.0 / static_cast<double>(scale) : 0.0;
+            for (std::size_t i = begin; i < end; ++i) {
+                const double q = std::nearbyint(static_cast<double>(data[i]) * inverse);
+                m_int8[i] = static_cast<std::int8_t>(std::clamp(q, -127.0, 127.0));
+            }
+        }
+    }
+}
+
+template QuantizedMatrix::QuantizedMatrix(const BasicTensor<double>&, WeightPrecision);
+template QuantizedMatrix::QuantizedMatrix(const BasicTensor<float>&, WeightPrecision);
+
+std::size_t QuantizedMatrix::bytes() const noexcept {
+    return m_int8.size() + m_scales.size() * sizeof(float) + m_fp16.size() * sizeof(std::uint16_t);
+}
+
+void QuantizedMatrix::matmul(const double* x, double* y, std::size_t batch) const {
+    if (m_precision == WeightPrecision::Float16) {
+        kernels::matmul_f16(x, m_fp16.data(), y, batch, m_rows, m_cols);
+    } else {
+        kernels::matmul_q8(x, m_int8.data(), m_scales.data(), y, batch, m_rows, m_cols);
+    }
+}
+
+void QuantizedMatrix::dequantize_row(std::size_t row, double* y) const {
+    if (m_precision == WeightPrecision::Float16) {
+        kernels::dequantize_f16(m_fp16.data() + row * m_cols, y, m_cols);
+    } else {
+        const std::size_t groups = (m_cols + kernels::kQuantGroup - 1) / kernels::kQuantGroup;
+        kernels::dequantize_q8(m_int8.data() + row * m_cols, m_scales.data() + row * groups, y, m_cols);
+    }
+}
+
+std::string QuantizationReport::summary() const {
+    std::ostringstream out;
+    out << "Quantized student weights to " << precision_name(precision) << ": " << std::fixed << std::setprecision(1)
+        << static_cast<double>(bytes_before) / (1024.0 * 1024.0) << " MiB -> "
+        << static_cast<double>(bytes_after) / (1024.0 * 1024.0) << " MiB; over " << probes
+        << " probes top-1 agreement " << top1_agreement * 100.0 << "%, relative logit RMS error "
+        << std::setprecision(2) << std::scientific << relative_rms_error << ", max " << max_abs_error;
+    return out.str();
+}
+
+} // namespace almondai
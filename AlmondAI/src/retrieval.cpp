@@ -10,37 +10,48 @@
 #include <fstream>
 #include <set>
 #include <cctype>
+#include <limits>
 #include <optional>
+#include <sstream>
 #include <type_traits>
+#include <utility>
 
 namespace almondai {
 
-RetrievalIndex::RetrievalIndex(const WordTokenizer& tokenizer) : m_tokenizer(tokenizer) {}
+RetrievalIndex::RetrievalIndex(const WordTokenizer& tokenizer)
+    : m_tokenizer(tokenizer), m_snapshot(std::make_shared<const Snapshot>()) {}
 
 RetrievalIndex::RetrievalIndex(RetrievalIndex&& other) noexcept
     : m_tokenizer(other.m_tokenizer) {
-    std::scoped_lock lock(other.m_mutex);
-    m_term_counts = std::move(other.m_term_counts);
-    m_document_frequency = std::move(other.m_document_frequency);
-    m_cached_tokens = std::move(other.m_cached_tokens);
-    m_query_count = other.m_query_count;
-    m_hit_count = other.m_hit_count;
+    std::scoped_lock lock(other.m_write_mutex);
+    m_snapshot.store(other.m_snapshot.exchange(std::make_shared<const Snapshot>()));
+    m_query_count.store(other.m_query_count.load());
+    m_hit_count.store(other.m_hit_count.load());
 }
 
 RetrievalIndex& RetrievalIndex::operator=(RetrievalIndex&& other) noexcept {
     if (this != &other) {
-        std::scoped_lock lock(m_mutex, other.m_mutex);
-        m_term_counts = std::move(other.m_term_counts);
-        m_document_frequency = std::move(other.m_document_frequency);
-        m_cached_tokens = std::move(other.m_cached_tokens);
-        m_query_count = other.m_query_count;
-        m_hit_count = other.m_hit_count;
+        std::scoped_lock lock(m_write_mutex, other.m_write_mutex);
+        m_snapshot.store(other.m_snapshot.exchange(std::make_shared<const Snapshot>()));
+        m_query_count.store(other.m_query_count.load());
+        m_hit_count.store(other.m_hit_count.load());
     }
     return *this;
 }
 
 namespace {
 
+constexpr double kBm25K1 = 1.2;
+constexpr double kBm25B = 0.75;
+// Tombstones tolerated before all segments are rebuilt into one.
+constexpr std::size_t kMergeMinimum = 1024;
+constexpr std::uint32_t kDroppedDocument = std::numeric_limits<std::uint32_t>::max();
+constexpr std::size_t kMissingTerm = std::numeric_limits<std::size_t>::max();
+
+double bm25_idf(double doc_count, double document_frequency) {
+    return std::log(1.0 + (doc_count - document_frequency + 0.5) / (document_frequency + 0.5));
+}
+
 std::vector<std::string> normalise_tags(const std::vector<std::string>& tags) {
     std::vector<std::string> cleaned;
     cleaned.reserve(tags.size());
@@ -77,35 +88,260 @@ std::vector<std::string> normalise_tags(const std::vector<std::string>& tags) {
 
 } // namespace
 
+std::shared_ptr<const RetrievalIndex::Snapshot> RetrievalIndex::snapshot() const {
+    return m_snapshot.load(std::memory_order_acquire);
+}
+
+const std::uint32_t* RetrievalIndex::Segment::find_number(const std::string& id) const {
+    const std::string_view key(id);
+    const auto it = std::lower_bound(ids.begin(), ids.end(), key, [](const auto& entry, std::string_view value) {
+        return entry.first < value;
+    });
+    if (it == ids.end() || it->first != key) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+std::size_t RetrievalIndex::Segment::find_term(int token) const {
+    const auto it = std::lower_bound(terms.begin(), terms.end(), token);
+    if (it == terms.end() || *it != token) {
+        return kMissingTerm;
+    }
+    return static_cast<std::size_t>(it - terms.begin());
+}
+
+std::shared_ptr<const RetrievalIndex::Segment> RetrievalIndex::build_segment(std::vector<Document> documents) {
+    struct Entry {
+        int token = 0;
+        std::uint32_t doc = 0;
+        std::uint32_t tf = 0;
+    };
+    auto segment = std::make_shared<Segment>();
+    segment->documents.reserve(documents.size());
+    segment->ids.reserve(documents.size());
+    std::vector<Entry> entries;
+    std::vector<int> sorted;
+    for (auto& source : documents) {
+        const auto number = static_cast<std::uint32_t>(segment->documents.size());
+        segment->documents.push_back(std::make_shared<const Document>(std::move(source)));
+        const Document& document = *segment->documents.back();
+        segment->ids.emplace_back(std::string_view(document.id), number);
+        sorted.assign(document.tokens.begin(), document.tokens.end());
+        std::sort(sorted.begin(), sorted.end());
+        for (std::size_t i = 0; i < sorted.size();) {
+            std::size_t j = i;
+            while (j < sorted.size() && sorted[j] == sorted[i]) {
+                ++j;
+            }
+            entries.push_back(Entry{sorted[i], number, static_cast<std::uint32_t>(j - i)});
+            i = j;
+        }
+    }
+    std::sort(segment->ids.begin(), segment->ids.end());
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.token < b.token || (a.token == b.token && a.doc < b.doc);
+    });
+
+    segment->postings.reserve(entries.size());
+    for (const Entry& entry : entries) {
+        if (segment->terms.empty() || segment->terms.back() != entry.token) {
+            segment->terms.push_back(entry.token);
+            segment->offsets.push_back(static_cast<std::uint32_t>(segment->postings.size()));
+            segment->max_tf.push_back(0);
+        }
+        segment->postings.push_back(Posting{entry.doc, entry.tf});
+        segment->max_tf.back() = std::max(segment->max_tf.back(), entry.tf);
+    }
+    segment->offsets.push_back(static_cast<std::uint32_t>(segment->postings.size()));
+    return segment;
+}
+
+const RetrievalIndex::Document* RetrievalIndex::find_live(const Snapshot& snapshot, const std::string& id) {
+    for (auto view = snapshot.segments.rbegin(); view != snapshot.segments.rend(); ++view) {
+        const std::uint32_t* number = view->segment->find_number(id);
+        if (number == nullptr || (view->deleted && (*view->deleted)[*number])) {
+            continue;
+        }
+        return view->segment->documents[*number].get();
+    }
+    return nullptr;
+}
+
+void RetrievalIndex::tombstone(Snapshot& snapshot, const std::string& id) {
+    for (auto view = snapshot.segments.rbegin(); view != snapshot.segments.rend(); ++view) {
+        const std::uint32_t* number = view->segment->find_number(id);
+        if (number == nullptr || (view->deleted && (*view->deleted)[*number])) {
+            continue;
+        }
+        auto deleted = view->deleted
+            ? std::make_shared<std::vector<bool>>(*view->deleted)
+            : std::make_shared<std::vector<bool>>(view->segment->documents.size(), false);
+        (*deleted)[*number] = true;
+        view->deleted = std::move(deleted);
+        ++view->deleted_count;
+        --snapshot.live_documents;
+        snapshot.live_token_total -= view->segment->documents[*number]->tokens.size();
+        return;
+    }
+}
+
+void RetrievalIndex::merge_segments(Snapshot& snapshot) {
+    const auto live_size = [](const SegmentView& view) {
+        return view.segment->documents.size() - view.deleted_count;
+    };
+    // Concatenates segments [first, end) dropping tombstones. Postings are remapped
+    // rather than recounted and stay sorted because older segments come first.
+    const auto merge_range = [&](std::size_t first) {
+        struct Run {
+            int token = 0;
+            std::size_t segment = 0;
+            std::size_t term = 0;
+        };
+        auto merged = std::make_shared<Segment>();
+        std::vector<std::vector<std::uint32_t>> remaps;
+        std::vector<Run> runs;
+        for (std::size_t s = first; s < snapshot.segments.size(); ++s) {
+            const SegmentView& view = snapshot.segments[s];
+            const Segment& source = *view.segment;
+            auto& remap = remaps.emplace_back(source.documents.size(), kDroppedDocument);
+            for (std::size_t d = 0; d < source.documents.size(); ++d) {
+                if (view.deleted && (*view.deleted)[d]) {
+                    continue;
+                }
+                remap[d] = static_cast<std::uint32_t>(merged->documents.size());
+                merged->documents.push_back(source.documents[d]);
+            }
+            const std::size_t middle = merged->ids.size();
+            for (const auto& [id, number] : source.ids) {
+                if (remap[number] != kDroppedDocument) {
+                    merged->ids.emplace_back(id, remap[number]);
+                }
+            }
+            std::inplace_merge(merged->ids.begin(), merged->ids.begin() + static_cast<std::ptrdiff_t>(middle),
+                               merged->ids.end());
+            for (std::size_t t = 0; t < source.terms.size(); ++t) {
+                runs.push_back(Run{source.terms[t], s - first, t});
+            }
+        }
+        std::stable_sort(runs.begin(), runs.end(), [](const Run& a, const Run& b) {
+            return a.token < b.token;
+        });
+
+        const auto close_term = [&] {
+            if (!merged->terms.empty() && merged->offsets.back() == merged->postings.size()) {
+                merged->terms.pop_back();
+                merged->offsets.pop_back();
+                merged->max_tf.pop_back();
+            }
+        };
+        for (const Run& run : runs) {
+            if (merged->terms.empty() || merged->terms.back() != run.token) {
+                close_term();
+                merged->terms.push_back(run.token);
+                merged->offsets.push_back(static_cast<std::uint32_t>(merged->postings.size()));
+                merged->max_tf.push_back(0);
+            }
+            const Segment& source = *snapshot.segments[first + run.segment].segment;
+            const auto& remap = remaps[run.segment];
+            for (std::uint32_t p = source.offsets[run.term]; p < source.offsets[run.term + 1]; ++p) {
+                const Posting& posting = source.postings[p];
+                if (remap[posting.doc] == kDroppedDocument) {
+                    continue;
+                }
+                merged->postings.push_back(Posting{remap[posting.doc], posting.tf});
+                merged->max_tf.back() = std::max(merged->max_tf.back(), posting.tf);
+            }
+        }
+        close_term();
+        merged->offsets.push_back(static_cast<std::uint32_t>(merged->postings.size()));
+
+        snapshot.segments.resize(first);
+        snapshot.segments.push_back(SegmentView{std::move(merged), nullptr, 0});
+    };
+
+    // Tombstones outweigh live documents: rebuild a single compact segment.
+    if (snapshot.total_documents - snapshot.live_documents > std::max(kMergeMinimum, snapshot.live_documents)) {
+        merge_range(0);
+        snapshot.total_documents = snapshot.live_documents;
+        return;
+    }
+    // Log-structured policy: fold the newest segment into its predecessor while the
+    // predecessor is no larger, keeping O(log n) segments and amortised O(log n) work
+    // per document.
+    while (snapshot.segments.size() >= 2) {
+        const std::size_t last = snapshot.segments.size() - 1;
+        if (live_size(snapshot.segments[last - 1]) > live_size(snapshot.segments[last])) {
+            break;
+        }
+        const std::size_t dropped = snapshot.segments[last - 1].deleted_count + snapshot.segments[last].deleted_count;
+        merge_range(last - 1);
+        snapshot.total_documents -= dropped;
+    }
+}
+
 void RetrievalIndex::ingest_document(const std::string& id,
                                      const std::string& text,
                                      const std::vector<std::string>& tags) {
     auto tokens = m_tokenizer.encode(text);
-    std::unordered_map<int, int> counts;
-    for (int token : tokens) {
-        ++counts[token];
-    }
-
-    std::scoped_lock lock(m_mutex);
-    if (auto existing = m_term_counts.find(id); existing != m_term_counts.end()) {
-        for (const auto& [token, _] : existing->second) {
-            auto freq_it = m_document_frequency.find(token);
-            if (freq_it != m_document_frequency.end()) {
-                if (freq_it->second > 1) {
-                    --freq_it->second;
-                } else {
-                    m_document_frequency.erase(freq_it);
-                }
+    auto cleaned_tags = normalise_tags(tags);
+
+    std::scoped_lock lock(m_write_mutex);
+    auto next = std::make_shared<Snapshot>(*snapshot());
+    tombstone(*next, id);
+    next->live_token_total += tokens.size();
+    ++next->live_documents;
+    ++next->total_documents;
+    std::vector<Document> delta;
+    delta.push_back(Document{id, std::move(tokens), std::move(cleaned_tags)});
+    next->segments.push_back(SegmentView{build_segment(std::move(delta)), nullptr, 0});
+    merge_segments(*next);
+    m_snapshot.store(std::move(next), std::memory_order_release);
+}
+
+std::size_t RetrievalIndex::ingest_documents(std::vector<PendingDocument> documents, ThreadPool& pool) {
+    // Positions of the last entry for each id, in ingestion order.
+    std::vector<std::size_t> kept;
+    {
+        std::unordered_set<std::string_view> seen;
+        for (std::size_t i = documents.size(); i-- > 0;) {
+            if (seen.insert(documents[i].id).second) {
+                kept.push_back(i);
             }
         }
+        std::reverse(kept.begin(), kept.end());
     }
-    m_cached_tokens[id] = tokens;
-    m_term_counts[id] = counts;
-    for (const auto& [token, count] : counts) {
-        (void)count;
-        ++m_document_frequency[token];
+    if (kept.empty()) {
+        return 0;
     }
-    m_document_tags[id] = normalise_tags(tags);
+    std::vector<Document> batch(kept.size());
+    const std::size_t shards = std::min(kept.size(), pool.size() * 4);
+    pool.parallel_for(shards, [&](std::size_t shard) {
+        const std::size_t last = kept.size() * (shard + 1) / shards;
+        for (std::size_t k = kept.size() * shard / shards; k < last; ++k) {
+            PendingDocument& source = documents[kept[k]];
+            batch[k] = Document{std::move(source.id), m_tokenizer.encode(source.text), normalise_tags(source.tags)};
+            source.text = std::string();
+        }
+    });
+
+    std::scoped_lock lock(m_write_mutex);
+    auto next = std::make_shared<Snapshot>(*snapshot());
+    std::size_t changed = 0;
+    for (const Document& document : batch) {
+        const Document* previous = find_live(*next, document.id);
+        if (!previous || previous->tokens != document.tokens || previous->tags != document.tags) {
+            ++changed;
+        }
+        tombstone(*next, document.id);
+        next->live_token_total += document.tokens.size();
+    }
+    next->live_documents += batch.size();
+    next->total_documents += batch.size();
+    next->segments.push_back(SegmentView{build_segment(std::move(batch)), nullptr, 0});
+    merge_segments(*next);
+    m_snapshot.store(std::move(next), std::memory_order_release);
+    return changed;
 }
 
 std::vector<RetrievalResult> RetrievalIndex::query(const std::string& text, std::size_t top_k) const {
@@ -116,86 +352,227 @@ std::vector<RetrievalResult> RetrievalIndex::query(const std::string& text, std:
     }
 
     std::vector<RetrievalResult> results;
-    std::scoped_lock lock(m_mutex);
-    ++m_query_count;
-    const double doc_count = static_cast<double>(m_term_counts.size());
-    for (const auto& [doc_id, counts] : m_term_counts) {
+    m_query_count.fetch_add(1, std::memory_order_relaxed);
+    const auto current = snapshot();
+    if (top_k == 0 || current->live_documents == 0) {
+        return results;
+    }
+
+    const double doc_count = static_cast<double>(current->total_documents);
+    const double avg_length = std::max(1.0, static_cast<double>(current->live_token_total)
+                                                / static_cast<double>(current->live_documents));
+
+    struct QueryTerm {
+        int token = 0;
+        double weight = 0.0;
+    };
+    std::vector<QueryTerm> terms;
+    terms.reserve(query_counts.size());
+    for (const auto& [token, qcount] : query_counts) {
+        std::size_t df = 0;
+        for (const auto& view : current->segments) {
+            const Segment& segment = *view.segment;
+            if (const std::size_t term = segment.find_term(token); term != kMissingTerm) {
+                df += segment.offsets[term + 1] - segment.offsets[term];
+            }
+        }
+        if (df == 0) {
+            continue;
+        }
+        terms.push_back(QueryTerm{token, bm25_idf(doc_count, static_cast<double>(df)) * static_cast<double>(qcount)});
+    }
+    if (terms.empty()) {
+        return results;
+    }
+
+    struct Scored {
         double score = 0.0;
-        for (const auto& [token, qcount] : query_counts) {
-            const auto df_it = m_document_frequency.find(token);
-            if (df_it == m_document_frequency.end()) {
+        std::uint64_t ordinal = 0;
+        const Document* document = nullptr;
+    };
+    const auto better = [](const Scored& a, const Scored& b) {
+        return a.score > b.score || (a.score == b.score && a.ordinal < b.ordinal);
+    };
+    std::vector<Scored> heap;
+    heap.reserve(top_k + 1);
+    double threshold = 0.0;
+
+    struct Cursor {
+        const Posting* pos = nullptr;
+        const Posting* end = nullptr;
+        double weight = 0.0;
+        double upper_bound = 0.0;
+    };
+    std::vector<Cursor> cursors;
+    std::vector<double> bound_prefix;
+
+    // The heap and threshold carry across segments so later segments prune against
+    // the best scores found so far.
+    std::uint64_t ordinal_base = 0;
+    for (const auto& view : current->segments) {
+        const Segment& segment = *view.segment;
+        const std::uint64_t segment_base = ordinal_base;
+        ordinal_base += segment.documents.size();
+
+        cursors.clear();
+        for (const auto& term : terms) {
+            const std::size_t index = segment.find_term(term.token);
+            if (index == kMissingTerm) {
                 continue;
             }
-            const double idf = std::log((doc_count + 1.0) / (df_it->second + 1.0)) + 1.0;
-            const auto tf_it = counts.find(token);
-            if (tf_it != counts.end()) {
-                score += (static_cast<double>(tf_it->second) * idf) * static_cast<double>(qcount);
+            // Document length only enters the denominator, so a zero-length document bounds the term.
+            const double max_tf = static_cast<double>(segment.max_tf[index]);
+            const double upper_bound = term.weight * max_tf * (kBm25K1 + 1.0) / (max_tf + kBm25K1 * (1.0 - kBm25B));
+            const Posting* postings = segment.postings.data();
+            cursors.push_back(Cursor{postings + segment.offsets[index], postings + segment.offsets[index + 1],
+                                     term.weight, upper_bound});
+        }
+        if (cursors.empty()) {
+            continue;
+        }
+
+        // MaxScore: terms sorted by upper bound; the low-bound prefix whose bounds sum
+        // to at most the current k-th score cannot introduce new candidates on its own
+        // and is only probed for documents found through the essential terms.
+        std::sort(cursors.begin(), cursors.end(), [](const Cursor& a, const Cursor& b) {
+            return a.upper_bound < b.upper_bound;
+        });
+        bound_prefix.assign(cursors.size() + 1, 0.0);
+        for (std::size_t i = 0; i < cursors.size(); ++i) {
+            bound_prefix[i + 1] = bound_prefix[i] + cursors[i].upper_bound;
+        }
+        std::size_t essential = 0;
+        if (heap.size() == top_k) {
+            while (essential < cursors.size() && bound_prefix[essential + 1] <= threshold) {
+                ++essential;
             }
         }
-        if (score > 0.0) {
-            RetrievalResult result;
-            result.document_id = doc_id;
-            result.score = score;
-            result.tokens = m_cached_tokens.at(doc_id);
-            if (auto tag_it = m_document_tags.find(doc_id); tag_it != m_document_tags.end()) {
-                result.tags = tag_it->second;
+
+        const auto term_score = [](const Cursor& cursor, std::uint32_t tf, double length_norm) {
+            const double freq = static_cast<double>(tf);
+            return cursor.weight * freq * (kBm25K1 + 1.0) / (freq + length_norm);
+        };
+
+        while (essential < cursors.size()) {
+            std::uint32_t doc = std::numeric_limits<std::uint32_t>::max();
+            for (std::size_t i = essential; i < cursors.size(); ++i) {
+                const Cursor& cursor = cursors[i];
+                if (cursor.pos != cursor.end) {
+                    doc = std::min(doc, cursor.pos->doc);
+                }
+            }
+            if (doc == std::numeric_limits<std::uint32_t>::max()) {
+                break;
+            }
+
+            const Document& document = *segment.documents[doc];
+            const double length = static_cast<double>(document.tokens.size());
+            const double length_norm = kBm25K1 * (1.0 - kBm25B + kBm25B * length / avg_length);
+            double score = 0.0;
+            for (std::size_t i = essential; i < cursors.size(); ++i) {
+                Cursor& cursor = cursors[i];
+                if (cursor.pos != cursor.end && cursor.pos->doc == doc) {
+                    score += term_score(cursor, cursor.pos->tf, length_norm);
+                    ++cursor.pos;
+                }
+            }
+            const bool full = heap.size() == top_k;
+            for (std::size_t i = essential; i-- > 0;) {
+                if (full && score + bound_prefix[i + 1] <= threshold) {
+                    break;
+                }
+                Cursor& cursor = cursors[i];
+                cursor.pos = std::lower_bound(cursor.pos, cursor.end, doc,
+                                              [](const Posting& posting, std::uint32_t target) {
+                                                  return posting.doc < target;
+                                              });
+                if (cursor.pos != cursor.end && cursor.pos->doc == doc) {
+                    score += term_score(cursor, cursor.pos->tf, length_norm);
+                }
+            }
+
+            if (score <= 0.0 || (view.deleted && (*view.deleted)[doc])) {
+                continue;
+            }
+            const Scored candidate{score, segment_base + doc, &document};
+            if (!full) {
+                heap.push_back(candidate);
+                std::push_heap(heap.begin(), heap.end(), better);
+            } else if (better(candidate, heap.front())) {
+                std::pop_heap(heap.begin(), heap.end(), better);
+                heap.back() = candidate;
+                std::push_heap(heap.begin(), heap.end(), better);
+            } else {
+                continue;
+            }
+            if (heap.size() == top_k) {
+                threshold = heap.front().score;
+                while (essential < cursors.size() && bound_prefix[essential + 1] <= threshold) {
+                    ++essential;
+                }
             }
-            results.push_back(std::move(result));
         }
     }
 
-    std::sort(results.begin(), results.end(), [](const RetrievalResult& a, const RetrievalResult& b) {
-        return a.score > b.score;
-    });
-    if (results.size() > top_k) {
-        results.resize(top_k);
+    std::sort_heap(heap.begin(), heap.end(), better);
+    results.reserve(heap.size());
+    for (const auto& scored : heap) {
+        RetrievalResult result;
+        result.document_id = scored.document->id;
+        result.score = scored.score;
+        result.tags = scored.document->tags;
+        results.push_back(std::move(result));
     }
     if (!results.empty()) {
-        ++m_hit_count;
+        m_hit_count.fetch_add(1, std::memory_order_relaxed);
     }
     return results;
 }
 
 double RetrievalIndex::hit_rate() const {
-    std::scoped_lock lock(m_mutex);
-    if (m_query_count == 0) {
+    const std::size_t queries = m_query_count.load(std::memory_order_relaxed);
+    if (queries == 0) {
         return 0.0;
     }
-    return static_cast<double>(m_hit_count) / static_cast<double>(m_query_count);
+    return static_cast<double>(m_hit_count.load(std::memory_order_relaxed)) / static_cast<double>(queries);
 }
 
 void RetrievalIndex::save_metadata(const std::filesystem::path& path) const {
     namespace fs = std::filesystem;
-    std::scoped_lock lock(m_mutex);
+    const auto current = snapshot();
 
     JsonObject root;
     JsonObject stats;
-    stats["query_count"] = Json(static_cast<double>(m_query_count));
-    stats["hit_count"] = Json(static_cast<double>(m_hit_count));
+    stats["query_count"] = Json(static_cast<double>(m_query_count.load(std::memory_order_relaxed)));
+    stats["hit_count"] = Json(static_cast<double>(m_hit_count.load(std::memory_order_relaxed)));
     root["stats"] = Json(stats);
 
     JsonArray documents;
-    documents.reserve(m_term_counts.size());
-    for (const auto& [doc_id, counts] : m_term_counts) {
-        JsonObject entry;
-        entry["id"] = Json(doc_id);
-        if (auto tag_it = m_document_tags.find(doc_id); tag_it != m_document_tags.end() && !tag_it->second.empty()) {
-            JsonArray tags_json;
-            tags_json.reserve(tag_it->second.size());
-            for (const auto& tag : tag_it->second) {
-                tags_json.emplace_back(Json(tag));
+    documents.reserve(current->live_documents);
+    for (const auto& view : current->segments) {
+        for (std::size_t d = 0; d < view.segment->documents.size(); ++d) {
+            if (view.deleted && (*view.deleted)[d]) {
+                continue;
+            }
+            const Document& document = *view.segment->documents[d];
+            JsonObject entry;
+            entry["id"] = Json(document.id);
+            if (!document.tags.empty()) {
+                JsonArray tags_json;
+                tags_json.reserve(document.tags.size());
+                for (const auto& tag : document.tags) {
+                    tags_json.emplace_back(Json(tag));
+                }
+                entry["tags"] = Json(tags_json);
             }
-            entry["tags"] = Json(tags_json);
-        }
-        if (auto token_it = m_cached_tokens.find(doc_id); token_it != m_cached_tokens.end()) {
             JsonArray tokens_json;
-            tokens_json.reserve(token_it->second.size());
-            for (int token : token_it->second) {
+            tokens_json.reserve(document.tokens.size());
+            for (int token : document.tokens) {
                 tokens_json.emplace_back(Json(static_cast<double>(token)));
             }
             entry["tokens"] = Json(tokens_json);
+            documents.emplace_back(Json(entry));
         }
-        documents.emplace_back(Json(entry));
     }
     root["documents"] = Json(documents);
 
@@ -262,26 +639,24 @@ void RetrievalIndex::load_metadata(const std::filesystem::path& path) {
             value.value());
     };
 
-    std::scoped_lock lock(m_mutex);
+    std::scoped_lock lock(m_write_mutex);
     const auto& obj = parsed.as_object();
     if (auto stats_it = obj.find("stats"); stats_it != obj.end() && stats_it->second.is_object()) {
         const auto& stats = stats_it->second.as_object();
         if (auto qc = stats.find("query_count"); qc != stats.end()) {
             if (auto numeric = extract_double(qc->second)) {
-                m_query_count = static_cast<std::size_t>(*numeric);
+                m_query_count.store(static_cast<std::size_t>(*numeric), std::memory_order_relaxed);
             }
         }
         if (auto hc = stats.find("hit_count"); hc != stats.end()) {
             if (auto numeric = extract_double(hc->second)) {
-                m_hit_count = static_cast<std::size_t>(*numeric);
+                m_hit_count.store(static_cast<std::size_t>(*numeric), std::memory_order_relaxed);
             }
         }
     }
 
-    m_term_counts.clear();
-    m_document_frequency.clear();
-    m_cached_tokens.clear();
-    m_document_tags.clear();
+    std::vector<Document> loaded;
+    std::unordered_map<std::string, std::size_t> positions;
 
     if (auto docs_it = obj.find("documents"); docs_it != obj.end() && docs_it->second.is_array()) {
         const auto& docs = docs_it->second.as_array();
@@ -306,17 +681,6 @@ void RetrievalIndex::load_metadata(const std::filesystem::path& path) {
                 }
             }
 
-            std::unordered_map<int, int> counts;
-            for (int token : tokens) {
-                ++counts[token];
-            }
-            m_cached_tokens[id] = tokens;
-            m_term_counts[id] = std::move(counts);
-            for (const auto& [token, _] : m_term_counts[id]) {
-                (void)_; 
-                ++m_document_frequency[token];
-            }
-
             std::vector<std::string> tag_list;
             if (auto tags_it = doc_obj.find("tags"); tags_it != doc_obj.end() && tags_it->second.is_array()) {
                 const auto& tags_json = tags_it->second.as_array();
@@ -327,19 +691,42 @@ void RetrievalIndex::load_metadata(const std::filesystem::path& path) {
                     }
                 }
             }
-            m_document_tags[id] = normalise_tags(tag_list);
+            Document document{id, std::move(tokens), normalise_tags(tag_list)};
+            if (auto existing = positions.find(id); existing != positions.end()) {
+                loaded[existing->second] = std::move(document);
+            } else {
+                positions.emplace(id, loaded.size());
+                loaded.push_back(std::move(document));
+            }
         }
     }
+
+    auto next = std::make_shared<Snapshot>();
+    next->total_documents = loaded.size();
+    next->live_documents = loaded.size();
+    for (const auto& document : loaded) {
+        next->live_token_total += document.tokens.size();
+    }
+    if (!loaded.empty()) {
+        next->segments.push_back(SegmentView{build_segment(std::move(loaded)), nullptr, 0});
+    }
+    m_snapshot.store(std::move(next), std::memory_order_release);
 }
 
 std::vector<std::string> RetrievalIndex::tags_for(const std::string& document_id) const {
-    std::scoped_lock lock(m_mutex);
-    auto it = m_document_tags.find(document_id);
-    if (it == m_document_tags.end()) {
-        return {};
-    }
-    return it->second;
+    const auto current = snapshot();
+    const Document* document = find_live(*current, document_id);
+    return document != nullptr ? document->tags : std::vector<std::string>{};
 }
 
-} // namespace almondai
+std::vector<int> RetrievalIndex::tokens_for(const std::string& document_id) const {
+    const auto current = snapshot();
+    const Document* document = find_live(*current, document_id);
+    return document != nullptr ? document->tokens : std::vector<int>{};
+}
 
+std::size_t RetrievalIndex::document_count() const {
+    return snapshot()->live_documents;
+}
+
+} // namespace almondai
@@ -1,62 +1,37 @@
 #include "../include/almondai/retrieval_refresh.hpp"
 
-#include <algorithm>
-#include <unordered_set>
+#include "../include/almondai/near_duplicate.hpp"
 
-namespace almondai {
-
-namespace {
+#include <unordered_map>
 
-std::unordered_set<int> tokens_for(const BpeTokenizer& tokenizer, const std::string& text) {
-    std::unordered_set<int> set;
-    auto ids = tokenizer.encode(text);
-    for (int id : ids) {
-        if (id <= BpeTokenizer::PAD_ID || id == BpeTokenizer::EOS_ID) {
-            continue;
-        }
-        set.insert(id);
-    }
-    return set;
-}
-
-} // namespace
+namespace almondai {
 
-void refresh_retrieval_index(const std::vector<TrainingExample>& dataset, BpeTokenizer& tokenizer) {
+double refresh_retrieval_index(const std::vector<TrainingExample>& dataset, BpeTokenizer& tokenizer) {
     if (dataset.empty()) {
-        return;
+        return 0.0;
+    }
+    // A prompt is a hit when another prompt shares a token with it (best
+    // Jaccard above zero). Per-token prompt counts answer that exactly, so no
+    // MinHash signatures are needed here.
+    std::vector<std::vector<int>> prompts;
+    prompts.reserve(dataset.size());
+    std::unordered_map<int, std::size_t> prompt_counts;
+    for (const auto& sample : dataset) {
+        prompts.push_back(NearDuplicateIndex::token_set(tokenizer, sample.prompt));
+        for (int token : prompts.back()) {
+            ++prompt_counts[token];
+        }
     }
     std::size_t hits = 0;
-    for (std::size_t i = 0; i < dataset.size(); ++i) {
-        const auto prompt_tokens = tokens_for(tokenizer, dataset[i].prompt);
-        double best = 0.0;
-        for (std::size_t j = 0; j < dataset.size(); ++j) {
-            if (i == j) {
-                continue;
-            }
-            const auto other = tokens_for(tokenizer, dataset[j].prompt);
-            if (other.empty()) {
-                continue;
-            }
-            std::size_t intersection = 0;
-            for (int token : prompt_tokens) {
-                if (other.find(token) != other.end()) {
-                    ++intersection;
-                }
+    for (const auto& prompt : prompts) {
+        for (int token : prompt) {
+            if (prompt_counts[token] > 1) {
+                ++hits;
+                break;
             }
-            std::size_t union_size = prompt_tokens.size() + other.size() - intersection;
-            if (union_size == 0) {
-                continue;
-            }
-            double score = static_cast<double>(intersection) / static_cast<double>(union_size);
-            best = std::max(best, score);
-        }
-        if (best > 0.0) {
-            ++hits;
         }
     }
-    double hit_rate = static_cast<double>(hits) / static_cast<double>(dataset.size());
-    (void)hit_rate;
+    return static_cast<double>(hits) / static_cast<double>(dataset.size());
 }
 
 } // namespace almondai
-
@@ -0,0 +1,58 @@
+#include "../include/almondai/rw_mutex.hpp"
+
+namespace almondai {
+
+void WriterPreferringMutex::lock() {
+    std::unique_lock lock(m_mutex);
+    ++m_writers_waiting;
+    m_writer_gate.wait(lock, [this] { return !m_writer && m_readers == 0; });
+    --m_writers_waiting;
+    m_writer = true;
+}
+
+bool WriterPreferringMutex::try_lock() {
+    std::scoped_lock lock(m_mutex);
+    if (m_writer || m_readers > 0) {
+        return false;
+    }
+    m_writer = true;
+    return true;
+}
+
+void WriterPreferringMutex::unlock() {
+    {
+        std::scoped_lock lock(m_mutex);
+        m_writer = false;
+    }
+    // A queued writer goes next; readers re-check and keep waiting for it.
+    m_writer_gate.notify_one();
+    m_reader_gate.notify_all();
+}
+
+void WriterPreferringMutex::lock_shared() {
+    std::unique_lock lock(m_mutex);
+    m_reader_gate.wait(lock, [this] { return !m_writer && m_writers_waiting == 0; });
+    ++m_readers;
+}
+
+bool WriterPreferringMutex::try_lock_shared() {
+    std::scoped_lock lock(m_mutex);
+    if (m_writer || m_writers_waiting > 0) {
+        return false;
+    }
+    ++m_readers;
+    return true;
+}
+
+void WriterPreferringMutex::unlock_shared() {
+    bool wake_writer = false;
+    {
+        std::scoped_lock lock(m_mutex);
+        wake_writer = --m_readers == 0 && m_writers_waiting > 0;
+    }
+    if (wake_writer) {
+        m_writer_gate.notify_one();
+    }
+}
+
+} // namespace almondai
@@ -0,0 +1,183 @@
+#include "../include/almondai/sampler.hpp"
+#include "../include/almondai/kernels.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+
+namespace almondai {
+
+namespace {
+
+// Weights lie in (0, 1]. Buckets are keyed by the exponent and the top
+// mantissa bits, so bucket order follows weight order; weights below
+// 2^-kExponentRange share bucket 0.
+constexpr int kExponentRange = 64;
+constexpr int kMantissaBits = 6;
+constexpr std::size_t kBuckets = (static_cast<std::size_t>(kExponentRange + 1) << kMantissaBits) + 1;
+constexpr std::uint64_t kLowestExponent = 1023 - kExponentRange;
+
+std::size_t bucket_of(double weight) {
+    const std::uint64_t bits = std::bit_cast<std::uint64_t>(weight);
+    const std::uint64_t exponent = bits >> 52;
+    if (exponent < kLowestExponent) {
+        return 0;
+    }
+    const std::uint64_t mantissa = (bits >> (52 - kMantissaBits)) & ((1u << kMantissaBits) - 1);
+    return static_cast<std::size_t>(((exponent - kLowestExponent) << kMantissaBits | mantissa) + 1);
+}
+
+double median_of_three(double a, double b, double c) {
+    return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+} // namespace
+
+int Sampler::sample(std::span<const double> logits,
+                    const SamplerSettings& settings,
+                    std::mt19937& rng,
+                    std::span<const int> history,
+                    int suppressed) {
+    const std::size_t n = logits.size();
+    if (n == 0) {
+        return 0;
+    }
+
+    m_weights.assign(logits.begin(), logits.end());
+    const double penalty = settings.repetition_penalty;
+    if (penalty > 0.0 && penalty != 1.0) {
+        for (int token : history) {
+            if (token >= 0 && static_cast<std::size_t>(token) < n) {
+                const double logit = logits[static_cast<std::size_t>(token)];
+                m_weights[static_cast<std::size_t>(token)] = logit > 0.0 ? logit / penalty : logit * penalty;
+            }
+        }
+    }
+    if (suppressed >= 0 && static_cast<std::size_t>(suppressed) < n) {
+        m_weights[static_cast<std::size_t>(suppressed)] = -std::numeric_limits<double>::infinity();
+    }
+
+    // Weights are relative to the most likely token, which gets exactly 1.
+    const double max_logit = *std::max_element(m_weights.begin(), m_weights.end());
+    const double inverse_temperature = 1.0 / std::max(settings.temperature, 1e-3);
+    const double total = kernels::exp_sum(m_weights.data(), max_logit, inverse_temperature, m_weights.data(), n);
+    if (!(total > 0.0) || !std::isfinite(total)) {
+        return static_cast<int>(std::distance(logits.begin(), std::max_element(logits.begin(), logits.end())));
+    }
+
+    const double floor = std::max(std::clamp(settings.min_p, 0.0, 1.0), std::numeric_limits<double>::denorm_min());
+    const double mass = std::clamp(settings.top_p, 1e-3, 1.0) * total;
+    const std::size_t top_k = settings.top_k == 0 ? n : std::min(settings.top_k, n);
+
+    Cut cut{floor, n, total};
+    if (settings.top_p < 1.0 || top_k < n || settings.min_p > 0.0) {
+        cut = find_cut(top_k, mass, floor);
+    }
+
+    std::uniform_real_distribution<double> draw(0.0, cut.kept);
+    double remaining = draw(rng);
+    std::size_t last = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double weight = m_weights[i];
+        bool keep = weight > cut.weight;
+        if (!keep && weight == cut.weight && cut.ties > 0) {
+            --cut.ties;
+            keep = true;
+        }
+        if (keep) {
+            remaining -= weight;
+            if (remaining < 0.0) {
+                return static_cast<int>(i);
+            }
+            last = i;
+        }
+    }
+    return static_cast<int>(last);
+}
+
+Sampler::Cut Sampler::find_cut(std::size_t top_k, double mass, double floor) {
+    m_bucket_mass.assign(kBuckets, 0.0);
+    m_bucket_count.assign(kBuckets, 0);
+    for (const double weight : m_weights) {
+        if (weight >= floor) {
+            const std::size_t bucket = bucket_of(weight);
+            m_bucket_mass[bucket] += weight;
+            ++m_bucket_count[bucket];
+        }
+    }
+
+    // Whole buckets from the top while neither cut falls inside one.
+    double above = 0.0;
+    std::size_t count = 0;
+    std::size_t bucket = kBuckets;
+    bool crossed = false;
+    while (bucket > 0 && !crossed) {
+        --bucket;
+        crossed = m_bucket_count[bucket] > 0
+                  && (above + m_bucket_mass[bucket] >= mass || count + m_bucket_count[bucket] >= top_k);
+        if (!crossed) {
+            above += m_bucket_mass[bucket];
+            count += m_bucket_count[bucket];
+        }
+    }
+    if (!crossed) {
+        return Cut{floor, m_weights.size(), above};
+    }
+
+    // The cut falls inside `bucket`. Near-flat distributions put most of the
+    // vocabulary there, so select within it instead of sorting it.
+    m_boundary.clear();
+    for (const double weight : m_weights) {
+        if (weight >= floor && bucket_of(weight) == bucket) {
+            m_boundary.push_back(weight);
+        }
+    }
+    auto crosses = [&](double extra_mass, std::size_t extra_count) {
+        return above + extra_mass >= mass || count + extra_count >= top_k;
+    };
+    // Weights in [first, last) are lighter than every weight counted in
+    // `above` and heavier than every weight after `last`.
+    auto first = m_boundary.begin();
+    auto last = m_boundary.end();
+    Cut cut;
+    while (last - first > 16) {
+        const double pivot = median_of_three(*first, *(first + (last - first) / 2), *(last - 1));
+        const auto heavier = std::partition(first, last, [&](double weight) { return weight > pivot; });
+        const auto equal = std::partition(heavier, last, [&](double weight) { return weight == pivot; });
+        const double heavier_mass = std::accumulate(first, heavier, 0.0);
+        const auto heavier_count = static_cast<std::size_t>(heavier - first);
+        if (heavier != first && crosses(heavier_mass, heavier_count)) {
+            last = heavier;
+            continue;
+        }
+        above += heavier_mass;
+        count += heavier_count;
+        cut = Cut{pivot, 0, 0.0};
+        for (auto it = heavier; it != equal; ++it) {
+            ++cut.ties;
+            above += pivot;
+            if (crosses(0.0, cut.ties)) {
+                cut.kept = above;
+                return cut;
+            }
+        }
+        count += cut.ties;
+        first = equal;
+    }
+    std::sort(first, last, std::greater<>());
+    for (auto it = first; it != last; ++it) {
+        cut.ties = *it == cut.weight ? cut.ties + 1 : 1;
+        cut.weight = *it;
+        above += *it;
+        if (above >= mass || ++count >= top_k) {
+            break;
+        }
+    }
+    cut.kept = above;
+    return cut;
+}
+
+} // namespace almondai
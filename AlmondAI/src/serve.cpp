@@ -1,17 +1,27 @@
 #include "../include/almondai/serve.hpp"
 #include "../include/almondai/fallback.hpp"
+#include "../include/almondai/generation_engine.hpp"
+#include "../include/almondai/jsonl_index.hpp"
+#include "../include/almondai/prefetcher.hpp"
 
 #include <algorithm>
 #include <atomic>
 #include <cctype>
+#include <condition_variable>
 #include <cstdint>
+#include <exception>
 #include <stdexcept>
 #include <functional>
+#include <future>
 #include <iomanip>
 #include <cmath>
 #include <numeric>
+#include <optional>
 #include <random>
+#include <mutex>
+#include <shared_mutex>
 #include <sstream>
+#include <streambuf>
 #include <limits>
 #include <variant>
 #include <type_traits>
@@ -30,8 +40,7 @@ namespace {
 struct DecodeSettings {
     int min_tokens = 8;
     int max_tokens = 128;
-    double temperature = 0.9;
-    double top_p = 0.95;
+    SamplerSettings sampling{.temperature = 0.9, .top_p = 0.95};
 };
 
 std::string compute_prompt_hash(const std::string& prompt) {
@@ -74,88 +83,6 @@ std::mt19937 make_rng() {
     return std::mt19937(seq);
 }
 
-int sample_token(const std::vector<double>& logits,
-                 const DecodeSettings& settings,
-                 std::size_t generated_tokens,
-                 int eos_token,
-                 std::mt19937& rng) {
-    if (logits.empty()) {
-        return 0;
-    }
-
-    const double temperature = std::max(settings.temperature, 1e-3);
-    std::vector<double> adjusted(logits.size());
-    std::transform(logits.begin(), logits.end(), adjusted.begin(), [temperature](double value) {
-        return value / temperature;
-    });
-    const double max_logit = *std::max_element(adjusted.begin(), adjusted.end());
-
-    std::vector<double> raw(logits.size());
-    double sum = 0.0;
-    for (std::size_t i = 0; i < adjusted.size(); ++i) {
-        const double value = std::exp(adjusted[i] - max_logit);
-        raw[i] = value;
-        sum += value;
-    }
-
-    if (generated_tokens < static_cast<std::size_t>(settings.min_tokens) && eos_token >= 0) {
-        const std::size_t eos_index = static_cast<std::size_t>(eos_token);
-        if (eos_index < raw.size()) {
-            sum -= raw[eos_index];
-            raw[eos_index] = 0.0;
-        }
-    }
-
-    if (sum <= 0.0) {
-        const auto it = std::max_element(logits.begin(), logits.end());
-        return static_cast<int>(std::distance(logits.begin(), it));
-    }
-
-    std::vector<double> probabilities(raw.size());
-    for (std::size_t i = 0; i < raw.size(); ++i) {
-        probabilities[i] = raw[i] / sum;
-    }
-
-    const double top_p = std::clamp(settings.top_p, 1e-3, 1.0);
-    std::vector<std::size_t> order(probabilities.size());
-    std::iota(order.begin(), order.end(), std::size_t{0});
-    std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
-        return probabilities[lhs] > probabilities[rhs];
-    });
-
-    double cumulative = 0.0;
-    std::vector<std::size_t> allowed;
-    allowed.reserve(order.size());
-    for (std::size_t index : order) {
-        cumulative += probabilities[index];
-        allowed.push_back(index);
-        if (cumulative >= top_p) {
-            break;
-        }
-    }
-    if (allowed.empty() && !order.empty()) {
-        allowed.push_back(order.front());
-    }
-
-    std::vector<double> weights;
-    weights.reserve(allowed.size());
-    double weight_sum = 0.0;
-    for (std::size_t index : allowed) {
-        const double weight = probabilities[index];
-        weights.push_back(weight);
-        weight_sum += weight;
-    }
-
-    if (weight_sum <= 0.0) {
-        const auto it = std::max_element(logits.begin(), logits.end());
-        return static_cast<int>(std::distance(logits.begin(), it));
-    }
-
-    std::discrete_distribution<std::size_t> distribution(weights.begin(), weights.end());
-    const std::size_t draw = distribution(rng);
-    return static_cast<int>(allowed[draw]);
-}
-
 std::vector<std::string> parse_tag_filter(const Json& value) {
     std::unordered_set<std::string> seen;
     std::vector<std::string> tags;
@@ -201,6 +128,115 @@ std::string ensure_prompt_hash(const JsonObject& params, const std::string& prom
     return compute_prompt_hash(prompt);
 }
 
+// Optional max_tokens, min_tokens, temperature, top_k, top_p, min_p and
+// repetition_penalty overrides.
+void apply_decode_params(const JsonObject& params, DecodeSettings& settings) {
+    auto number = [&](const char* key) -> const double* {
+        auto it = params.find(key);
+        return it == params.end() ? nullptr : std::get_if<double>(&it->second.value());
+    };
+    if (const double* value = number("max_tokens")) {
+        settings.max_tokens = static_cast<int>(std::clamp(*value, 0.0, 4096.0));
+    }
+    if (const double* value = number("min_tokens")) {
+        settings.min_tokens = static_cast<int>(std::clamp(*value, 0.0, 4096.0));
+    }
+    SamplerSettings& sampling = settings.sampling;
+    if (const double* value = number("temperature")) {
+        sampling.temperature = *value;
+    }
+    if (const double* value = number("top_k"); value && *value >= 0.0) {
+        sampling.top_k = static_cast<std::size_t>(*value);
+    }
+    if (const double* value = number("top_p")) {
+        sampling.top_p = *value;
+    }
+    if (const double* value = number("min_p")) {
+        sampling.min_p = *value;
+    }
+    if (const double* value = number("repetition_penalty")) {
+        sampling.repetition_penalty = *value;
+    }
+}
+
+bool wants_stream(const JsonObject& params) {
+    auto it = params.find("stream");
+    if (it == params.end()) {
+        return false;
+    }
+    if (const auto* flag = std::get_if<bool>(&it->second.value())) {
+        return *flag;
+    }
+    return it->second.is_string() && it->second.as_string() == "true";
+}
+
+// Streams a backend reply to a client. Backends may report deltas on another
+// thread (the HTTP client's event loop for the remote ones), so the callback
+// only queues them and the calling worker thread does every write to `emit`,
+// while the completion itself runs on a helper thread. Whitespace that begins
+// the reply, and whitespace not yet followed by more text, is held back: the
+// deltas sent concatenate to the trim_whitespace()d reply the final response
+// carries. Returns the untrimmed reply or rethrows the backend's exception.
+std::string stream_completion(chat::Backend& backend,
+                              const std::vector<chat::Message>& conversation,
+                              const chat::DeltaCallback& emit) {
+    std::mutex mutex;
+    std::condition_variable arrived;
+    std::string queued;
+    bool finished = false;
+    const chat::DeltaCallback enqueue = [&](const std::string& delta) {
+        {
+            std::scoped_lock lock(mutex);
+            queued += delta;
+        }
+        arrived.notify_one();
+    };
+    auto completion = std::async(std::launch::async, [&] {
+        struct Finish {
+            std::mutex& mutex;
+            std::condition_variable& arrived;
+            bool& finished;
+            ~Finish() {
+                {
+                    std::scoped_lock lock(mutex);
+                    finished = true;
+                }
+                arrived.notify_one();
+            }
+        } finish{mutex, arrived, finished};
+        return backend.complete_stream(conversation, enqueue);
+    });
+
+    bool started = false;
+    std::string held;
+    std::unique_lock lock(mutex);
+    while (true) {
+        arrived.wait(lock, [&] { return finished || !queued.empty(); });
+        std::string pending = std::move(queued);
+        queued.clear();
+        const bool done = finished;
+        lock.unlock();
+        if (!started) {
+            const auto first = std::find_if_not(pending.begin(), pending.end(),
+                                                [](unsigned char ch) { return std::isspace(ch) != 0; });
+            pending.erase(pending.begin(), first);
+            started = !pending.empty();
+        }
+        held += pending;
+        const auto last = std::find_if_not(held.rbegin(), held.rend(),
+                                           [](unsigned char ch) { return std::isspace(ch) != 0; }).base();
+        if (last != held.begin()) {
+            emit(std::string(held.begin(), last));
+            held.erase(held.begin(), last);
+        }
+        if (done) {
+            break;
+        }
+        lock.lock();
+    }
+    return completion.get();
+}
+
 JsonArray build_retrieval_hits(const std::vector<RetrievalResult>& results) {
     JsonArray hits;
     for (const auto& item : results) {
@@ -220,11 +256,13 @@ JsonArray build_retrieval_hits(const std::vector<RetrievalResult>& results) {
     return hits;
 }
 
-std::string build_retrieval_context(const std::vector<RetrievalResult>& results, WordTokenizer& tokenizer) {
+std::string build_retrieval_context(const std::vector<RetrievalResult>& results,
+                                    const RetrievalIndex& index,
+                                    WordTokenizer& tokenizer) {
     std::ostringstream oss;
     bool first = true;
     for (const auto& item : results) {
-        const std::string decoded = tokenizer.decode(item.tokens);
+        const std::string decoded = tokenizer.decode(index.tokens_for(item.document_id));
         if (decoded.empty()) {
             continue;
         }
@@ -334,7 +372,7 @@ GenerationContext build_generation_context(ContinuousLearner& learner,
         ctx.retrieval = learner.retrieval().query(prompt);
         ctx.hits = build_retrieval_hits(ctx.retrieval);
         ctx.retrieval_summary = summarise_hits(ctx.hits);
-        const std::string context = build_retrieval_context(ctx.retrieval, learner.tokenizer());
+        const std::string context = build_retrieval_context(ctx.retrieval, learner.retrieval(), learner.tokenizer());
         if (!context.empty()) {
             if (!ctx.augmented_prompt.empty()) {
                 ctx.augmented_prompt += "\n\n";
@@ -353,8 +391,10 @@ struct LocalGenerationOutcome {
 };
 
 LocalGenerationOutcome generate_with_student(ContinuousLearner& learner,
+                                             GenerationEngine& engine,
                                              const GenerationContext& ctx,
-                                             const DecodeSettings& settings) {
+                                             const DecodeSettings& settings,
+                                             const chat::DeltaCallback& on_delta = {}) {
     LocalGenerationOutcome outcome;
     double best_score = -std::numeric_limits<double>::infinity();
     std::string retrieval_fallback;
@@ -377,10 +417,11 @@ LocalGenerationOutcome generate_with_student(ContinuousLearner& learner,
             }
         }
         if (candidate.empty()) {
-            const std::string decoded = learner.tokenizer().decode(result.tokens);
+            const std::vector<int> tokens = learner.retrieval().tokens_for(result.document_id);
+            const std::string decoded = learner.tokenizer().decode(tokens);
             if (!decoded.empty()) {
                 candidate = decoded;
-                retrieval_tokens = static_cast<int>(result.tokens.size());
+                retrieval_tokens = static_cast<int>(tokens.size());
             }
         }
 
@@ -389,43 +430,23 @@ LocalGenerationOutcome generate_with_student(ContinuousLearner& learner,
             retrieval_fallback = std::move(candidate);
         }
     }
-    std::vector<int> tokens = learner.tokenizer().encode(ctx.augmented_prompt);
-    std::vector<int> generated;
-    generated.reserve(settings.max_tokens);
-    std::mt19937 rng = make_rng();
-    const int eos_token = learner.tokenizer().token_id("<eos>");
-
-    for (int step = 0; step < settings.max_tokens; ++step) {
-        auto forward = learner.student().forward(tokens);
-        std::vector<double> logits = std::move(forward.logits);
-        int next = sample_token(logits, settings, generated.size(), eos_token, rng);
-        if (next == eos_token) {
-            if (generated.size() >= static_cast<std::size_t>(settings.min_tokens)) {
-                break;
+    GenerationRequest request;
+    request.prompt = learner.tokenizer().encode(ctx.augmented_prompt);
+    request.max_tokens = settings.max_tokens;
+    request.min_tokens = settings.min_tokens;
+    request.eos_token = learner.tokenizer().token_id("<eos>");
+    request.sampling = settings.sampling;
+    request.rng = make_rng();
+    std::function<void(int)> on_token;
+    if (on_delta) {
+        on_token = [&](int token) {
+            const std::string piece = learner.tokenizer().decode({token});
+            if (!piece.empty()) {
+                on_delta(piece);
             }
-            double best = std::numeric_limits<double>::lowest();
-            int fallback = -1;
-            for (std::size_t idx = 0; idx < logits.size(); ++idx) {
-                if (static_cast<int>(idx) == eos_token) {
-                    continue;
-                }
-                if (logits[idx] > best) {
-                    best = logits[idx];
-                    fallback = static_cast<int>(idx);
-                }
-            }
-            if (fallback >= 0) {
-                next = fallback;
-            } else {
-                break;
-            }
-        }
-        if (next == eos_token || next < 0) {
-            break;
-        }
-        generated.push_back(next);
-        tokens.push_back(next);
+        };
     }
+    const std::vector<int> generated = engine.generate(std::move(request), on_token);
 
     outcome.tokens_generated = static_cast<int>(generated.size());
     outcome.output = learner.tokenizer().decode(generated);
@@ -463,13 +484,16 @@ struct TeacherFetchOutcome {
     std::string remote_error;
     std::string route;
     std::string source_label;
+    std::string cache_status;
 };
 
-TeacherFetchOutcome fetch_teacher_output(ContinuousLearner& learner,
-                                         MCPBridge& bridge,
-                                         const std::string& prompt,
-                                         const Json& constraints,
-                                         const std::string& remote_label) {
+// The remote half of fetch_teacher_output. It only touches the bridge, so it
+// may run alongside training; an outcome without a route still needs
+// complete_with_student.
+TeacherFetchOutcome request_teacher_output(MCPBridge& bridge,
+                                           const std::string& prompt,
+                                           const Json& constraints,
+                                           const std::string& remote_label) {
     TeacherFetchOutcome outcome;
     if (prompt.empty()) {
         outcome.placeholder = true;
@@ -482,11 +506,6 @@ TeacherFetchOutcome fetch_teacher_output(ContinuousLearner& learner,
         return outcome;
     }
 
-    std::string teacher_prompt = prompt;
-    if (!is_null(constraints)) {
-        teacher_prompt += "\n\nConstraints:\n" + constraints.dump();
-    }
-
     JsonObject params;
     params["prompt"] = Json(prompt);
     if (!is_null(constraints)) {
@@ -510,6 +529,9 @@ TeacherFetchOutcome fetch_teacher_output(ContinuousLearner& learner,
                 if (auto src_it = prov.find("source"); src_it != prov.end() && src_it->second.is_string()) {
                     outcome.source_label = src_it->second.as_string();
                 }
+                if (auto cache_it = prov.find("cache"); cache_it != prov.end() && cache_it->second.is_string()) {
+                    outcome.cache_status = cache_it->second.as_string();
+                }
             }
         }
     }
@@ -529,10 +551,24 @@ TeacherFetchOutcome fetch_teacher_output(ContinuousLearner& learner,
     } else {
         outcome.fallback = fallback_response(prompt);
     }
+    return outcome;
+}
+
+// Answers a prompt the remote teacher could not from the local student. It
+// reads the learner, so callers hold the state lock or run on the writer thread.
+void complete_with_student(ContinuousLearner& learner,
+                           GenerationEngine& engine,
+                           const std::string& prompt,
+                           const Json& constraints,
+                           TeacherFetchOutcome& outcome) {
+    std::string teacher_prompt = prompt;
+    if (!is_null(constraints)) {
+        teacher_prompt += "\n\nConstraints:\n" + constraints.dump();
+    }
 
     DecodeSettings settings;
     GenerationContext ctx = build_generation_context(learner, teacher_prompt, true);
-    LocalGenerationOutcome local = generate_with_student(learner, ctx, settings);
+    LocalGenerationOutcome local = generate_with_student(learner, engine, ctx, settings);
     outcome.output = local.output;
     outcome.used_local = true;
     outcome.route = local.used_fallback ? "fallback" : "local";
@@ -542,6 +578,18 @@ TeacherFetchOutcome fetch_teacher_output(ContinuousLearner& learner,
     if (local.used_fallback) {
         outcome.fallback = local.fallback_payload;
     }
+}
+
+TeacherFetchOutcome fetch_teacher_output(ContinuousLearner& learner,
+                                         GenerationEngine& engine,
+                                         MCPBridge& bridge,
+                                         const std::string& prompt,
+                                         const Json& constraints,
+                                         const std::string& remote_label) {
+    TeacherFetchOutcome outcome = request_teacher_output(bridge, prompt, constraints, remote_label);
+    if (outcome.route.empty()) {
+        complete_with_student(learner, engine, prompt, constraints, outcome);
+    }
     return outcome;
 }
 
@@ -577,40 +625,268 @@ std::string summarise_hits(const JsonArray& hits) {
     return oss.str();
 }
 
+enum class Lane {
+    Reader,
+    Writer
+};
+
+// Methods listed here only read learner state. Anything else, including
+// unknown methods, is serialized on the writer lane.
+Lane lane_for(const std::string& method) {
+    static const std::unordered_set<std::string> kReadOnly{
+        "model.generate", "gpt.generate", "retrieval.query", "data.read", "reader", "compiler.build", "service.stats"};
+    return kReadOnly.count(method) ? Lane::Reader : Lane::Writer;
+}
+
+// Forwards whole lines to a shared stream so concurrent handlers never
+// interleave within a JSON line. A trailing partial line is written on destruction.
+class LineSyncBuffer : public std::streambuf {
+public:
+    LineSyncBuffer(std::ostream& sink, std::mutex& mutex) : m_sink(sink), m_mutex(mutex) {}
+    ~LineSyncBuffer() override { emit(m_line.size()); }
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) {
+            return traits_type::not_eof(ch);
+        }
+        const char c = traits_type::to_char_type(ch);
+        xsputn(&c, 1);
+        return ch;
+    }
+
+    std::streamsize xsputn(const char* data, std::streamsize count) override {
+        m_line.append(data, static_cast<std::size_t>(count));
+        return count;
+    }
+
+    int sync() override {
+        const auto newline = m_line.rfind('\n');
+        if (newline != std::string::npos) {
+            emit(newline + 1);
+        }
+        return 0;
+    }
+
+private:
+    std::ostream& m_sink;
+    std::mutex& m_mutex;
+    std::string m_line;
+
+    void emit(std::size_t length) {
+        if (length == 0) {
+            return;
+        }
+        std::scoped_lock lock(m_mutex);
+        m_sink.write(m_line.data(), static_cast<std::streamsize>(length));
+        m_sink.flush();
+        m_line.erase(0, length);
+    }
+};
+
 } // namespace
 
+void LatencyHistogram::record(double ms) {
+    const auto bucket = std::lower_bound(kBoundsMs.begin(), kBoundsMs.end(), ms) - kBoundsMs.begin();
+    ++buckets[static_cast<std::size_t>(bucket)];
+    ++count;
+    total_ms += ms;
+    max_ms = std::max(max_ms, ms);
+}
+
+double LatencyHistogram::quantile_ms(double q) const {
+    if (count == 0) {
+        return 0.0;
+    }
+    const double target = std::clamp(q, 0.0, 1.0) * static_cast<double>(count);
+    std::size_t seen = 0;
+    for (std::size_t i = 0; i < kBoundsMs.size(); ++i) {
+        seen += buckets[i];
+        if (static_cast<double>(seen) >= target && seen > 0) {
+            return std::min(kBoundsMs[i], max_ms);
+        }
+    }
+    return max_ms;
+}
+
 Service::Service(ContinuousLearner& learner, MCPBridge bridge)
-    : m_learner(&learner), m_bridge(std::move(bridge)) {
+    : Service(learner, std::move(bridge), Options{}) {}
+
+Service::Service(ContinuousLearner& learner, MCPBridge bridge, Options options)
+    : m_learner(&learner), m_bridge(std::move(bridge)), m_options(options),
+      m_teacher_cache(m_options.teacher_cache),
+      m_generation(learner.student(), m_options.generation) {
     m_bridge.set_chat_backend(nullptr);
+    m_bridge.set_teacher_cache(&m_teacher_cache, m_chat_route);
+    m_options.reader_threads = std::max<std::size_t>(1, m_options.reader_threads);
+    m_options.max_in_flight = std::max<std::size_t>(1, m_options.max_in_flight);
+}
+
+Service::~Service() {
+    {
+        std::scoped_lock lock(m_queue_mutex);
+        m_stopping = true;
+    }
+    m_reader_ready.notify_all();
+    m_writer_ready.notify_all();
+    for (auto& reader : m_readers) {
+        reader.join();
+    }
+    if (m_writer.joinable()) {
+        m_writer.join();
+    }
 }
 
 void Service::set_chat_backend(chat::Backend* backend, std::string route_label) {
     m_chat_backend = backend;
     m_chat_route = std::move(route_label);
     m_bridge.set_chat_backend(backend);
+    m_bridge.set_teacher_cache(&m_teacher_cache, m_chat_route);
+}
+
+void Service::start_workers() {
+    if (m_writer.joinable()) {
+        return;
+    }
+    m_writer = std::thread([this] { worker_loop(m_write_queue, m_writer_ready); });
+    m_readers.reserve(m_options.reader_threads);
+    for (std::size_t i = 0; i < m_options.reader_threads; ++i) {
+        m_readers.emplace_back([this] { worker_loop(m_read_queue, m_reader_ready); });
+    }
 }
 
 void Service::run(std::istream& in, std::ostream& out) {
-    while (auto request = m_bridge.read_request(in)) {
-        try {
-            if (request->method == "trainer.fit") {
-                handle_trainer_fit(*request, out);
-            } else if (request->method == "train.self_loop") {
-                handle_train_self_loop(*request, out);
-            } else {
-                JsonObject payload = handle_request(*request);
-                m_bridge.send_response(out, request->id, Json(payload));
-                out.flush();
+    start_workers();
+    auto wait_for_idle = [this] {
+        std::unique_lock lock(m_queue_mutex);
+        m_slot_freed.wait(lock, [this] { return m_in_flight == 0; });
+    };
+    try {
+        while (auto request = m_bridge.read_request(in)) {
+            const Lane lane = lane_for(request->method);
+            {
+                std::unique_lock lock(m_queue_mutex);
+                m_slot_freed.wait(lock, [this] { return m_in_flight < m_options.max_in_flight; });
+                ++m_in_flight;
+                auto& queue = lane == Lane::Writer ? m_write_queue : m_read_queue;
+                queue.push_back(Job{std::move(*request), &out});
             }
-        } catch (const std::exception& ex) {
-            m_bridge.send_error(out, request->id, ex.what());
-            out.flush();
+            (lane == Lane::Writer ? m_writer_ready : m_reader_ready).notify_one();
         }
+    } catch (...) {
+        // Queued jobs still reference `out`.
+        wait_for_idle();
+        throw;
     }
+    wait_for_idle();
     out.flush();
 }
 
-JsonObject Service::handle_request(const MCPBridge::Request& request) {
+std::map<std::string, LatencyHistogram> Service::latency_stats() const {
+    std::scoped_lock lock(m_queue_mutex);
+    return m_latency;
+}
+
+void Service::worker_loop(std::deque<Job>& queue, std::condition_variable& ready) {
+    std::unique_lock lock(m_queue_mutex);
+    while (true) {
+        ready.wait(lock, [&] { return m_stopping || !queue.empty(); });
+        if (queue.empty()) {
+            return;
+        }
+        Job job = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        execute(job);
+        lock.lock();
+    }
+}
+
+void Service::execute(Job& job) {
+    const auto started = std::chrono::steady_clock::now();
+    {
+        LineSyncBuffer buffer(*job.out, m_output_mutex);
+        std::ostream out(&buffer);
+        try {
+            // Handlers take m_state_mutex themselves, around local work only.
+            dispatch(job.request, out);
+        } catch (const std::exception& ex) {
+            m_bridge.send_error(out, job.request.id, ex.what());
+        }
+        out.flush();
+    }
+    const double elapsed_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    {
+        std::scoped_lock lock(m_queue_mutex);
+        m_latency[job.request.method].record(elapsed_ms);
+        --m_in_flight;
+    }
+    m_slot_freed.notify_all();
+}
+
+void Service::dispatch(const MCPBridge::Request& request, std::ostream& out) {
+    if (request.method == "trainer.fit") {
+        handle_trainer_fit(request, out);
+    } else if (request.method == "train.self_loop") {
+        handle_train_self_loop(request, out);
+    } else {
+        JsonObject payload = request.method == "service.stats" ? handle_service_stats() : handle_request(request, out);
+        m_bridge.send_response(out, request.id, Json(payload));
+        out.flush();
+    }
+}
+
+JsonObject Service::handle_service_stats() const {
+    JsonObject methods;
+    std::size_t in_flight = 0;
+    {
+        std::scoped_lock lock(m_queue_mutex);
+        in_flight = m_in_flight;
+        for (const auto& [method, histogram] : m_latency) {
+            JsonArray buckets;
+            for (std::size_t i = 0; i < histogram.buckets.size(); ++i) {
+                JsonObject bucket;
+                bucket["le_ms"] = i < LatencyHistogram::kBoundsMs.size() ? Json(LatencyHistogram::kBoundsMs[i]) : Json("inf");
+                bucket["count"] = Json(static_cast<double>(histogram.buckets[i]));
+                buckets.emplace_back(Json(bucket));
+            }
+            JsonObject entry;
+            entry["count"] = Json(static_cast<double>(histogram.count));
+            entry["mean_ms"] = Json(histogram.count ? histogram.total_ms / static_cast<double>(histogram.count) : 0.0);
+            entry["p50_ms"] = Json(histogram.quantile_ms(0.5));
+            entry["p99_ms"] = Json(histogram.quantile_ms(0.99));
+            entry["max_ms"] = Json(histogram.max_ms);
+            entry["buckets"] = Json(buckets);
+            methods[method] = Json(entry);
+        }
+    }
+    JsonObject payload;
+    payload["output"] = Json("Service statistics.");
+    payload["in_flight"] = Json(static_cast<double>(in_flight));
+    payload["max_in_flight"] = Json(static_cast<double>(m_options.max_in_flight));
+    payload["reader_threads"] = Json(static_cast<double>(m_options.reader_threads));
+    const TeacherCache::Stats cache = m_teacher_cache.stats();
+    JsonObject cache_json;
+    cache_json["hits"] = Json(static_cast<double>(cache.hits));
+    cache_json["misses"] = Json(static_cast<double>(cache.misses));
+    cache_json["memory_entries"] = Json(static_cast<double>(cache.memory_entries));
+    cache_json["stored_entries"] = Json(static_cast<double>(cache.stored_entries));
+    cache_json["store_bytes"] = Json(static_cast<double>(cache.store_bytes));
+    payload["teacher_cache"] = Json(cache_json);
+    const GenerationEngine::Stats generation = m_generation.stats();
+    JsonObject generation_json;
+    generation_json["requests"] = Json(static_cast<double>(generation.requests));
+    generation_json["steps"] = Json(static_cast<double>(generation.steps));
+    generation_json["tokens"] = Json(static_cast<double>(generation.tokens));
+    generation_json["tokens_per_step"] = Json(generation.steps ? static_cast<double>(generation.tokens) / static_cast<double>(generation.steps) : 0.0);
+    generation_json["peak_batch"] = Json(static_cast<double>(generation.peak_batch));
+    payload["generation"] = Json(generation_json);
+    payload["methods"] = Json(methods);
+    return payload;
+}
+
+JsonObject Service::handle_request(const MCPBridge::Request& request, std::ostream& out) {
     if (!m_learner) {
         throw std::runtime_error("learner unavailable");
     }
@@ -619,8 +895,28 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
         const auto& params = request.params.as_object();
         const std::string prompt = extract_string(params, "prompt");
 
+        const bool stream = wants_stream(params);
+        std::size_t deltas_sent = 0;
+        chat::DeltaCallback emit_delta;
+        if (stream) {
+            // Runs on this worker thread only: remote replies go through
+            // stream_completion, local generation reports tokens here. The
+            // deltas concatenate to the final output unless a fallback
+            // replaced an empty local reply.
+            emit_delta = [&](const std::string& delta) {
+                m_bridge.send_delta(out, request.id, delta);
+                out.flush();
+                ++deltas_sent;
+            };
+        }
+
         DecodeSettings settings;
-        GenerationContext ctx = build_generation_context(*m_learner, prompt, true);
+        apply_decode_params(params, settings);
+        GenerationContext ctx;
+        {
+            std::shared_lock lock(m_state_mutex);
+            ctx = build_generation_context(*m_learner, prompt, true);
+        }
 
         std::string output;
         std::string route = "local";
@@ -635,7 +931,8 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
             try {
                 std::vector<almondai::chat::Message> conversation;
                 conversation.push_back({"user", ctx.augmented_prompt});
-                std::string reply = trim_whitespace(m_chat_backend->complete(conversation));
+                std::string reply = trim_whitespace(stream ? stream_completion(*m_chat_backend, conversation, emit_delta)
+                                                           : m_chat_backend->complete(conversation));
                 if (!reply.empty()) {
                     output = std::move(reply);
                     remote_used = true;
@@ -648,8 +945,15 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
             }
         }
 
+        // Everything from here on is local; the backend call above ran unlocked.
+        std::shared_lock lock(m_state_mutex);
         if (!remote_used) {
-            LocalGenerationOutcome local = generate_with_student(*m_learner, ctx, settings);
+            if (deltas_sent > 0) {
+                // The remote stream failed part way; tell the client to discard it.
+                m_bridge.send_delta(out, request.id, std::string(), true);
+                out.flush();
+            }
+            LocalGenerationOutcome local = generate_with_student(*m_learner, m_generation, ctx, settings, emit_delta);
             output = local.output;
             used_fallback = local.used_fallback;
             tokens_generated = local.tokens_generated;
@@ -688,6 +992,9 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
         if (include_fallback) {
             payload["fallback"] = Json(fallback_info);
         }
+        if (stream) {
+            payload["streamed"] = Json(true);
+        }
         return payload;
     }
 
@@ -701,8 +1008,28 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
             teacher_prompt += "\n\nConstraints:\n" + constraints.dump();
         }
 
+        const bool stream = wants_stream(params);
+        std::size_t deltas_sent = 0;
+        chat::DeltaCallback emit_delta;
+        if (stream) {
+            // Runs on this worker thread only: remote replies go through
+            // stream_completion, local generation reports tokens here. The
+            // deltas concatenate to the final output unless a fallback
+            // replaced an empty local reply.
+            emit_delta = [&](const std::string& delta) {
+                m_bridge.send_delta(out, request.id, delta);
+                out.flush();
+                ++deltas_sent;
+            };
+        }
+
         DecodeSettings settings;
-        GenerationContext ctx = build_generation_context(*m_learner, teacher_prompt, true);
+        apply_decode_params(params, settings);
+        GenerationContext ctx;
+        {
+            std::shared_lock lock(m_state_mutex);
+            ctx = build_generation_context(*m_learner, teacher_prompt, true);
+        }
 
         std::string output;
         bool remote_used = false;
@@ -710,14 +1037,32 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
         bool include_fallback = false;
         JsonObject fallback_info;
         std::string remote_error;
+        std::string cache_status;
 
+        // Keyed on what the teacher is sent, so retrieval context is part of the key.
+        const std::string cache_key = TeacherCache::make_key(m_chat_route, ctx.augmented_prompt);
         if (m_chat_backend) {
+            if (auto hit = m_teacher_cache.lookup(cache_key)) {
+                output = hit->output;
+                remote_used = true;
+                cache_status = "hit";
+                if (emit_delta) {
+                    emit_delta(output);
+                }
+            } else {
+                cache_status = "miss";
+            }
+        }
+
+        if (m_chat_backend && !remote_used) {
             try {
                 std::vector<almondai::chat::Message> conversation;
                 conversation.push_back({"system", "You are AlmondAI's teacher model. Provide thorough, safe answers suitable for fine-tuning."});
                 conversation.push_back({"user", ctx.augmented_prompt});
-                std::string reply = trim_whitespace(m_chat_backend->complete(conversation));
+                std::string reply = trim_whitespace(stream ? stream_completion(*m_chat_backend, conversation, emit_delta)
+                                                           : m_chat_backend->complete(conversation));
                 if (!reply.empty()) {
+                    m_teacher_cache.store(cache_key, reply, "chat_backend");
                     output = std::move(reply);
                     remote_used = true;
                 } else {
@@ -728,8 +1073,15 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
             }
         }
 
+        // Everything from here on is local; the backend call above ran unlocked.
+        std::shared_lock lock(m_state_mutex);
         if (!remote_used) {
-            LocalGenerationOutcome local = generate_with_student(*m_learner, ctx, settings);
+            if (deltas_sent > 0) {
+                // The remote stream failed part way; tell the client to discard it.
+                m_bridge.send_delta(out, request.id, std::string(), true);
+                out.flush();
+            }
+            LocalGenerationOutcome local = generate_with_student(*m_learner, m_generation, ctx, settings, emit_delta);
             output = local.output;
             used_fallback = local.used_fallback;
             if (local.used_fallback) {
@@ -754,6 +1106,9 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
         if (remote_used && !m_chat_route.empty()) {
             provenance["backend"] = Json(m_chat_route);
         }
+        if (!cache_status.empty()) {
+            provenance["cache"] = Json(cache_status);
+        }
 
         JsonObject payload;
         payload["output"] = Json(output);
@@ -769,12 +1124,16 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
         if (include_fallback) {
             payload["fallback"] = Json(fallback_info);
         }
+        if (stream) {
+            payload["streamed"] = Json(true);
+        }
         return payload;
     }
 
     if (request.method == "retrieval.query") {
         const auto& params = request.params.as_object();
         const std::string query = params.at("query").as_string();
+        std::shared_lock lock(m_state_mutex);
         auto results = m_learner->retrieval().query(query);
         JsonArray hits = build_retrieval_hits(results);
         JsonObject payload;
@@ -849,58 +1208,75 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
             }
         }
 
-        std::ifstream in(resolved);
-        if (!in) {
-            throw std::runtime_error("Unable to open JSONL file: " + resolved.string());
+        // The learner's dataset pages through the shared line index, so deep
+        // offsets are a lookup rather than a scan. Any other file gets a
+        // private in-memory index for this request only.
+        const fs::path own_path = fs::weakly_canonical(ContinuousLearner::training_data_path(), ec);
+        std::shared_ptr<JsonlIndex> shared_index;
+        std::optional<JsonlIndex> private_index;
+        if (!ec && resolved == own_path) {
+            shared_index = JsonlIndex::shared(resolved);
+        } else {
+            private_index.emplace(resolved, false);
         }
-
-        std::string line;
-        int skipped = 0;
-        while (skipped < offset && std::getline(in, line)) {
-            ++skipped;
+        JsonlIndex& index = shared_index ? *shared_index : *private_index;
+        if (!index.exists()) {
+            throw std::runtime_error("Unable to open JSONL file: " + resolved.string());
         }
+        const std::size_t total_lines = index.line_count();
+        const int skipped = static_cast<int>(std::min(static_cast<std::size_t>(offset), total_lines));
 
         JsonArray records;
         int consumed = skipped;
+        bool at_end = false;
 
-        while ((limit <= 0 || static_cast<int>(records.size()) < limit) && std::getline(in, line)) {
-            ++consumed;
-            if (line.empty()) {
-                continue;
+        while (!at_end && (limit <= 0 || static_cast<int>(records.size()) < limit)) {
+            const std::size_t wanted = limit > 0 ? static_cast<std::size_t>(limit) - records.size() : total_lines;
+            const auto lines = index.read(static_cast<std::size_t>(consumed), std::max<std::size_t>(wanted, 1));
+            if (lines.empty()) {
+                at_end = true;
+                break;
             }
+            for (const auto& indexed : lines) {
+                ++consumed;
+                at_end = !indexed.terminated;
+                const std::string& line = indexed.text;
+                if (line.empty()) {
+                    continue;
+                }
 
-            JsonObject entry;
-            entry["line"] = Json(consumed);
-            entry["raw"] = Json(line);
-            try {
-                Json parsed = Json::parse(line);
-                if (parsed.is_object()) {
-                    const auto& obj = parsed.as_object();
-                    if (auto it = obj.find("prompt"); it != obj.end() && it->second.is_string()) {
-                        entry["prompt"] = Json(it->second.as_string());
-                    }
-                    if (auto it = obj.find("teacher_output"); it != obj.end() && it->second.is_string()) {
-                        entry["teacher_output"] = Json(it->second.as_string());
-                    }
-                    if (auto it = obj.find("constraints"); it != obj.end()) {
-                        entry["constraints"] = it->second;
-                    }
-                    if (auto it = obj.find("tags"); it != obj.end()) {
-                        entry["tags"] = it->second;
-                    }
-                    if (auto it = obj.find("provenance"); it != obj.end()) {
-                        entry["provenance"] = it->second;
+                JsonObject entry;
+                entry["line"] = Json(consumed);
+                entry["raw"] = Json(line);
+                try {
+                    Json parsed = Json::parse(line);
+                    if (parsed.is_object()) {
+                        const auto& obj = parsed.as_object();
+                        if (auto it = obj.find("prompt"); it != obj.end() && it->second.is_string()) {
+                            entry["prompt"] = Json(it->second.as_string());
+                        }
+                        if (auto it = obj.find("teacher_output"); it != obj.end() && it->second.is_string()) {
+                            entry["teacher_output"] = Json(it->second.as_string());
+                        }
+                        if (auto it = obj.find("constraints"); it != obj.end()) {
+                            entry["constraints"] = it->second;
+                        }
+                        if (auto it = obj.find("tags"); it != obj.end()) {
+                            entry["tags"] = it->second;
+                        }
+                        if (auto it = obj.find("provenance"); it != obj.end()) {
+                            entry["provenance"] = it->second;
+                        }
                     }
+                } catch (const std::exception& ex) {
+                    entry["error"] = Json(std::string("parse_error: ") + ex.what());
                 }
-            } catch (const std::exception& ex) {
-                entry["error"] = Json(std::string("parse_error: ") + ex.what());
-            }
 
-            records.emplace_back(Json(entry));
+                records.emplace_back(Json(entry));
+            }
         }
 
-        const bool at_end = in.eof();
-        const bool truncated = (limit > 0 && static_cast<int>(records.size()) >= limit && !at_end) || in.bad();
+        const bool truncated = limit > 0 && static_cast<int>(records.size()) >= limit && !at_end;
 
         std::ostringstream summary;
         summary << "Read " << records.size() << " record" << (records.size() == 1 ? "" : "s")
@@ -945,6 +1321,7 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
     if (request.method == "admin.hot_swap") {
         const auto& params = request.params.as_object();
         std::string message;
+        std::unique_lock lock(m_state_mutex);
         if (auto it = params.find("name"); it != params.end() && it->second.is_string()) {
             const std::string name = it->second.as_string();
             m_learner->promote_adapter(name);
@@ -968,7 +1345,7 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
         TeacherFetchOutcome teacher;
         bool fetched = false;
         if (teacher_output.empty()) {
-            teacher = fetch_teacher_output(*m_learner, m_bridge, prompt, constraints, m_chat_route);
+            teacher = fetch_teacher_output(*m_learner, m_generation, m_bridge, prompt, constraints, m_chat_route);
             teacher_output = teacher.output;
             fetched = true;
             if (!teacher.source_label.empty()) {
@@ -993,6 +1370,9 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
             if (fetched) {
                 std::string teacher_route = teacher.placeholder ? (teacher.used_local ? "local" : "fallback") : "remote";
                 payload["teacher_route"] = Json(teacher_route);
+                if (!teacher.cache_status.empty()) {
+                    payload["teacher_cache"] = Json(teacher.cache_status);
+                }
             }
             return payload;
         }
@@ -1011,7 +1391,11 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
             }
         }
 
-        auto curated = m_learner->ingest(prompt, teacher_output, constraints, hash, teacher_source);
+        std::optional<CuratedSample> curated;
+        {
+            std::unique_lock lock(m_state_mutex);
+            curated = m_learner->ingest(prompt, teacher_output, constraints, hash, teacher_source);
+        }
         payload["accepted"] = Json(curated.has_value());
         payload["teacher_output"] = Json(teacher_output);
         payload["output"] = Json(curated ? "Sample ingested." : "Sample rejected by curator.");
@@ -1025,6 +1409,9 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
         if (fetched) {
             std::string teacher_route = teacher.placeholder ? (teacher.used_local ? "local" : "fallback") : "remote";
             payload["teacher_route"] = Json(teacher_route);
+            if (!teacher.cache_status.empty()) {
+                payload["teacher_cache"] = Json(teacher.cache_status);
+            }
         }
         return payload;
     }
@@ -1038,7 +1425,7 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
         TeacherFetchOutcome teacher;
         bool fetched = false;
         if (teacher_output.empty()) {
-            teacher = fetch_teacher_output(*m_learner, m_bridge, prompt, constraints, m_chat_route);
+            teacher = fetch_teacher_output(*m_learner, m_generation, m_bridge, prompt, constraints, m_chat_route);
             teacher_output = teacher.output;
             fetched = true;
             if (!teacher.source_label.empty()) {
@@ -1063,6 +1450,9 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
             if (fetched) {
                 std::string teacher_route = teacher.placeholder ? (teacher.used_local ? "local" : "fallback") : "remote";
                 payload["teacher_route"] = Json(teacher_route);
+                if (!teacher.cache_status.empty()) {
+                    payload["teacher_cache"] = Json(teacher.cache_status);
+                }
             }
             return payload;
         }
@@ -1081,6 +1471,8 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
             }
         }
 
+        // Ingest and train as one mutation step; the teacher fetch above ran unlocked.
+        std::unique_lock lock(m_state_mutex);
         auto curated = m_learner->ingest(prompt, teacher_output, constraints, hash, teacher_source);
         if (!curated) {
             payload["output"] = Json("Sample skipped by curator.");
@@ -1095,6 +1487,9 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
             if (fetched) {
                 std::string teacher_route = teacher.placeholder ? (teacher.used_local ? "local" : "fallback") : "remote";
                 payload["teacher_route"] = Json(teacher_route);
+                if (!teacher.cache_status.empty()) {
+                    payload["teacher_cache"] = Json(teacher.cache_status);
+                }
             }
             return payload;
         }
@@ -1128,10 +1523,15 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
         if (fetched) {
             std::string teacher_route = teacher.placeholder ? (teacher.used_local ? "local" : "fallback") : "remote";
             payload["teacher_route"] = Json(teacher_route);
+            if (!teacher.cache_status.empty()) {
+                payload["teacher_cache"] = Json(teacher.cache_status);
+            }
         }
         return payload;
     }
 
+    // Only the writer thread mutates the learner, so these writer-lane reads
+    // need no lock.
     if (request.method == "eval.canary") {
         TrainingStats stats = m_learner->evaluate_canary();
         JsonObject payload;
@@ -1154,6 +1554,19 @@ JsonObject Service::handle_request(const MCPBridge::Request& request) {
         return payload;
     }
 
+    if (request.method == "checkpoint.flush") {
+        const bool ok = m_learner->flush_checkpoint();
+        const auto status = m_learner->checkpoint_status();
+        JsonObject payload;
+        payload["output"] = Json(ok ? "Checkpoint written." : "Checkpoint write failed.");
+        payload["status"] = Json(ok ? "ok" : "error");
+        payload["writes_completed"] = Json(static_cast<double>(status.writes_completed));
+        if (status.last_step) {
+            payload["step"] = Json(static_cast<double>(*status.last_step));
+        }
+        return payload;
+    }
+
     throw std::runtime_error("unknown method: " + request.method);
 }
 
@@ -1165,6 +1578,7 @@ void Service::handle_trainer_fit(const MCPBridge::Request& request, std::ostream
     std::string file;
     int epochs = 1;
     int batch = 32;
+    int threads = static_cast<int>(m_learner->fit_threads());
 
     auto emit_info = [&out](std::string message, std::function<void(JsonObject&)> enrich = {}) {
         JsonObject event;
@@ -1215,7 +1629,11 @@ void Service::handle_trainer_fit(const MCPBridge::Request& request, std::ostream
         if (auto it = params.find("batch"); it != params.end()) {
             batch = std::max(1, parse_int(it->second, batch));
         }
+        if (auto it = params.find("threads"); it != params.end()) {
+            threads = std::max(0, parse_int(it->second, threads));
+        }
     }
+    m_learner->set_fit_threads(static_cast<std::size_t>(threads));
 
     if (!file.empty()) {
         namespace fs = std::filesystem;
@@ -1254,10 +1672,12 @@ void Service::handle_trainer_fit(const MCPBridge::Request& request, std::ostream
 
     emit_info(
         "Training configuration: epochs=" + std::to_string(epochs)
-            + ", batch=" + std::to_string(batch) + '.',
+            + ", batch=" + std::to_string(batch)
+            + ", threads=" + std::to_string(threads) + '.',
         [&](JsonObject& payload) {
             payload["epochs"] = Json(epochs);
             payload["batch"] = Json(batch);
+            payload["threads"] = Json(threads);
         });
 
     double final_loss = 0.0;
@@ -1274,6 +1694,9 @@ void Service::handle_trainer_fit(const MCPBridge::Request& request, std::ostream
         out.flush();
         final_loss = loss;
         final_step = step;
+    }, [this](const std::function<void()>& step) {
+        std::unique_lock lock(m_state_mutex);
+        step();
     });
 
     std::ostringstream summary;
@@ -1353,6 +1776,7 @@ void Service::handle_train_self_loop(const MCPBridge::Request& request, std::ost
     bool shuffle = false;
     bool force_new = false;
     int limit = 0;
+    int concurrency = 4;
 
     if (auto it = params.find("loops"); it != params.end()) {
         loops = parse_int(it->second, loops);
@@ -1369,6 +1793,9 @@ void Service::handle_train_self_loop(const MCPBridge::Request& request, std::ost
     if (auto it = params.find("limit"); it != params.end()) {
         limit = parse_int(it->second, limit);
     }
+    if (auto it = params.find("concurrency"); it != params.end()) {
+        concurrency = parse_int(it->second, concurrency);
+    }
 
     std::vector<std::string> tag_filter;
     if (auto it = params.find("tags"); it != params.end()) {
@@ -1377,6 +1804,7 @@ void Service::handle_train_self_loop(const MCPBridge::Request& request, std::ost
 
     loops = std::clamp(loops, 1, 1000);
     delay_ms = std::clamp(delay_ms, 0, 60000);
+    concurrency = std::clamp(concurrency, 1, 32);
     if (limit < 0) {
         limit = 0;
     }
@@ -1438,7 +1866,8 @@ void Service::handle_train_self_loop(const MCPBridge::Request& request, std::ost
     start << "Starting self-learning loop: prompts=" << prompts.size()
           << ", loops=" << loops
           << ", shuffle=" << (shuffle ? "true" : "false")
-          << ", force_new=" << (force_new ? "true" : "false");
+          << ", force_new=" << (force_new ? "true" : "false")
+          << ", concurrency=" << concurrency;
     if (limit > 0) {
         start << ", limit=" << limit;
     }
@@ -1459,6 +1888,7 @@ void Service::handle_train_self_loop(const MCPBridge::Request& request, std::ost
         payload["delay_ms"] = Json(delay_ms);
         payload["shuffle"] = Json(shuffle);
         payload["force_new"] = Json(force_new);
+        payload["concurrency"] = Json(concurrency);
         payload["prompts"] = Json(static_cast<int>(prompts.size()));
         if (limit > 0) {
             payload["limit"] = Json(limit);
@@ -1484,189 +1914,226 @@ void Service::handle_train_self_loop(const MCPBridge::Request& request, std::ost
     events.reserve(std::min<std::size_t>(desired_total, std::size_t{200}));
 
     std::mt19937 rng = make_rng();
-    auto last_debug_update = std::chrono::steady_clock::now();
 
-    while (processed < desired_total && loops_completed < loops) {
+    struct PlannedStep {
+        std::size_t prompt = 0;
+        int loop = 0;
+    };
+    std::vector<PlannedStep> plan;
+    plan.reserve(desired_total);
+    for (int loop = 0; loop < loops && plan.size() < desired_total; ++loop) {
         if (shuffle) {
             std::shuffle(order.begin(), order.end(), rng);
         }
-
         for (std::size_t index : order) {
-            if (processed >= desired_total) {
+            if (plan.size() >= desired_total) {
                 break;
             }
+            plan.push_back(PlannedStep{index, loop});
+        }
+    }
+
+    // Teacher requests for upcoming steps run on `concurrency` threads while
+    // this thread trains on the current one. Only the remote call is
+    // prefetched: prompts the teacher cannot answer fall back to the student
+    // here, in step order, so they see the same model state as before.
+    // delay_ms spaces the starts of teacher requests.
+    const auto started = std::chrono::steady_clock::now();
+    auto last_debug_update = started;
+    Prefetcher<TeacherFetchOutcome> prefetcher(
+        plan.size(), static_cast<std::size_t>(concurrency), std::chrono::milliseconds(delay_ms),
+        [&](std::size_t item) {
+            return request_teacher_output(m_bridge, prompts[plan[item].prompt], Json(), m_chat_route);
+        });
 
-            const std::string& prompt = prompts[index];
-            TeacherFetchOutcome teacher = fetch_teacher_output(*m_learner, m_bridge, prompt, Json(), m_chat_route);
+    for (const PlannedStep& planned : plan) {
+        loops_completed = planned.loop;
+        const std::string& prompt = prompts[planned.prompt];
+        TeacherFetchOutcome teacher = prefetcher.next();
+        if (teacher.route.empty()) {
+            complete_with_student(*m_learner, m_generation, prompt, Json(), teacher);
+        }
 
-            JsonObject event;
-            event["prompt"] = Json(prompt);
-            event["loop"] = Json(loops_completed + 1);
-            event["iteration"] = Json(static_cast<int>(processed + 1));
-            if (!tag_filter.empty()) {
-                event["requested_tags"] = Json(make_tag_array(tag_filter));
-            }
-            if (!teacher.route.empty()) {
-                event["teacher_route"] = Json(teacher.route);
-            }
-            if (!teacher.source_label.empty()) {
-                event["teacher_source"] = Json(teacher.source_label);
+        JsonObject event;
+        event["prompt"] = Json(prompt);
+        event["loop"] = Json(loops_completed + 1);
+        event["iteration"] = Json(static_cast<int>(processed + 1));
+        if (!tag_filter.empty()) {
+            event["requested_tags"] = Json(make_tag_array(tag_filter));
+        }
+        if (!teacher.route.empty()) {
+            event["teacher_route"] = Json(teacher.route);
+        }
+        if (!teacher.source_label.empty()) {
+            event["teacher_source"] = Json(teacher.source_label);
+        }
+        if (!teacher.cache_status.empty()) {
+            event["teacher_cache"] = Json(teacher.cache_status);
+        }
+        if (!teacher.remote_error.empty()) {
+            event["remote_error"] = Json(teacher.remote_error);
+        }
+        if (teacher.placeholder) {
+            event["placeholder"] = Json(true);
+        }
+
+        const int step_index = static_cast<int>(processed + 1);
+        std::string teacher_output = teacher.output;
+        if (teacher_output.empty()) {
+            event["status"] = Json("teacher_unavailable");
+            ++unavailable;
+            emit_info(
+                "Step " + std::to_string(step_index) + ": teacher unavailable",
+                [&](JsonObject& payload) {
+                    payload["step"] = Json(step_index);
+                    payload["status"] = Json("teacher_unavailable");
+                    if (!teacher.route.empty()) {
+                        payload["route"] = Json(teacher.route);
+                    }
+                    if (!teacher.remote_error.empty()) {
+                        payload["remote_error"] = Json(teacher.remote_error);
+                    }
+                });
+        } else {
+            std::string teacher_source = teacher.source_label;
+            if (teacher_source.empty()) {
+                if (teacher.route == "remote") {
+                    teacher_source = m_chat_route.empty() ? "remote_teacher" : m_chat_route;
+                } else if (teacher.route == "local") {
+                    teacher_source = "local_student";
+                } else {
+                    teacher_source = "fallback_teacher";
+                }
             }
-            if (!teacher.remote_error.empty()) {
-                event["remote_error"] = Json(teacher.remote_error);
+
+            std::string prompt_hash;
+            if (force_new) {
+                std::ostringstream hash_seed;
+                hash_seed << prompt << "::selfloop::" << loops_completed << ':' << processed;
+                prompt_hash = compute_prompt_hash(hash_seed.str());
+            } else {
+                prompt_hash = compute_prompt_hash(prompt);
             }
-            if (teacher.placeholder) {
-                event["placeholder"] = Json(true);
+
+            std::string curated_source = teacher_source;
+            if (force_new) {
+                std::ostringstream tagged_source;
+                tagged_source << teacher_source << "::selfloop::" << (loops_completed + 1) << ':' << (processed + 1);
+                curated_source = tagged_source.str();
             }
 
-            const int step_index = static_cast<int>(processed + 1);
-            std::string teacher_output = teacher.output;
-            if (teacher_output.empty()) {
-                event["status"] = Json("teacher_unavailable");
-                ++unavailable;
+            // Lock per mutation only; the prefetcher and debug.update run unlocked.
+            std::optional<CuratedSample> curated;
+            {
+                std::unique_lock lock(m_state_mutex);
+                curated = m_learner->ingest(prompt, teacher_output, Json(), prompt_hash, curated_source);
+            }
+            if (!curated) {
+                event["status"] = Json("skipped");
+                ++skipped;
                 emit_info(
-                    "Step " + std::to_string(step_index) + ": teacher unavailable",
+                    "Step " + std::to_string(step_index) + ": sample skipped by curator",
                     [&](JsonObject& payload) {
                         payload["step"] = Json(step_index);
-                        payload["status"] = Json("teacher_unavailable");
+                        payload["status"] = Json("skipped");
                         if (!teacher.route.empty()) {
                             payload["route"] = Json(teacher.route);
                         }
-                        if (!teacher.remote_error.empty()) {
-                            payload["remote_error"] = Json(teacher.remote_error);
+                        if (!teacher_source.empty()) {
+                            payload["teacher_source"] = Json(teacher_source);
                         }
                     });
             } else {
-                std::string teacher_source = teacher.source_label;
-                if (teacher_source.empty()) {
-                    if (teacher.route == "remote") {
-                        teacher_source = m_chat_route.empty() ? "remote_teacher" : m_chat_route;
-                    } else if (teacher.route == "local") {
-                        teacher_source = "local_student";
-                    } else {
-                        teacher_source = "fallback_teacher";
+                if (!curated->semantic_tags.empty()) {
+                    JsonArray sample_tags;
+                    sample_tags.reserve(curated->semantic_tags.size());
+                    for (const auto& tag : curated->semantic_tags) {
+                        sample_tags.emplace_back(Json(tag));
                     }
+                    event["semantic_tags"] = Json(sample_tags);
                 }
-
-                std::string prompt_hash;
-                if (force_new) {
-                    std::ostringstream hash_seed;
-                    hash_seed << prompt << "::selfloop::" << loops_completed << ':' << processed;
-                    prompt_hash = compute_prompt_hash(hash_seed.str());
-                } else {
-                    prompt_hash = compute_prompt_hash(prompt);
+                TrainingStats stats;
+                {
+                    std::unique_lock lock(m_state_mutex);
+                    stats = m_learner->train_step(*curated);
                 }
-
-                std::string curated_source = teacher_source;
-                if (force_new) {
-                    std::ostringstream tagged_source;
-                    tagged_source << teacher_source << "::selfloop::" << (loops_completed + 1) << ':' << (processed + 1);
-                    curated_source = tagged_source.str();
+                event["status"] = Json("trained");
+                event["loss"] = Json(stats.loss);
+                event["accuracy"] = Json(stats.accuracy);
+                event["adapter_norm"] = Json(stats.adapter_norm);
+                event["retrieval_hit_rate"] = Json(stats.retrieval_hit_rate);
+                if (!stats.learning_tags.empty()) {
+                    JsonArray tags;
+                    tags.reserve(stats.learning_tags.size());
+                    for (const auto& tag : stats.learning_tags) {
+                        tags.emplace_back(Json(tag));
+                    }
+                    event["learning_tags"] = Json(tags);
                 }
-
-                auto curated = m_learner->ingest(prompt, teacher_output, Json(), prompt_hash, curated_source);
-                if (!curated) {
-                    event["status"] = Json("skipped");
-                    ++skipped;
-                    emit_info(
-                        "Step " + std::to_string(step_index) + ": sample skipped by curator",
-                        [&](JsonObject& payload) {
-                            payload["step"] = Json(step_index);
-                            payload["status"] = Json("skipped");
-                            if (!teacher.route.empty()) {
-                                payload["route"] = Json(teacher.route);
-                            }
-                            if (!teacher_source.empty()) {
-                                payload["teacher_source"] = Json(teacher_source);
-                            }
-                        });
-                } else {
-                    if (!curated->semantic_tags.empty()) {
-                        JsonArray sample_tags;
-                        sample_tags.reserve(curated->semantic_tags.size());
-                        for (const auto& tag : curated->semantic_tags) {
-                            sample_tags.emplace_back(Json(tag));
-                        }
-                        event["semantic_tags"] = Json(sample_tags);
+                if (!stats.learning_trace.empty()) {
+                    event["learning_trace"] = Json(stats.learning_trace);
+                }
+                loss_accumulator += stats.loss;
+                accuracy_accumulator += stats.accuracy;
+                ++trained;
+
+                emit_batch(step_index, [&](JsonObject& payload) {
+                    payload["loss"] = Json(stats.loss);
+                    payload["accuracy"] = Json(stats.accuracy);
+                    payload["status"] = Json("trained");
+                    if (!teacher.route.empty()) {
+                        payload["route"] = Json(teacher.route);
                     }
-                    TrainingStats stats = m_learner->train_step(*curated);
-                    event["status"] = Json("trained");
-                    event["loss"] = Json(stats.loss);
-                    event["accuracy"] = Json(stats.accuracy);
-                    event["adapter_norm"] = Json(stats.adapter_norm);
-                    event["retrieval_hit_rate"] = Json(stats.retrieval_hit_rate);
-                    if (!stats.learning_tags.empty()) {
-                        JsonArray tags;
-                        tags.reserve(stats.learning_tags.size());
-                        for (const auto& tag : stats.learning_tags) {
-                            tags.emplace_back(Json(tag));
-                        }
-                        event["learning_tags"] = Json(tags);
+                    if (!teacher_source.empty()) {
+                        payload["teacher_source"] = Json(teacher_source);
                     }
-                    if (!stats.learning_trace.empty()) {
-                        event["learning_trace"] = Json(stats.learning_trace);
+                    if (!tag_filter.empty()) {
+                        payload["requested_tags"] = Json(make_tag_array(tag_filter));
                     }
-                    loss_accumulator += stats.loss;
-                    accuracy_accumulator += stats.accuracy;
-                    ++trained;
-
-                    emit_batch(step_index, [&](JsonObject& payload) {
-                        payload["loss"] = Json(stats.loss);
-                        payload["accuracy"] = Json(stats.accuracy);
-                        payload["status"] = Json("trained");
-                        if (!teacher.route.empty()) {
-                            payload["route"] = Json(teacher.route);
-                        }
-                        if (!teacher_source.empty()) {
-                            payload["teacher_source"] = Json(teacher_source);
-                        }
-                        if (!tag_filter.empty()) {
-                            payload["requested_tags"] = Json(make_tag_array(tag_filter));
-                        }
-                    });
-                }
-            }
-
-            if (events.size() < 200) {
-                events.emplace_back(Json(event));
-            } else {
-                events_truncated = true;
-            }
-
-            ++processed;
-
-            if (delay_ms > 0 && processed < desired_total) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+                });
             }
+        }
 
-            auto now = std::chrono::steady_clock::now();
-            if (now - last_debug_update >= std::chrono::seconds(1)) {
-                JsonObject debug;
-                debug["stage"] = Json("train.self_loop");
-                debug["processed"] = Json(static_cast<int>(std::min<std::size_t>(processed, static_cast<std::size_t>(std::numeric_limits<int>::max()))));
-                debug["desired_total"] = Json(static_cast<int>(std::min<std::size_t>(desired_total, static_cast<std::size_t>(std::numeric_limits<int>::max()))));
-                debug["trained"] = Json(trained);
-                debug["skipped"] = Json(skipped);
-                debug["teacher_unavailable"] = Json(unavailable);
-                debug["loops_completed"] = Json(loops_completed);
-                debug["loops_requested"] = Json(loops);
-                if (trained > 0) {
-                    debug["average_loss"] = Json(loss_accumulator / static_cast<double>(trained));
-                    debug["average_accuracy"] = Json(accuracy_accumulator / static_cast<double>(trained));
-                }
-                m_bridge.call("debug.update", Json(debug));
-                last_debug_update = now;
+        if (events.size() < 200) {
+            events.emplace_back(Json(event));
+        } else {
+            events_truncated = true;
+        }
+
+        ++processed;
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_debug_update >= std::chrono::seconds(1)) {
+            JsonObject debug;
+            debug["stage"] = Json("train.self_loop");
+            debug["processed"] = Json(static_cast<int>(std::min<std::size_t>(processed, static_cast<std::size_t>(std::numeric_limits<int>::max()))));
+            debug["desired_total"] = Json(static_cast<int>(std::min<std::size_t>(desired_total, static_cast<std::size_t>(std::numeric_limits<int>::max()))));
+            debug["trained"] = Json(trained);
+            debug["skipped"] = Json(skipped);
+            debug["teacher_unavailable"] = Json(unavailable);
+            debug["loops_completed"] = Json(loops_completed);
+            debug["loops_requested"] = Json(loops);
+            if (trained > 0) {
+                debug["average_loss"] = Json(loss_accumulator / static_cast<double>(trained));
+                debug["average_accuracy"] = Json(accuracy_accumulator / static_cast<double>(trained));
             }
+            m_bridge.call("debug.update", Json(debug));
+            last_debug_update = now;
         }
-
-        ++loops_completed;
     }
 
+    loops_completed = plan.back().loop + 1;
+
+    const double elapsed_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    const double samples_per_minute = elapsed_ms > 0.0 ? trained * 60000.0 / elapsed_ms : 0.0;
+
     std::ostringstream summary;
     summary << "Self-learning processed " << processed << " prompt" << (processed == 1 ? "" : "s")
             << " (trained=" << trained
             << ", skipped=" << skipped
-            << ", teacher_unavailable=" << unavailable << ")";
+            << ", teacher_unavailable=" << unavailable << ", "
+            << std::fixed << std::setprecision(1) << samples_per_minute << " samples/min)";
 
     JsonObject payload;
     payload["label"] = Json("auto");
@@ -1677,6 +2144,9 @@ void Service::handle_train_self_loop(const MCPBridge::Request& request, std::ost
     payload["trained"] = Json(trained);
     payload["skipped"] = Json(skipped);
     payload["teacher_unavailable"] = Json(unavailable);
+    payload["concurrency"] = Json(concurrency);
+    payload["elapsed_ms"] = Json(elapsed_ms);
+    payload["samples_per_minute"] = Json(samples_per_minute);
     if (trained > 0) {
         payload["average_loss"] = Json(loss_accumulator / static_cast<double>(trained));
         payload["average_accuracy"] = Json(accuracy_accumulator / static_cast<double>(trained));
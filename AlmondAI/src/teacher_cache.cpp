@@ -0,0 +1,292 @@
+#include "../include/almondai/teacher_cache.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace almondai {
+
+namespace {
+
+std::uint64_t fnv1a(std::uint64_t hash, std::string_view text) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::int64_t now_seconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+std::string encode_record(const std::string& key, const TeacherCache::Entry& entry) {
+    JsonObject record;
+    record["key"] = Json(key);
+    record["output"] = Json(entry.output);
+    record["source"] = Json(entry.source);
+    // Stored as a string, the form decode_record reads back.
+    record["created_at"] = Json(std::to_string(entry.created_at));
+    return Json(record).dump() + '\n';
+}
+
+std::optional<std::pair<std::string, TeacherCache::Entry>> decode_record(std::string_view line) {
+    if (line.empty()) {
+        return std::nullopt;
+    }
+    try {
+        Json parsed = Json::parse(line);
+        if (!parsed.is_object()) {
+            return std::nullopt;
+        }
+        const auto& obj = parsed.as_object();
+        auto key_it = obj.find("key");
+        auto output_it = obj.find("output");
+        if (key_it == obj.end() || !key_it->second.is_string() || output_it == obj.end()
+            || !output_it->second.is_string()) {
+            return std::nullopt;
+        }
+        TeacherCache::Entry entry;
+        entry.output = output_it->second.as_string();
+        if (auto it = obj.find("source"); it != obj.end() && it->second.is_string()) {
+            entry.source = it->second.as_string();
+        }
+        if (auto it = obj.find("created_at"); it != obj.end() && it->second.is_string()) {
+            entry.created_at = std::stoll(it->second.as_string());
+        }
+        return std::make_pair(key_it->second.as_string(), std::move(entry));
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+} // namespace
+
+TeacherCache::TeacherCache() : TeacherCache(Options{}) {}
+
+TeacherCache::TeacherCache(Options options) : m_options(std::move(options)) {
+    m_options.max_memory_entries = std::max<std::size_t>(1, m_options.max_memory_entries);
+    std::scoped_lock lock(m_mutex);
+    load_store_locked();
+}
+
+std::string TeacherCache::make_key(std::string_view scope, std::string_view message) {
+    std::uint64_t hash = 1469598103934665603ull;
+    hash = fnv1a(hash, scope);
+    hash = fnv1a(hash, std::string_view("\0", 1));
+    hash = fnv1a(hash, message);
+    static constexpr char kDigits[] = "0123456789abcdef";
+    std::string key(16, '0');
+    for (int i = 15; i >= 0; --i) {
+        key[static_cast<std::size_t>(i)] = kDigits[hash & 0xF];
+        hash >>= 4;
+    }
+    return key;
+}
+
+std::optional<TeacherCache::Entry> TeacherCache::lookup(const std::string& key) {
+    std::scoped_lock lock(m_mutex);
+    if (auto it = m_memory.find(key); it != m_memory.end()) {
+        if (!expired(it->second->second)) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second);
+            ++m_hits;
+            return it->second->second;
+        }
+        m_lru.erase(it->second);
+        m_memory.erase(it);
+    }
+    if (auto it = m_offsets.find(key); it != m_offsets.end()) {
+        auto record = read_record_locked(it->second);
+        if (record && !expired(*record)) {
+            ++m_hits;
+            remember_locked(key, *record);
+            return record;
+        }
+        m_offsets.erase(it);
+    }
+    ++m_misses;
+    return std::nullopt;
+}
+
+void TeacherCache::store(const std::string& key, std::string output, std::string source) {
+    Entry entry{std::move(output), std::move(source), now_seconds()};
+    std::scoped_lock lock(m_mutex);
+    if (m_store.is_open()) {
+        const std::string line = encode_record(key, entry);
+        m_store.clear();
+        m_store.seekp(0, std::ios::end);
+        m_store.write(line.data(), static_cast<std::streamsize>(line.size()));
+        m_store.flush();
+        if (m_store) {
+            m_offsets[key] = m_store_bytes;
+            m_store_bytes += line.size();
+        }
+    }
+    remember_locked(key, std::move(entry));
+    if (m_store.is_open() && m_store_bytes > m_options.max_store_bytes) {
+        compact_locked();
+    }
+}
+
+void TeacherCache::clear() {
+    std::scoped_lock lock(m_mutex);
+    m_lru.clear();
+    m_memory.clear();
+    m_offsets.clear();
+    if (m_store.is_open()) {
+        m_store.close();
+        std::ofstream truncate(m_options.store_path, std::ios::trunc | std::ios::binary);
+        truncate.close();
+        m_store_bytes = 0;
+        open_store_locked();
+    }
+}
+
+TeacherCache::Stats TeacherCache::stats() const {
+    std::scoped_lock lock(m_mutex);
+    Stats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.memory_entries = m_memory.size();
+    stats.stored_entries = m_offsets.size();
+    stats.store_bytes = static_cast<std::size_t>(m_store_bytes);
+    return stats;
+}
+
+bool TeacherCache::expired(const Entry& entry) const {
+    if (m_options.ttl.count() <= 0) {
+        return false;
+    }
+    return now_seconds() - entry.created_at > m_options.ttl.count();
+}
+
+void TeacherCache::remember_locked(const std::string& key, Entry entry) {
+    if (auto it = m_memory.find(key); it != m_memory.end()) {
+        it->second->second = std::move(entry);
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return;
+    }
+    m_lru.emplace_front(key, std::move(entry));
+    m_memory[key] = m_lru.begin();
+    while (m_memory.size() > m_options.max_memory_entries) {
+        m_memory.erase(m_lru.back().first);
+        m_lru.pop_back();
+    }
+}
+
+std::optional<TeacherCache::Entry> TeacherCache::read_record_locked(std::uint64_t offset) {
+    if (!m_store.is_open()) {
+        return std::nullopt;
+    }
+    m_store.clear();
+    m_store.seekg(static_cast<std::streamoff>(offset));
+    std::string line;
+    if (!std::getline(m_store, line)) {
+        return std::nullopt;
+    }
+    auto record = decode_record(line);
+    if (!record) {
+        return std::nullopt;
+    }
+    return std::move(record->second);
+}
+
+bool TeacherCache::open_store_locked() {
+    std::error_code ec;
+    if (m_options.store_path.has_parent_path()) {
+        std::filesystem::create_directories(m_options.store_path.parent_path(), ec);
+    }
+    m_store.open(m_options.store_path, std::ios::in | std::ios::out | std::ios::app | std::ios::binary);
+    return m_store.is_open();
+}
+
+void TeacherCache::load_store_locked() {
+    if (m_options.store_path.empty() || !open_store_locked()) {
+        return;
+    }
+    m_store.seekg(0);
+    std::string line;
+    std::uint64_t offset = 0;
+    bool terminated = true;
+    while (std::getline(m_store, line)) {
+        terminated = !m_store.eof();
+        if (auto record = decode_record(line)) {
+            if (expired(record->second)) {
+                m_offsets.erase(record->first);
+            } else {
+                m_offsets[record->first] = offset;
+            }
+        }
+        offset += line.size() + 1;
+    }
+    if (!terminated) {
+        // A write cut short left a partial last line; end it so the next
+        // append starts a record of its own, where `offset` expects it.
+        m_store.clear();
+        m_store.seekp(0, std::ios::end);
+        m_store.put('\n');
+        m_store.flush();
+    }
+    m_store_bytes = offset;
+    if (m_store_bytes > m_options.max_store_bytes) {
+        compact_locked();
+    }
+}
+
+void TeacherCache::compact_locked() {
+    // Keep the newest live records until the store is back under three
+    // quarters of the cap, so compaction does not run on every append.
+    std::vector<std::pair<std::string, Entry>> live;
+    live.reserve(m_offsets.size());
+    for (const auto& [key, offset] : m_offsets) {
+        if (auto record = read_record_locked(offset); record && !expired(*record)) {
+            live.emplace_back(key, std::move(*record));
+        }
+    }
+    std::sort(live.begin(), live.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second.created_at > rhs.second.created_at;
+    });
+
+    const std::uint64_t budget = m_options.max_store_bytes / 4 * 3;
+    std::filesystem::path temp = m_options.store_path;
+    temp += ".tmp";
+    std::unordered_map<std::string, std::uint64_t> offsets;
+    std::uint64_t written = 0;
+    {
+        std::ofstream out(temp, std::ios::trunc | std::ios::binary);
+        if (!out) {
+            return;
+        }
+        for (const auto& [key, entry] : live) {
+            const std::string line = encode_record(key, entry);
+            if (written + line.size() > budget) {
+                break;
+            }
+            out.write(line.data(), static_cast<std::streamsize>(line.size()));
+            offsets[key] = written;
+            written += line.size();
+        }
+        if (!out) {
+            std::error_code ec;
+            std::filesystem::remove(temp, ec);
+            return;
+        }
+    }
+
+    m_store.close();
+    std::error_code ec;
+    std::filesystem::rename(temp, m_options.store_path, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        open_store_locked();
+        return;
+    }
+    m_offsets = std::move(offsets);
+    m_store_bytes = written;
+    open_store_locked();
+}
+
+} // namespace almondai
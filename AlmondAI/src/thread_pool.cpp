@@ -0,0 +1,130 @@
+#include "../include/almondai/thread_pool.hpp"
+
+#include "../include/almondai/kernels.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace almondai {
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) {
+        threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
+    m_workers.reserve(threads - 1);
+    for (std::size_t i = 1; i < threads; ++i) {
+        m_workers.emplace_back([this] { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::scoped_lock lock(m_mutex);
+        m_stopping = true;
+    }
+    m_start.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+    if (m_workers.empty() || count == 1) {
+        for (std::size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+    {
+        std::scoped_lock lock(m_mutex);
+        m_task = &task;
+        m_count = count;
+        m_next.store(0, std::memory_order_relaxed);
+        m_error = nullptr;
+        m_busy = m_workers.size();
+        ++m_generation;
+    }
+    m_start.notify_all();
+    drain(task, count);
+
+    std::unique_lock lock(m_mutex);
+    m_finished.wait(lock, [this] { return m_busy == 0; });
+    m_task = nullptr;
+    if (m_error) {
+        std::rethrow_exception(std::exchange(m_error, nullptr));
+    }
+}
+
+void ThreadPool::drain(const std::function<void(std::size_t)>& task, std::size_t count) {
+    while (true) {
+        const std::size_t index = m_next.fetch_add(1, std::memory_order_relaxed);
+        if (index >= count) {
+            return;
+        }
+        try {
+            task(index);
+        } catch (...) {
+            std::scoped_lock lock(m_mutex);
+            if (!m_error) {
+                m_error = std::current_exception();
+            }
+        }
+    }
+}
+
+void ThreadPool::worker_loop() {
+    std::size_t seen_generation = 0;
+    std::unique_lock lock(m_mutex);
+    while (true) {
+        m_start.wait(lock, [&] { return m_stopping || m_generation != seen_generation; });
+        if (m_stopping) {
+            return;
+        }
+        seen_generation = m_generation;
+        const auto* task = m_task;
+        const std::size_t count = m_count;
+        lock.unlock();
+        drain(*task, count);
+        lock.lock();
+        if (--m_busy == 0) {
+            m_finished.notify_one();
+        }
+    }
+}
+
+std::vector<double>& sharded_sum(ThreadPool& pool,
+                                 std::size_t count,
+                                 std::size_t size,
+                                 std::vector<std::vector<double>>& buffers,
+                                 const std::function<void(std::size_t, std::vector<double>&)>& accumulate) {
+    const std::size_t shards = std::max<std::size_t>(1, std::min(pool.size(), count));
+    const std::size_t per_shard = count == 0 ? 0 : (count + shards - 1) / shards;
+    if (buffers.size() < shards) {
+        buffers.resize(shards);
+    }
+    pool.parallel_for(shards, [&](std::size_t shard) {
+        auto& sum = buffers[shard];
+        sum.assign(size, 0.0);
+        const std::size_t begin = std::min(count, shard * per_shard);
+        const std::size_t end = std::min(count, begin + per_shard);
+        for (std::size_t i = begin; i < end; ++i) {
+            accumulate(i, sum);
+        }
+    });
+    for (std::size_t stride = 1; stride < shards; stride *= 2) {
+        const std::size_t pairs = (shards + 2 * stride - 1) / (2 * stride);
+        pool.parallel_for(pairs, [&](std::size_t pair) {
+            const std::size_t target = pair * 2 * stride;
+            const std::size_t source = target + stride;
+            if (source < shards) {
+                kernels::axpy(1.0, buffers[source].data(), buffers[target].data(), size);
+            }
+        });
+    }
+    return buffers.front();
+}
+
+} // namespace almondai
@@ -4,7 +4,6 @@
 #include <cctype>
 #include <fstream>
 #include <iterator>
-#include <optional>
 #include <set>
 #include <system_error>
 
@@ -23,6 +22,8 @@ bool is_space(char ch) {
 const std::vector<std::string> kCompoundTokens{
     "::", "->", "==", "!=", "<=", ">=", "()", "{}", "[]", "<>"
 };
+// First bytes of kCompoundTokens.
+constexpr std::string_view kCompoundLeads = ":-=!<>({[";
 
 const std::vector<std::string> kRequiredTokens{
     "<pad>", "<eos>", "<unk>", " ", "\n", "\t",
@@ -30,58 +31,212 @@ const std::vector<std::string> kRequiredTokens{
     "template", "constexpr", "noexcept"
 };
 
-std::vector<std::string> utf8_graphemes(std::string_view text) {
-    std::vector<std::string> result;
-    for (std::size_t i = 0; i < text.size();) {
-        unsigned char c = static_cast<unsigned char>(text[i]);
-        std::size_t length = 1;
-        if ((c & 0x80u) == 0) {
-            length = 1;
-        } else if ((c & 0xE0u) == 0xC0u) {
-            length = 2;
-        } else if ((c & 0xF0u) == 0xE0u) {
-            length = 3;
-        } else if ((c & 0xF8u) == 0xF0u) {
-            length = 4;
-        } else {
-            length = 1;
+std::size_t grapheme_length(std::string_view text, std::size_t pos) {
+    const unsigned char c = static_cast<unsigned char>(text[pos]);
+    std::size_t length = 1;
+    if ((c & 0x80u) == 0) {
+        length = 1;
+    } else if ((c & 0xE0u) == 0xC0u) {
+        length = 2;
+    } else if ((c & 0xF0u) == 0xE0u) {
+        length = 3;
+    } else if ((c & 0xF8u) == 0xF0u) {
+        length = 4;
+    }
+    return std::min(length, text.size() - pos);
+}
+
+constexpr int kInitialRoot = 0;
+constexpr int kContinuationRoot = 1;
+
+std::ofstream open_for_save(const std::filesystem::path& path) {
+    if (path.has_parent_path()) {
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+    }
+    return std::ofstream(path);
+}
+
+} // namespace
+
+WordPieceTrie::WordPieceTrie() {
+    clear();
+}
+
+void WordPieceTrie::clear() {
+    m_nodes.assign(2, Node{});
+    for (auto& table : m_root_children) {
+        table.fill(-1);
+    }
+}
+
+void WordPieceTrie::insert(std::string_view token, int id) {
+    if (token.empty()) {
+        return;
+    }
+    insert_at(kInitialRoot, token, id);
+    if (token.size() > 2 && token.compare(0, 2, "##") == 0) {
+        insert_at(kContinuationRoot, token.substr(2), id);
+    }
+}
+
+void WordPieceTrie::insert_at(int root, std::string_view key, int id) {
+    int node = root;
+    for (char ch : key) {
+        node = add_child(node, static_cast<unsigned char>(ch));
+    }
+    m_nodes[static_cast<std::size_t>(node)].token_id = id;
+}
+
+int WordPieceTrie::child(int node, unsigned char byte) const {
+    if (node <= kContinuationRoot) {
+        return m_root_children[static_cast<std::size_t>(node)][byte];
+    }
+    for (int next = m_nodes[static_cast<std::size_t>(node)].first_child; next >= 0;
+         next = m_nodes[static_cast<std::size_t>(next)].next_sibling) {
+        if (m_nodes[static_cast<std::size_t>(next)].byte == byte) {
+            return next;
         }
-        if (i + length > text.size()) {
-            length = text.size() - i;
+    }
+    return -1;
+}
+
+int WordPieceTrie::add_child(int node, unsigned char byte) {
+    if (const int existing = child(node, byte); existing >= 0) {
+        return existing;
+    }
+    const int created = static_cast<int>(m_nodes.size());
+    Node fresh;
+    fresh.byte = byte;
+    if (node <= kContinuationRoot) {
+        m_root_children[static_cast<std::size_t>(node)][byte] = created;
+    } else {
+        fresh.next_sibling = m_nodes[static_cast<std::size_t>(node)].first_child;
+        m_nodes[static_cast<std::size_t>(node)].first_child = created;
+    }
+    m_nodes.push_back(fresh);
+    return created;
+}
+
+WordPieceTrie::Match WordPieceTrie::longest_match(std::string_view text, std::size_t start, bool continuation) const {
+    Match best;
+    if (start >= text.size()) {
+        return best;
+    }
+    int node = continuation ? kContinuationRoot : kInitialRoot;
+    std::size_t boundary = start + grapheme_length(text, start);
+    for (std::size_t pos = start; pos < text.size(); ++pos) {
+        node = child(node, static_cast<unsigned char>(text[pos]));
+        if (node < 0) {
+            break;
+        }
+        if (pos + 1 == boundary) {
+            if (const int id = m_nodes[static_cast<std::size_t>(node)].token_id; id >= 0) {
+                best = Match{boundary - start, id};
+            }
+            if (boundary < text.size()) {
+                boundary += grapheme_length(text, boundary);
+            }
         }
-        result.emplace_back(text.substr(i, length));
-        i += length;
     }
-    return result;
+    return best;
 }
 
-} // namespace
+int WordPieceTrie::find(std::string_view piece, bool continuation) const {
+    if (piece.empty()) {
+        return -1;
+    }
+    int node = continuation ? kContinuationRoot : kInitialRoot;
+    for (char ch : piece) {
+        node = child(node, static_cast<unsigned char>(ch));
+        if (node < 0) {
+            return -1;
+        }
+    }
+    return m_nodes[static_cast<std::size_t>(node)].token_id;
+}
 
-BpeTokenizer::BpeTokenizer() {
-    m_id_to_token.reserve(8192);
+BpeTokenizer::BpeTokenizer() = default;
+
+std::shared_ptr<const BpeTokenizer::Vocabulary> BpeTokenizer::snapshot() const {
+    return m_vocab.load(std::memory_order_acquire);
+}
+
+void BpeTokenizer::publish(Vocabulary vocab) {
+    m_vocab.store(std::make_shared<const Vocabulary>(std::move(vocab)), std::memory_order_release);
 }
 
 std::size_t BpeTokenizer::ingest_training_pair(std::string_view prompt, std::string_view teacher_output) {
-    std::scoped_lock lock(m_mutex);
-    const std::size_t before = m_id_to_token.size();
-    ensure_tokens_for(prompt);
-    ensure_tokens_for(teacher_output);
-    return m_id_to_token.size() - before;
+    std::scoped_lock lock(m_write_mutex);
+    const auto current = snapshot();
+    if (!current || (!adds_tokens(*current, prompt) && !adds_tokens(*current, teacher_output))) {
+        return 0;
+    }
+    Vocabulary next = *current;
+    const std::size_t before = next.id_to_token.size();
+    ensure_tokens_for(next, prompt);
+    ensure_tokens_for(next, teacher_output);
+    const std::size_t added = next.id_to_token.size() - before;
+    publish(std::move(next));
+    return added;
+}
+
+std::size_t BpeTokenizer::ingest_texts(std::span<const std::string_view> texts, ThreadPool& pool) {
+    std::scoped_lock lock(m_write_mutex);
+    const auto current = snapshot();
+    if (!current || texts.empty()) {
+        return 0;
+    }
+    // Windows of texts are checked in parallel against the vocabulary as it
+    // stands when the window starts; within a window, the texts after the
+    // first one that adds tokens are checked again in order.
+    std::optional<Vocabulary> next;
+    const std::size_t window = pool.size() * 1024;
+    std::vector<char> adds;
+    for (std::size_t begin = 0; begin < texts.size(); begin += window) {
+        const std::size_t count = std::min(window, texts.size() - begin);
+        const Vocabulary& vocab = next ? *next : *current;
+        adds.assign(count, 0);
+        const std::size_t shards = std::min(count, pool.size() * 4);
+        pool.parallel_for(shards, [&](std::size_t shard) {
+            const std::size_t last = count * (shard + 1) / shards;
+            for (std::size_t i = count * shard / shards; i < last; ++i) {
+                adds[i] = adds_tokens(vocab, texts[begin + i]) ? 1 : 0;
+            }
+        });
+        const auto first = static_cast<std::size_t>(std::find(adds.begin(), adds.end(), 1) - adds.begin());
+        if (first == count) {
+            continue;
+        }
+        if (!next) {
+            next.emplace(*current);
+        }
+        ensure_tokens_for(*next, texts[begin + first]);
+        for (std::size_t i = first + 1; i < count; ++i) {
+            if (adds_tokens(*next, texts[begin + i])) {
+                ensure_tokens_for(*next, texts[begin + i]);
+            }
+        }
+    }
+    if (!next) {
+        return 0;
+    }
+    const std::size_t added = next->id_to_token.size() - current->id_to_token.size();
+    publish(std::move(*next));
+    return added;
 }
 
 std::size_t BpeTokenizer::vocab_size() const {
-    std::scoped_lock lock(m_mutex);
-    return m_id_to_token.size();
+    const auto vocab = snapshot();
+    return vocab ? vocab->id_to_token.size() : 0;
 }
 
 bool BpeTokenizer::load(const std::filesystem::path& vocab_path,
                         const std::filesystem::path& merges_path) {
-    std::scoped_lock lock(m_mutex);
+    std::scoped_lock lock(m_write_mutex);
     m_vocab_path = vocab_path;
-    m_ready = false;
-    m_id_to_token.clear();
-    m_token_to_id.clear();
-    m_recorded_merges.clear();
+    Vocabulary next;
+    next.id_to_token.reserve(8192);
 
     std::ifstream vocab_file(vocab_path);
     if (vocab_file) {
@@ -96,31 +251,32 @@ bool BpeTokenizer::load(const std::filesystem::path& vocab_path,
             if (line.empty()) {
                 continue;
             }
-            if (m_token_to_id.find(line) != m_token_to_id.end()) {
+            if (next.token_to_id.find(line) != next.token_to_id.end()) {
                 continue;
             }
-            const int id = static_cast<int>(m_id_to_token.size());
-            m_token_to_id.emplace(line, id);
-            m_id_to_token.push_back(line);
+            const int id = static_cast<int>(next.id_to_token.size());
+            next.token_to_id.emplace(line, id);
+            next.id_to_token.push_back(line);
         }
     }
 
-    if (m_id_to_token.size() < 3) {
-        m_id_to_token.resize(3);
-        m_id_to_token[0] = "<pad>";
-        m_id_to_token[1] = "<eos>";
-        m_id_to_token[2] = "<unk>";
-        m_token_to_id["<pad>"] = PAD_ID;
-        m_token_to_id["<eos>"] = EOS_ID;
-        m_token_to_id["<unk>"] = UNK_ID;
+    if (next.id_to_token.size() < 3) {
+        next.id_to_token.resize(3);
+        next.id_to_token[0] = "<pad>";
+        next.id_to_token[1] = "<eos>";
+        next.id_to_token[2] = "<unk>";
+        next.token_to_id["<pad>"] = PAD_ID;
+        next.token_to_id["<eos>"] = EOS_ID;
+        next.token_to_id["<unk>"] = UNK_ID;
     }
+    rebuild_trie(next);
 
-    ensure_token("<pad>", false);
-    ensure_token("<eos>", false);
-    ensure_token("<unk>", false);
+    ensure_token(next, "<pad>", false);
+    ensure_token(next, "<eos>", false);
+    ensure_token(next, "<unk>", false);
 
     for (const auto& token : kRequiredTokens) {
-        ensure_token(token, false);
+        ensure_token(next, token, false);
     }
 
     if (!merges_path.empty()) {
@@ -137,48 +293,43 @@ bool BpeTokenizer::load(const std::filesystem::path& vocab_path,
                 if (merge_line.empty()) {
                     continue;
                 }
-                ensure_token(merge_line, false);
-                if (std::find(m_recorded_merges.begin(), m_recorded_merges.end(), merge_line) == m_recorded_merges.end()) {
-                    m_recorded_merges.push_back(merge_line);
+                ensure_token(next, merge_line, false);
+                if (std::find(next.merges.begin(), next.merges.end(), merge_line) == next.merges.end()) {
+                    next.merges.push_back(merge_line);
                 }
             }
         }
     }
 
-    m_ready = true;
+    publish(std::move(next));
     return true;
 }
 
 std::vector<int> BpeTokenizer::encode(std::string_view text) const {
-    std::scoped_lock lock(m_mutex);
-    if (!m_ready) {
+    const auto vocab = snapshot();
+    if (!vocab) {
         return {};
     }
     std::vector<int> result;
+    result.reserve(text.size() / 3 + 1);
     const auto segments = segment_text(text);
     for (const auto& segment : segments) {
         if (segment.empty()) {
             continue;
         }
-        auto pieces = tokenize_segment(segment, false);
-        if (pieces.empty()) {
-            pieces.push_back("<unk>");
-        }
-        for (const auto& piece : pieces) {
-            auto it = m_token_to_id.find(piece);
-            if (it != m_token_to_id.end()) {
-                result.push_back(it->second);
-            } else {
-                result.push_back(UNK_ID);
-            }
+        if (is_whitespace(segment)) {
+            const int id = vocab->trie.find(segment, false);
+            result.push_back(id >= 0 ? id : UNK_ID);
+            continue;
         }
+        wordpiece_ids(*vocab, segment, result);
     }
     return result;
 }
 
 std::string BpeTokenizer::decode(const std::vector<int>& tokens) const {
-    std::scoped_lock lock(m_mutex);
-    if (!m_ready) {
+    const auto vocab = snapshot();
+    if (!vocab) {
         return {};
     }
     std::string result;
@@ -187,10 +338,10 @@ std::string BpeTokenizer::decode(const std::vector<int>& tokens) const {
         if (token == PAD_ID) {
             continue;
         }
-        if (token < 0 || static_cast<std::size_t>(token) >= m_id_to_token.size()) {
+        if (token < 0 || static_cast<std::size_t>(token) >= vocab->id_to_token.size()) {
             continue;
         }
-        const std::string& piece = m_id_to_token[token];
+        const std::string& piece = vocab->id_to_token[token];
         if (piece == "<eos>" || piece == "<pad>") {
             continue;
         }
@@ -223,20 +374,23 @@ std::string BpeTokenizer::decode(const std::vector<int>& tokens) const {
 }
 
 int BpeTokenizer::token_to_id(std::string_view token) const {
-    std::scoped_lock lock(m_mutex);
-    auto it = m_token_to_id.find(std::string(token));
-    if (it == m_token_to_id.end()) {
+    const auto vocab = snapshot();
+    if (!vocab) {
+        return UNK_ID;
+    }
+    auto it = vocab->token_to_id.find(std::string(token));
+    if (it == vocab->token_to_id.end()) {
         return UNK_ID;
     }
     return it->second;
 }
 
 std::string BpeTokenizer::id_to_token(int id) const {
-    std::scoped_lock lock(m_mutex);
-    if (id < 0 || static_cast<std::size_t>(id) >= m_id_to_token.size()) {
+    const auto vocab = snapshot();
+    if (!vocab || id < 0 || static_cast<std::size_t>(id) >= vocab->id_to_token.size()) {
         return "<unk>";
     }
-    return m_id_to_token[id];
+    return vocab->id_to_token[id];
 }
 
 bool BpeTokenizer::is_whitespace(std::string_view token) {
@@ -258,7 +412,11 @@ std::vector<std::string> BpeTokenizer::segment_text(std::string_view text) {
     enum class Mode { None, Whitespace, Word, Punct } mode = Mode::None;
     for (std::size_t i = 0; i < text.size();) {
         bool matched_compound = false;
+        const bool compound_lead = kCompoundLeads.find(text[i]) != std::string_view::npos;
         for (const auto& compound : kCompoundTokens) {
+            if (!compound_lead) {
+                break;
+            }
             if (!compound.empty() && text.size() >= i + compound.size() &&
                 text.substr(i, compound.size()) == compound) {
                 if (!current.empty()) {
@@ -337,135 +495,169 @@ std::vector<std::string> BpeTokenizer::segment_text(std::string_view text) {
     return segments;
 }
 
-std::vector<std::string> BpeTokenizer::wordpiece_tokens(
-    std::string_view token,
-    const std::unordered_map<std::string, int>& vocab,
-    std::vector<std::string>& new_tokens) {
+std::vector<std::string> BpeTokenizer::wordpiece_tokens(const Vocabulary& vocab,
+                                                        std::string_view token,
+                                                        std::vector<std::string>& new_tokens) {
     std::vector<std::string> pieces;
-    if (token.empty()) {
-        return pieces;
-    }
-    const auto graphemes = utf8_graphemes(token);
     std::size_t start = 0;
-    while (start < graphemes.size()) {
-        std::size_t end = graphemes.size();
-        std::optional<std::string> match;
-        while (end > start) {
-            std::string candidate;
-            for (std::size_t i = start; i < end; ++i) {
-                candidate += graphemes[i];
-            }
-            if (start > 0) {
-                candidate.insert(0, "##");
-            }
-            if (vocab.find(candidate) != vocab.end()) {
-                match = std::move(candidate);
-                break;
-            }
-            --end;
-        }
-        if (!match) {
+    while (start < token.size()) {
+        const auto match = vocab.trie.longest_match(token, start, start > 0);
+        if (match.length == 0) {
             // Fallback to single grapheme pieces to guarantee progress
-            for (std::size_t i = start; i < graphemes.size(); ++i) {
-                std::string piece = graphemes[i];
+            for (std::size_t i = start; i < token.size();) {
+                const std::size_t length = grapheme_length(token, i);
+                std::string piece(token.substr(i, length));
                 if (i > start) {
                     piece.insert(0, "##");
                 }
                 new_tokens.push_back(piece);
-                pieces.push_back(piece);
+                pieces.push_back(std::move(piece));
+                i += length;
             }
             break;
         }
-        pieces.push_back(*match);
-        start = end;
+        std::string piece = start > 0 ? "##" : "";
+        piece.append(token.substr(start, match.length));
+        pieces.push_back(std::move(piece));
+        start += match.length;
     }
     return pieces;
 }
 
-void BpeTokenizer::ensure_tokens_for(std::string_view text) {
+// Same segmentation as wordpiece_tokens, emitting ids without building strings.
+void BpeTokenizer::wordpiece_ids(const Vocabulary& vocab, std::string_view token, std::vector<int>& ids) {
+    std::size_t start = 0;
+    while (start < token.size()) {
+        const auto match = vocab.trie.longest_match(token, start, start > 0);
+        if (match.length == 0) {
+            for (std::size_t i = start; i < token.size();) {
+                const std::size_t length = grapheme_length(token, i);
+                const int id = vocab.trie.find(token.substr(i, length), i > start);
+                ids.push_back(id >= 0 ? id : UNK_ID);
+                i += length;
+            }
+            return;
+        }
+        ids.push_back(match.id);
+        start += match.length;
+    }
+}
+
+void BpeTokenizer::rebuild_trie(Vocabulary& vocab) {
+    vocab.trie.clear();
+    for (const auto& [token, id] : vocab.token_to_id) {
+        vocab.trie.insert(token, id);
+    }
+}
+
+// Read-only pass over `text`: true when ensure_tokens_for would add anything.
+// Nothing is added unless some segment is an unknown whitespace run or needs
+// the grapheme fallback, since every other piece came from the vocabulary.
+// Walks the trie like wordpiece_ids, so no piece strings are built.
+bool BpeTokenizer::adds_tokens(const Vocabulary& vocab, std::string_view text) {
+    for (const auto& segment : segment_text(text)) {
+        if (segment.empty()) {
+            continue;
+        }
+        if (is_whitespace(segment)) {
+            if (vocab.token_to_id.find(segment) == vocab.token_to_id.end()) {
+                return true;
+            }
+            continue;
+        }
+        const std::string_view token(segment);
+        std::size_t start = 0;
+        while (start < token.size()) {
+            const auto match = vocab.trie.longest_match(token, start, start > 0);
+            if (match.length == 0) {
+                for (std::size_t i = start; i < token.size();) {
+                    const std::size_t length = grapheme_length(token, i);
+                    if (vocab.trie.find(token.substr(i, length), i > start) < 0) {
+                        return true;
+                    }
+                    i += length;
+                }
+                break;
+            }
+            start += match.length;
+        }
+    }
+    return false;
+}
+
+void BpeTokenizer::ensure_tokens_for(Vocabulary& vocab, std::string_view text) {
     const auto segments = segment_text(text);
     for (const auto& segment : segments) {
-        tokenize_segment(segment, true);
+        tokenize_segment(vocab, segment);
     }
 }
 
-bool BpeTokenizer::ensure_token(const std::string& token, bool record) {
-    if (m_token_to_id.find(token) != m_token_to_id.end()) {
+bool BpeTokenizer::ensure_token(Vocabulary& vocab, const std::string& token, bool record) {
+    if (vocab.token_to_id.find(token) != vocab.token_to_id.end()) {
         return false;
     }
-    const int id = static_cast<int>(m_id_to_token.size());
-    m_token_to_id.emplace(token, id);
-    m_id_to_token.push_back(token);
+    const int id = static_cast<int>(vocab.id_to_token.size());
+    vocab.token_to_id.emplace(token, id);
+    vocab.id_to_token.push_back(token);
+    vocab.trie.insert(token, id);
     if (record) {
-        if (std::find(m_recorded_merges.begin(), m_recorded_merges.end(), token) == m_recorded_merges.end()) {
-            m_recorded_merges.push_back(token);
-        }
+        vocab.merges.push_back(token);
     }
     return true;
 }
 
-std::vector<std::string> BpeTokenizer::tokenize_segment(std::string_view segment, bool ensure_new_tokens) const {
+std::vector<std::string> BpeTokenizer::tokenize_segment(Vocabulary& vocab, std::string_view segment) {
     if (segment.empty()) {
         return {};
     }
     if (is_whitespace(segment)) {
-        if (ensure_new_tokens) {
-            const_cast<BpeTokenizer*>(this)->ensure_token(std::string(segment), false);
-        }
+        ensure_token(vocab, std::string(segment), false);
         return {std::string(segment)};
     }
 
     std::vector<std::string> new_tokens;
-    auto pieces = wordpiece_tokens(segment, m_token_to_id, new_tokens);
-    if (ensure_new_tokens) {
-        for (const auto& token : new_tokens) {
-            const_cast<BpeTokenizer*>(this)->ensure_token(token, true);
-        }
-        for (const auto& piece : pieces) {
-            const_cast<BpeTokenizer*>(this)->ensure_token(piece, false);
-        }
+    auto pieces = wordpiece_tokens(vocab, segment, new_tokens);
+    for (const auto& token : new_tokens) {
+        ensure_token(vocab, token, true);
+    }
+    for (const auto& piece : pieces) {
+        ensure_token(vocab, piece, false);
     }
     if (!pieces.empty()) {
         return pieces;
     }
-    if (ensure_new_tokens) {
-        const_cast<BpeTokenizer*>(this)->ensure_token("<unk>", false);
-    }
+    ensure_token(vocab, "<unk>", false);
     return {"<unk>"};
 }
 
 void BpeTokenizer::save_vocab(const std::filesystem::path& path) const {
-    if (path.empty()) {
-        return;
+    if (const auto vocab = snapshot()) {
+        save_vocab(*vocab, path);
     }
-    std::scoped_lock lock(m_mutex);
-    if (path.has_parent_path()) {
-        std::error_code ec;
-        std::filesystem::create_directories(path.parent_path(), ec);
+}
+
+void BpeTokenizer::save_merges(const std::filesystem::path& path) const {
+    if (const auto vocab = snapshot()) {
+        save_merges(*vocab, path);
     }
-    std::ofstream out(path);
-    if (!out) {
+}
+
+void BpeTokenizer::save_vocab(const Vocabulary& vocab, const std::filesystem::path& path) {
+    if (path.empty()) {
         return;
     }
-    for (const auto& token : m_id_to_token) {
+    std::ofstream out = open_for_save(path);
+    for (const auto& token : vocab.id_to_token) {
         out << token << '\n';
     }
 }
 
-void BpeTokenizer::save_merges(const std::filesystem::path& path) const {
+void BpeTokenizer::save_merges(const Vocabulary& vocab, const std::filesystem::path& path) {
     if (path.empty()) {
         return;
     }
-    std::scoped_lock lock(m_mutex);
-    if (path.has_parent_path()) {
-        std::error_code ec;
-        std::filesystem::create_directories(path.parent_path(), ec);
-    }
-    std::ofstream out(path);
-    if (!out) {
-        return;
-    }
-    for (const auto& merge : m_recorded_merges) {
+    std::ofstream out = open_for_save(path);
+    for (const auto& merge : vocab.merges) {
         out << merge << '\n';
     }
 }
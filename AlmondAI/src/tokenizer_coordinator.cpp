@@ -1,9 +1,11 @@
 #include "../include/almondai/tokenizer_coordinator.hpp"
 
 #include <algorithm>
+#include <functional>
 #include <iomanip>
 #include <sstream>
 #include <system_error>
+#include <vector>
 
 namespace almondai {
 
@@ -16,6 +18,9 @@ TokenizerCoordinator::IngestResult TokenizerCoordinator::ingest_training_pair(
     StudentModel& student,
     std::string_view prompt,
     std::string_view teacher_output) {
+    // A quantized student cannot grow its vocabulary; refuse before the
+    // tokenizers publish tokens it would never have rows for.
+    student.base().require_trainable();
     IngestResult result;
     {
         std::scoped_lock lock(m_mutex);
@@ -26,9 +31,23 @@ TokenizerCoordinator::IngestResult TokenizerCoordinator::ingest_training_pair(
         }
     }
     resize_student_if_needed(student, result);
-    if (result.word_tokens_added > 0 || result.bpe_tokens_added > 0) {
-        persist();
+    return result;
+}
+
+TokenizerCoordinator::IngestResult TokenizerCoordinator::ingest_texts(StudentModel& student,
+                                                                     std::span<const std::string_view> texts,
+                                                                     ThreadPool& pool) {
+    student.base().require_trainable();
+    IngestResult result;
+    {
+        std::scoped_lock lock(m_mutex);
+        result.word_tokens_added = m_word_tokenizer.ingest_texts(texts, pool);
+        result.bpe_tokens_added = m_bpe_tokenizer.ingest_texts(texts, pool);
+        if (result.word_tokens_added > 0 || result.bpe_tokens_added > 0) {
+            m_dirty = true;
+        }
     }
+    resize_student_if_needed(student, result);
     return result;
 }
 
@@ -55,52 +74,105 @@ void TokenizerCoordinator::ensure_parent_directory(const std::filesystem::path&
 }
 
 void TokenizerCoordinator::persist(std::optional<std::size_t> version) const {
+    persist(capture(), version);
+}
+
+TokenizerCoordinator::Snapshot TokenizerCoordinator::capture() const {
     std::scoped_lock lock(m_mutex);
-    if (!m_dirty && !version) {
+    Snapshot snapshot{m_word_tokenizer.snapshot(), m_bpe_tokenizer.snapshot(), m_dirty};
+    m_dirty = false;
+    return snapshot;
+}
+
+void TokenizerCoordinator::persist(const Snapshot& snapshot, std::optional<std::size_t> version) const {
+    if (!snapshot.dirty && !version) {
         return;
     }
-    persist_locked(version);
-    m_dirty = false;
+    PersistenceConfig paths;
+    {
+        std::scoped_lock lock(m_mutex);
+        paths = m_paths;
+    }
+    std::scoped_lock lock(m_persist_mutex);
+    if (snapshot.word) {
+        persist_file(paths.word_vocab, version, [&](const std::filesystem::path& path) {
+            WordTokenizer::save_vocab(*snapshot.word, path.string());
+        });
+    }
+    if (snapshot.bpe) {
+        persist_file(paths.bpe_vocab, version, [&](const std::filesystem::path& path) {
+            BpeTokenizer::save_vocab(*snapshot.bpe, path);
+        });
+        persist_file(paths.bpe_merges, version, [&](const std::filesystem::path& path) {
+            BpeTokenizer::save_merges(*snapshot.bpe, path);
+        });
+    }
 }
 
-void TokenizerCoordinator::persist_locked(std::optional<std::size_t> version) const {
-    if (!m_paths.word_vocab.empty()) {
-        ensure_parent_directory(m_paths.word_vocab);
-        m_word_tokenizer.save_vocab(m_paths.word_vocab.string());
-        if (version) {
-            std::ostringstream name;
-            name << m_paths.word_vocab.stem().string() << ".step" << std::setw(6) << std::setfill('0') << *version
-                 << m_paths.word_vocab.extension().string();
-            std::filesystem::path version_path = m_paths.word_vocab.parent_path() / name.str();
-            std::error_code ec;
-            std::filesystem::copy_file(m_paths.word_vocab, version_path, std::filesystem::copy_options::overwrite_existing, ec);
-        }
+void TokenizerCoordinator::persist_file(const std::filesystem::path& path,
+                                        std::optional<std::size_t> version,
+                                        const std::function<void(const std::filesystem::path&)>& save) {
+    if (path.empty()) {
+        return;
     }
-    if (!m_paths.bpe_vocab.empty()) {
-        ensure_parent_directory(m_paths.bpe_vocab);
-        m_bpe_tokenizer.save_vocab(m_paths.bpe_vocab);
-        if (version) {
-            std::ostringstream name;
-            name << m_paths.bpe_vocab.stem().string() << ".step" << std::setw(6) << std::setfill('0') << *version
-                 << m_paths.bpe_vocab.extension().string();
-            std::filesystem::path version_path = m_paths.bpe_vocab.parent_path() / name.str();
-            std::error_code ec;
-            std::filesystem::copy_file(m_paths.bpe_vocab, version_path, std::filesystem::copy_options::overwrite_existing, ec);
-        }
+    ensure_parent_directory(path);
+    std::filesystem::path temp = path;
+    temp += ".tmp";
+    save(temp);
+    std::error_code ec;
+    if (!std::filesystem::exists(temp, ec)) {
+        return;
+    }
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        return;
+    }
+    if (version) {
+        std::filesystem::copy_file(path, version_path(path, *version),
+                                   std::filesystem::copy_options::overwrite_existing, ec);
+    }
+}
+
+std::filesystem::path TokenizerCoordinator::version_path(const std::filesystem::path& path, std::size_t version) {
+    std::ostringstream name;
+    name << path.stem().string() << ".step" << std::setw(6) << std::setfill('0') << version
+         << path.extension().string();
+    return path.parent_path() / name.str();
+}
+
+void TokenizerCoordinator::prune_versions(std::size_t keep) const {
+    PersistenceConfig paths;
+    {
+        std::scoped_lock lock(m_mutex);
+        paths = m_paths;
     }
-    if (!m_paths.bpe_merges.empty()) {
-        ensure_parent_directory(m_paths.bpe_merges);
-        m_bpe_tokenizer.save_merges(m_paths.bpe_merges);
-        if (version) {
-            std::ostringstream name;
-            name << m_paths.bpe_merges.stem().string() << ".step" << std::setw(6) << std::setfill('0') << *version
-                 << m_paths.bpe_merges.extension().string();
-            std::filesystem::path version_path = m_paths.bpe_merges.parent_path() / name.str();
-            std::error_code ec;
-            std::filesystem::copy_file(m_paths.bpe_merges, version_path, std::filesystem::copy_options::overwrite_existing, ec);
+    std::scoped_lock lock(m_persist_mutex);
+    for (const auto* path : {&paths.word_vocab, &paths.bpe_vocab, &paths.bpe_merges}) {
+        if (path->empty()) {
+            continue;
+        }
+        const std::string prefix = path->stem().string() + ".step";
+        const std::string extension = path->extension().string();
+        const auto directory = path->has_parent_path() ? path->parent_path() : std::filesystem::path(".");
+        std::vector<std::filesystem::path> versions;
+        std::error_code ec;
+        for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+            const std::string name = it->path().filename().string();
+            if (name.size() > prefix.size() + extension.size() && name.starts_with(prefix) &&
+                name.ends_with(extension) && it->path().extension() == extension) {
+                versions.push_back(it->path());
+            }
+        }
+        if (versions.size() <= keep) {
+            continue;
+        }
+        // Zero-padded step numbers sort lexicographically.
+        std::sort(versions.begin(), versions.end());
+        for (std::size_t i = 0; i + keep < versions.size(); ++i) {
+            std::filesystem::remove(versions[i], ec);
         }
     }
 }
 
 } // namespace almondai
-
@@ -1,13 +1,19 @@
 #include "../include/almondai/tokenizer_word.hpp"
 
-#include <locale>
-#include <cctype>
 #include <sstream>
 #include <mutex>
 #include <unordered_set>
 #include <string_view>
 #include <iomanip>
+#include <algorithm>
 #include <array>
+#include <optional>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ALMONDAI_TOKENIZER_SSE2 1
+#include <bit>
+#include <emmintrin.h>
+#endif
 
 namespace almondai {
 
@@ -34,58 +40,91 @@ void append_utf8(char32_t code, std::string& out) {
     }
 }
 
-std::string canonicalise_apostrophes(std::string_view token) {
-    static constexpr std::string_view kCurlyApostrophe{"\xE2\x80\x99", 3};
-    static constexpr std::string_view kCurlyOpenApostrophe{"\xE2\x80\x98", 3};
+constexpr char32_t kBmpSize = 0x10000;
 
-    std::string result;
-    result.reserve(token.size());
-    for (std::size_t i = 0; i < token.size();) {
-        const unsigned char ch = static_cast<unsigned char>(token[i]);
-        if (ch == 0xE2 && i + 2 < token.size()) {
-            const unsigned char next1 = static_cast<unsigned char>(token[i + 1]);
-            const unsigned char next2 = static_cast<unsigned char>(token[i + 2]);
-            if (next1 == 0x80 && (next2 == 0x98 || next2 == 0x99)) {
-                result.push_back('\'');
-                i += 3;
-                continue;
-            }
+// Length of the leading run of ASCII bytes.
+std::size_t ascii_run(const char* data, std::size_t size) {
+    std::size_t i = 0;
+#ifdef ALMONDAI_TOKENIZER_SSE2
+    for (; i + 16 <= size; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(chunk));
+        if (mask != 0) {
+            return i + static_cast<std::size_t>(std::countr_zero(mask));
         }
-        result.push_back(static_cast<char>(ch));
-        ++i;
     }
-    return result;
+#endif
+    for (; i < size; ++i) {
+        if (static_cast<unsigned char>(data[i]) >= 0x80) {
+            return i;
+        }
+    }
+    return size;
+}
+
+// Decodes the code point at `ptr`, returning its length in bytes or 0 for a
+// byte that does not start a complete sequence.
+std::size_t decode_codepoint(const char* ptr, const char* end, char32_t& code) {
+    const unsigned char lead = static_cast<unsigned char>(*ptr);
+    if (lead < 0x80) {
+        code = lead;
+        return 1;
+    }
+    if ((lead >> 5) == 0x6 && ptr + 1 < end) {
+        code = ((lead & 0x1F) << 6) | (static_cast<unsigned char>(ptr[1]) & 0x3F);
+        return 2;
+    }
+    if ((lead >> 4) == 0xE && ptr + 2 < end) {
+        code = ((lead & 0x0F) << 12) | ((static_cast<unsigned char>(ptr[1]) & 0x3F) << 6)
+               | (static_cast<unsigned char>(ptr[2]) & 0x3F);
+        return 3;
+    }
+    if ((lead >> 3) == 0x1E && ptr + 3 < end) {
+        code = ((lead & 0x07) << 18) | ((static_cast<unsigned char>(ptr[1]) & 0x3F) << 12)
+               | ((static_cast<unsigned char>(ptr[2]) & 0x3F) << 6)
+               | (static_cast<unsigned char>(ptr[3]) & 0x3F);
+        return 4;
+    }
+    return 0;
 }
 }
 
 WordTokenizer::WordTokenizer() {
-    ensure_special_tokens();
+    Vocabulary vocab;
+    ensure_special_tokens(vocab);
+    publish(std::move(vocab));
 }
 
 WordTokenizer::WordTokenizer(WordTokenizer&& other) noexcept
-    : m_config(other.m_config),
-      m_token_to_id(std::move(other.m_token_to_id)),
-      m_id_to_token(std::move(other.m_id_to_token)) {
-    ensure_special_tokens();
-}
+    : m_vocab(other.snapshot()) {}
 
 WordTokenizer& WordTokenizer::operator=(WordTokenizer&& other) noexcept {
     if (this != &other) {
-        std::scoped_lock lock(m_mutex, other.m_mutex);
-        m_config = other.m_config;
-        m_token_to_id = std::move(other.m_token_to_id);
-        m_id_to_token = std::move(other.m_id_to_token);
-        ensure_special_tokens();
+        std::scoped_lock lock(m_write_mutex, other.m_write_mutex);
+        m_vocab.store(other.snapshot(), std::memory_order_release);
     }
     return *this;
 }
 
+std::shared_ptr<const WordTokenizer::Vocabulary> WordTokenizer::snapshot() const {
+    return m_vocab.load(std::memory_order_acquire);
+}
+
+void WordTokenizer::publish(Vocabulary vocab) {
+    for (char32_t c = 0; c < vocab.ascii_ids.size(); ++c) {
+        vocab.ascii_ids[c] = codepoint_id(vocab, normalize(vocab.config, c));
+    }
+    m_vocab.store(std::make_shared<const Vocabulary>(std::move(vocab)), std::memory_order_release);
+}
+
 void WordTokenizer::set_config(TokenizerConfig config) {
-    std::scoped_lock lock(m_mutex);
-    m_config = config;
+    std::scoped_lock lock(m_write_mutex);
+    Vocabulary next = *snapshot();
+    next.config = config;
+    publish(std::move(next));
 }
 
-void WordTokenizer::ensure_special_tokens() {
+void WordTokenizer::ensure_special_tokens(Vocabulary& vocab) {
     static constexpr std::array<const char*, 4> kSpecialTokens = {
         kSpecialPad,
         kSpecialBos,
@@ -94,9 +133,9 @@ void WordTokenizer::ensure_special_tokens() {
     };
 
     std::vector<std::string> rebuilt;
-    rebuilt.reserve(m_id_to_token.size() + kSpecialTokens.size());
+    rebuilt.reserve(vocab.id_to_token.size() + kSpecialTokens.size());
     std::unordered_set<std::string> seen;
-    seen.reserve(m_id_to_token.size() + kSpecialTokens.size());
+    seen.reserve(vocab.id_to_token.size() + kSpecialTokens.size());
 
     auto add_token = [&](const std::string& token) {
         if (seen.insert(token).second) {
@@ -108,70 +147,90 @@ void WordTokenizer::ensure_special_tokens() {
         add_token(token);
     }
 
-    for (const auto& token : m_id_to_token) {
+    for (const auto& token : vocab.id_to_token) {
         add_token(token);
     }
 
-    m_id_to_token = std::move(rebuilt);
-    m_token_to_id.clear();
-    for (std::size_t i = 0; i < m_id_to_token.size(); ++i) {
-        m_token_to_id[m_id_to_token[i]] = static_cast<int>(i);
+    vocab.id_to_token = std::move(rebuilt);
+    vocab.token_to_id.clear();
+    for (std::size_t i = 0; i < vocab.id_to_token.size(); ++i) {
+        vocab.token_to_id[vocab.id_to_token[i]] = static_cast<int>(i);
+    }
+    reindex(vocab);
+}
+
+void WordTokenizer::reindex(Vocabulary& vocab) {
+    vocab.bmp_ids.assign(kBmpSize, -1);
+    vocab.astral_ids.clear();
+    for (const auto& [token, id] : vocab.token_to_id) {
+        index_token(vocab, token, id);
     }
 }
 
-std::string WordTokenizer::normalize(const std::string& token) const {
+// Only canonical single code point spellings are indexed; those are the only
+// tokens encode can produce.
+void WordTokenizer::index_token(Vocabulary& vocab, const std::string& token, int id) {
     if (token.empty()) {
-        return token;
+        return;
     }
-    std::string result = canonicalise_apostrophes(token);
-    if (m_config.lowercase) {
-        std::locale loc;
-        for (char& c : result) {
-            c = static_cast<char>(std::tolower(c, loc));
-        }
+    char32_t code = 0;
+    const std::size_t length = decode_codepoint(token.data(), token.data() + token.size(), code);
+    if (length != token.size() || codepoint_to_utf8(code) != token) {
+        return;
+    }
+    if (code < kBmpSize) {
+        vocab.bmp_ids[code] = id;
+    } else {
+        vocab.astral_ids[code] = id;
+    }
+}
+
+int WordTokenizer::codepoint_id(const Vocabulary& vocab, char32_t codepoint) {
+    if (codepoint < kBmpSize) {
+        return codepoint < vocab.bmp_ids.size() ? vocab.bmp_ids[codepoint] : -1;
+    }
+    const auto it = vocab.astral_ids.find(codepoint);
+    return it == vocab.astral_ids.end() ? -1 : it->second;
+}
+
+void WordTokenizer::add_token(Vocabulary& vocab, std::string token) {
+    const int id = static_cast<int>(vocab.id_to_token.size());
+    index_token(vocab, token, id);
+    vocab.token_to_id[token] = id;
+    vocab.id_to_token.push_back(std::move(token));
+}
+
+char32_t WordTokenizer::normalize(const TokenizerConfig& config, char32_t codepoint) {
+    // Curly apostrophes fold to the ASCII one.
+    if (codepoint == 0x2018 || codepoint == 0x2019) {
+        return U'\'';
     }
-    if (m_config.normalize_nfkc) {
+    if (config.lowercase && codepoint >= U'A' && codepoint <= U'Z') {
+        return codepoint + (U'a' - U'A');
+    }
+    if (config.normalize_nfkc) {
         // Placeholder: full NFKC requires a full Unicode implementation.
-        // We return the string unchanged to keep determinism while surfacing the option.
+        // We return the code point unchanged to keep determinism while surfacing the option.
     }
-    return result;
+    return codepoint;
 }
 
-void WordTokenizer::consume_text(std::string_view text, std::unordered_set<std::string>& newly_added) {
+void WordTokenizer::consume_text(const Vocabulary& vocab,
+                                 std::string_view text,
+                                 std::unordered_set<char32_t>& newly_added,
+                                 std::vector<std::string>& pending) {
     const char* ptr = text.data();
     const char* end = text.data() + text.size();
     while (ptr < end) {
         char32_t code = 0;
-        unsigned char lead = static_cast<unsigned char>(*ptr);
-        std::size_t length = 0;
-        if (lead < 0x80) {
-            code = lead;
-            length = 1;
-        } else if ((lead >> 5) == 0x6 && ptr + 1 < end) {
-            code = ((lead & 0x1F) << 6) | (static_cast<unsigned char>(ptr[1]) & 0x3F);
-            length = 2;
-        } else if ((lead >> 4) == 0xE && ptr + 2 < end) {
-            code = ((lead & 0x0F) << 12) | ((static_cast<unsigned char>(ptr[1]) & 0x3F) << 6)
-                   | (static_cast<unsigned char>(ptr[2]) & 0x3F);
-            length = 3;
-        } else if ((lead >> 3) == 0x1E && ptr + 3 < end) {
-            code = ((lead & 0x07) << 18) | ((static_cast<unsigned char>(ptr[1]) & 0x3F) << 12)
-                   | ((static_cast<unsigned char>(ptr[2]) & 0x3F) << 6)
-                   | (static_cast<unsigned char>(ptr[3]) & 0x3F);
-            length = 4;
-        } else {
+        const std::size_t length = decode_codepoint(ptr, end, code);
+        if (length == 0) {
             ++ptr;
             continue;
         }
-
-        std::string token = codepoint_to_utf8(code);
-        token = normalize(token);
-        if (!token.empty() && m_token_to_id.find(token) == m_token_to_id.end()) {
-            if (newly_added.insert(token).second) {
-                int id = static_cast<int>(m_id_to_token.size());
-                m_token_to_id[token] = id;
-                m_id_to_token.push_back(token);
-            }
+        const char32_t normalized = normalize(vocab.config, code);
+        if (codepoint_id(vocab, normalized) < 0 && newly_added.insert(normalized).second) {
+            pending.push_back(codepoint_to_utf8(normalized));
         }
         ptr += length;
     }
@@ -184,76 +243,123 @@ std::string WordTokenizer::codepoint_to_utf8(char32_t codepoint) {
 }
 
 void WordTokenizer::build_vocab(const std::vector<std::string>& documents) {
-    std::scoped_lock lock(m_mutex);
-    ensure_special_tokens();
-    std::unordered_set<std::string> newly_added;
+    std::scoped_lock lock(m_write_mutex);
+    Vocabulary next = *snapshot();
+    ensure_special_tokens(next);
+    std::unordered_set<char32_t> newly_added;
+    std::vector<std::string> pending;
     for (const auto& doc : documents) {
-        consume_text(doc, newly_added);
+        consume_text(next, doc, newly_added, pending);
+    }
+    for (auto& token : pending) {
+        add_token(next, std::move(token));
     }
+    publish(std::move(next));
 }
 
 std::size_t WordTokenizer::ingest_training_pair(std::string_view prompt, std::string_view teacher_output) {
-    std::scoped_lock lock(m_mutex);
-    ensure_special_tokens();
-    std::unordered_set<std::string> newly_added;
-    consume_text(prompt, newly_added);
-    consume_text(teacher_output, newly_added);
+    std::scoped_lock lock(m_write_mutex);
+    const auto current = snapshot();
+    std::unordered_set<char32_t> newly_added;
+    std::vector<std::string> pending;
+    consume_text(*current, prompt, newly_added, pending);
+    consume_text(*current, teacher_output, newly_added, pending);
+    if (pending.empty()) {
+        return 0;
+    }
+    Vocabulary next = *current;
+    for (auto& token : pending) {
+        add_token(next, std::move(token));
+    }
+    publish(std::move(next));
     return newly_added.size();
 }
 
+std::size_t WordTokenizer::ingest_texts(std::span<const std::string_view> texts, ThreadPool& pool) {
+    std::scoped_lock lock(m_write_mutex);
+    const auto current = snapshot();
+    // Windows of texts are scanned in parallel against the vocabulary as it
+    // stands when the window starts. Each shard lists its unknown tokens in
+    // order; concatenating the lists and keeping first occurrences reproduces
+    // the serial order.
+    std::optional<Vocabulary> next;
+    std::size_t added = 0;
+    const std::size_t window = pool.size() * 1024;
+    const std::size_t shards = pool.size() * 4;
+    std::vector<std::vector<std::string>> pending(shards);
+    for (std::size_t begin = 0; begin < texts.size(); begin += window) {
+        const std::size_t count = std::min(window, texts.size() - begin);
+        const Vocabulary& vocab = next ? *next : *current;
+        pool.parallel_for(shards, [&](std::size_t shard) {
+            std::unordered_set<char32_t> newly_added;
+            pending[shard].clear();
+            const std::size_t last = begin + count * (shard + 1) / shards;
+            for (std::size_t i = begin + count * shard / shards; i < last; ++i) {
+                consume_text(vocab, texts[i], newly_added, pending[shard]);
+            }
+        });
+        for (auto& tokens : pending) {
+            for (auto& token : tokens) {
+                if (!next) {
+                    next.emplace(*current);
+                }
+                if (next->token_to_id.find(token) == next->token_to_id.end()) {
+                    add_token(*next, std::move(token));
+                    ++added;
+                }
+            }
+        }
+    }
+    if (next) {
+        publish(std::move(*next));
+    }
+    return added;
+}
+
 std::vector<int> WordTokenizer::encode(const std::string& text) const {
+    const auto vocab = snapshot();
     std::vector<int> tokens;
-    tokens.reserve(text.size() / 4);
-    const auto it = m_token_to_id.find(kSpecialBos);
-    if (it != m_token_to_id.end()) {
+    // At most one token per byte, plus <bos> and <eos>.
+    tokens.reserve(text.size() + 2);
+    const auto it = vocab->token_to_id.find(kSpecialBos);
+    if (it != vocab->token_to_id.end()) {
         tokens.push_back(it->second);
     }
+    const int unk_id = vocab->token_to_id.at(kSpecialUnk);
     const char* ptr = text.data();
     const char* end = text.data() + text.size();
     while (ptr < end) {
+        const std::size_t run = ascii_run(ptr, static_cast<std::size_t>(end - ptr));
+        for (const char* stop = ptr + run; ptr < stop; ++ptr) {
+            const int id = vocab->ascii_ids[static_cast<unsigned char>(*ptr)];
+            tokens.push_back(id >= 0 ? id : unk_id);
+        }
+        if (ptr == end) {
+            break;
+        }
         char32_t code = 0;
-        unsigned char lead = static_cast<unsigned char>(*ptr);
-        std::size_t length = 0;
-        if (lead < 0x80) {
-            code = lead;
-            length = 1;
-        } else if ((lead >> 5) == 0x6 && ptr + 1 < end) {
-            code = ((lead & 0x1F) << 6) | (static_cast<unsigned char>(ptr[1]) & 0x3F);
-            length = 2;
-        } else if ((lead >> 4) == 0xE && ptr + 2 < end) {
-            code = ((lead & 0x0F) << 12) | ((static_cast<unsigned char>(ptr[1]) & 0x3F) << 6)
-                   | (static_cast<unsigned char>(ptr[2]) & 0x3F);
-            length = 3;
-        } else if ((lead >> 3) == 0x1E && ptr + 3 < end) {
-            code = ((lead & 0x07) << 18) | ((static_cast<unsigned char>(ptr[1]) & 0x3F) << 12)
-                   | ((static_cast<unsigned char>(ptr[2]) & 0x3F) << 6)
-                   | (static_cast<unsigned char>(ptr[3]) & 0x3F);
-            length = 4;
-        } else {
+        const std::size_t length = decode_codepoint(ptr, end, code);
+        if (length == 0) {
             ++ptr;
             continue;
         }
-        std::string token = normalize(codepoint_to_utf8(code));
-        auto token_it = m_token_to_id.find(token);
-        if (token_it == m_token_to_id.end()) {
-            tokens.push_back(m_token_to_id.at(kSpecialUnk));
-        } else {
-            tokens.push_back(token_it->second);
-        }
+        const int id = codepoint_id(*vocab, normalize(vocab->config, code));
+        tokens.push_back(id >= 0 ? id : unk_id);
         ptr += length;
     }
-    tokens.push_back(m_token_to_id.at(kSpecialEos));
+    tokens.push_back(vocab->token_to_id.at(kSpecialEos));
     return tokens;
 }
 
 std::string WordTokenizer::decode(const std::vector<int>& tokens) const {
+    const auto vocab = snapshot();
     std::string result;
     result.reserve(tokens.size());
     for (int token : tokens) {
-        if (token < 0 || static_cast<std::size_t>(token) >= m_id_to_token.size()) {
+        if (token < 0 || static_cast<std::size_t>(token) >= vocab->id_to_token.size()) {
             continue;
         }
-        const std::string& word = m_id_to_token[token];
+        const std::string& word = vocab->id_to_token[token];
         if (word == kSpecialBos || word == kSpecialEos || word == kSpecialPad) {
             continue;
         }
@@ -266,18 +372,21 @@ std::string WordTokenizer::decode(const std::vector<int>& tokens) const {
 }
 
 int WordTokenizer::token_id(const std::string& token) const {
-    std::scoped_lock lock(m_mutex);
-    auto it = m_token_to_id.find(token);
-    if (it == m_token_to_id.end()) {
+    const auto vocab = snapshot();
+    auto it = vocab->token_to_id.find(token);
+    if (it == vocab->token_to_id.end()) {
         return -1;
     }
     return it->second;
 }
 
 void WordTokenizer::save_vocab(const std::string& path) const {
-    std::scoped_lock lock(m_mutex);
+    save_vocab(*snapshot(), path);
+}
+
+void WordTokenizer::save_vocab(const Vocabulary& vocab, const std::string& path) {
     std::ofstream file(path, std::ios::trunc);
-    for (const auto& token : m_id_to_token) {
+    for (const auto& token : vocab.id_to_token) {
         file << std::quoted(token) << '\n';
     }
 }
@@ -287,9 +396,9 @@ void WordTokenizer::load_vocab(const std::string& path) {
     if (!file) {
         return;
     }
-    std::scoped_lock lock(m_mutex);
-    m_token_to_id.clear();
-    m_id_to_token.clear();
+    std::scoped_lock lock(m_write_mutex);
+    Vocabulary next;
+    next.config = snapshot()->config;
     std::string line;
     int index = 0;
     while (std::getline(file, line)) {
@@ -305,16 +414,15 @@ void WordTokenizer::load_vocab(const std::string& path) {
         } else {
             token = line;
         }
-        m_token_to_id[token] = index++;
-        m_id_to_token.push_back(token);
+        next.token_to_id[token] = index++;
+        next.id_to_token.push_back(token);
     }
-    ensure_special_tokens();
+    ensure_special_tokens(next);
+    publish(std::move(next));
 }
 
 std::size_t WordTokenizer::vocab_size() const {
-    std::scoped_lock lock(m_mutex);
-    return m_id_to_token.size();
+    return snapshot()->id_to_token.size();
 }
 
 } // namespace almondai
-
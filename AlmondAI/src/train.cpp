@@ -1,8 +1,12 @@
 #include "../include/almondai/train.hpp"
 
+#include "../include/almondai/jsonl_index.hpp"
+#include "../include/almondai/kernels.hpp"
+
 #include <algorithm>
 #include <atomic>
 #include <iomanip>
+#include <iterator>
 #include <filesystem>
 #include <sstream>
 #include <functional>
@@ -28,6 +32,7 @@ const std::filesystem::path kVocabPath{"data/vocab.txt"};
 const std::filesystem::path kBpeVocabPath{"data/bpe_vocab.txt"};
 const std::filesystem::path kBpeMergesPath{"data/bpe_merges.txt"};
 const std::filesystem::path kWeightsPath{"data/student_weights.json"};
+const std::filesystem::path kBinaryWeightsPath{"data/student_weights.bin"};
 const std::filesystem::path kSeedTextPath{"data/seed.txt"};
 const std::filesystem::path kRetrievalMetadataPath{"data/retrieval_index.json"};
 
@@ -318,7 +323,27 @@ std::vector<SeedSpec> bootstrap_curriculum_for_profile(const std::string& profil
     };
 }
 
-std::optional<CuratedSample> parse_sample_line(const std::string& line) {
+// Persisted samples are parsed in chunks of about this size and indexed for
+// retrieval in blocks of at most this many documents.
+constexpr std::size_t kLoadChunkBytes = std::size_t{1} << 20;
+constexpr std::size_t kLoadIndexBlock = 16384;
+
+// Splits `text` into pieces of roughly `target` bytes that end on a line break.
+std::vector<std::string_view> split_lines(std::string_view text, std::size_t target) {
+    std::vector<std::string_view> chunks;
+    while (!text.empty()) {
+        std::size_t end = text.size();
+        if (target < text.size()) {
+            const std::size_t newline = text.find('\n', target);
+            end = newline == std::string_view::npos ? text.size() : newline + 1;
+        }
+        chunks.push_back(text.substr(0, end));
+        text.remove_prefix(end);
+    }
+    return chunks;
+}
+
+std::optional<CuratedSample> parse_sample_line(std::string_view line) {
     if (line.empty()) {
         return std::nullopt;
     }
@@ -362,6 +387,107 @@ std::optional<CuratedSample> parse_sample_line(const std::string& line) {
     }
 }
 
+// Soft-target cross entropy against the teacher's token histogram.
+struct DistillationGradient {
+    std::unordered_map<int, double> token_counts;
+    std::vector<double> probabilities;
+    std::vector<double> grad_logits;
+    double loss = 0.0;
+};
+
+DistillationGradient distillation_gradient(const std::vector<double>& logits, const std::vector<int>& teacher_tokens) {
+    DistillationGradient result;
+    auto& token_counts = result.token_counts;
+    for (int token : teacher_tokens) {
+        if (token < 0) {
+            continue;
+        }
+        const std::size_t index = static_cast<std::size_t>(token);
+        if (index >= logits.size()) {
+            continue;
+        }
+        token_counts[token] += 1.0;
+    }
+    if (token_counts.empty() && !logits.empty()) {
+        token_counts[0] = 1.0;
+    }
+
+    const double total = std::accumulate(token_counts.begin(), token_counts.end(), 0.0,
+                                         [](double sum, const auto& entry) {
+                                             return sum + entry.second;
+                                         });
+    std::vector<double> target_distribution(logits.size(), 0.0);
+    for (const auto& [token, count] : token_counts) {
+        const std::size_t index = static_cast<std::size_t>(token);
+        target_distribution[index] = count / (total > 0.0 ? total : 1.0);
+    }
+
+    auto& probabilities = result.probabilities;
+    probabilities.assign(logits.size(), 0.0);
+    double normaliser = 0.0;
+    double max_logit = logits.empty() ? 0.0 : *std::max_element(logits.begin(), logits.end());
+    for (std::size_t i = 0; i < logits.size(); ++i) {
+        const double value = std::exp(logits[i] - max_logit);
+        probabilities[i] = value;
+        normaliser += value;
+    }
+    if (normaliser > 0.0) {
+        for (double& probability : probabilities) {
+            probability /= normaliser;
+        }
+    } else if (!probabilities.empty()) {
+        const double uniform = 1.0 / static_cast<double>(probabilities.size());
+        std::fill(probabilities.begin(), probabilities.end(), uniform);
+    }
+
+    constexpr double kEpsilon = 1e-12;
+    result.grad_logits.assign(logits.size(), 0.0);
+    for (std::size_t i = 0; i < logits.size(); ++i) {
+        result.grad_logits[i] = probabilities[i] - target_distribution[i];
+        if (target_distribution[i] > 0.0) {
+            result.loss -= target_distribution[i] * std::log(std::max(probabilities[i], kEpsilon));
+        }
+    }
+    return result;
+}
+
+// Opening trace event of a training step, with the sample's provenance.
+JsonObject step_begin_event(std::size_t step, const CuratedSample& sample) {
+    JsonObject event;
+    event["tag"] = Json("learn::step.begin");
+    event["step"] = Json(static_cast<double>(step));
+    if (sample.provenance.is_object()) {
+        const auto& prov = sample.provenance.as_object();
+        if (auto it = prov.find("prompt_hash"); it != prov.end()) {
+            event["prompt_hash"] = it->second;
+        }
+        if (auto it = prov.find("sample_hash"); it != prov.end()) {
+            event["sample_hash"] = it->second;
+        }
+        if (auto it = prov.find("source"); it != prov.end()) {
+            event["teacher_source"] = it->second;
+        }
+    }
+    return event;
+}
+
+struct Prediction {
+    int token = -1;
+    // 1 when the teacher output contains the predicted token.
+    double accuracy = 0.0;
+};
+
+Prediction predict(const DistillationGradient& distilled) {
+    Prediction prediction;
+    const auto& probabilities = distilled.probabilities;
+    auto max_it = std::max_element(probabilities.begin(), probabilities.end());
+    if (max_it != probabilities.end()) {
+        prediction.token = static_cast<int>(std::distance(probabilities.begin(), max_it));
+        prediction.accuracy = distilled.token_counts.count(prediction.token) ? 1.0 : 0.0;
+    }
+    return prediction;
+}
+
 std::mt19937 make_training_rng() {
     static std::atomic<std::uint64_t> counter{0};
     const auto now = std::chrono::high_resolution_clock::now().time_since_epoch().count();
@@ -602,7 +728,8 @@ ContinuousLearner::ContinuousLearner(StudentModel student,
       m_retrieval(m_tokenizer),
       m_evaluator(m_tokenizer),
       m_governor(std::move(governor)),
-      m_load_status_callback(std::move(load_callback)) {
+      m_load_status_callback(std::move(load_callback)),
+      m_checkpoints({kWeightsPath, kBinaryWeightsPath, &tokenizers}) {
     m_tokenizers->set_persistence({kVocabPath, kBpeVocabPath, kBpeMergesPath});
     m_tokenizers->sync_student_vocab(m_student);
     m_log_file.open("data/training_log.txt", std::ios::app);
@@ -613,11 +740,18 @@ ContinuousLearner::ContinuousLearner(StudentModel student,
     load_persistent_data();
 }
 
+ContinuousLearner::~ContinuousLearner() {
+    if (m_checkpoints.status().dirty) {
+        flush_checkpoint();
+    }
+}
+
 std::optional<CuratedSample> ContinuousLearner::ingest(const std::string& prompt,
                                                        const std::string& teacher_output,
                                                        Json constraints,
                                                        const std::string& prompt_hash,
                                                        const std::string& teacher_source) {
+    m_student.base().require_trainable();
     auto curated = m_curator.curate(prompt, teacher_output, std::move(constraints), prompt_hash, teacher_source);
     if (!curated) {
         return std::nullopt;
@@ -680,26 +814,12 @@ std::optional<CuratedSample> ContinuousLearner::ingest(const std::string& prompt
 }
 
 TrainingStats ContinuousLearner::train_step(const CuratedSample& sample) {
+    m_student.base().require_trainable();
     ++m_step;
     TrainingStats stats;
     stats.step = m_step;
     stats.learning_tags.emplace_back("learn::step.begin");
-    JsonObject begin_event;
-    begin_event["tag"] = Json("learn::step.begin");
-    begin_event["step"] = Json(static_cast<double>(stats.step));
-    if (sample.provenance.is_object()) {
-        const auto& prov = sample.provenance.as_object();
-        if (auto it = prov.find("prompt_hash"); it != prov.end()) {
-            begin_event["prompt_hash"] = it->second;
-        }
-        if (auto it = prov.find("sample_hash"); it != prov.end()) {
-            begin_event["sample_hash"] = it->second;
-        }
-        if (auto it = prov.find("source"); it != prov.end()) {
-            begin_event["teacher_source"] = it->second;
-        }
-    }
-    stats.learning_trace.emplace_back(Json(begin_event));
+    stats.learning_trace.emplace_back(Json(step_begin_event(stats.step, sample)));
 
     auto tokens = m_tokenizer.encode(sample.prompt);
     stats.learning_tags.emplace_back("learn::tokenize.prompt");
@@ -707,7 +827,7 @@ TrainingStats ContinuousLearner::train_step(const CuratedSample& sample) {
     prompt_event["tag"] = Json("learn::tokenize.prompt");
     prompt_event["tokens"] = Json(static_cast<double>(tokens.size()));
     prompt_event["characters"] = Json(static_cast<double>(sample.prompt.size()));
-    prompt_event["vocab_size"] = Json(static_cast<double>(m_tokenizer.vocab().size()));
+    prompt_event["vocab_size"] = Json(static_cast<double>(m_tokenizer.vocab_size()));
     stats.learning_trace.emplace_back(Json(prompt_event));
     auto forward = m_student.forward(tokens);
     const auto& logits = forward.logits;
@@ -727,57 +847,9 @@ TrainingStats ContinuousLearner::train_step(const CuratedSample& sample) {
     teacher_event["tokens"] = Json(static_cast<double>(teacher_tokens.size()));
     teacher_event["characters"] = Json(static_cast<double>(sample.teacher_output.size()));
     stats.learning_trace.emplace_back(Json(teacher_event));
-    std::unordered_map<int, double> token_counts;
-    for (int token : teacher_tokens) {
-        if (token < 0) {
-            continue;
-        }
-        const std::size_t index = static_cast<std::size_t>(token);
-        if (index >= logits.size()) {
-            continue;
-        }
-        token_counts[token] += 1.0;
-    }
-    if (token_counts.empty() && !logits.empty()) {
-        token_counts[0] = 1.0;
-    }
-
-    const double total = std::accumulate(token_counts.begin(), token_counts.end(), 0.0,
-                                         [](double sum, const auto& entry) {
-                                             return sum + entry.second;
-                                         });
-    std::vector<double> target_distribution(logits.size(), 0.0);
-    for (const auto& [token, count] : token_counts) {
-        const std::size_t index = static_cast<std::size_t>(token);
-        target_distribution[index] = count / (total > 0.0 ? total : 1.0);
-    }
-
-    std::vector<double> probabilities(logits.size(), 0.0);
-    double normaliser = 0.0;
-    double max_logit = logits.empty() ? 0.0 : *std::max_element(logits.begin(), logits.end());
-    for (std::size_t i = 0; i < logits.size(); ++i) {
-        const double value = std::exp(logits[i] - max_logit);
-        probabilities[i] = value;
-        normaliser += value;
-    }
-    if (normaliser > 0.0) {
-        for (double& probability : probabilities) {
-            probability /= normaliser;
-        }
-    } else if (!probabilities.empty()) {
-        const double uniform = 1.0 / static_cast<double>(probabilities.size());
-        std::fill(probabilities.begin(), probabilities.end(), uniform);
-    }
-
-    constexpr double kEpsilon = 1e-12;
-    std::vector<double> grad_logits(logits.size(), 0.0);
-    double loss = 0.0;
-    for (std::size_t i = 0; i < logits.size(); ++i) {
-        grad_logits[i] = probabilities[i] - target_distribution[i];
-        if (target_distribution[i] > 0.0) {
-            loss -= target_distribution[i] * std::log(std::max(probabilities[i], kEpsilon));
-        }
-    }
+    auto distilled = distillation_gradient(logits, teacher_tokens);
+    const auto& grad_logits = distilled.grad_logits;
+    const double loss = distilled.loss;
 
     std::vector<double> grad_hidden(hidden.size(), 0.0);
     if (!grad_logits.empty()) {
@@ -801,27 +873,16 @@ TrainingStats ContinuousLearner::train_step(const CuratedSample& sample) {
         stats.learning_trace.emplace_back(Json(adapter_event));
     }
 
-    auto max_it = std::max_element(probabilities.begin(), probabilities.end());
+    const Prediction prediction = predict(distilled);
     std::vector<int> decoded;
-    if (max_it != probabilities.end()) {
-        decoded.push_back(static_cast<int>(std::distance(probabilities.begin(), max_it)));
+    if (prediction.token >= 0) {
+        decoded.push_back(prediction.token);
     }
     std::string student_output = m_tokenizer.decode(decoded);
     m_curator.record_student_response(sample.prompt, student_output, sample);
 
-    std::unordered_set<int> teacher_vocab;
-    for (const auto& [token, _] : token_counts) {
-        (void)_;
-        teacher_vocab.insert(token);
-    }
-
     stats.loss = loss;
-    if (max_it != probabilities.end()) {
-        const int prediction = static_cast<int>(std::distance(probabilities.begin(), max_it));
-        stats.accuracy = teacher_vocab.count(prediction) ? 1.0 : 0.0;
-    } else {
-        stats.accuracy = 0.0;
-    }
+    stats.accuracy = prediction.accuracy;
     stats.retrieval_hit_rate = m_retrieval.hit_rate();
     if (sample.provenance.is_object()) {
         const auto& prov = sample.provenance.as_object();
@@ -879,26 +940,36 @@ TrainingStats ContinuousLearner::evaluate_canary() {
 void ContinuousLearner::fit(const std::string& path,
                             int epochs,
                             int batch,
-                            std::function<void(int, double, double, double)> on_batch) {
+                            std::function<void(int, double, double, double)> on_batch,
+                            FitStepGuard guard) {
+    m_student.base().require_trainable();
     const int safe_epochs = std::max(1, epochs);
     const int safe_batch = std::max(1, batch);
 
+    const auto step = [&](const std::function<void()>& body) {
+        if (guard) {
+            guard(body);
+        } else {
+            body();
+        }
+    };
+
     std::vector<CuratedSample> dataset = m_training_data;
 
     if (!path.empty()) {
-        std::ifstream file(path);
-        if (file) {
-            std::string line;
-            while (std::getline(file, line)) {
-                if (auto sample = parse_sample_line(line)) {
+        // Any file a client names: index it privately rather than leave a
+        // sidecar and a shared mapping behind.
+        JsonlIndex(path, false).for_each([&](std::size_t, std::string_view line) {
+            if (auto sample = parse_sample_line(line)) {
+                step([&] {
                     const auto added = m_tokenizers->ingest_training_pair(m_student, sample->prompt, sample->teacher_output);
                     if (added.word_tokens_added > 0 || added.bpe_tokens_added > 0) {
                         persist_state();
                     }
-                    dataset.push_back(*sample);
-                }
+                });
+                dataset.push_back(*sample);
             }
-        }
+        });
     }
 
     if (dataset.empty()) {
@@ -917,13 +988,22 @@ void ContinuousLearner::fit(const std::string& path,
             if (end <= offset) {
                 continue;
             }
+            const double schedule = 0.5 + 0.5 * (1.0 - (static_cast<double>(global_step) / static_cast<double>(safe_epochs * steps_per_epoch)));
+            const double current_lr = base_lr * schedule;
             const auto batch_start_time = std::chrono::steady_clock::now();
             double loss_sum = 0.0;
             std::size_t token_count = 0;
-            for (std::size_t i = offset; i < end; ++i) {
-                token_count += m_tokenizer.encode(dataset[i].prompt).size();
-                TrainingStats stats = train_step(dataset[i]);
-                loss_sum += stats.loss;
+            if (m_fit_pool) {
+                step([&] {
+                    loss_sum = train_batch_parallel(std::span<const CuratedSample>(dataset).subspan(offset, end - offset),
+                                                    current_lr,
+                                                    token_count);
+                });
+            } else {
+                for (std::size_t i = offset; i < end; ++i) {
+                    token_count += m_tokenizer.encode(dataset[i].prompt).size();
+                    step([&] { loss_sum += train_step(dataset[i]).loss; });
+                }
             }
             const auto batch_end_time = std::chrono::steady_clock::now();
             const std::chrono::duration<double> elapsed = batch_end_time - batch_start_time;
@@ -934,14 +1014,139 @@ void ContinuousLearner::fit(const std::string& path,
             ++global_step;
             if (on_batch) {
                 const double average_loss = loss_sum / static_cast<double>(end - offset);
-                const double schedule = 0.5 + 0.5 * (1.0 - (static_cast<double>(global_step - 1) / static_cast<double>(safe_epochs * steps_per_epoch)));
-                const double current_lr = base_lr * schedule;
                 on_batch(global_step, average_loss, current_lr, tokens_per_second);
             }
         }
     }
 }
 
+const std::filesystem::path& ContinuousLearner::training_data_path() {
+    return kTrainingDataPath;
+}
+
+void ContinuousLearner::set_fit_threads(std::size_t threads) {
+    m_fit_threads = threads;
+    if (threads == 0) {
+        m_fit_optimizer.set_thread_pool(nullptr);
+        m_fit_pool.reset();
+        m_fit_gradients.clear();
+    } else if (!m_fit_pool || m_fit_pool->size() != threads) {
+        m_fit_optimizer.set_thread_pool(nullptr);
+        m_fit_pool = std::make_unique<ThreadPool>(threads);
+        m_fit_optimizer.set_thread_pool(m_fit_pool.get());
+    }
+}
+
+double ContinuousLearner::train_batch_parallel(std::span<const CuratedSample> batch,
+                                               double learning_rate,
+                                               std::size_t& prompt_tokens) {
+    // Tokenize up front on this thread; the workers only touch immutable state.
+    std::vector<std::vector<int>> prompts;
+    std::vector<std::vector<int>> teachers;
+    prompts.reserve(batch.size());
+    teachers.reserve(batch.size());
+    for (const auto& sample : batch) {
+        prompts.push_back(m_tokenizer.encode(sample.prompt));
+        teachers.push_back(m_tokenizer.encode(sample.teacher_output));
+        prompt_tokens += prompts.back().size();
+    }
+
+    const auto& config = m_student.base().config();
+    const std::size_t vocab = config.vocab_size;
+    const std::size_t hidden_size = config.hidden_size;
+    const std::size_t gradient_size = vocab * hidden_size;
+
+    // Per-sample results that touch shared state are applied after the reduce.
+    std::vector<double> sample_loss(batch.size(), 0.0);
+    std::vector<Prediction> predictions(batch.size());
+    std::vector<std::vector<double>> adapter_inputs(batch.size());
+    std::vector<std::vector<double>> hidden_gradients(batch.size());
+    const BaseDecoder& base = m_student.base();
+
+    auto& gradient = sharded_sum(*m_fit_pool, batch.size(), gradient_size, m_fit_gradients,
+                                 [&](std::size_t i, std::vector<double>& sum) {
+        auto forward = m_student.forward(prompts[i]);
+        auto distilled = distillation_gradient(forward.logits, teachers[i]);
+        sample_loss[i] = distilled.loss;
+        predictions[i] = predict(distilled);
+        if (forward.hidden.size() != hidden_size || distilled.grad_logits.size() != vocab) {
+            return;
+        }
+        auto& grad_hidden = hidden_gradients[i];
+        grad_hidden.resize(hidden_size);
+        base.visit_weights([&](const auto& weights) {
+            const auto* projection = weights.back().data();
+            for (std::size_t h = 0; h < hidden_size; ++h) {
+                grad_hidden[h] = kernels::dot(projection + h * vocab, distilled.grad_logits.data(), vocab);
+                kernels::axpy(forward.hidden[h], distilled.grad_logits.data(), sum.data() + h * vocab, vocab);
+            }
+        });
+        adapter_inputs[i] = std::move(forward.pre_adapter_hidden);
+    });
+    const double inv_batch = 1.0 / static_cast<double>(batch.size());
+    for (double& value : gradient) {
+        value *= inv_batch;
+    }
+    auto params = m_fit_optimizer.params();
+    params.learning_rate = learning_rate;
+    m_fit_optimizer.set_params(params);
+    m_student.base().visit_weights([&](auto& weights) { m_fit_optimizer.step(weights.back().vector(), gradient); });
+
+    if (Adapter* active = m_adapters.active_adapter()) {
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (hidden_gradients[i].empty()) {
+                continue;
+            }
+            active->apply_gradient(adapter_inputs[i], hidden_gradients[i]);
+            active->update_statistics(adapter_inputs[i]);
+        }
+    }
+
+    TrainingStats stats;
+    double accuracy_sum = 0.0;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        const auto& sample = batch[i];
+        const Prediction& prediction = predictions[i];
+        std::vector<int> decoded;
+        if (prediction.token >= 0) {
+            decoded.push_back(prediction.token);
+        }
+        m_curator.record_student_response(sample.prompt, m_tokenizer.decode(decoded), sample);
+        accuracy_sum += prediction.accuracy;
+
+        stats.learning_trace.emplace_back(Json(step_begin_event(m_step + i + 1, sample)));
+        JsonObject sample_event;
+        sample_event["tag"] = Json("learn::fit.sample");
+        sample_event["prompt_tokens"] = Json(static_cast<double>(prompts[i].size()));
+        sample_event["teacher_tokens"] = Json(static_cast<double>(teachers[i].size()));
+        sample_event["loss"] = Json(sample_loss[i]);
+        sample_event["accuracy"] = Json(prediction.accuracy);
+        stats.learning_trace.emplace_back(Json(sample_event));
+    }
+
+    m_step += batch.size();
+    stats.step = m_step;
+    stats.loss = std::accumulate(sample_loss.begin(), sample_loss.end(), 0.0);
+    stats.accuracy = accuracy_sum / static_cast<double>(batch.size());
+    if (const Adapter* adapter = m_adapters.active_adapter()) {
+        stats.adapter_norm = adapter->norm();
+    }
+    stats.retrieval_hit_rate = m_retrieval.hit_rate();
+    stats.teacher_source = "fit";
+    stats.learning_tags.emplace_back("learn::fit.data_parallel");
+    JsonObject summary_event;
+    summary_event["tag"] = Json("learn::summary");
+    summary_event["samples"] = Json(static_cast<double>(batch.size()));
+    summary_event["loss"] = Json(stats.loss);
+    summary_event["accuracy"] = Json(stats.accuracy);
+    summary_event["learning_rate"] = Json(learning_rate);
+    summary_event["retrieval_hit_rate"] = Json(stats.retrieval_hit_rate);
+    stats.learning_trace.emplace_back(Json(summary_event));
+    log_stats(stats);
+    persist_state(m_step);
+    return stats.loss;
+}
+
 void ContinuousLearner::promote_adapter(const std::string& name) {
     m_adapters.activate(name);
     if (const Adapter* adapter = m_adapters.active_adapter()) {
@@ -989,6 +1194,16 @@ void ContinuousLearner::load_persistent_data() {
     report_load_status("initializing", "Ensuring data directories exist");
     fs::create_directories(kTrainingDataPath.parent_path(), ec);
 
+    if (const auto requested = read_env("ALMONDAI_PRECISION")) {
+        const auto precision = parse_precision(*requested);
+        if (precision == WeightPrecision::Float64 || precision == WeightPrecision::Float32) {
+            m_student.base().set_precision(*precision);
+            report_load_status("weights", std::string("Storing student weights in ") + precision_name(*precision));
+        } else {
+            report_load_status("weights", "Ignoring ALMONDAI_PRECISION '" + *requested + "'; expected fp64 or fp32");
+        }
+    }
+
     report_load_status("seeds", "Verifying seed curriculum");
     ensure_seed_samples();
 
@@ -1002,10 +1217,34 @@ void ContinuousLearner::load_persistent_data() {
         m_tokenizers->sync_student_vocab(m_student);
     }
 
-    if (fs::exists(kWeightsPath)) {
+    const bool has_json_weights = fs::exists(kWeightsPath);
+    bool prefer_binary = fs::exists(kBinaryWeightsPath);
+    if (prefer_binary && has_json_weights) {
+        // Tools that only write JSON (trainer checkpoints, autopilot) leave the binary copy stale.
+        const auto binary_time = fs::last_write_time(kBinaryWeightsPath, ec);
+        const auto json_time = fs::last_write_time(kWeightsPath, ec);
+        prefer_binary = !ec && binary_time >= json_time;
+    }
+
+    bool weights_loaded = false;
+    if (prefer_binary) {
+        report_load_status("weights", "Loading student weights (binary)");
+        weights_loaded = m_student.base().load_weights(kBinaryWeightsPath.string());
+        if (!weights_loaded) {
+            report_load_status("weights", "Binary checkpoint unreadable; falling back to JSON");
+        }
+    }
+    if (!weights_loaded && has_json_weights) {
         report_load_status("weights", "Loading student weights");
-        const bool loaded = m_student.base().load_weights(kWeightsPath.string());
-        report_load_status("weights", loaded ? "Student weights loaded" : "Failed to load student weights");
+        weights_loaded = m_student.base().load_weights(kWeightsPath.string());
+        if (weights_loaded) {
+            m_student.base().save_weights_binary(kBinaryWeightsPath.string());
+        }
+    }
+    if (weights_loaded) {
+        report_load_status("weights", "Student weights loaded");
+    } else if (prefer_binary || has_json_weights) {
+        report_load_status("weights", "Failed to load student weights");
     } else {
         report_load_status("weights", "No persisted student weights found");
     }
@@ -1015,32 +1254,7 @@ void ContinuousLearner::load_persistent_data() {
         fs::copy_file(kSeedDataPath, kTrainingDataPath, fs::copy_options::overwrite_existing, ec);
     }
 
-    if (fs::exists(kTrainingDataPath)) {
-        report_load_status("vocab", "Refreshing vocabulary from persisted training data");
-        consume_training_data_for_vocab(kTrainingDataPath);
-    } else {
-        report_load_status("vocab", "No training data available for vocabulary refresh");
-    }
-
-    auto count_samples = [](const fs::path& path) -> std::size_t {
-        if (!fs::exists(path)) {
-            return 0;
-        }
-        std::ifstream in(path);
-        if (!in) {
-            return 0;
-        }
-        std::size_t count = 0;
-        std::string line;
-        while (std::getline(in, line)) {
-            if (!line.empty()) {
-                ++count;
-            }
-        }
-        return count;
-    };
-
-    const std::size_t total_samples = count_samples(kTrainingDataPath);
+    const std::size_t total_samples = JsonlIndex::shared(kTrainingDataPath)->non_empty_count();
     if (total_samples > 0) {
         report_load_status("samples", "Loading persisted training samples", 0, total_samples);
     } else {
@@ -1166,42 +1380,17 @@ void ContinuousLearner::load_persistent_data() {
         }
     }
 
-    report_load_status("ready", "Learner initialisation complete", m_training_data.size(), m_training_data.size());
-}
-
-void ContinuousLearner::consume_training_data_for_vocab(const std::filesystem::path& path) {
-    if (!std::filesystem::exists(path)) {
-        return;
-    }
-
-    std::ifstream file(path);
-    if (!file) {
-        return;
-    }
-
-    std::string line;
-    std::size_t processed = 0;
-    std::size_t added_tokens = 0;
-    while (std::getline(file, line)) {
-        if (line.empty()) {
-            continue;
-        }
-        if (auto sample = parse_sample_line(line)) {
-            const auto added = m_tokenizers->ingest_training_pair(m_student, sample->prompt, sample->teacher_output);
-            added_tokens += added.word_tokens_added + added.bpe_tokens_added;
-            ++processed;
+    // Last, since seeding above still trains and grows the vocabulary.
+    if (const auto requested = read_env("ALMONDAI_INFERENCE_PRECISION")) {
+        const auto precision = parse_precision(*requested);
+        if (!precision) {
+            report_load_status("weights", "Ignoring unknown ALMONDAI_INFERENCE_PRECISION '" + *requested + "'");
+        } else if (*precision != WeightPrecision::Float64) {
+            report_load_status("weights", m_student.base().quantize(*precision).summary());
         }
     }
 
-    if (added_tokens > 0) {
-        persist_state();
-    }
-
-    if (processed > 0) {
-        std::ostringstream detail;
-        detail << "Refreshed vocabulary from " << processed << " samples";
-        report_load_status("vocab", detail.str(), processed, processed);
-    }
+    report_load_status("ready", "Learner initialisation complete", m_training_data.size(), m_training_data.size());
 }
 
 void ContinuousLearner::load_samples_from_file(const std::filesystem::path& path,
@@ -1210,38 +1399,27 @@ void ContinuousLearner::load_samples_from_file(const std::filesystem::path& path
         report_load_status("samples", "Training data file not found", 0, total_samples_hint);
         return;
     }
-    std::ifstream file(path);
-    if (!file) {
+    const auto contents = JsonlIndex::shared(path)->contents();
+    if (!contents) {
         report_load_status("samples", "Failed to open training data file", 0, total_samples_hint);
         return;
     }
-    std::string line;
+
     std::size_t loaded = 0;
     std::size_t last_reported = 0;
     const std::size_t step = total_samples_hint > 0
         ? std::max<std::size_t>(std::size_t{1}, total_samples_hint / 10)
         : std::size_t{25};
-    auto notify_progress = [&](bool force) {
+    auto notify_progress = [&](std::string_view verb, bool force) {
         if (!m_load_status_callback) {
             return;
         }
-        if (!force) {
-            if (loaded == 0) {
-                return;
-            }
-            if (total_samples_hint > 0) {
-                if (loaded < last_reported + step) {
-                    return;
-                }
-            } else {
-                if (loaded % step != 0) {
-                    return;
-                }
-            }
+        if (!force && (loaded == 0 || loaded < last_reported + step)) {
+            return;
         }
         last_reported = loaded;
         std::ostringstream detail;
-        detail << "Loaded " << loaded;
+        detail << verb << ' ' << loaded;
         if (total_samples_hint > 0) {
             detail << " / " << total_samples_hint;
         }
@@ -1249,63 +1427,115 @@ void ContinuousLearner::load_samples_from_file(const std::filesystem::path& path
         report_load_status("samples", detail.str(), loaded, total_samples_hint);
     };
 
-    while (std::getline(file, line)) {
-        if (line.empty()) {
-            continue;
-        }
-        if (auto sample = parse_sample_line(line)) {
-            CuratedSample sample_value = *sample;
-            sample_value.semantic_tags = compute_semantic_tags(sample_value);
-            const auto added = m_tokenizers->ingest_training_pair(m_student, sample_value.prompt, sample_value.teacher_output);
-            if (added.word_tokens_added > 0 || added.bpe_tokens_added > 0) {
-                persist_state();
-            }
-            m_training_data.push_back(sample_value);
-            CuratedSample& stored = m_training_data.back();
-            m_curator.register_curated(stored);
-            if (m_eval_data.size() < 16) {
-                m_eval_data.push_back(stored);
-            }
-            const std::size_t index = m_training_data.size() - 1;
-            const std::string document_id = derive_document_id(stored, index);
-            std::string retrieval_text = stored.prompt;
-            if (!retrieval_text.empty() && !stored.teacher_output.empty()) {
-                retrieval_text.append("\n\n");
-            }
-            retrieval_text.append(stored.teacher_output);
-            std::string retrieval_id = document_id;
-            if (!document_id.empty()) {
-                if (stored.provenance.is_object()) {
-                    auto& prov = stored.provenance.as_object();
-                    if (prov.find("sample_hash") == prov.end()) {
-                        prov["sample_hash"] = Json(document_id);
-                    }
+    // The file is read once: line-aligned chunks are parsed and tagged in
+    // parallel, then the vocabulary and the retrieval index are updated in
+    // bulk, in file order, so the result does not depend on the thread count.
+    ThreadPool pool;
+    const auto chunks = split_lines(contents->view(), kLoadChunkBytes);
+    std::vector<std::vector<CuratedSample>> parsed(chunks.size());
+    for (std::size_t first = 0; first < chunks.size(); first += pool.size()) {
+        const std::size_t count = std::min(pool.size(), chunks.size() - first);
+        pool.parallel_for(count, [&](std::size_t i) {
+            std::string_view rest = chunks[first + i];
+            while (!rest.empty()) {
+                const std::size_t newline = rest.find('\n');
+                const std::string_view line = rest.substr(0, newline);
+                rest.remove_prefix(newline == std::string_view::npos ? rest.size() : newline + 1);
+                if (auto sample = parse_sample_line(line)) {
+                    sample->semantic_tags = compute_semantic_tags(*sample);
+                    m_curator.register_curated(*sample);
+                    parsed[first + i].push_back(std::move(*sample));
                 }
-            } else {
-                std::hash<std::string> hasher;
-                std::ostringstream oss;
-                oss << "sample:" << index << ':' << hasher(stored.prompt + stored.teacher_output);
-                retrieval_id = oss.str();
             }
-            stored.semantic_tags = merge_semantic_tags(stored.semantic_tags, m_retrieval.tags_for(retrieval_id));
-            m_retrieval.ingest_document(retrieval_id, retrieval_text, stored.semantic_tags);
-            m_document_to_index[retrieval_id] = index;
-            ++loaded;
-            notify_progress(false);
+        });
+        for (std::size_t i = first; i < first + count; ++i) {
+            loaded += parsed[i].size();
         }
+        notify_progress("Parsed", false);
     }
 
+    const std::size_t base = m_training_data.size();
+    m_training_data.reserve(base + loaded);
+    for (auto& samples : parsed) {
+        std::move(samples.begin(), samples.end(), std::back_inserter(m_training_data));
+        std::vector<CuratedSample>().swap(samples);
+    }
     if (loaded == 0) {
         report_load_status("samples", "No persisted samples were ingested", 0, total_samples_hint);
-    } else {
-        notify_progress(true);
+        return;
     }
 
-    if (loaded > 0) {
-        m_retrieval.save_metadata(kRetrievalMetadataPath);
+    std::vector<std::string_view> texts;
+    texts.reserve(loaded * 2);
+    for (std::size_t index = base; index < m_training_data.size(); ++index) {
+        texts.push_back(m_training_data[index].prompt);
+        texts.push_back(m_training_data[index].teacher_output);
+    }
+    const auto added = m_tokenizers->ingest_texts(m_student, texts, pool);
+    if (added.word_tokens_added > 0 || added.bpe_tokens_added > 0) {
+        persist_state();
     }
+    {
+        std::ostringstream detail;
+        detail << "Refreshed vocabulary from " << loaded << " samples";
+        report_load_status("vocab", detail.str(), loaded, loaded);
+    }
+
+    // Documents go to the index in blocks of distinct ids, so a repeated id
+    // still picks up the tags of the copy it replaces.
+    std::vector<RetrievalIndex::PendingDocument> block;
+    std::unordered_set<std::string> block_ids;
+    std::size_t changed = 0;
+    loaded = 0;
+    last_reported = 0;
+    auto flush_block = [&] {
+        loaded += block.size();
+        changed += m_retrieval.ingest_documents(std::move(block), pool);
+        block.clear();
+        block_ids.clear();
+        notify_progress("Loaded", false);
+    };
+    for (std::size_t index = base; index < m_training_data.size(); ++index) {
+        CuratedSample& stored = m_training_data[index];
+        if (m_eval_data.size() < 16) {
+            m_eval_data.push_back(stored);
+        }
+        const std::string document_id = derive_document_id(stored, index);
+        std::string retrieval_id = document_id;
+        if (!document_id.empty()) {
+            if (stored.provenance.is_object()) {
+                auto& prov = stored.provenance.as_object();
+                if (prov.find("sample_hash") == prov.end()) {
+                    prov["sample_hash"] = Json(document_id);
+                }
+            }
+        } else {
+            std::hash<std::string> hasher;
+            std::ostringstream oss;
+            oss << "sample:" << index << ':' << hasher(stored.prompt + stored.teacher_output);
+            retrieval_id = oss.str();
+        }
+        if (block.size() >= kLoadIndexBlock || block_ids.count(retrieval_id) > 0) {
+            flush_block();
+        }
+        std::string retrieval_text = stored.prompt;
+        if (!retrieval_text.empty() && !stored.teacher_output.empty()) {
+            retrieval_text.append("\n\n");
+        }
+        retrieval_text.append(stored.teacher_output);
+        stored.semantic_tags = merge_semantic_tags(stored.semantic_tags, m_retrieval.tags_for(retrieval_id));
+        block.push_back({retrieval_id, std::move(retrieval_text), stored.semantic_tags});
+        block_ids.insert(retrieval_id);
+        m_document_to_index[retrieval_id] = index;
+    }
+    flush_block();
+    notify_progress("Loaded", true);
 
-    if (!m_training_data.empty() && m_tokenizers) {
+    // Usually the saved index already matches the training data.
+    if (changed > 0) {
+        m_retrieval.save_metadata(kRetrievalMetadataPath);
+    }
+    if (m_tokenizers) {
         m_tokenizers->persist();
     }
 }
@@ -1366,13 +1596,6 @@ void ContinuousLearner::set_load_status_callback(LoadStatusCallback callback) {
 }
 
 void ContinuousLearner::persist_sample(const CuratedSample& sample) {
-    namespace fs = std::filesystem;
-    std::error_code ec;
-    fs::create_directories(kTrainingDataPath.parent_path(), ec);
-    std::ofstream file(kTrainingDataPath, std::ios::app);
-    if (!file) {
-        return;
-    }
     JsonObject obj;
     obj["prompt"] = Json(sample.prompt);
     obj["teacher_output"] = Json(sample.teacher_output);
@@ -1386,7 +1609,7 @@ void ContinuousLearner::persist_sample(const CuratedSample& sample) {
         }
         obj["semantic_tags"] = Json(tags);
     }
-    file << Json(obj).dump() << '\n';
+    JsonlIndex::shared(kTrainingDataPath)->append(Json(obj).dump());
 }
 
 std::string ContinuousLearner::derive_document_id(const CuratedSample& sample, std::size_t index) const {
@@ -1433,10 +1656,11 @@ void ContinuousLearner::report_load_status(std::string_view phase,
 }
 
 void ContinuousLearner::persist_state(std::optional<std::size_t> version) {
-    m_student.base().save_weights(kWeightsPath.string());
-    if (m_tokenizers) {
-        m_tokenizers->persist(version);
-    }
+    m_checkpoints.request(m_student.base(), version);
+}
+
+bool ContinuousLearner::flush_checkpoint() {
+    return m_checkpoints.flush(m_student.base(), m_step);
 }
 
 } // namespace almondai
@@ -2,8 +2,10 @@
 
 #include "../include/almondai/json.hpp"
 #include "../include/almondai/adapter.hpp"
+#include "../include/almondai/retrieval_refresh.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <fstream>
 #include <iostream>
@@ -28,12 +30,51 @@ std::vector<int> trim_pad(const std::vector<int>& tokens) {
     return trimmed;
 }
 
-void truncate_context(std::vector<int>& context, std::size_t limit) {
-    if (limit == 0 || context.size() <= limit) {
-        return;
+// Teacher-forcing context for one sequence. Keeps the running embedding sum of the
+// last `limit` tokens so each target costs O(hidden) before the layers, evicting
+// from the front instead of re-pooling the whole prefix.
+class ContextWindow {
+public:
+    ContextWindow(const BaseDecoder& decoder, std::vector<int> prompt, std::size_t limit)
+        : m_session(decoder), m_tokens(std::move(prompt)), m_limit(limit) {
+        m_session.append(m_tokens);
     }
-    context.erase(context.begin(), context.end() - static_cast<std::ptrdiff_t>(limit));
-}
+
+    void push(int token) {
+        m_tokens.push_back(token);
+        m_session.append(token);
+    }
+
+    BaseDecoder::ForwardResult forward() {
+        truncate();
+        return m_session.forward();
+    }
+
+private:
+    DecodeSession m_session;
+    std::vector<int> m_tokens;
+    std::size_t m_start = 0;
+    std::size_t m_limit = 0;
+    std::size_t m_evictions = 0;
+
+    void truncate() {
+        if (m_limit == 0) {
+            return;
+        }
+        while (m_tokens.size() - m_start > m_limit) {
+            m_session.evict(m_tokens[m_start++]);
+            ++m_evictions;
+        }
+        // Re-sum once a full window has been evicted so subtraction error stays bounded.
+        if (m_evictions >= m_limit) {
+            m_session.reset();
+            for (std::size_t i = m_start; i < m_tokens.size(); ++i) {
+                m_session.append(m_tokens[i]);
+            }
+            m_evictions = 0;
+        }
+    }
+};
 
 } // namespace
 
@@ -93,8 +134,7 @@ Trainer::Trainer(StudentModel& model,
     , m_optimizer(std::move(optimizer))
     , m_scheduler(std::move(scheduler)) {
     m_checkpoint_path = std::filesystem::path("data") / "student_weights.json";
-    const auto& projection = m_model.base().output_projection();
-    m_optimizer.reset(projection.vector().size());
+    m_model.base().visit_weights([&](const auto& weights) { m_optimizer.reset(weights.back().size()); });
 }
 
 void Trainer::set_checkpoint_path(std::filesystem::path path) {
@@ -201,10 +241,12 @@ std::vector<double> Trainer::compute_logits_gradient(const std::vector<double>&
 }
 
 TrainingReport Trainer::train_on_batch(const std::vector<TrainingExample>& batch) {
+    m_model.base().require_trainable();
     TrainingReport report;
     if (batch.empty()) {
         return report;
     }
+    const auto started = std::chrono::steady_clock::now();
     const auto prepared = prepare_batch(batch);
     if (prepared.token_count == 0) {
         return report;
@@ -219,14 +261,13 @@ TrainingReport Trainer::train_on_batch(const std::vector<TrainingExample>& batch
     std::size_t total_tokens = 0;
 
     for (std::size_t i = 0; i < prepared.inputs.size(); ++i) {
-        std::vector<int> context = trim_pad(prepared.inputs[i]);
+        ContextWindow context(m_model.base(), trim_pad(prepared.inputs[i]), config.context_length);
         for (std::size_t t = 0; t < prepared.targets[i].size(); ++t) {
             if (prepared.masks[i][t] == 0.0) {
                 continue;
             }
             int target_id = prepared.targets[i][t];
-            truncate_context(context, config.context_length);
-            auto forward = m_model.forward(context);
+            auto forward = context.forward();
 
             double step_loss = 0.0;
             auto grad_logits = compute_logits_gradient(
@@ -257,7 +298,7 @@ TrainingReport Trainer::train_on_batch(const std::vector<TrainingExample>& batch
 
             total_loss += step_loss;
             ++total_tokens;
-            context.push_back(target_id);
+            context.push(target_id);
         }
     }
 
@@ -283,8 +324,9 @@ TrainingReport Trainer::train_on_batch(const std::vector<TrainingExample>& batch
     }
 
     double lr_scale = m_scheduler.learning_rate_scale(m_step);
-    auto& projection = m_model.base().output_projection().vector();
-    m_optimizer.step(projection, grad_projection, lr_scale);
+    m_model.base().visit_weights([&](auto& weights) {
+        m_optimizer.step(weights.back().vector(), grad_projection, lr_scale);
+    });
 
     ++m_step;
     m_tokens_trained += total_tokens;
@@ -293,6 +335,10 @@ TrainingReport Trainer::train_on_batch(const std::vector<TrainingExample>& batch
     report.tokens = total_tokens;
     report.loss = total_loss * inv_tokens;
     report.perplexity = std::exp(report.loss);
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    if (elapsed > 0.0) {
+        report.tokens_per_second = static_cast<double>(total_tokens) / elapsed;
+    }
     if (m_options.save_every > 0 && (m_step % m_options.save_every) == 0) {
         report.checkpoint_saved = save_checkpoint();
     }
@@ -317,14 +363,13 @@ EvaluationReport Trainer::evaluate(const std::vector<TrainingExample>& dataset)
     std::vector<std::size_t> sample_tokens(dataset.size(), 0);
 
     for (std::size_t i = 0; i < prepared.inputs.size(); ++i) {
-        std::vector<int> context = trim_pad(prepared.inputs[i]);
+        ContextWindow context(m_model.base(), trim_pad(prepared.inputs[i]), config.context_length);
         for (std::size_t t = 0; t < prepared.targets[i].size(); ++t) {
             if (prepared.masks[i][t] == 0.0) {
                 continue;
             }
             int target_id = prepared.targets[i][t];
-            truncate_context(context, config.context_length);
-            auto forward = m_model.forward(context);
+            auto forward = context.forward();
             double step_loss = 0.0;
             auto grad_logits = compute_logits_gradient(
                 forward.logits,
@@ -336,7 +381,7 @@ EvaluationReport Trainer::evaluate(const std::vector<TrainingExample>& dataset)
             ++total_tokens;
             sample_loss[i] += step_loss;
             ++sample_tokens[i];
-            context.push_back(target_id);
+            context.push(target_id);
         }
     }
 
@@ -369,53 +414,9 @@ EvaluationReport Trainer::evaluate(const std::vector<TrainingExample>& dataset)
         report.tag_token_counts[tag] = tokens;
     }
 
-    auto compute_token_set = [this](const std::string& text) {
-        std::unordered_set<int> set;
-        auto tokens = m_tokenizer.encode(text);
-        for (int id : tokens) {
-            if (id <= BpeTokenizer::PAD_ID || id == BpeTokenizer::EOS_ID) {
-                continue;
-            }
-            set.insert(id);
-        }
-        return set;
-    };
-
     double current_hit_rate = 0.0;
     if (dataset.size() >= 2) {
-        std::size_t hits = 0;
-        for (std::size_t i = 0; i < dataset.size(); ++i) {
-            const auto prompt_tokens = compute_token_set(dataset[i].prompt);
-            if (prompt_tokens.empty()) {
-                continue;
-            }
-            double best = 0.0;
-            for (std::size_t j = 0; j < dataset.size(); ++j) {
-                if (i == j) {
-                    continue;
-                }
-                const auto other_tokens = compute_token_set(dataset[j].prompt);
-                if (other_tokens.empty()) {
-                    continue;
-                }
-                std::size_t intersection = 0;
-                for (int token : prompt_tokens) {
-                    if (other_tokens.find(token) != other_tokens.end()) {
-                        ++intersection;
-                    }
-                }
-                const std::size_t union_size = prompt_tokens.size() + other_tokens.size() - intersection;
-                if (union_size == 0) {
-                    continue;
-                }
-                const double score = static_cast<double>(intersection) / static_cast<double>(union_size);
-                best = std::max(best, score);
-            }
-            if (best > 0.0) {
-                ++hits;
-            }
-        }
-        current_hit_rate = static_cast<double>(hits) / static_cast<double>(dataset.size());
+        current_hit_rate = refresh_retrieval_index(dataset, m_tokenizer);
     }
 
     if (std::isfinite(current_hit_rate)) {
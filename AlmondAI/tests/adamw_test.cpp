@@ -0,0 +1,135 @@
+#include "almondai/kernels.hpp"
+#include "almondai/optim_adamw.hpp"
+#include "almondai/thread_pool.hpp"
+
+#include "test_support.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// AdamWOptimizer is compared with the textbook update written out element by
+// element. Every moment precision must match a reference that rounds the
+// moments the same way, bit for bit, under each ALMONDAI_KERNELS setting and
+// whether or not the step is split across a thread pool.
+
+using namespace almondai;
+
+namespace {
+
+using Precision = AdamWOptimizer::MomentPrecision;
+
+constexpr std::size_t kSteps = 3;
+
+std::vector<double> random_values(std::mt19937& rng, std::size_t n, double scale) {
+    std::normal_distribution<double> dist(0.0, scale);
+    std::vector<double> values(n);
+    for (double& value : values) {
+        value = dist(rng);
+    }
+    return values;
+}
+
+double round_moment(double value, Precision precision) {
+    switch (precision) {
+    case Precision::Float64:
+        return value;
+    case Precision::Float32:
+        return static_cast<float>(value);
+    case Precision::BFloat16:
+        return kernels::bf16_to_double(kernels::double_to_bf16(value));
+    }
+    return value;
+}
+
+template <typename Param>
+std::vector<Param> reference_run(const AdamWOptimizer::Params& params,
+                                 std::vector<Param> weights,
+                                 const std::vector<std::vector<double>>& gradients) {
+    std::vector<double> m(weights.size(), 0.0);
+    std::vector<double> v(weights.size(), 0.0);
+    for (std::size_t t = 1; t <= gradients.size(); ++t) {
+        const double lr = params.learning_rate * (t % 2 == 0 ? 0.5 : 1.0);
+        const double correction1 = 1.0 - std::pow(params.beta1, static_cast<double>(t));
+        const double correction2 = 1.0 - std::pow(params.beta2, static_cast<double>(t));
+        const auto& grad = gradients[t - 1];
+        for (std::size_t i = 0; i < weights.size(); ++i) {
+            const double next_m = params.beta1 * m[i] + (1.0 - params.beta1) * grad[i];
+            const double next_v = params.beta2 * v[i] + (1.0 - params.beta2) * (grad[i] * grad[i]);
+            const double update = (next_m / correction1) / (std::sqrt(next_v / correction2) + params.epsilon);
+            const double param = static_cast<double>(weights[i]);
+            weights[i] = static_cast<Param>(param - lr * (update + params.weight_decay * param));
+            m[i] = round_moment(next_m, params.moment_precision);
+            v[i] = round_moment(next_v, params.moment_precision);
+        }
+    }
+    return weights;
+}
+
+template <typename Param>
+std::vector<Param> optimizer_run(const AdamWOptimizer::Params& params,
+                                 std::vector<Param> weights,
+                                 const std::vector<std::vector<double>>& gradients,
+                                 ThreadPool* pool) {
+    AdamWOptimizer optimizer(weights.size(), params);
+    optimizer.set_thread_pool(pool);
+    for (std::size_t t = 1; t <= gradients.size(); ++t) {
+        optimizer.step(weights, gradients[t - 1], t % 2 == 0 ? 0.5 : 1.0);
+    }
+    ALMOND_CHECK(optimizer.step_index() == gradients.size());
+    return weights;
+}
+
+template <typename Param>
+void check_precision(std::mt19937& rng, Precision precision, ThreadPool& pool) {
+    AdamWOptimizer::Params params;
+    params.learning_rate = 1e-2;
+    params.moment_precision = precision;
+    // Odd sizes leave vector tails; the largest is split across the pool.
+    for (const std::size_t n : {1, 7, 37, 140007}) {
+        const auto initial = random_values(rng, n, 1.0);
+        std::vector<std::vector<double>> gradients;
+        for (std::size_t t = 0; t < kSteps; ++t) {
+            gradients.push_back(random_values(rng, n, 0.1));
+        }
+        const std::vector<Param> weights(initial.begin(), initial.end());
+        const auto expected = reference_run(params, weights, gradients);
+        ALMOND_CHECK(optimizer_run(params, weights, gradients, nullptr) == expected);
+        ALMOND_CHECK(optimizer_run(params, weights, gradients, &pool) == expected);
+    }
+}
+
+// Narrow moments stay close to the fp64 trajectory.
+void check_narrow_moments(std::mt19937& rng) {
+    const std::size_t n = 4096;
+    const auto initial = random_values(rng, n, 1.0);
+    std::vector<std::vector<double>> gradients;
+    for (std::size_t t = 0; t < kSteps; ++t) {
+        gradients.push_back(random_values(rng, n, 0.1));
+    }
+    AdamWOptimizer::Params params;
+    params.learning_rate = 1e-2;
+    const auto exact = optimizer_run(params, initial, gradients, nullptr);
+    for (const auto& [precision, tolerance] : {std::pair{Precision::Float32, 1e-8}, std::pair{Precision::BFloat16, 1e-3}}) {
+        params.moment_precision = precision;
+        const auto narrow = optimizer_run(params, initial, gradients, nullptr);
+        for (std::size_t i = 0; i < n; ++i) {
+            ALMOND_CHECK_NEAR(narrow[i], exact[i], tolerance);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    std::printf("kernel isa: %s\n", kernels::isa_name(kernels::active_isa()));
+    std::mt19937 rng(515);
+    ThreadPool pool(4);
+    for (const auto precision : {Precision::Float64, Precision::Float32, Precision::BFloat16}) {
+        check_precision<double>(rng, precision, pool);
+        check_precision<float>(rng, precision, pool);
+    }
+    check_narrow_moments(rng);
+    return test::finish("adamw_test");
+}
@@ -0,0 +1,133 @@
+#include "almondai/model.hpp"
+
+#include "test_support.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace almondai;
+
+namespace {
+
+// Offsets into the version 1 header and tensor table (see model.cpp).
+constexpr std::size_t kVocabOffset = 16;
+constexpr std::size_t kHiddenOffset = 24;
+constexpr std::size_t kLayersOffset = 32;
+constexpr std::size_t kTensorCountOffset = 56;
+constexpr std::size_t kTableOffset = 64;
+constexpr std::size_t kEntryDimsOffset = 8;
+constexpr std::size_t kEntryBytesOffset = 48;
+
+std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void write_file(const std::string& path, const std::string& contents) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+}
+
+void poke(std::string& buffer, std::size_t offset, std::uint64_t value) {
+    std::memcpy(buffer.data() + offset, &value, sizeof(value));
+}
+
+ModelConfig small_config() {
+    ModelConfig config;
+    config.vocab_size = 37;
+    config.hidden_size = 8;
+    config.num_layers = 2;
+    return config;
+}
+
+// Loading `contents` must fail cleanly and leave the decoder as it was.
+bool rejects(const test::TempDir& dir, const std::string& contents) {
+    const std::string path = dir.file("corrupt.bin");
+    write_file(path, contents);
+    BaseDecoder decoder(small_config());
+    const auto before = decoder.forward(std::vector<int>{1, 2, 3}).logits;
+    bool loaded = true;
+    try {
+        loaded = decoder.load_weights_binary(path);
+    } catch (...) {
+        return false;
+    }
+    return !loaded && decoder.forward(std::vector<int>{1, 2, 3}).logits == before;
+}
+
+} // namespace
+
+int main() {
+    test::TempDir dir("checkpoint_test");
+    const std::vector<int> probe{4, 5, 6, 36};
+
+    BaseDecoder original(small_config());
+    const std::string path = dir.file("weights.bin");
+    ALMOND_CHECK(original.save_weights_binary(path));
+    ALMOND_CHECK(is_binary_checkpoint(path));
+
+    BaseDecoder restored(small_config());
+    ALMOND_CHECK(restored.load_weights(path));
+    ALMOND_CHECK(restored.forward(probe).logits == original.forward(probe).logits);
+
+    // JSON and binary convert into each other without loss.
+    const std::string json_path = dir.file("weights.json");
+    const std::string round_trip = dir.file("round_trip.bin");
+    ALMOND_CHECK(convert_checkpoint(path, json_path));
+    ALMOND_CHECK(convert_checkpoint(json_path, round_trip));
+    BaseDecoder converted(small_config());
+    ALMOND_CHECK(converted.load_weights(round_trip));
+    ALMOND_CHECK(converted.forward(probe).logits == original.forward(probe).logits);
+
+    const std::string valid = read_file(path);
+    ALMOND_CHECK(!rejects(dir, valid));
+
+    {
+        std::string truncated = valid.substr(0, valid.size() - 1);
+        ALMOND_CHECK(rejects(dir, truncated));
+        ALMOND_CHECK(rejects(dir, valid.substr(0, 40)));
+    }
+    {
+        // A table too large for the file, sized so that the old bounds
+        // check overflowed.
+        std::string huge_table = valid;
+        poke(huge_table, kTensorCountOffset, std::uint64_t{1} << 60);
+        poke(huge_table, kLayersOffset, (std::uint64_t{1} << 60) - 2);
+        ALMOND_CHECK(rejects(dir, huge_table));
+    }
+    {
+        // layers + 2 wraps around to the tensor count.
+        std::string wrapped = valid;
+        poke(wrapped, kTensorCountOffset, 1);
+        poke(wrapped, kLayersOffset, std::numeric_limits<std::uint64_t>::max());
+        ALMOND_CHECK(rejects(dir, wrapped));
+    }
+    {
+        // Consistent header and dims whose element count overflows; the
+        // wrapped byte count is 0.
+        std::string overflow = valid;
+        const std::uint64_t dim = std::uint64_t{1} << 33;
+        poke(overflow, kVocabOffset, dim);
+        poke(overflow, kHiddenOffset, dim);
+        poke(overflow, kTableOffset + kEntryDimsOffset, dim);
+        poke(overflow, kTableOffset + kEntryDimsOffset + 8, dim);
+        poke(overflow, kTableOffset + kEntryBytesOffset, 0);
+        ALMOND_CHECK(rejects(dir, overflow));
+    }
+    {
+        // A multi-terabyte tensor claimed by a small file.
+        std::string oversized = valid;
+        const std::uint64_t dim = 1000000;
+        poke(oversized, kVocabOffset, dim);
+        poke(oversized, kTableOffset + kEntryDimsOffset, dim);
+        poke(oversized, kTableOffset + kEntryBytesOffset, dim * 8 * sizeof(double));
+        ALMOND_CHECK(rejects(dir, oversized));
+    }
+
+    return test::finish("checkpoint_test");
+}
@@ -0,0 +1,70 @@
+#include "almondai/checkpoint_writer.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+// Tokenizer files are written from the vocabularies captured when a write is
+// queued, not from whatever the live tokenizers hold when the worker runs.
+
+using namespace almondai;
+
+namespace {
+
+std::string read_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+std::size_t line_count(const std::filesystem::path& path) {
+    const std::string contents = read_file(path);
+    return static_cast<std::size_t>(std::count(contents.begin(), contents.end(), '\n'));
+}
+
+} // namespace
+
+int main() {
+    test::TempDir dir("checkpoint_writer_test");
+    ModelConfig config;
+    config.vocab_size = 16;
+    config.hidden_size = 4;
+    config.num_layers = 1;
+    StudentModel student{BaseDecoder(config)};
+
+    TokenizerCoordinator tokenizers;
+    tokenizers.set_persistence({dir.path() / "word.txt", dir.path() / "bpe.txt", dir.path() / "merges.txt"});
+    ALMOND_CHECK(tokenizers.bpe().load(dir.path() / "missing_vocab.txt", dir.path() / "missing_merges.txt"));
+    tokenizers.ingest_training_pair(student, "alpha beta", "gamma");
+
+    // A captured snapshot keeps its contents after later ingestion.
+    const auto captured = tokenizers.capture();
+    ALMOND_CHECK(captured.dirty);
+    ALMOND_CHECK(!tokenizers.capture().dirty);
+    tokenizers.ingest_training_pair(student, "zeta", "omega");
+    tokenizers.persist(captured, std::nullopt);
+    const std::size_t captured_bpe = captured.bpe->id_to_token.size();
+    const std::size_t captured_word = captured.word->id_to_token.size();
+    ALMOND_CHECK(tokenizers.bpe().vocab_size() > captured_bpe);
+    ALMOND_CHECK(tokenizers.word().vocab_size() > captured_word);
+    BpeTokenizer::save_vocab(*captured.bpe, dir.path() / "expected_bpe.txt");
+    ALMOND_CHECK(read_file(dir.path() / "bpe.txt") == read_file(dir.path() / "expected_bpe.txt"));
+    ALMOND_CHECK(line_count(dir.path() / "word.txt") == captured_word);
+    ALMOND_CHECK(line_count(dir.path() / "merges.txt") == captured.bpe->merges.size());
+
+    // The writer captures at enqueue; flush writes the current state.
+    CheckpointWriter writer({dir.path() / "weights.json", dir.path() / "weights.bin", &tokenizers});
+    ALMOND_CHECK(writer.flush(student.base(), 3));
+    tokenizers.bpe().save_vocab(dir.path() / "expected_bpe.txt");
+    ALMOND_CHECK(read_file(dir.path() / "bpe.txt") == read_file(dir.path() / "expected_bpe.txt"));
+    ALMOND_CHECK(line_count(dir.path() / "word.txt") == tokenizers.word().vocab_size());
+    ALMOND_CHECK(read_file(dir.path() / "bpe.step000003.txt") == read_file(dir.path() / "bpe.txt"));
+    ALMOND_CHECK(read_file(dir.path() / "merges.txt") == read_file(dir.path() / "merges.step000003.txt"));
+    ALMOND_CHECK(writer.status().last_step == std::optional<std::size_t>{3});
+
+    BaseDecoder restored(config);
+    ALMOND_CHECK(restored.load_weights((dir.path() / "weights.bin").string()));
+    return test::finish("checkpoint_writer_test");
+}
@@ -0,0 +1,103 @@
+#include "almondai/model.hpp"
+#include "almondai/thread_pool.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// fit() with worker threads sums the projection gradient of a batch with
+// sharded_sum: one contiguous shard of samples per thread, then a pairwise
+// tree over the shard buffers. The result must match the same per-sample
+// gradients summed serially, within rounding, for every pool size against
+// batches smaller than, equal to and larger than the pool, and repeated calls
+// must not leak the previous batch through the reused buffers.
+
+using namespace almondai;
+
+namespace {
+
+ModelConfig small_config() {
+    ModelConfig config;
+    config.vocab_size = 41;
+    config.hidden_size = 12;
+    config.num_layers = 2;
+    return config;
+}
+
+// Per-sample projection gradient as fit() forms it: hidden state times the
+// softmax-minus-target error on the logits.
+void add_gradient(const StudentModel& student,
+                  const std::vector<int>& prompt,
+                  int target,
+                  std::vector<double>& sum) {
+    const auto forward = student.forward(prompt);
+    const std::size_t vocab = forward.logits.size();
+    const double max_logit = *std::max_element(forward.logits.begin(), forward.logits.end());
+    std::vector<double> error(vocab);
+    double total = 0.0;
+    for (std::size_t v = 0; v < vocab; ++v) {
+        error[v] = std::exp(forward.logits[v] - max_logit);
+        total += error[v];
+    }
+    for (std::size_t v = 0; v < vocab; ++v) {
+        error[v] = error[v] / total - (static_cast<int>(v) == target ? 1.0 : 0.0);
+    }
+    for (std::size_t h = 0; h < forward.hidden.size(); ++h) {
+        for (std::size_t v = 0; v < vocab; ++v) {
+            sum[h * vocab + v] += forward.hidden[h] * error[v];
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    const ModelConfig config = small_config();
+    StudentModel student{BaseDecoder(config)};
+    const std::size_t size = config.vocab_size * config.hidden_size;
+
+    std::mt19937 rng(9);
+    std::uniform_int_distribution<int> token(0, static_cast<int>(config.vocab_size) - 1);
+    std::uniform_int_distribution<std::size_t> length(1, 7);
+    std::vector<std::vector<int>> prompts(13);
+    std::vector<int> targets(prompts.size());
+    for (std::size_t i = 0; i < prompts.size(); ++i) {
+        prompts[i].resize(length(rng));
+        for (int& id : prompts[i]) {
+            id = token(rng);
+        }
+        targets[i] = token(rng);
+    }
+
+    for (std::size_t threads = 1; threads <= 8; ++threads) {
+        ThreadPool pool(threads);
+        std::vector<std::vector<double>> buffers;
+        for (std::size_t batch = 1; batch <= prompts.size(); ++batch) {
+            std::vector<double> expected(size, 0.0);
+            for (std::size_t i = 0; i < batch; ++i) {
+                add_gradient(student, prompts[i], targets[i], expected);
+            }
+            const auto& actual = sharded_sum(pool, batch, size, buffers, [&](std::size_t i, std::vector<double>& sum) {
+                add_gradient(student, prompts[i], targets[i], sum);
+            });
+            ALMOND_CHECK(actual.size() == size);
+            double scale = 0.0;
+            for (double value : expected) {
+                scale = std::max(scale, std::fabs(value));
+            }
+            for (std::size_t j = 0; j < std::min(actual.size(), size); ++j) {
+                ALMOND_CHECK_NEAR(actual[j], expected[j], 1e-12 * scale + 1e-15);
+            }
+        }
+
+        // An empty batch sums to zero even after the buffers held a gradient.
+        const auto& empty = sharded_sum(pool, 0, size, buffers, [](std::size_t, std::vector<double>&) {});
+        ALMOND_CHECK(empty.size() == size);
+        ALMOND_CHECK(std::all_of(empty.begin(), empty.end(), [](double value) { return value == 0.0; }));
+    }
+
+    return test::finish("data_parallel_test");
+}
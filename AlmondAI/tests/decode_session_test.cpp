@@ -0,0 +1,102 @@
+#include "almondai/model.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <random>
+#include <vector>
+
+// A DecodeSession driven the way generation drives it, appending one token at
+// a time and evicting from the front once the window is full, must match a
+// fresh BaseDecoder::forward on each step's window. Appends and resets keep
+// the summation order of forward, so those steps match bit for bit; eviction
+// subtracts from the running sum and only has to match within rounding. The
+// embedding sums are in double for both weight storage types.
+
+using namespace almondai;
+
+namespace {
+
+ModelConfig small_config(WeightPrecision precision) {
+    ModelConfig config;
+    config.vocab_size = 61;
+    config.hidden_size = 16;
+    config.num_layers = 2;
+    config.precision = precision;
+    return config;
+}
+
+void check_close(const std::vector<double>& actual, const std::vector<double>& expected) {
+    ALMOND_CHECK(actual.size() == expected.size());
+    double scale = 0.0;
+    for (double value : expected) {
+        scale = std::max(scale, std::fabs(value));
+    }
+    for (std::size_t i = 0; i < std::min(actual.size(), expected.size()); ++i) {
+        ALMOND_CHECK_NEAR(actual[i], expected[i], 1e-12 * scale + 1e-15);
+    }
+}
+
+void check_window(WeightPrecision precision) {
+    StudentModel student{BaseDecoder(small_config(precision))};
+    const BaseDecoder& decoder = student.base();
+    std::mt19937 rng(precision == WeightPrecision::Float32 ? 32 : 64);
+    std::uniform_int_distribution<int> token(0, static_cast<int>(decoder.config().vocab_size) - 1);
+
+    const std::size_t window_size = 9;
+    std::vector<int> prompt{3, 1, 4, 1, 5};
+    auto session = student.start_session(prompt);
+    std::deque<int> window(prompt.begin(), prompt.end());
+    ALMOND_CHECK(session.token_count() == window.size());
+    ALMOND_CHECK(session.forward().logits == decoder.forward(prompt).logits);
+
+    bool evicted = false;
+    for (int step = 0; step < 60; ++step) {
+        const int next = token(rng);
+        session.append(next);
+        window.push_back(next);
+        if (window.size() > window_size) {
+            session.evict(window.front());
+            window.pop_front();
+            evicted = true;
+        }
+        const std::vector<int> context(window.begin(), window.end());
+        ALMOND_CHECK(session.token_count() == context.size());
+        const auto expected = decoder.forward(context).logits;
+        if (evicted) {
+            check_close(session.forward().logits, expected);
+        } else {
+            ALMOND_CHECK(session.forward().logits == expected);
+        }
+
+        // Re-summing the window after a reset brings back exact agreement.
+        if (step % 20 == 19) {
+            session.reset();
+            ALMOND_CHECK(session.token_count() == 0);
+            ALMOND_CHECK(session.forward().logits == decoder.forward(std::vector<int>{}).logits);
+            session.append(context);
+            ALMOND_CHECK(session.forward().logits == expected);
+            evicted = false;
+        }
+    }
+
+    // Out-of-range ids fall back to row 0 in both paths.
+    session.reset();
+    session.append(std::vector<int>{-5, 2, 1000});
+    ALMOND_CHECK(session.forward().logits == decoder.forward(std::vector<int>{-5, 2, 1000}).logits);
+
+    // Evicting from an empty session is a no-op.
+    session.reset();
+    session.evict(2);
+    ALMOND_CHECK(session.token_count() == 0);
+}
+
+} // namespace
+
+int main() {
+    check_window(WeightPrecision::Float64);
+    check_window(WeightPrecision::Float32);
+    return test::finish("decode_session_test");
+}
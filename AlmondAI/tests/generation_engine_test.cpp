@@ -0,0 +1,219 @@
+#include "almondai/generation_engine.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <latch>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Requests decoded together by a GenerationEngine must produce exactly the
+// tokens each would produce alone with the same seed and settings: the
+// batched forward gives every row the logits of a single-row forward, and
+// each row samples from its own rng. This holds while requests join the batch
+// mid-run, leave it when they hit their end token, their token limit, or a
+// throwing callback, and while some stream their tokens through on_token.
+
+using namespace almondai;
+
+namespace {
+
+constexpr int kEos = 7;
+
+StudentModel small_student() {
+    ModelConfig config;
+    config.vocab_size = 211;
+    config.hidden_size = 24;
+    config.num_layers = 2;
+    return StudentModel{BaseDecoder(config)};
+}
+
+// Prompts, limits and sampling settings differ per request, so rows end at
+// different steps. The first request runs long enough for a second wave of
+// requests to join while it is still being stepped.
+std::vector<GenerationRequest> make_requests(std::size_t count, std::size_t vocab) {
+    std::mt19937 rng(23);
+    std::uniform_int_distribution<int> token(0, static_cast<int>(vocab) - 1);
+    std::vector<GenerationRequest> requests(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        GenerationRequest& request = requests[i];
+        request.prompt.resize(i % 5);
+        for (int& id : request.prompt) {
+            id = token(rng);
+        }
+        request.max_tokens = 5 + static_cast<int>((i * 17) % 60);
+        request.min_tokens = i % 3 == 1 ? 4 : 0;
+        request.eos_token = i % 4 == 3 ? -1 : kEos;
+        request.sampling.temperature = 0.25 + 0.125 * static_cast<double>(i % 7);
+        request.sampling.top_k = i % 3 == 0 ? 0 : 10 * (i % 5 + 1);
+        request.sampling.top_p = i % 2 == 0 ? 1.0 : 0.9;
+        request.sampling.min_p = i % 5 == 4 ? 0.05 : 0.0;
+        request.sampling.repetition_penalty = i % 3 == 1 ? 1.3 : 1.0;
+        request.rng.seed(static_cast<unsigned>(1000 + i));
+    }
+    requests[0].max_tokens = 4000;
+    requests[0].eos_token = -1;
+    return requests;
+}
+
+// The model is randomly initialised, so rather than hope for an end token,
+// requests that may end at once pick theirs from a probe run: the first new
+// token past half their limit. Without suppression the draws up to it are the
+// same, so they end exactly there. Returns where each such request stops.
+std::vector<std::size_t> choose_end_tokens(const StudentModel& student, std::vector<GenerationRequest>& requests) {
+    GenerationEngine engine(student, GenerationEngine::Options{.max_batch = 1});
+    std::vector<std::size_t> stops(requests.size(), 0);
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        GenerationRequest& request = requests[i];
+        if (request.eos_token < 0 || request.min_tokens > 0) {
+            continue;
+        }
+        GenerationRequest probe = request;
+        probe.eos_token = -1;
+        const auto output = engine.generate(probe);
+        for (std::size_t k = output.size() / 2; k < output.size(); ++k) {
+            if (std::find(output.begin(), output.begin() + static_cast<std::ptrdiff_t>(k), output[k]) ==
+                output.begin() + static_cast<std::ptrdiff_t>(k)) {
+                request.eos_token = output[k];
+                stops[i] = k;
+                break;
+            }
+        }
+    }
+    return stops;
+}
+
+// Each request on its own, one at a time.
+std::vector<std::vector<int>> serial_outputs(const StudentModel& student,
+                                             const std::vector<GenerationRequest>& requests) {
+    GenerationEngine engine(student, GenerationEngine::Options{.max_batch = 1});
+    std::vector<std::vector<int>> outputs;
+    for (const auto& request : requests) {
+        outputs.push_back(engine.generate(request));
+    }
+    ALMOND_CHECK(engine.stats().peak_batch == 1);
+    // A request ending on its end token spends one step drawing it.
+    ALMOND_CHECK(engine.stats().steps >= engine.stats().tokens);
+    ALMOND_CHECK(engine.stats().steps <= engine.stats().tokens + engine.stats().requests);
+    return outputs;
+}
+
+void check_serial_bounds(const std::vector<GenerationRequest>& requests, const std::vector<std::vector<int>>& outputs) {
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        const auto& output = outputs[i];
+        ALMOND_CHECK(output.size() <= static_cast<std::size_t>(requests[i].max_tokens));
+        ALMOND_CHECK(output.size() >= static_cast<std::size_t>(requests[i].min_tokens));
+        for (int token : output) {
+            ALMOND_CHECK(token != requests[i].eos_token);
+        }
+    }
+}
+
+void check_concurrent(const StudentModel& student,
+                      const std::vector<GenerationRequest>& requests,
+                      const std::vector<std::vector<int>>& expected) {
+    const std::size_t count = requests.size();
+    const std::size_t first_wave = count / 2;
+    // Its callback throws after this many tokens, dropping it mid-batch.
+    const std::size_t throwing = count - 2;
+    constexpr std::size_t kThrowAfter = 3;
+
+    GenerationEngine engine(student, GenerationEngine::Options{.max_batch = 4});
+    std::vector<std::vector<int>> outputs(count);
+    std::vector<std::vector<int>> streamed(count);
+    std::vector<std::string> errors(count);
+    std::latch long_request_started(1);
+    std::atomic<bool> signalled{false};
+
+    auto run = [&](std::size_t i) {
+        // Every other request streams; the long one and the throwing one always do.
+        const bool streaming = i % 2 == 0 || i == throwing;
+        std::function<void(int)> on_token;
+        if (streaming) {
+            on_token = [&, i](int token) {
+                streamed[i].push_back(token);
+                if (i == 0 && !signalled.exchange(true)) {
+                    long_request_started.count_down();
+                }
+                if (i == throwing && streamed[i].size() == kThrowAfter) {
+                    throw std::runtime_error("callback stopped");
+                }
+            };
+        }
+        try {
+            outputs[i] = engine.generate(requests[i], on_token);
+        } catch (const std::exception& error) {
+            errors[i] = error.what();
+        }
+    };
+
+    std::vector<std::thread> clients;
+    for (std::size_t i = 0; i < first_wave; ++i) {
+        clients.emplace_back(run, i);
+    }
+    // The second wave joins once the long request is being stepped.
+    long_request_started.wait();
+    for (std::size_t i = first_wave; i < count; ++i) {
+        clients.emplace_back(run, i);
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i == throwing) {
+            ALMOND_CHECK(errors[i] == "callback stopped");
+            ALMOND_CHECK(outputs[i].empty());
+            ALMOND_CHECK(streamed[i].size() == kThrowAfter);
+            ALMOND_CHECK(expected[i].size() >= kThrowAfter);
+            ALMOND_CHECK(std::equal(streamed[i].begin(), streamed[i].end(), expected[i].begin()));
+            continue;
+        }
+        ALMOND_CHECK(errors[i].empty());
+        ALMOND_CHECK(outputs[i] == expected[i]);
+        if (i % 2 == 0) {
+            ALMOND_CHECK(streamed[i] == outputs[i]);
+        } else {
+            ALMOND_CHECK(streamed[i].empty());
+        }
+    }
+
+    const auto stats = engine.stats();
+    ALMOND_CHECK(stats.requests == count);
+    ALMOND_CHECK(stats.peak_batch > 1);
+    ALMOND_CHECK(stats.peak_batch <= 4);
+    // Rows stepped together share a step.
+    ALMOND_CHECK(stats.steps < stats.tokens);
+}
+
+} // namespace
+
+int main() {
+    const StudentModel student = small_student();
+    auto requests = make_requests(12, student.base().config().vocab_size);
+    const auto stops = choose_end_tokens(student, requests);
+    const auto expected = serial_outputs(student, requests);
+    check_serial_bounds(requests, expected);
+    std::size_t ended_early = 0;
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        if (stops[i] > 0) {
+            ALMOND_CHECK(expected[i].size() == stops[i]);
+            ++ended_early;
+        }
+    }
+    ALMOND_CHECK(ended_early >= 3);
+    ALMOND_CHECK(expected.front().size() == 4000);
+
+    // The same requests again through a fresh serial engine give the same tokens.
+    ALMOND_CHECK(serial_outputs(student, requests) == expected);
+
+    check_concurrent(student, requests, expected);
+    return test::finish("generation_engine_test");
+}
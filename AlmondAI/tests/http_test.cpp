@@ -0,0 +1,286 @@
+#include "almondai/net/http.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// HttpClient against a stub HTTP/1.1 server on localhost: connections are
+// kept alive and reused, the per-host limit holds under concurrent requests,
+// errors and streamed bodies are reported correctly.
+
+using namespace almondai;
+
+#ifndef _WIN32
+
+namespace {
+
+// Minimal keep-alive server. Routes: /echo returns the request body, /slow
+// does the same after 100 ms, /fail answers 500, /stream sends a chunked body
+// and /close answers and then closes the connection.
+class StubServer {
+public:
+    StubServer() {
+        m_listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        if (::bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(m_listener, 16) != 0) {
+            throw std::runtime_error("stub server: bind/listen failed");
+        }
+        socklen_t length = sizeof(address);
+        ::getsockname(m_listener, reinterpret_cast<sockaddr*>(&address), &length);
+        m_port = ntohs(address.sin_port);
+        m_acceptor = std::thread([this] { accept_loop(); });
+    }
+
+    ~StubServer() {
+        m_stopping = true;
+        m_acceptor.join();
+        for (auto& connection : m_connections) {
+            connection.join();
+        }
+        ::close(m_listener);
+    }
+
+    std::string url(const std::string& path) const {
+        return "http://127.0.0.1:" + std::to_string(m_port) + path;
+    }
+
+    std::size_t accepted() const { return m_accepted; }
+    std::size_t peak_open() const { return m_peak_open; }
+
+private:
+    int m_listener = -1;
+    unsigned short m_port = 0;
+    std::atomic<bool> m_stopping{false};
+    std::atomic<std::size_t> m_accepted{0};
+    std::atomic<std::size_t> m_open{0};
+    std::atomic<std::size_t> m_peak_open{0};
+    std::thread m_acceptor;
+    std::vector<std::thread> m_connections;
+
+    bool wait_readable(int fd) const {
+        pollfd entry{fd, POLLIN, 0};
+        while (!m_stopping) {
+            if (::poll(&entry, 1, 20) > 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void accept_loop() {
+        while (wait_readable(m_listener)) {
+            const int client = ::accept(m_listener, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            ++m_accepted;
+            const std::size_t open = ++m_open;
+            std::size_t peak = m_peak_open;
+            while (open > peak && !m_peak_open.compare_exchange_weak(peak, open)) {
+            }
+            m_connections.emplace_back([this, client] {
+                serve(client);
+                ::close(client);
+                --m_open;
+            });
+        }
+    }
+
+    static void send_all(int fd, const std::string& data) {
+        std::size_t sent = 0;
+        while (sent < data.size()) {
+            const ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return;
+            }
+            sent += static_cast<std::size_t>(n);
+        }
+    }
+
+    static std::string reply(int status, const std::string& body, const std::string& extra = {}) {
+        return "HTTP/1.1 " + std::to_string(status) + (status == 200 ? " OK" : " Error") +
+               "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n" + extra + "\r\n" + body;
+    }
+
+    void serve(int fd) {
+        std::string buffer;
+        char chunk[4096];
+        while (true) {
+            std::size_t header_end = buffer.find("\r\n\r\n");
+            while (header_end == std::string::npos) {
+                if (!wait_readable(fd)) {
+                    return;
+                }
+                const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    return;
+                }
+                buffer.append(chunk, static_cast<std::size_t>(n));
+                header_end = buffer.find("\r\n\r\n");
+            }
+            const std::string head = buffer.substr(0, header_end);
+            std::size_t content_length = 0;
+            if (const auto at = head.find("Content-Length: "); at != std::string::npos) {
+                content_length = std::stoul(head.substr(at + 16));
+            }
+            while (buffer.size() < header_end + 4 + content_length) {
+                if (!wait_readable(fd)) {
+                    return;
+                }
+                const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    return;
+                }
+                buffer.append(chunk, static_cast<std::size_t>(n));
+            }
+            const std::string body = buffer.substr(header_end + 4, content_length);
+            buffer.erase(0, header_end + 4 + content_length);
+            const std::string path = head.substr(5, head.find(' ', 5) - 5);
+
+            if (path == "/echo") {
+                send_all(fd, reply(200, body));
+            } else if (path == "/slow") {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                send_all(fd, reply(200, body));
+            } else if (path == "/fail") {
+                send_all(fd, reply(500, "backend exploded"));
+            } else if (path == "/stream") {
+                send_all(fd, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
+                for (const std::string piece : {"alpha ", "beta ", "gamma"}) {
+                    char size[16];
+                    std::snprintf(size, sizeof(size), "%zx\r\n", piece.size());
+                    send_all(fd, size + piece + "\r\n");
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                }
+                send_all(fd, "0\r\n\r\n");
+            } else {
+                send_all(fd, reply(200, "bye", "Connection: close\r\n"));
+                return;
+            }
+        }
+    }
+};
+
+void check_keep_alive(StubServer& server) {
+    net::HttpClient client;
+    for (int i = 0; i < 8; ++i) {
+        const std::string body = "{\"n\":" + std::to_string(i) + "}";
+        const auto response = client.post(server.url("/echo"), body, {});
+        ALMOND_CHECK(response.status == 200);
+        ALMOND_CHECK(response.body == body);
+        ALMOND_CHECK(response.reused_connection == (i > 0));
+    }
+    const auto stats = client.stats();
+    ALMOND_CHECK(server.accepted() == 1);
+    ALMOND_CHECK(stats.requests == 8);
+    ALMOND_CHECK(stats.connections_opened == 1);
+    ALMOND_CHECK(stats.connections_reused == 7);
+    ALMOND_CHECK(stats.failures == 0);
+    ALMOND_CHECK(stats.in_flight == 0);
+
+    // An error status fails the call but leaves the connection usable.
+    bool threw = false;
+    try {
+        client.post(server.url("/fail"), "{}", {});
+    } catch (const std::runtime_error& error) {
+        threw = std::string(error.what()).find("500") != std::string::npos;
+    }
+    ALMOND_CHECK(threw);
+    ALMOND_CHECK(client.stats().failures == 1);
+    ALMOND_CHECK(client.post(server.url("/echo"), "after", {}).reused_connection);
+
+    // A server-side close forces exactly one new connection.
+    ALMOND_CHECK(client.post(server.url("/close"), "{}", {}).body == "bye");
+    ALMOND_CHECK(!client.post(server.url("/echo"), "again", {}).reused_connection);
+    ALMOND_CHECK(server.accepted() == 2);
+}
+
+void check_host_limit(StubServer& server) {
+    net::HttpClient::Options options;
+    options.max_connections_per_host = 2;
+    net::HttpClient client(options);
+    std::vector<std::future<net::HttpResponse>> pending;
+    for (int i = 0; i < 6; ++i) {
+        pending.push_back(client.post_async(server.url("/slow"), std::to_string(i), {}));
+    }
+    for (int i = 0; i < 6; ++i) {
+        ALMOND_CHECK(pending[static_cast<std::size_t>(i)].get().body == std::to_string(i));
+    }
+    const auto stats = client.stats();
+    ALMOND_CHECK(stats.connections_opened <= 2);
+    ALMOND_CHECK(stats.connections_opened + stats.connections_reused == 6);
+    ALMOND_CHECK(server.peak_open() <= 2);
+}
+
+void check_stream(StubServer& server) {
+    net::HttpClient client;
+    std::string streamed;
+    std::size_t chunks = 0;
+    const auto response = client.post_stream(server.url("/stream"), "{}", {}, [&](std::string_view piece) {
+        streamed.append(piece);
+        ++chunks;
+    });
+    ALMOND_CHECK(response.status == 200);
+    ALMOND_CHECK(response.body.empty());
+    ALMOND_CHECK(streamed == "alpha beta gamma");
+    ALMOND_CHECK(chunks >= 1);
+
+    // An exception from the callback aborts the transfer and reaches the caller.
+    bool rethrown = false;
+    try {
+        client.post_stream(server.url("/stream"), "{}", {}, [](std::string_view) {
+            throw std::logic_error("stop");
+        });
+    } catch (const std::logic_error&) {
+        rethrown = true;
+    }
+    ALMOND_CHECK(rethrown);
+}
+
+} // namespace
+
+int main() {
+    {
+        StubServer server;
+        check_keep_alive(server);
+    }
+    {
+        StubServer server;
+        check_host_limit(server);
+    }
+    {
+        StubServer server;
+        check_stream(server);
+    }
+    return test::finish("http_test");
+}
+
+#else
+
+int main() {
+    std::printf("http_test: skipped, the stub server needs POSIX sockets\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,53 @@
+#include "almondai/ingest.hpp"
+
+#include "test_support.hpp"
+
+#include <string>
+
+// DataCurator drops teacher outputs that carry phone numbers or email
+// addresses, and keeps ones whose long digit runs are IDs rather than phone
+// numbers. Everything else about the samples passes the other gates.
+
+using namespace almondai;
+
+namespace {
+
+bool accepted(DataCurator& curator, const std::string& detail) {
+    const std::string output = "The build finished without errors and the report lists " + detail + " for review.";
+    return curator.curate("Summarise the nightly build report please.", output, Json(), "hash").has_value();
+}
+
+} // namespace
+
+int main() {
+    DataCurator curator;
+
+    const char* phone_numbers[] = {
+        "555-123-4567",
+        "(555) 123-4567",
+        "+1 555 123 4567",
+        "+44-555-123-4567",
+        "5551234567",
+        "tel:555 123 4567",
+    };
+    for (const char* number : phone_numbers) {
+        ALMOND_CHECK(!accepted(curator, number));
+    }
+    // At the very start of the text, where there is no leading non-digit.
+    ALMOND_CHECK(!curator.curate("Summarise the nightly build report please.",
+                                 "555-123-4567 is the number listed in the report for the build team.",
+                                 Json(), "hash").has_value());
+    ALMOND_CHECK(!accepted(curator, "ops@example.com"));
+
+    const char* identifiers[] = {
+        "build 123456789012345",
+        "ticket 12345678901234",
+        "commit 1234567",
+        "version 2024.06.11",
+    };
+    for (const char* id : identifiers) {
+        ALMOND_CHECK(accepted(curator, id));
+    }
+
+    return test::finish("ingest_test");
+}
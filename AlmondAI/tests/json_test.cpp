@@ -0,0 +1,109 @@
+#include "almondai/json.hpp"
+
+#include "test_support.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Numbers dump in their shortest form and parse back to the same bits;
+// strings survive escaping at every offset of the vectorized scan; documents
+// round-trip through dump/parse; malformed input is rejected.
+
+using namespace almondai;
+
+namespace {
+
+bool rejects(const std::string& text) {
+    try {
+        Json::parse(text);
+    } catch (const std::exception&) {
+        return true;
+    }
+    return false;
+}
+
+bool same_bits(double a, double b) {
+    return std::bit_cast<std::uint64_t>(a) == std::bit_cast<std::uint64_t>(b);
+}
+
+void check_numbers(std::mt19937_64& rng) {
+    for (int i = 0; i < 20000; ++i) {
+        const double value = std::bit_cast<double>(rng());
+        if (!std::isfinite(value)) {
+            continue;
+        }
+        const Json parsed = Json::parse(Json(value).dump());
+        ALMOND_CHECK(std::holds_alternative<double>(parsed.value()));
+        ALMOND_CHECK(same_bits(std::get<double>(parsed.value()), value));
+    }
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    for (int i = 0; i < 20000; ++i) {
+        const double value = unit(rng);
+        ALMOND_CHECK(same_bits(std::get<double>(Json::parse(Json(value).dump()).value()), value));
+    }
+    ALMOND_CHECK(Json(3).dump() == "3");
+    ALMOND_CHECK(Json(0.1).dump() == "0.1");
+    ALMOND_CHECK(Json(-2.5e-300).dump() == "-2.5e-300");
+    ALMOND_CHECK(Json(0.123456789012345).dump() == "0.123456789012345");
+    ALMOND_CHECK(std::get<double>(Json::parse("1E3").value()) == 1000.0);
+    ALMOND_CHECK(std::get<double>(Json::parse(" -0.5 ").value()) == -0.5);
+}
+
+void check_strings() {
+    // Put each special character at every position around a 16-byte chunk.
+    const std::string specials[] = {"\"", "\\", "\n", "\r", "\t", std::string(1, '\x01'), "\x7f", "\xc3\xa9"};
+    for (const auto& special : specials) {
+        for (std::size_t position = 0; position < 40; ++position) {
+            std::string text(40, 'x');
+            text.insert(position, special);
+            const std::string dumped = Json(text).dump();
+            ALMOND_CHECK(Json::parse(dumped).as_string() == text);
+        }
+    }
+    ALMOND_CHECK(Json(std::string("a\"b\\c\n\x02")).dump() == "\"a\\\"b\\\\c\\n\\u0002\"");
+    ALMOND_CHECK(Json::parse(R"("\u00e9\u4e2d\/\b\f")").as_string() == "\xc3\xa9\xe4\xb8\xad/\b\f");
+    // A surrogate pair decodes to one 4-byte character.
+    ALMOND_CHECK(Json::parse(R"("\ud83d\ude00")").as_string() == "\xf0\x9f\x98\x80");
+
+    JsonObject object;
+    object["key \"quoted\""] = Json(1);
+    ALMOND_CHECK(Json(object).dump() == R"({"key \"quoted\"":1})");
+}
+
+void check_documents() {
+    const std::string text =
+        R"({"constraints":{"max":12,"style":["short","plain"]},"empty":{},"flag":false,)"
+        R"("list":[],"nested":[[1,2.5],[null,true]],"prompt":"tab\there"})";
+    const Json parsed = Json::parse(text);
+    ALMOND_CHECK(parsed.dump() == text);
+    ALMOND_CHECK(Json::parse(" \n{ \"b\" : 1 , \"a\" : [ 1 , 2 ] }\t").dump() == R"({"a":[1,2],"b":1})");
+
+    // Appending reuses the buffer and leaves earlier contents alone.
+    std::string buffer = "prefix:";
+    parsed.as_object().at("nested").dump_to(buffer);
+    ALMOND_CHECK(buffer == "prefix:[[1,2.5],[null,true]]");
+}
+
+void check_rejections() {
+    const char* malformed[] = {"", "{", "[", "[1,", "{\"a\":1,", "[1,]", "[1 2]", "{\"a\" 1}", "{\"a\":1,}",
+                               "\"abc", "tru", "nul", "1 2", "{} x", "\"\\x\"", "\"\\u12\"", "\"\\u12g4\"", "-",
+                               "1e999"};
+    for (const char* text : malformed) {
+        ALMOND_CHECK(rejects(text));
+    }
+}
+
+} // namespace
+
+int main() {
+    std::mt19937_64 rng(7);
+    check_numbers(rng);
+    check_strings();
+    check_documents();
+    check_rejections();
+    return test::finish("json_test");
+}
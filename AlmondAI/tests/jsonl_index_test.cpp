@@ -0,0 +1,73 @@
+#include "almondai/jsonl_index.hpp"
+
+#include "test_support.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+// Paging reads the right lines with and without a sidecar, a private index
+// leaves nothing next to the file, and the shared registry drops idle
+// instances once it holds more than kMaxShared.
+
+using namespace almondai;
+
+namespace {
+
+void write_lines(const std::string& path, int count) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    for (int i = 0; i < count; ++i) {
+        out << "{\"n\":" << i << "}\n";
+    }
+}
+
+} // namespace
+
+int main() {
+    test::TempDir dir("jsonl_index_test");
+    const std::string path = dir.file("data.jsonl");
+    write_lines(path, 100);
+
+    {
+        JsonlIndex index(path, false);
+        ALMOND_CHECK(index.line_count() == 100);
+        const auto lines = index.read(97, 10);
+        ALMOND_CHECK(lines.size() == 3);
+        ALMOND_CHECK(!lines.empty() && lines.front().text == "{\"n\":97}");
+        ALMOND_CHECK(index.append("{\"n\":100}"));
+        ALMOND_CHECK(index.line_count() == 101);
+    }
+    ALMOND_CHECK(!std::filesystem::exists(JsonlIndex::sidecar_path(path)));
+
+    {
+        JsonlIndex index(path);
+        ALMOND_CHECK(index.line_count() == 101);
+    }
+    ALMOND_CHECK(std::filesystem::exists(JsonlIndex::sidecar_path(path)));
+    {
+        // A fresh instance pages from the sidecar and sees later appends.
+        JsonlIndex index(path);
+        ALMOND_CHECK(index.append("{\"n\":101}"));
+        const auto lines = index.read(100, 5);
+        ALMOND_CHECK(lines.size() == 2);
+        ALMOND_CHECK(lines.size() == 2 && lines[1].text == "{\"n\":101}");
+    }
+
+    // Held instances survive eviction; idle ones are dropped.
+    const auto held = JsonlIndex::shared(path);
+    std::weak_ptr<JsonlIndex> idle;
+    for (std::size_t i = 0; i < 3 * JsonlIndex::kMaxShared; ++i) {
+        const std::string other = dir.file("other" + std::to_string(i) + ".jsonl");
+        write_lines(other, 1);
+        const auto index = JsonlIndex::shared(other);
+        ALMOND_CHECK(index->line_count() == 1);
+        if (i == 0) {
+            idle = index;
+        }
+    }
+    ALMOND_CHECK(JsonlIndex::shared(path) == held);
+    ALMOND_CHECK(idle.expired());
+
+    return test::finish("jsonl_index_test");
+}
@@ -0,0 +1,157 @@
+#include "almondai/kernels.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Every kernel is compared with a plain reference that performs the same
+// operations in the same order, so a pass under each ALMONDAI_KERNELS setting
+// means the ISA paths agree bit for bit. dot is also checked against a
+// sequential long double sum within a rounding tolerance. The float storage
+// variants must equal the fp64 kernels on the widened values.
+
+using namespace almondai;
+
+namespace {
+
+std::vector<double> random_values(std::mt19937& rng, std::size_t n, double scale = 1.0) {
+    std::normal_distribution<double> dist(0.0, scale);
+    std::vector<double> values(n);
+    for (double& value : values) {
+        value = dist(rng);
+    }
+    return values;
+}
+
+void reference_vecmat(const double* x, const double* w, double* y, std::size_t rows, std::size_t cols) {
+    for (std::size_t n = 0; n < cols; ++n) {
+        double sum = 0.0;
+        for (std::size_t k = 0; k < rows; ++k) {
+            sum += x[k] * w[k * cols + n];
+        }
+        y[n] = sum;
+    }
+}
+
+double reference_dot(const double* a, const double* b, std::size_t n) {
+    double lanes[8] = {};
+    for (std::size_t i = 0; i < n; ++i) {
+        lanes[i % 8] += a[i] * b[i];
+    }
+    return ((lanes[0] + lanes[4]) + (lanes[1] + lanes[5])) + ((lanes[2] + lanes[6]) + (lanes[3] + lanes[7]));
+}
+
+void check_products(std::mt19937& rng) {
+    // Odd sizes exercise the vector tails and the column tiling.
+    const std::pair<std::size_t, std::size_t> shapes[] = {{1, 1}, {7, 13}, {33, 300}, {64, 517}};
+    for (const auto& [rows, cols] : shapes) {
+        const auto w = random_values(rng, rows * cols);
+        const std::size_t batch = 5;
+        const auto x = random_values(rng, batch * rows);
+        std::vector<double> expected(batch * cols);
+        for (std::size_t b = 0; b < batch; ++b) {
+            reference_vecmat(x.data() + b * rows, w.data(), expected.data() + b * cols, rows, cols);
+        }
+        std::vector<double> single(cols);
+        kernels::vecmat(x.data(), w.data(), single.data(), rows, cols);
+        ALMOND_CHECK(std::equal(single.begin(), single.end(), expected.begin()));
+        std::vector<double> batched(batch * cols);
+        kernels::matmul(x.data(), w.data(), batched.data(), batch, rows, cols);
+        ALMOND_CHECK(batched == expected);
+    }
+}
+
+void check_dot_and_axpy(std::mt19937& rng) {
+    for (const std::size_t n : {0, 1, 7, 8, 9, 15, 16, 17, 100, 1023}) {
+        const auto a = random_values(rng, n);
+        const auto b = random_values(rng, n);
+        const double result = kernels::dot(a.data(), b.data(), n);
+        ALMOND_CHECK(result == reference_dot(a.data(), b.data(), n));
+
+        long double exact = 0.0L;
+        double magnitude = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            exact += static_cast<long double>(a[i]) * b[i];
+            magnitude += std::fabs(a[i] * b[i]);
+        }
+        ALMOND_CHECK_NEAR(result, static_cast<double>(exact), 4.0 * static_cast<double>(n + 1) * 1.2e-16 * magnitude);
+
+        std::vector<double> y = random_values(rng, n);
+        std::vector<double> expected = y;
+        for (std::size_t i = 0; i < n; ++i) {
+            expected[i] += a[i] * 0.37;
+        }
+        kernels::axpy(0.37, a.data(), y.data(), n);
+        ALMOND_CHECK(y == expected);
+    }
+}
+
+void check_float_storage(std::mt19937& rng) {
+    const auto widen = [](const std::vector<float>& values) { return std::vector<double>(values.begin(), values.end()); };
+    const auto narrow = [](const std::vector<double>& values) { return std::vector<float>(values.begin(), values.end()); };
+
+    for (const std::size_t n : {0, 1, 7, 8, 9, 15, 16, 17, 100, 1023}) {
+        const auto a = narrow(random_values(rng, n));
+        const auto b = random_values(rng, n);
+        const auto wide = widen(a);
+        ALMOND_CHECK(kernels::dot(a.data(), b.data(), n) == reference_dot(wide.data(), b.data(), n));
+
+        auto y = narrow(random_values(rng, n));
+        std::vector<float> expected = y;
+        for (std::size_t i = 0; i < n; ++i) {
+            expected[i] = static_cast<float>(static_cast<double>(expected[i]) + b[i] * 0.37);
+        }
+        kernels::axpy(0.37, b.data(), y.data(), n);
+        ALMOND_CHECK(y == expected);
+    }
+
+    const std::pair<std::size_t, std::size_t> shapes[] = {{1, 1}, {7, 13}, {33, 300}};
+    for (const auto& [rows, cols] : shapes) {
+        const auto w = narrow(random_values(rng, rows * cols));
+        const auto wide = widen(w);
+        const std::size_t batch = 5;
+        const auto x = random_values(rng, batch * rows);
+        std::vector<double> expected(batch * cols);
+        kernels::matmul(x.data(), wide.data(), expected.data(), batch, rows, cols);
+        std::vector<double> single(cols);
+        kernels::vecmat(x.data(), w.data(), single.data(), rows, cols);
+        ALMOND_CHECK(std::equal(single.begin(), single.end(), expected.begin()));
+        std::vector<double> batched(batch * cols);
+        kernels::matmul(x.data(), w.data(), batched.data(), batch, rows, cols);
+        ALMOND_CHECK(batched == expected);
+    }
+}
+
+void check_exp_sum(std::mt19937& rng) {
+    for (const std::size_t n : {1, 3, 4, 5, 64, 1001}) {
+        auto x = random_values(rng, n, 20.0);
+        x[0] = -2000.0;
+        std::vector<double> y(n);
+        const double sum = kernels::exp_sum(x.data(), 1.5, 0.5, y.data(), n);
+        double lanes[4] = {};
+        for (std::size_t i = 0; i < n; ++i) {
+            const double expected = std::exp((x[i] - 1.5) * 0.5);
+            ALMOND_CHECK_NEAR(y[i], expected, 4.5e-16 * expected);
+            lanes[i % 4] += y[i];
+        }
+        ALMOND_CHECK(y[0] == 0.0);
+        ALMOND_CHECK(sum == (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+    }
+}
+
+} // namespace
+
+int main() {
+    std::printf("kernel isa: %s\n", kernels::isa_name(kernels::active_isa()));
+    std::mt19937 rng(20240611);
+    check_products(rng);
+    check_dot_and_axpy(rng);
+    check_float_storage(rng);
+    check_exp_sum(rng);
+    return test::finish("kernels_test");
+}
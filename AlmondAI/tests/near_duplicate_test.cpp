@@ -0,0 +1,96 @@
+#include "almondai/near_duplicate.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// nearest_exact must agree with a brute-force Jaccard scan below its
+// threshold, including moderate similarities that LSH banding misses.
+
+using namespace almondai;
+
+namespace {
+
+double reference_jaccard(std::vector<int> a, std::vector<int> b) {
+    std::sort(a.begin(), a.end());
+    a.erase(std::unique(a.begin(), a.end()), a.end());
+    std::sort(b.begin(), b.end());
+    b.erase(std::unique(b.begin(), b.end()), b.end());
+    std::vector<int> common;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(common));
+    const std::size_t union_size = a.size() + b.size() - common.size();
+    return union_size == 0 ? 0.0 : static_cast<double>(common.size()) / static_cast<double>(union_size);
+}
+
+// Keeps `overlap` of base's tokens and fills the rest with fresh ids.
+std::vector<int> variant(std::mt19937& rng, const std::vector<int>& base, double overlap, int& next_id) {
+    std::vector<int> out;
+    std::bernoulli_distribution keep(overlap);
+    for (int token : base) {
+        out.push_back(keep(rng) ? token : next_id++);
+    }
+    return out;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(7);
+    int next_id = 1;
+    std::vector<std::vector<int>> sets;
+    for (std::size_t i = 0; i < 64; ++i) {
+        std::vector<int> base;
+        for (std::size_t t = 0; t < 60; ++t) {
+            base.push_back(next_id++);
+        }
+        sets.push_back(base);
+    }
+
+    NearDuplicateIndex index;
+    std::vector<std::size_t> ids;
+    for (const auto& set : sets) {
+        ids.push_back(index.insert(set));
+    }
+    ALMOND_CHECK(index.size() == sets.size());
+
+    std::size_t lsh_misses = 0;
+    for (std::size_t q = 0; q < 400; ++q) {
+        const auto& base = sets[q % sets.size()];
+        const double overlap = 0.2 + 0.8 * static_cast<double>(q) / 400.0;
+        const auto query = variant(rng, base, overlap, next_id);
+        double expected = 0.0;
+        for (const auto& set : sets) {
+            expected = std::max(expected, reference_jaccard(query, set));
+        }
+        const auto exact = index.nearest_exact(query, 0.92);
+        const auto lsh = index.nearest(query);
+        ALMOND_CHECK(lsh.similarity <= exact.similarity);
+        if (expected <= 0.92) {
+            ALMOND_CHECK(exact.similarity == expected);
+        } else {
+            ALMOND_CHECK(exact.similarity > 0.92);
+        }
+        ALMOND_CHECK(exact.id == ids[q % sets.size()] || expected == 0.0);
+        if (lsh.similarity < expected) {
+            ++lsh_misses;
+        }
+    }
+    // The fallback matters only if banding really misses some neighbours.
+    ALMOND_CHECK(lsh_misses > 0);
+
+    // Erased entries are never reported and their ids are reused.
+    index.erase(ids[3]);
+    ALMOND_CHECK(index.nearest_exact(sets[3], 0.92).id != ids[3]);
+    ALMOND_CHECK(index.nearest(sets[3]).id != ids[3]);
+    ALMOND_CHECK(index.insert(sets[3]) == ids[3]);
+    ALMOND_CHECK(index.nearest_exact(sets[3], 0.92).similarity == 1.0);
+    ALMOND_CHECK(index.nearest_to(ids[3]).id != ids[3]);
+
+    index.clear();
+    ALMOND_CHECK(index.size() == 0);
+    ALMOND_CHECK(index.nearest_exact(sets[0], 0.92).id == NearDuplicateIndex::npos);
+
+    return test::finish("near_duplicate_test");
+}
@@ -0,0 +1,134 @@
+#include "almondai/model.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <string>
+#include <vector>
+
+// fp32 storage widens every weight to double before any arithmetic, so an
+// fp32 decoder must give bit-identical logits to an fp64 decoder holding the
+// same weights rounded to float, through forward, batched forward and decode
+// sessions, and stay within float rounding of the unrounded fp64 model. The
+// binary checkpoint stores fp32 weights as float and reloads them exactly,
+// into either storage type.
+
+using namespace almondai;
+
+namespace {
+
+std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+ModelConfig small_config() {
+    ModelConfig config;
+    config.vocab_size = 53;
+    config.hidden_size = 24;
+    config.num_layers = 3;
+    return config;
+}
+
+const std::vector<std::vector<int>>& probes() {
+    static const std::vector<std::vector<int>> contexts{{1}, {4, 5, 6, 36}, {52, 0, 17, 17, 9, 30, 2}};
+    return contexts;
+}
+
+bool same_logits(const BaseDecoder& a, const BaseDecoder& b) {
+    for (const auto& tokens : probes()) {
+        if (a.forward(tokens).logits != b.forward(tokens).logits) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void check_rounded_parity() {
+    BaseDecoder full(small_config());
+    BaseDecoder single = full;
+    single.set_precision(WeightPrecision::Float32);
+    ALMOND_CHECK(single.precision() == WeightPrecision::Float32);
+    BaseDecoder rounded = single;
+    rounded.set_precision(WeightPrecision::Float64);
+    ALMOND_CHECK(rounded.precision() == WeightPrecision::Float64);
+
+    ALMOND_CHECK(same_logits(single, rounded));
+
+    const auto batched = single.forward(std::span<const std::vector<int>>(probes()));
+    ALMOND_CHECK(batched.size() == probes().size());
+    for (std::size_t i = 0; i < std::min(batched.size(), probes().size()); ++i) {
+        const auto expected = rounded.forward(probes()[i]);
+        ALMOND_CHECK(batched[i].logits == expected.logits);
+        ALMOND_CHECK(batched[i].hidden == expected.hidden);
+    }
+
+    StudentModel student{single};
+    const auto session = student.start_session(probes().back());
+    ALMOND_CHECK(session.forward().logits == rounded.forward(probes().back()).logits);
+
+    // Rounding each weight moves the logits by about float epsilon relative
+    // to their scale, never more than a small multiple of it.
+    for (const auto& tokens : probes()) {
+        const auto expected = full.forward(tokens).logits;
+        const auto actual = single.forward(tokens).logits;
+        ALMOND_CHECK(actual.size() == expected.size());
+        double scale = 0.0;
+        for (double value : expected) {
+            scale = std::max(scale, std::fabs(value));
+        }
+        for (std::size_t i = 0; i < std::min(actual.size(), expected.size()); ++i) {
+            ALMOND_CHECK_NEAR(actual[i], expected[i], 1e-5 * scale + 1e-12);
+        }
+    }
+}
+
+void check_checkpoint_round_trip() {
+    test::TempDir dir("precision_test");
+    BaseDecoder full(small_config());
+    BaseDecoder single = full;
+    single.set_precision(WeightPrecision::Float32);
+
+    const std::string full_path = dir.file("fp64.bin");
+    const std::string single_path = dir.file("fp32.bin");
+    ALMOND_CHECK(full.save_weights_binary(full_path));
+    ALMOND_CHECK(single.save_weights_binary(single_path));
+    // Float payloads take half the bytes; only the header and padding are shared.
+    ALMOND_CHECK(std::filesystem::file_size(single_path) < std::filesystem::file_size(full_path));
+
+    ModelConfig config = small_config();
+    config.precision = WeightPrecision::Float32;
+    BaseDecoder reloaded_single(config);
+    ALMOND_CHECK(reloaded_single.load_weights(single_path));
+    ALMOND_CHECK(reloaded_single.precision() == WeightPrecision::Float32);
+    ALMOND_CHECK(same_logits(reloaded_single, single));
+
+    // Loading keeps the decoder's storage: fp32 files widen exactly into
+    // fp64, and fp64 files round into fp32 the way set_precision does.
+    BaseDecoder widened(small_config());
+    ALMOND_CHECK(widened.load_weights(single_path));
+    ALMOND_CHECK(widened.precision() == WeightPrecision::Float64);
+    ALMOND_CHECK(same_logits(widened, single));
+
+    BaseDecoder narrowed(config);
+    ALMOND_CHECK(narrowed.load_weights(full_path));
+    ALMOND_CHECK(same_logits(narrowed, single));
+
+    // A second save of the reloaded fp32 weights is byte-for-byte the same file.
+    const std::string again_path = dir.file("fp32_again.bin");
+    ALMOND_CHECK(reloaded_single.save_weights_binary(again_path));
+    ALMOND_CHECK(read_file(again_path) == read_file(single_path));
+}
+
+} // namespace
+
+int main() {
+    check_rounded_parity();
+    check_checkpoint_round_trip();
+    return test::finish("precision_test");
+}
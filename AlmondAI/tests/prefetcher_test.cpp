@@ -0,0 +1,135 @@
+#include "almondai/prefetcher.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Prefetcher runs a stub fetch that takes a random time. Results must come
+// back in item order whatever order the fetches finish in; no fetch may start
+// more than `depth` items ahead of the consumer, nor while `depth` others are
+// running; the k-th fetch may not start before k * spacing has passed; an
+// exception from one fetch reaches the consumer for that item only; and
+// destroying a prefetcher that was not drained returns promptly.
+
+using namespace almondai;
+
+namespace {
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+struct Observed {
+    std::mutex mutex;
+    std::vector<Clock::time_point> starts;
+    std::atomic<std::size_t> running{0};
+    std::atomic<std::size_t> peak_running{0};
+    std::atomic<std::size_t> consumed{0};
+    std::atomic<bool> ran_ahead{false};
+};
+
+void check_prefetch(std::size_t count, std::size_t depth, std::chrono::milliseconds spacing, std::size_t failing) {
+    Observed observed;
+    const auto created = Clock::now();
+    {
+        Prefetcher<std::string> prefetcher(count, depth, spacing, [&](std::size_t item) {
+            {
+                std::scoped_lock lock(observed.mutex);
+                observed.starts.push_back(Clock::now());
+            }
+            if (item >= observed.consumed + depth) {
+                observed.ran_ahead = true;
+            }
+            const std::size_t running = ++observed.running;
+            std::size_t peak = observed.peak_running;
+            while (running > peak && !observed.peak_running.compare_exchange_weak(peak, running)) {
+            }
+            // Later items tend to finish first.
+            std::this_thread::sleep_for(std::chrono::microseconds(200 * ((count - item) % 7)));
+            --observed.running;
+            if (item == failing) {
+                throw std::runtime_error("fetch " + std::to_string(item) + " failed");
+            }
+            return "result " + std::to_string(item);
+        });
+
+        for (std::size_t item = 0; item < count; ++item) {
+            // Counted on entry: from here the prefetcher may hand this slot
+            // back at any moment, which lets one more fetch start.
+            ++observed.consumed;
+            if (item == failing) {
+                bool thrown = false;
+                try {
+                    prefetcher.next();
+                } catch (const std::runtime_error& error) {
+                    thrown = std::string(error.what()) == "fetch " + std::to_string(item) + " failed";
+                }
+                ALMOND_CHECK(thrown);
+            } else {
+                ALMOND_CHECK(prefetcher.next() == "result " + std::to_string(item));
+            }
+            // A slow consumer lets the workers fill every slot.
+            if (item % 5 == 0) {
+                std::this_thread::sleep_for(2ms);
+            }
+        }
+        bool exhausted = false;
+        try {
+            prefetcher.next();
+        } catch (const std::out_of_range&) {
+            exhausted = true;
+        }
+        ALMOND_CHECK(exhausted);
+    }
+
+    ALMOND_CHECK(!observed.ran_ahead);
+    ALMOND_CHECK(observed.peak_running <= depth);
+    ALMOND_CHECK(observed.starts.size() == count);
+    std::sort(observed.starts.begin(), observed.starts.end());
+    for (std::size_t k = 0; k < observed.starts.size(); ++k) {
+        ALMOND_CHECK(observed.starts[k] - created >= spacing * static_cast<long>(k));
+    }
+}
+
+void check_abandoned() {
+    // Undrained prefetchers stop their workers, including one waiting out a
+    // long spacing and ones blocked on full slots.
+    const auto started = Clock::now();
+    {
+        Prefetcher<int> spaced(4, 2, 10s, [](std::size_t item) { return static_cast<int>(item); });
+        ALMOND_CHECK(spaced.next() == 0);
+    }
+    {
+        Prefetcher<int> full(100, 3, 0ms, [](std::size_t item) { return static_cast<int>(item); });
+        std::this_thread::sleep_for(5ms);
+    }
+    ALMOND_CHECK(Clock::now() - started < 5s);
+
+    // Nothing to fetch: next() reports exhaustion immediately.
+    Prefetcher<int> empty(0, 4, 0ms, [](std::size_t) { return 0; });
+    bool exhausted = false;
+    try {
+        empty.next();
+    } catch (const std::out_of_range&) {
+        exhausted = true;
+    }
+    ALMOND_CHECK(exhausted);
+}
+
+} // namespace
+
+int main() {
+    check_prefetch(40, 1, 0ms, 40);
+    check_prefetch(40, 4, 0ms, 17);
+    check_prefetch(25, 3, 3ms, 0);
+    check_prefetch(12, 8, 1ms, 11);
+    check_abandoned();
+    return test::finish("prefetcher_test");
+}
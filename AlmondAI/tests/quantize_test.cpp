@@ -0,0 +1,80 @@
+#include "almondai/model.hpp"
+#include "almondai/tokenizer_coordinator.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+// A quantized decoder pools its context from dequantized embedding rows the
+// same way whether it runs forward on the token list or an incremental decode
+// session, and refuses vocabulary growth before the tokenizers take any new
+// tokens.
+
+using namespace almondai;
+
+namespace {
+
+ModelConfig small_config() {
+    ModelConfig config;
+    config.vocab_size = 37;
+    config.hidden_size = 8;
+    config.num_layers = 2;
+    return config;
+}
+
+void check_session(WeightPrecision precision) {
+    StudentModel student{BaseDecoder(small_config())};
+    student.base().quantize(precision);
+    const std::vector<int> tokens{4, 5, 6, 36, 4};
+
+    auto session = student.start_session(tokens);
+    ALMOND_CHECK(session.forward().logits == student.forward(tokens).logits);
+
+    session.evict(tokens.front());
+    const auto expected = student.forward(std::vector<int>(tokens.begin() + 1, tokens.end())).logits;
+    const auto actual = session.forward().logits;
+    ALMOND_CHECK(actual.size() == expected.size());
+    for (std::size_t i = 0; i < std::min(actual.size(), expected.size()); ++i) {
+        ALMOND_CHECK_NEAR(actual[i], expected[i], 1e-9);
+    }
+}
+
+bool throws(const std::function<void()>& body) {
+    try {
+        body();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+void check_ingest_rejected() {
+    StudentModel student{BaseDecoder(small_config())};
+    TokenizerCoordinator tokenizers;
+    tokenizers.bpe().load("");
+    student.base().quantize(WeightPrecision::Int8);
+    const std::size_t word_vocab = tokenizers.word().vocab_size();
+    const std::size_t bpe_vocab = tokenizers.bpe().vocab_size();
+
+    ALMOND_CHECK(throws([&] { tokenizers.ingest_training_pair(student, "brand new words", "never seen before"); }));
+    ThreadPool pool(2);
+    const std::vector<std::string_view> texts{"more unseen words", "and their reply"};
+    ALMOND_CHECK(throws([&] { tokenizers.ingest_texts(student, texts, pool); }));
+
+    ALMOND_CHECK(tokenizers.word().vocab_size() == word_vocab);
+    ALMOND_CHECK(tokenizers.bpe().vocab_size() == bpe_vocab);
+    ALMOND_CHECK(student.base().config().vocab_size == small_config().vocab_size);
+}
+
+} // namespace
+
+int main() {
+    check_session(WeightPrecision::Float16);
+    check_session(WeightPrecision::Int8);
+    check_ingest_rejected();
+    return test::finish("quantize_test");
+}
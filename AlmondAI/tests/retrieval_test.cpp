@@ -0,0 +1,292 @@
+#include "almondai/retrieval.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// The postings index with MaxScore pruning must return the same top-k as
+// scoring every document with BM25 directly. Queries running while another
+// thread re-ingests the same ids must stay well-formed and never return a
+// document version that has been replaced.
+
+using namespace almondai;
+
+namespace {
+
+constexpr double kK1 = 1.2;
+constexpr double kB = 0.75;
+
+std::string utf8(char32_t codepoint) {
+    std::string out;
+    out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    return out;
+}
+
+// Zipf-distributed CJK symbols, one token each for the word tokenizer.
+class Corpus {
+public:
+    explicit Corpus(std::size_t symbols) : m_rng(1234) {
+        std::vector<double> weights(symbols);
+        for (std::size_t i = 0; i < symbols; ++i) {
+            weights[i] = 1.0 / static_cast<double>(i + 1);
+        }
+        m_symbol = std::discrete_distribution<std::size_t>(weights.begin(), weights.end());
+    }
+
+    std::string text(std::size_t min_length, std::size_t max_length) {
+        std::uniform_int_distribution<std::size_t> length(min_length, max_length);
+        std::string out;
+        for (std::size_t i = length(m_rng); i > 0; --i) {
+            out += utf8(static_cast<char32_t>(0x4E00 + m_symbol(m_rng)));
+        }
+        return out;
+    }
+
+private:
+    std::mt19937 m_rng;
+    std::discrete_distribution<std::size_t> m_symbol;
+};
+
+struct Reference {
+    std::string id;
+    double score = 0.0;
+};
+
+// Term frequencies and document frequencies for direct BM25 scoring.
+class BruteForce {
+public:
+    void add(const std::string& id, const std::vector<int>& tokens) {
+        Entry entry{id, {}, static_cast<double>(tokens.size())};
+        for (int token : tokens) {
+            if (++entry.tf[token] == 1) {
+                ++m_df[token];
+            }
+        }
+        m_total_length += entry.length;
+        m_entries.push_back(std::move(entry));
+    }
+
+    std::vector<Reference> query(const WordTokenizer& tokenizer, const std::string& text, std::size_t top_k) const {
+        std::unordered_map<int, int> query_counts;
+        for (int token : tokenizer.encode(text)) {
+            ++query_counts[token];
+        }
+        const double count = static_cast<double>(m_entries.size());
+        const double avg_length = std::max(1.0, m_total_length / count);
+        std::vector<Reference> scored;
+        for (const auto& entry : m_entries) {
+            const double norm = kK1 * (1.0 - kB + kB * entry.length / avg_length);
+            double score = 0.0;
+            for (const auto& [token, qcount] : query_counts) {
+                const auto found = entry.tf.find(token);
+                if (found == entry.tf.end()) {
+                    continue;
+                }
+                const double d = static_cast<double>(m_df.at(token));
+                const double idf = std::log(1.0 + (count - d + 0.5) / (d + 0.5));
+                const double f = static_cast<double>(found->second);
+                score += idf * qcount * f * (kK1 + 1.0) / (f + norm);
+            }
+            if (score > 0.0) {
+                scored.push_back(Reference{entry.id, score});
+            }
+        }
+        std::stable_sort(scored.begin(), scored.end(), [](const Reference& a, const Reference& b) {
+            return a.score > b.score;
+        });
+        scored.resize(std::min(scored.size(), top_k));
+        return scored;
+    }
+
+private:
+    struct Entry {
+        std::string id;
+        std::unordered_map<int, int> tf;
+        double length = 0.0;
+    };
+    std::vector<Entry> m_entries;
+    std::unordered_map<int, std::size_t> m_df;
+    double m_total_length = 0.0;
+};
+
+// Every round re-ingests all ids with new texts tagged with the round,
+// alternating single and batched ingestion. Once a round has completed, every
+// live document is from that round or a later one, so a hit tagged with an
+// earlier round is a replaced document that should have been tombstoned.
+void check_concurrent_reingest(Corpus& corpus) {
+    constexpr std::size_t kDocuments = 200;
+    constexpr std::size_t kRounds = 24;
+
+    std::vector<std::vector<std::string>> texts(kRounds);
+    std::vector<std::string> vocabulary_texts;
+    for (auto& round_texts : texts) {
+        for (std::size_t d = 0; d < kDocuments; ++d) {
+            round_texts.push_back(corpus.text(3, 20));
+        }
+        vocabulary_texts.insert(vocabulary_texts.end(), round_texts.begin(), round_texts.end());
+    }
+    WordTokenizer tokenizer;
+    tokenizer.build_vocab(vocabulary_texts);
+    RetrievalIndex index(tokenizer);
+    const auto id = [](std::size_t d) { return "live-" + std::to_string(d); };
+    const auto tag = [](std::size_t round) { return "round-" + std::to_string(round); };
+
+    std::atomic<std::size_t> completed{0};
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> malformed{0};
+    std::atomic<std::size_t> stale{0};
+    std::atomic<std::size_t> queries{0};
+
+    // Returns the round a hit was ingested in, or kRounds when malformed.
+    const auto hit_round = [&](const RetrievalResult& hit) {
+        if (hit.tags.size() != 1 || hit.tags.front().rfind("round-", 0) != 0) {
+            return kRounds;
+        }
+        return static_cast<std::size_t>(std::stoul(hit.tags.front().substr(6)));
+    };
+
+    const auto reader = [&](unsigned seed) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> symbol(0, 60);
+        std::uniform_int_distribution<std::size_t> top(1, kDocuments);
+        while (!done.load()) {
+            const std::size_t finished = completed.load();
+            std::string query;
+            for (int i = 0; i < 3; ++i) {
+                query += utf8(static_cast<char32_t>(0x4E00 + symbol(rng)));
+            }
+            const std::size_t top_k = top(rng);
+            const auto hits = index.query(query, top_k);
+            queries.fetch_add(1);
+            std::set<std::string> seen;
+            bool ok = hits.size() <= top_k;
+            for (std::size_t i = 0; i < hits.size(); ++i) {
+                const std::size_t round = hit_round(hits[i]);
+                ok = ok && round < kRounds && std::isfinite(hits[i].score) && hits[i].score > 0.0
+                    && hits[i].document_id.rfind("live-", 0) == 0 && seen.insert(hits[i].document_id).second
+                    && (i == 0 || hits[i - 1].score >= hits[i].score);
+                if (round + 1 < finished) {
+                    stale.fetch_add(1);
+                }
+            }
+            if (!ok) {
+                malformed.fetch_add(1);
+            }
+        }
+    };
+
+    ThreadPool pool(2);
+    std::vector<std::thread> readers;
+    for (unsigned r = 0; r < 3; ++r) {
+        readers.emplace_back(reader, 100 + r);
+    }
+    for (std::size_t round = 0; round < kRounds; ++round) {
+        if (round % 2 == 0) {
+            for (std::size_t d = 0; d < kDocuments; ++d) {
+                index.ingest_document(id(d), texts[round][d], {tag(round)});
+            }
+        } else {
+            std::vector<RetrievalIndex::PendingDocument> batch;
+            for (std::size_t d = 0; d < kDocuments; ++d) {
+                batch.push_back(RetrievalIndex::PendingDocument{id(d), texts[round][d], {tag(round)}});
+            }
+            index.ingest_documents(std::move(batch), pool);
+        }
+        completed.store(round + 1);
+    }
+    // Let the readers query the final state too before stopping them.
+    const std::size_t settled = queries.load();
+    while (queries.load() < settled + 30) {
+        std::this_thread::yield();
+    }
+    done.store(true);
+    for (auto& thread : readers) {
+        thread.join();
+    }
+
+    ALMOND_CHECK(malformed.load() == 0);
+    ALMOND_CHECK(stale.load() == 0);
+    ALMOND_CHECK(index.document_count() == kDocuments);
+    const auto all = index.query(texts.back().front(), kDocuments);
+    ALMOND_CHECK(all.size() == kDocuments);
+    for (const auto& hit : all) {
+        ALMOND_CHECK(hit_round(hit) == kRounds - 1);
+    }
+}
+
+} // namespace
+
+int main() {
+    Corpus corpus(2000);
+    std::vector<std::string> texts;
+    for (std::size_t i = 0; i < 4000; ++i) {
+        texts.push_back(corpus.text(5, 60));
+    }
+    WordTokenizer tokenizer;
+    tokenizer.build_vocab(texts);
+    RetrievalIndex index(tokenizer);
+
+    // One document at a time, then in batches, so queries span several segments.
+    BruteForce reference;
+    ThreadPool pool(2);
+    std::vector<RetrievalIndex::PendingDocument> batch;
+    for (std::size_t i = 0; i < texts.size(); ++i) {
+        const std::string id = "doc-" + std::to_string(i);
+        reference.add(id, tokenizer.encode(texts[i]));
+        if (i < 500) {
+            index.ingest_document(id, texts[i], {"tag" + std::to_string(i % 3)});
+            continue;
+        }
+        batch.push_back(RetrievalIndex::PendingDocument{id, texts[i], {}});
+        if (batch.size() == 1000) {
+            index.ingest_documents(std::move(batch), pool);
+            batch.clear();
+        }
+    }
+    index.ingest_documents(std::move(batch), pool);
+    ALMOND_CHECK(index.document_count() == texts.size());
+    ALMOND_CHECK(index.tokens_for("doc-42") == tokenizer.encode(texts[42]));
+    ALMOND_CHECK(index.tags_for("doc-4") == std::vector<std::string>{"tag1"});
+
+    std::size_t compared = 0;
+    for (std::size_t q = 0; q < 200; ++q) {
+        const std::string query = corpus.text(1, 8);
+        const std::size_t top_k = 1 + q % 10;
+        // One extra reference hit tells whether the k-th place is a tie.
+        const auto expected = reference.query(tokenizer, query, top_k + 1);
+        const auto actual = index.query(query, top_k);
+        ALMOND_CHECK(actual.size() == std::min(expected.size(), top_k));
+        for (std::size_t i = 0; i < std::min(actual.size(), expected.size()); ++i) {
+            // Scores are summed in a different term order; equal scores can
+            // swap ranks, so only require ids to match away from ties.
+            ALMOND_CHECK_NEAR(actual[i].score, expected[i].score, 1e-9 * expected[i].score);
+            const bool tied = (i > 0 && expected[i - 1].score - expected[i].score < 1e-9)
+                || (i + 1 < expected.size() && expected[i].score - expected[i + 1].score < 1e-9);
+            ALMOND_CHECK(tied || actual[i].document_id == expected[i].id);
+            ++compared;
+        }
+    }
+    ALMOND_CHECK(compared > 500);
+
+    // Re-ingesting an id replaces the document instead of adding one.
+    const std::string replacement = corpus.text(10, 10);
+    index.ingest_document("doc-7", replacement);
+    ALMOND_CHECK(index.document_count() == texts.size());
+    ALMOND_CHECK(index.tokens_for("doc-7") == tokenizer.encode(replacement));
+    const auto hits = index.query(replacement, 1);
+    ALMOND_CHECK(!hits.empty() && hits.front().document_id == "doc-7");
+
+    check_concurrent_reingest(corpus);
+
+    return test::finish("retrieval_test");
+}
@@ -0,0 +1,177 @@
+#include "almondai/kernels.hpp"
+#include "almondai/sampler.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Sampler draws must follow the distribution obtained by sorting the weights:
+// keep the most likely tokens (ties in vocabulary order) until top-k or top-p
+// is reached, drop those below min_p, and renormalise. Every draw must land in
+// that set, and the draw counts must pass a chi-square test against it.
+
+using namespace almondai;
+
+namespace {
+
+// Kept tokens and their probabilities, computed by sorting.
+std::vector<double> reference_distribution(std::vector<double> logits,
+                                           const SamplerSettings& settings,
+                                           const std::vector<int>& history,
+                                           int suppressed) {
+    const std::size_t n = logits.size();
+    std::vector<double> source = logits;
+    if (settings.repetition_penalty > 0.0 && settings.repetition_penalty != 1.0) {
+        for (int token : history) {
+            const double logit = source[static_cast<std::size_t>(token)];
+            logits[static_cast<std::size_t>(token)] =
+                logit > 0.0 ? logit / settings.repetition_penalty : logit * settings.repetition_penalty;
+        }
+    }
+    if (suppressed >= 0) {
+        logits[static_cast<std::size_t>(suppressed)] = -INFINITY;
+    }
+    // Same exponentials as the sampler, so equal logits give equal weights.
+    const double max_logit = *std::max_element(logits.begin(), logits.end());
+    std::vector<double> weights(n);
+    const double total = kernels::exp_sum(logits.data(), max_logit, 1.0 / settings.temperature, weights.data(), n);
+
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return weights[a] > weights[b]; });
+    const double floor = std::max(settings.min_p, std::numeric_limits<double>::denorm_min());
+    const std::size_t top_k = settings.top_k == 0 ? n : settings.top_k;
+    std::vector<double> probability(n, 0.0);
+    double kept = 0.0;
+    std::size_t count = 0;
+    for (std::size_t token : order) {
+        if (weights[token] < floor) {
+            break;
+        }
+        probability[token] = weights[token];
+        kept += weights[token];
+        if (kept >= settings.top_p * total || ++count >= top_k) {
+            break;
+        }
+    }
+    for (double& p : probability) {
+        p /= kept;
+    }
+    return probability;
+}
+
+struct Case {
+    const char* name;
+    std::size_t vocab;
+    std::size_t draws;
+    SamplerSettings settings;
+    // Logits rounded to this step, so many tokens tie; zero leaves them distinct.
+    double tie_step = 0.0;
+    bool penalise = false;
+};
+
+void check_case(const Case& test_case, std::mt19937& rng) {
+    std::normal_distribution<double> normal(0.0, 2.5);
+    std::vector<double> logits(test_case.vocab);
+    for (double& logit : logits) {
+        logit = normal(rng);
+        if (test_case.tie_step > 0.0) {
+            logit = std::round(logit / test_case.tie_step) * test_case.tie_step;
+        }
+    }
+    std::vector<int> history;
+    int suppressed = -1;
+    if (test_case.penalise) {
+        // Penalise the two most likely tokens and suppress the third.
+        std::vector<int> order(test_case.vocab);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return logits[a] > logits[b]; });
+        history = {order[0], order[1], order[0]};
+        suppressed = order[2];
+    }
+
+    const auto expected = reference_distribution(logits, test_case.settings, history, suppressed);
+    Sampler sampler;
+    std::vector<std::size_t> counts(test_case.vocab, 0);
+    std::size_t outside = 0;
+    for (std::size_t draw = 0; draw < test_case.draws; ++draw) {
+        const int token = sampler.sample(logits, test_case.settings, rng, history, suppressed);
+        if (token < 0 || static_cast<std::size_t>(token) >= test_case.vocab || expected[token] == 0.0) {
+            ++outside;
+            continue;
+        }
+        ++counts[static_cast<std::size_t>(token)];
+    }
+    ALMOND_CHECK(outside == 0);
+
+    // Pearson chi-square; tokens expected fewer than 5 times share one bin.
+    double chi_square = 0.0;
+    std::size_t bins = 0;
+    double pooled_expected = 0.0;
+    double pooled_observed = 0.0;
+    for (std::size_t token = 0; token < test_case.vocab; ++token) {
+        const double e = expected[token] * static_cast<double>(test_case.draws);
+        if (e == 0.0) {
+            continue;
+        }
+        if (e < 5.0) {
+            pooled_expected += e;
+            pooled_observed += static_cast<double>(counts[token]);
+            continue;
+        }
+        const double d = static_cast<double>(counts[token]) - e;
+        chi_square += d * d / e;
+        ++bins;
+    }
+    if (pooled_expected > 0.0) {
+        const double d = pooled_observed - pooled_expected;
+        chi_square += d * d / pooled_expected;
+        ++bins;
+    }
+    // Mean dof, sd sqrt(2 dof); six sd keeps a fixed seed far from flaky.
+    const double dof = static_cast<double>(std::max<std::size_t>(bins, 2) - 1);
+    const bool passed = chi_square <= dof + 6.0 * std::sqrt(2.0 * dof) + 10.0;
+    if (!passed) {
+        std::fprintf(stderr, "%s: chi-square %.1f over %zu bins\n", test_case.name, chi_square, bins);
+    }
+    ALMOND_CHECK(passed);
+}
+
+SamplerSettings settings(double temperature, std::size_t top_k, double top_p, double min_p, double penalty = 1.0) {
+    SamplerSettings s;
+    s.temperature = temperature;
+    s.top_k = top_k;
+    s.top_p = top_p;
+    s.min_p = min_p;
+    s.repetition_penalty = penalty;
+    return s;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(424242);
+    const Case cases[] = {
+        {"full", 40, 20000, settings(1.0, 0, 1.0, 0.0)},
+        {"top_k", 40, 20000, settings(1.0, 5, 1.0, 0.0)},
+        {"top_p", 40, 20000, settings(0.8, 0, 0.9, 0.0)},
+        {"min_p", 40, 20000, settings(1.2, 0, 1.0, 0.05)},
+        {"combined", 40, 20000, settings(0.7, 8, 0.85, 0.02)},
+        {"ties in top_k", 60, 20000, settings(1.0, 7, 1.0, 0.0), 1.0},
+        {"ties in top_p", 60, 20000, settings(1.0, 0, 0.6, 0.0), 0.5},
+        {"penalty", 40, 20000, settings(1.0, 10, 0.95, 0.0, 1.5), 0.0, true},
+        // Large enough that the cut is selected by partitioning a bucket.
+        {"large top_p", 4000, 3000, settings(1.0, 0, 0.5, 0.0)},
+        {"large top_k ties", 4000, 3000, settings(1.0, 300, 1.0, 0.0), 0.25},
+    };
+    for (const auto& test_case : cases) {
+        check_case(test_case, rng);
+    }
+    return test::finish("sampler_test");
+}
@@ -0,0 +1,444 @@
+#include "almondai/adapter.hpp"
+#include "almondai/governor.hpp"
+#include "almondai/serve.hpp"
+#include "almondai/tokenizer_coordinator.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+// Service::run reads requests from a stream, answers read-only methods on a
+// reader pool and mutations one at a time on a writer thread. Every request
+// must get exactly one complete response line, whatever order they finish
+// in; writer-lane responses come out in request order; no more than
+// max_in_flight requests are ever being handled; reader-lane requests do
+// overlap; and each method's latency histogram counts its requests. The
+// learner lock must let a waiting writer in ahead of newly arriving readers.
+// Streamed deltas reported on a backend's own thread reach the client from
+// the worker thread, concatenate to the trimmed final output, and a stream
+// that fails part way is followed by a reset before the local fallback.
+
+using namespace almondai;
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// The learner keeps its state under ./data, so each test runs it in a fresh
+// working directory.
+class Workspace {
+public:
+    explicit Workspace(const std::string& name) : m_dir(name), m_previous(std::filesystem::current_path()) {
+        std::filesystem::current_path(m_dir.path());
+    }
+    ~Workspace() { std::filesystem::current_path(m_previous); }
+
+private:
+    test::TempDir m_dir;
+    std::filesystem::path m_previous;
+};
+
+StudentModel small_student() {
+    ModelConfig config;
+    config.hidden_size = 16;
+    config.num_layers = 1;
+    return StudentModel{BaseDecoder(config)};
+}
+
+std::string request_line(const std::string& id, const std::string& method, JsonObject params) {
+    JsonObject request;
+    request["id"] = Json(id);
+    request["method"] = Json(method);
+    request["params"] = Json(std::move(params));
+    return Json(request).dump() + "\n";
+}
+
+// Response lines by id, in the order they were written. Deltas are skipped.
+std::vector<std::pair<std::string, Json>> responses(const std::string& output) {
+    std::vector<std::pair<std::string, Json>> parsed;
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        Json message = Json::parse(line);
+        const auto& object = message.as_object();
+        if (object.count("delta")) {
+            continue;
+        }
+        parsed.emplace_back(object.at("id").as_string(), message);
+    }
+    return parsed;
+}
+
+// Holds each completion until `target` calls are inside at once or `patience`
+// passes, recording the most that ever overlapped.
+class OverlapBackend : public chat::Backend {
+public:
+    OverlapBackend(std::size_t target, std::chrono::milliseconds patience) : m_target(target), m_patience(patience) {}
+
+    std::string complete(const std::vector<chat::Message>&) override {
+        std::unique_lock lock(m_mutex);
+        ++m_active;
+        m_peak = std::max(m_peak, m_active);
+        m_changed.notify_all();
+        m_changed.wait_for(lock, m_patience, [this] { return m_active >= m_target; });
+        --m_active;
+        return "remote reply";
+    }
+
+    std::size_t peak() const {
+        std::scoped_lock lock(m_mutex);
+        return m_peak;
+    }
+
+private:
+    std::size_t m_target;
+    std::chrono::milliseconds m_patience;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::size_t m_active = 0;
+    std::size_t m_peak = 0;
+};
+
+void check_interleaved(ContinuousLearner& learner) {
+    Service::Options options;
+    options.reader_threads = 3;
+    options.max_in_flight = 5;
+    Service service(learner, MCPBridge(), options);
+
+    std::string input;
+    std::map<std::string, std::string> expected;
+    std::vector<std::string> writer_ids;
+    for (int i = 0; i < 40; ++i) {
+        const std::string id = "r" + std::to_string(i);
+        JsonObject params;
+        std::string method;
+        switch (i % 5) {
+        case 0:
+            method = "model.generate";
+            params["prompt"] = Json("tell me about request " + std::to_string(i));
+            params["max_tokens"] = Json(4.0);
+            break;
+        case 1:
+            method = "retrieval.query";
+            params["query"] = Json("request");
+            break;
+        case 2:
+            method = "ingest.step";
+            params["prompt"] = Json("what is request number " + std::to_string(i) + "?");
+            params["teacher_output"] = Json("It is request number " + std::to_string(i) + " of the interleaved batch.");
+            writer_ids.push_back(id);
+            break;
+        case 3:
+            method = "service.stats";
+            break;
+        default:
+            method = i % 10 == 4 ? "no.such_method" : "checkpoint.flush";
+            writer_ids.push_back(id);
+            break;
+        }
+        expected[id] = method;
+        input += request_line(id, method, params);
+    }
+
+    std::istringstream in(input);
+    std::ostringstream out;
+    service.run(in, out);
+
+    const auto answered = responses(out.str());
+    ALMOND_CHECK(answered.size() == expected.size());
+    std::map<std::string, int> seen;
+    std::vector<std::string> writer_order;
+    for (const auto& [id, message] : answered) {
+        ++seen[id];
+        const auto& object = message.as_object();
+        const auto method = expected.find(id);
+        ALMOND_CHECK(method != expected.end());
+        if (method == expected.end()) {
+            continue;
+        }
+        // Unknown methods error out; everything else answers with a result.
+        const bool unknown = method->second == "no.such_method";
+        ALMOND_CHECK(object.count(unknown ? "error" : "result") == 1);
+        if (std::find(writer_ids.begin(), writer_ids.end(), id) != writer_ids.end()) {
+            writer_order.push_back(id);
+        }
+        if (method->second == "service.stats") {
+            const auto& result = object.at("result").as_object();
+            ALMOND_CHECK(std::get<double>(result.at("in_flight").value()) <= static_cast<double>(options.max_in_flight));
+        }
+    }
+    for (const auto& [id, method] : expected) {
+        ALMOND_CHECK(seen[id] == 1);
+    }
+    ALMOND_CHECK(writer_order == writer_ids);
+
+    // Every handled request lands in its method's histogram exactly once.
+    std::map<std::string, std::size_t> per_method;
+    for (const auto& [id, method] : expected) {
+        ++per_method[method];
+    }
+    const auto stats = service.latency_stats();
+    ALMOND_CHECK(stats.size() == per_method.size());
+    for (const auto& [method, count] : per_method) {
+        const auto it = stats.find(method);
+        ALMOND_CHECK(it != stats.end());
+        if (it == stats.end()) {
+            continue;
+        }
+        const auto& histogram = it->second;
+        ALMOND_CHECK(histogram.count == count);
+        ALMOND_CHECK(std::accumulate(histogram.buckets.begin(), histogram.buckets.end(), std::size_t{0}) == count);
+        ALMOND_CHECK(histogram.max_ms >= histogram.total_ms / static_cast<double>(count));
+        ALMOND_CHECK(histogram.quantile_ms(0.5) <= histogram.quantile_ms(0.99));
+    }
+}
+
+// Remote completions run outside the learner lock, so the number overlapping
+// shows how many requests the service is handling at once.
+std::size_t peak_remote_overlap(ContinuousLearner& learner, std::size_t readers, std::size_t max_in_flight) {
+    Service::Options options;
+    options.reader_threads = readers;
+    options.max_in_flight = max_in_flight;
+    Service service(learner, MCPBridge(), options);
+    OverlapBackend backend(readers + 1, 50ms);
+    service.set_chat_backend(&backend, "overlap");
+
+    std::string input;
+    for (int i = 0; i < 8; ++i) {
+        JsonObject params;
+        params["prompt"] = Json("overlap " + std::to_string(i));
+        input += request_line("g" + std::to_string(i), "model.generate", params);
+    }
+    std::istringstream in(input);
+    std::ostringstream out;
+    service.run(in, out);
+    ALMOND_CHECK(responses(out.str()).size() == 8);
+    return backend.peak();
+}
+
+// Delivers its reply in pieces from a thread of its own, the way the HTTP
+// client's event loop does, optionally failing after the last piece.
+class ThreadedStreamBackend : public chat::Backend {
+public:
+    ThreadedStreamBackend(std::vector<std::string> pieces, bool fail) : m_pieces(std::move(pieces)), m_fail(fail) {}
+
+    std::string complete(const std::vector<chat::Message>&) override {
+        return std::accumulate(m_pieces.begin(), m_pieces.end(), std::string());
+    }
+
+    std::string complete_stream(const std::vector<chat::Message>& messages, const chat::DeltaCallback& on_delta) override {
+        std::exception_ptr error;
+        std::thread loop([&] {
+            try {
+                for (const auto& piece : m_pieces) {
+                    on_delta(piece);
+                }
+            } catch (...) {
+                error = std::current_exception();
+            }
+            std::scoped_lock lock(m_mutex);
+            m_threads.insert(std::this_thread::get_id());
+        });
+        loop.join();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        if (m_fail) {
+            throw std::runtime_error("stream dropped");
+        }
+        return complete(messages);
+    }
+
+    std::set<std::thread::id> threads() const {
+        std::scoped_lock lock(m_mutex);
+        return m_threads;
+    }
+
+private:
+    std::vector<std::string> m_pieces;
+    bool m_fail;
+    mutable std::mutex m_mutex;
+    std::set<std::thread::id> m_threads;
+};
+
+// Collects the output and the threads that wrote it.
+class RecordingBuffer : public std::streambuf {
+public:
+    std::string text() const {
+        std::scoped_lock lock(m_mutex);
+        return m_text;
+    }
+    std::set<std::thread::id> writers() const {
+        std::scoped_lock lock(m_mutex);
+        return m_writers;
+    }
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            const char c = traits_type::to_char_type(ch);
+            xsputn(&c, 1);
+        }
+        return traits_type::not_eof(ch);
+    }
+    std::streamsize xsputn(const char* data, std::streamsize count) override {
+        std::scoped_lock lock(m_mutex);
+        m_text.append(data, static_cast<std::size_t>(count));
+        m_writers.insert(std::this_thread::get_id());
+        return count;
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::string m_text;
+    std::set<std::thread::id> m_writers;
+};
+
+struct StreamedReply {
+    std::vector<Json> deltas;
+    JsonObject result;
+};
+
+StreamedReply stream_request(ContinuousLearner& learner, ThreadedStreamBackend& backend, const std::string& method) {
+    Service service(learner, MCPBridge());
+    service.set_chat_backend(&backend, "threaded");
+    JsonObject params;
+    params["prompt"] = Json("stream this " + method);
+    params["stream"] = Json(true);
+    params["max_tokens"] = Json(6.0);
+    std::istringstream in(request_line("s", method, params));
+    RecordingBuffer buffer;
+    std::ostream out(&buffer);
+    service.run(in, out);
+
+    for (const auto& id : backend.threads()) {
+        ALMOND_CHECK(buffer.writers().count(id) == 0);
+    }
+    StreamedReply reply;
+    std::istringstream lines(buffer.text());
+    std::string line;
+    while (std::getline(lines, line)) {
+        Json message = Json::parse(line);
+        const auto& object = message.as_object();
+        ALMOND_CHECK(reply.result.empty());
+        if (object.count("delta")) {
+            reply.deltas.push_back(message);
+        } else if (object.count("result")) {
+            reply.result = object.at("result").as_object();
+        }
+    }
+    ALMOND_CHECK(!reply.result.empty());
+    return reply;
+}
+
+std::string joined(const std::vector<Json>& deltas, std::size_t from) {
+    std::string text;
+    for (std::size_t i = from; i < deltas.size(); ++i) {
+        text += deltas[i].as_object().at("delta").as_string();
+    }
+    return text;
+}
+
+void check_streaming(ContinuousLearner& learner) {
+    const std::vector<std::string> pieces{"\n  Hello", ", wor", "ld", "  ", "\n", "again.", "  \n"};
+    for (const char* method : {"model.generate", "gpt.generate"}) {
+        ThreadedStreamBackend backend(pieces, false);
+        const auto reply = stream_request(learner, backend, method);
+        ALMOND_CHECK(!backend.threads().empty());
+        ALMOND_CHECK(reply.result.at("output").as_string() == "Hello, world  \nagain.");
+        ALMOND_CHECK(joined(reply.deltas, 0) == reply.result.at("output").as_string());
+        for (const auto& delta : reply.deltas) {
+            ALMOND_CHECK(!delta.as_object().count("reset"));
+        }
+    }
+
+    // The partial remote reply is retracted before local generation streams.
+    ThreadedStreamBackend failing({"partial ", "reply"}, true);
+    const auto reply = stream_request(learner, failing, "model.generate");
+    ALMOND_CHECK(reply.result.at("route").as_string() != "remote");
+    ALMOND_CHECK(reply.result.at("remote_error").as_string() == "stream dropped");
+    std::size_t reset = reply.deltas.size();
+    for (std::size_t i = 0; i < reply.deltas.size(); ++i) {
+        if (reply.deltas[i].as_object().count("reset")) {
+            ALMOND_CHECK(reset == reply.deltas.size());
+            reset = i;
+        }
+    }
+    ALMOND_CHECK(reset < reply.deltas.size());
+    ALMOND_CHECK(joined(reply.deltas, 0).rfind("partial reply", 0) == 0);
+    const std::string local = joined(reply.deltas, reset + 1);
+    if (!local.empty()) {
+        ALMOND_CHECK(local == reply.result.at("output").as_string());
+    }
+}
+
+void check_writer_preference() {
+    WriterPreferringMutex mutex;
+    mutex.lock_shared();
+    std::atomic<bool> written{false};
+    std::thread writer([&] {
+        mutex.lock();
+        written = true;
+        mutex.unlock();
+    });
+
+    // Once the writer is queued, new readers are turned away even though only
+    // a reader holds the lock.
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    bool queued = false;
+    while (!queued && std::chrono::steady_clock::now() < deadline) {
+        if (mutex.try_lock_shared()) {
+            mutex.unlock_shared();
+            std::this_thread::sleep_for(1ms);
+        } else {
+            queued = true;
+        }
+    }
+    ALMOND_CHECK(queued);
+    ALMOND_CHECK(!written);
+    ALMOND_CHECK(!mutex.try_lock());
+
+    mutex.unlock_shared();
+    writer.join();
+    ALMOND_CHECK(written);
+    ALMOND_CHECK(mutex.try_lock_shared());
+    ALMOND_CHECK(!mutex.try_lock());
+    mutex.unlock_shared();
+    ALMOND_CHECK(mutex.try_lock());
+    ALMOND_CHECK(!mutex.try_lock_shared());
+    mutex.unlock();
+}
+
+} // namespace
+
+int main() {
+    check_writer_preference();
+    {
+        Workspace workspace("service_test");
+        TokenizerCoordinator tokenizers;
+        ContinuousLearner learner(small_student(), AdapterManager(), tokenizers, PolicyGovernor());
+        check_interleaved(learner);
+        // Readers overlap up to the pool size, and never beyond max_in_flight.
+        ALMOND_CHECK(peak_remote_overlap(learner, 4, 64) >= 2);
+        ALMOND_CHECK(peak_remote_overlap(learner, 4, 2) <= 2);
+        ALMOND_CHECK(peak_remote_overlap(learner, 1, 64) == 1);
+        check_streaming(learner);
+    }
+    return test::finish("service_test");
+}
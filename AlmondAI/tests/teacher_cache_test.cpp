@@ -0,0 +1,254 @@
+#include "almondai/teacher_cache.hpp"
+
+#include "test_support.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+// TeacherCache keeps recent replies in an LRU of max_memory_entries and
+// appends every reply to a JSONL store. Checks eviction order, TTL expiry in
+// memory and in the store, reloading the store after a restart (newest record
+// per key wins; corrupt and truncated lines are skipped and later appends
+// still land on lines of their own), compaction down to three quarters of
+// the size cap keeping the newest records, and that make_key depends on both
+// the scope and the message.
+
+using namespace almondai;
+
+namespace {
+
+using namespace std::chrono_literals;
+
+std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+std::int64_t now_seconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// A store line as TeacherCache writes it.
+std::string record(const std::string& key, const std::string& output, std::int64_t created_at) {
+    JsonObject object;
+    object["key"] = Json(key);
+    object["output"] = Json(output);
+    object["source"] = Json("test");
+    object["created_at"] = Json(std::to_string(created_at));
+    return Json(object).dump() + '\n';
+}
+
+bool hit(TeacherCache& cache, const std::string& key, const std::string& output) {
+    const auto entry = cache.lookup(key);
+    return entry && entry->output == output;
+}
+
+void check_make_key() {
+    const std::string key = TeacherCache::make_key("route", "hello");
+    ALMOND_CHECK(key.size() == 16);
+    ALMOND_CHECK(key == TeacherCache::make_key("route", "hello"));
+    ALMOND_CHECK(key != TeacherCache::make_key("other", "hello"));
+    ALMOND_CHECK(key != TeacherCache::make_key("route", "hello!"));
+    ALMOND_CHECK(key != TeacherCache::make_key("", "hello"));
+    // The scope ends where the message starts.
+    ALMOND_CHECK(TeacherCache::make_key("ab", "c") != TeacherCache::make_key("a", "bc"));
+}
+
+void check_lru() {
+    TeacherCache::Options options;
+    options.store_path.clear();
+    options.max_memory_entries = 3;
+    TeacherCache cache(options);
+    cache.store("a", "A", "test");
+    cache.store("b", "B", "test");
+    cache.store("c", "C", "test");
+    // Touching `a` makes `b` the least recently used.
+    ALMOND_CHECK(hit(cache, "a", "A"));
+    cache.store("d", "D", "test");
+    ALMOND_CHECK(cache.stats().memory_entries == 3);
+    ALMOND_CHECK(!cache.lookup("b"));
+    ALMOND_CHECK(hit(cache, "c", "C"));
+    ALMOND_CHECK(hit(cache, "a", "A"));
+    ALMOND_CHECK(hit(cache, "d", "D"));
+    // Re-storing a key replaces it and refreshes it; `c` is now the oldest.
+    cache.store("a", "A2", "test");
+    cache.store("e", "E", "test");
+    ALMOND_CHECK(!cache.lookup("c"));
+    ALMOND_CHECK(hit(cache, "a", "A2"));
+
+    const auto stats = cache.stats();
+    ALMOND_CHECK(stats.hits == 5);
+    ALMOND_CHECK(stats.misses == 2);
+    ALMOND_CHECK(stats.stored_entries == 0);
+    ALMOND_CHECK(stats.store_bytes == 0);
+}
+
+void check_reload() {
+    test::TempDir dir("teacher_cache_reload");
+    TeacherCache::Options options;
+    options.store_path = dir.file("cache.jsonl");
+    options.max_memory_entries = 2;
+    {
+        TeacherCache cache(options);
+        for (int i = 0; i < 5; ++i) {
+            cache.store("k" + std::to_string(i), "reply " + std::to_string(i), "test");
+        }
+        cache.store("k1", "newer reply 1", "test");
+        // Evicted from memory, still served from the store.
+        ALMOND_CHECK(hit(cache, "k0", "reply 0"));
+        ALMOND_CHECK(cache.stats().memory_entries == 2);
+    }
+
+    TeacherCache cache(options);
+    ALMOND_CHECK(cache.stats().memory_entries == 0);
+    ALMOND_CHECK(cache.stats().stored_entries == 5);
+    ALMOND_CHECK(cache.stats().store_bytes == std::filesystem::file_size(options.store_path));
+    ALMOND_CHECK(hit(cache, "k1", "newer reply 1"));
+    for (int i : {0, 2, 3, 4}) {
+        const auto entry = cache.lookup("k" + std::to_string(i));
+        ALMOND_CHECK(entry && entry->output == "reply " + std::to_string(i) && entry->source == "test");
+    }
+}
+
+void check_corrupt_store() {
+    test::TempDir dir("teacher_cache_corrupt");
+    TeacherCache::Options options;
+    options.store_path = dir.file("cache.jsonl");
+    const std::int64_t now = now_seconds();
+    const std::string kept = record("kept", "first", now);
+    {
+        std::ofstream out(options.store_path, std::ios::binary);
+        out << kept << "{not json\n" << "\n" << "[1,2,3]\n" << "{\"output\":\"no key\"}\n"
+            << record("after", "second", now);
+        // A write cut short mid-record.
+        const std::string cut = record("cut", "lost", now);
+        out << cut.substr(0, cut.size() / 2);
+    }
+    {
+        TeacherCache cache(options);
+        ALMOND_CHECK(cache.stats().stored_entries == 2);
+        ALMOND_CHECK(cache.stats().store_bytes == std::filesystem::file_size(options.store_path));
+        ALMOND_CHECK(hit(cache, "kept", "first"));
+        ALMOND_CHECK(hit(cache, "after", "second"));
+        ALMOND_CHECK(!cache.lookup("cut"));
+        cache.store("appended", "third", "test");
+    }
+    // The record appended after the partial line reloads intact.
+    const std::string contents = read_file(options.store_path.string());
+    ALMOND_CHECK(contents.rfind(kept, 0) == 0);
+    ALMOND_CHECK(contents.back() == '\n');
+    TeacherCache cache(options);
+    ALMOND_CHECK(cache.stats().stored_entries == 3);
+    ALMOND_CHECK(hit(cache, "appended", "third"));
+    ALMOND_CHECK(hit(cache, "after", "second"));
+}
+
+void check_ttl() {
+    test::TempDir dir("teacher_cache_ttl");
+    TeacherCache::Options options;
+    options.store_path = dir.file("cache.jsonl");
+    options.ttl = 1h;
+    const std::int64_t now = now_seconds();
+    {
+        std::ofstream out(options.store_path, std::ios::binary);
+        out << record("fresh", "fresh reply", now - 60) << record("stale", "stale reply", now - 7200)
+            << record("revived", "old", now - 7200) << record("revived", "new", now - 60)
+            << record("superseded", "new", now - 60) << record("superseded", "old", now - 7200);
+    }
+    {
+        TeacherCache cache(options);
+        // The last record for a key decides, even when an earlier one is still live.
+        ALMOND_CHECK(cache.stats().stored_entries == 2);
+        ALMOND_CHECK(hit(cache, "fresh", "fresh reply"));
+        ALMOND_CHECK(hit(cache, "revived", "new"));
+        ALMOND_CHECK(!cache.lookup("stale"));
+        ALMOND_CHECK(!cache.lookup("superseded"));
+    }
+    {
+        options.ttl = 0s;
+        TeacherCache forever(options);
+        ALMOND_CHECK(forever.stats().stored_entries == 4);
+        ALMOND_CHECK(hit(forever, "stale", "stale reply"));
+    }
+
+    // Entries already in memory expire too.
+    TeacherCache::Options memory;
+    memory.store_path.clear();
+    memory.ttl = 1s;
+    TeacherCache cache(memory);
+    cache.store("short", "lived", "test");
+    ALMOND_CHECK(hit(cache, "short", "lived"));
+    std::this_thread::sleep_for(2100ms);
+    ALMOND_CHECK(!cache.lookup("short"));
+    ALMOND_CHECK(cache.stats().memory_entries == 0);
+}
+
+void check_compaction() {
+    test::TempDir dir("teacher_cache_compact");
+    TeacherCache::Options options;
+    options.store_path = dir.file("cache.jsonl");
+    const std::int64_t now = now_seconds();
+    // Ten records of equal size, key i written i seconds ago, so the newest
+    // have the lowest numbers.
+    std::vector<std::string> lines;
+    for (int i = 0; i < 10; ++i) {
+        lines.push_back(record("key" + std::to_string(i), "reply " + std::to_string(i), now - 100 + 10 - i));
+    }
+    const std::size_t line_size = lines.front().size();
+    {
+        std::ofstream out(options.store_path, std::ios::binary);
+        for (auto it = lines.rbegin(); it != lines.rend(); ++it) {
+            out << *it;
+        }
+    }
+    // A cap of eight records leaves room for six after compaction on load.
+    options.max_store_bytes = 8 * line_size;
+    {
+        TeacherCache cache(options);
+        const auto stats = cache.stats();
+        ALMOND_CHECK(stats.store_bytes <= options.max_store_bytes / 4 * 3);
+        ALMOND_CHECK(stats.store_bytes == 6 * line_size);
+        ALMOND_CHECK(stats.stored_entries == 6);
+        ALMOND_CHECK(stats.store_bytes == std::filesystem::file_size(options.store_path));
+        ALMOND_CHECK(!std::filesystem::exists(options.store_path.string() + ".tmp"));
+        for (int i = 0; i < 10; ++i) {
+            ALMOND_CHECK(static_cast<bool>(cache.lookup("key" + std::to_string(i))) == (i < 6));
+        }
+    }
+
+    // Appends compact as soon as the store passes the cap.
+    TeacherCache cache(options);
+    std::size_t compactions = 0;
+    std::size_t previous = cache.stats().store_bytes;
+    for (int i = 0; i < 40; ++i) {
+        cache.store("new" + std::to_string(i), "appended reply", "test");
+        const auto stats = cache.stats();
+        ALMOND_CHECK(stats.store_bytes <= options.max_store_bytes);
+        ALMOND_CHECK(stats.store_bytes == std::filesystem::file_size(options.store_path));
+        if (stats.store_bytes < previous) {
+            ++compactions;
+            ALMOND_CHECK(stats.store_bytes <= options.max_store_bytes / 4 * 3);
+        }
+        previous = stats.store_bytes;
+    }
+    ALMOND_CHECK(compactions > 1);
+    ALMOND_CHECK(hit(cache, "new39", "appended reply"));
+}
+
+} // namespace
+
+int main() {
+    check_make_key();
+    check_lru();
+    check_reload();
+    check_corrupt_store();
+    check_ttl();
+    check_compaction();
+    return test::finish("teacher_cache_test");
+}
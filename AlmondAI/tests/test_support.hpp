@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+// Minimal assertion helpers for the test executables. A test binary runs all
+// of its checks, prints each failure and returns non-zero from finish().
+
+namespace almondai::test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline void check(bool passed, const char* expression, const char* file, int line) {
+    if (!passed) {
+        ++failures();
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+    }
+}
+
+inline void check_near(double actual, double expected, double tolerance,
+                       const char* expression, const char* file, int line) {
+    if (!(std::fabs(actual - expected) <= tolerance)) {
+        ++failures();
+        std::fprintf(stderr, "%s:%d: check failed: %s (%.17g vs %.17g, tolerance %.3g)\n",
+                     file, line, expression, actual, expected, tolerance);
+    }
+}
+
+inline int finish(const char* name) {
+    if (failures() == 0) {
+        std::printf("%s: all checks passed\n", name);
+        return 0;
+    }
+    std::printf("%s: %d check(s) failed\n", name, failures());
+    return 1;
+}
+
+// Fresh directory under the system temp dir, removed when the test exits.
+class TempDir {
+public:
+    explicit TempDir(const std::string& name)
+        : m_path(std::filesystem::temp_directory_path() / ("almondai_" + name)) {
+        std::filesystem::remove_all(m_path);
+        std::filesystem::create_directories(m_path);
+    }
+    ~TempDir() {
+        std::error_code ignored;
+        std::filesystem::remove_all(m_path, ignored);
+    }
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    const std::filesystem::path& path() const noexcept { return m_path; }
+    std::string file(const std::string& name) const { return (m_path / name).string(); }
+
+private:
+    std::filesystem::path m_path;
+};
+
+} // namespace almondai::test
+
+#define ALMOND_CHECK(expr) ::almondai::test::check(static_cast<bool>(expr), #expr, __FILE__, __LINE__)
+#define ALMOND_CHECK_NEAR(actual, expected, tolerance) \
+    ::almondai::test::check_near((actual), (expected), (tolerance), #actual " ~ " #expected, __FILE__, __LINE__)
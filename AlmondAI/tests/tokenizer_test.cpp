@@ -0,0 +1,373 @@
+#include "almondai/tokenizer_bpe.hpp"
+#include "almondai/tokenizer_word.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// The WordPiece trie must find the same longest piece as trying every prefix
+// against the vocabulary, both while tokens are inserted one at a time and
+// after a rebuild. BpeTokenizer::encode must then pick the same pieces as a
+// greedy longest-match, with the same single-character fallback, over its own
+// vocabulary snapshot. WordTokenizer::encode, with its SSE2 scan for ASCII
+// runs and direct code point tables, must match a byte-at-a-time decode and
+// lookup, including at 16-byte run boundaries and on malformed UTF-8. Bulk
+// ingest_texts on a pool must give both tokenizers the vocabulary that
+// ingesting the texts one at a time gives.
+
+using namespace almondai;
+
+namespace {
+
+bool is_boundary(std::string_view text, std::size_t end) {
+    return end == text.size() || (static_cast<unsigned char>(text[end]) & 0xC0u) != 0x80u;
+}
+
+WordPieceTrie::Match reference_match(const std::unordered_map<std::string, int>& vocab,
+                                     std::string_view text,
+                                     std::size_t start,
+                                     bool continuation) {
+    WordPieceTrie::Match best;
+    for (std::size_t end = start + 1; end <= text.size(); ++end) {
+        if (!is_boundary(text, end)) {
+            continue;
+        }
+        std::string piece(text.substr(start, end - start));
+        if (continuation) {
+            piece.insert(0, "##");
+        }
+        if (auto it = vocab.find(piece); it != vocab.end()) {
+            best = WordPieceTrie::Match{end - start, it->second};
+        }
+    }
+    return best;
+}
+
+// Letters from a small alphabet that mixes 1-, 2- and 3-byte characters.
+std::string random_text(std::mt19937& rng, std::size_t min_chars, std::size_t max_chars) {
+    static const char* kAlphabet[] = {"a", "b", "c", "#", "\xc3\xa9", "\xe4\xb8\xad"};
+    std::uniform_int_distribution<std::size_t> length(min_chars, max_chars);
+    std::uniform_int_distribution<std::size_t> letter(0, std::size(kAlphabet) - 1);
+    std::string text;
+    for (std::size_t i = length(rng); i > 0; --i) {
+        text += kAlphabet[letter(rng)];
+    }
+    return text;
+}
+
+void check_against(const WordPieceTrie& trie,
+                   const std::unordered_map<std::string, int>& vocab,
+                   const std::vector<std::string>& texts) {
+    for (const auto& text : texts) {
+        for (std::size_t start = 0; start < text.size(); ++start) {
+            if (!is_boundary(text, start)) {
+                continue;
+            }
+            for (const bool continuation : {false, true}) {
+                const auto expected = reference_match(vocab, text, start, continuation);
+                const auto actual = trie.longest_match(text, start, continuation);
+                ALMOND_CHECK(actual.length == expected.length);
+                ALMOND_CHECK(actual.length == 0 || actual.id == expected.id);
+            }
+        }
+    }
+}
+
+void check_trie(std::mt19937& rng) {
+    std::vector<std::string> texts;
+    for (int i = 0; i < 200; ++i) {
+        texts.push_back(random_text(rng, 1, 12));
+    }
+
+    WordPieceTrie trie;
+    std::unordered_map<std::string, int> vocab;
+    for (int round = 0; round < 4; ++round) {
+        for (int i = 0; i < 60; ++i) {
+            std::string token = random_text(rng, 1, 4);
+            if (i % 2 == 1) {
+                token.insert(0, "##");
+            }
+            if (vocab.emplace(token, static_cast<int>(vocab.size())).second) {
+                trie.insert(token, vocab.at(token));
+            }
+        }
+        check_against(trie, vocab, texts);
+        for (const auto& [token, id] : vocab) {
+            ALMOND_CHECK(trie.find(token, false) == id);
+        }
+    }
+
+    WordPieceTrie rebuilt;
+    for (const auto& [token, id] : vocab) {
+        rebuilt.insert(token, id);
+    }
+    check_against(rebuilt, vocab, texts);
+    rebuilt.clear();
+    ALMOND_CHECK(rebuilt.longest_match(texts.front(), 0, false).length == 0);
+}
+
+// Greedy longest match over the snapshot for space-separated ASCII words,
+// which segment into the words and single spaces.
+std::vector<int> reference_encode(const BpeTokenizer::Vocabulary& vocab, std::string_view text) {
+    std::vector<int> ids;
+    std::size_t word_start = 0;
+    for (std::size_t i = 0; i <= text.size(); ++i) {
+        if (i < text.size() && text[i] != ' ') {
+            continue;
+        }
+        const std::string_view word = text.substr(word_start, i - word_start);
+        for (std::size_t start = 0; start < word.size();) {
+            const auto match = reference_match(vocab.token_to_id, word, start, start > 0);
+            if (match.length == 0) {
+                // The rest of the word falls back to single characters, the
+                // first without the "##" prefix.
+                for (std::size_t j = start; j < word.size(); ++j) {
+                    const std::string piece = (j > start ? "##" : "") + std::string(1, word[j]);
+                    const auto it = vocab.token_to_id.find(piece);
+                    ids.push_back(it != vocab.token_to_id.end() ? it->second : BpeTokenizer::UNK_ID);
+                }
+                break;
+            }
+            ids.push_back(match.id);
+            start += match.length;
+        }
+        if (i < text.size()) {
+            ids.push_back(vocab.token_to_id.at(" "));
+        }
+        word_start = i + 1;
+    }
+    return ids;
+}
+
+void check_encode(std::mt19937& rng) {
+    test::TempDir dir("tokenizer_test");
+    {
+        // Multi-character pieces so the longest match has choices to make.
+        std::ofstream vocab(dir.file("vocab.txt"));
+        vocab << "<pad>\n<eos>\n<unk>\nalpha\nal\n##bet\n##be\ntab\n##le\nx1\n##2\n";
+    }
+    BpeTokenizer tokenizer;
+    ALMOND_CHECK(tokenizer.load(dir.file("vocab.txt")));
+
+    static const char* kWords[] = {"alpha", "alphabet", "bet", "beta", "tab", "table", "able", "x1", "x12", "_y"};
+    std::uniform_int_distribution<std::size_t> word(0, std::size(kWords) - 1);
+    const auto sentence = [&] {
+        std::string text = kWords[word(rng)];
+        for (int i = 0; i < 6; ++i) {
+            text += ' ';
+            text += kWords[word(rng)];
+        }
+        return text;
+    };
+
+    std::vector<std::string> texts;
+    for (int i = 0; i < 50; ++i) {
+        texts.push_back(sentence());
+        tokenizer.ingest_training_pair(texts.back(), sentence());
+    }
+    const auto vocab = tokenizer.snapshot();
+    for (const auto& text : texts) {
+        const auto ids = tokenizer.encode(text);
+        ALMOND_CHECK(ids == reference_encode(*vocab, text));
+        for (int id : ids) {
+            ALMOND_CHECK(id != BpeTokenizer::UNK_ID);
+        }
+    }
+
+    // A reload rebuilds the trie from the saved files and must pick the same pieces.
+    tokenizer.save_vocab(dir.file("vocab.txt"));
+    tokenizer.save_merges(dir.file("merges.txt"));
+    BpeTokenizer reloaded;
+    ALMOND_CHECK(reloaded.load(dir.file("vocab.txt"), dir.file("merges.txt")));
+    for (const auto& text : texts) {
+        const auto before = tokenizer.encode(text);
+        const auto after = reloaded.encode(text);
+        ALMOND_CHECK(before.size() == after.size());
+        for (std::size_t i = 0; i < std::min(before.size(), after.size()); ++i) {
+            ALMOND_CHECK(tokenizer.id_to_token(before[i]) == reloaded.id_to_token(after[i]));
+        }
+    }
+}
+
+// One code point at a time: the lead byte gives the length, a lead byte with
+// too few bytes left or no valid length is skipped on its own, and trailing
+// bytes are taken as they are. Curly apostrophes fold to '\'', ASCII upper
+// case folds when asked, and the canonical spelling is looked up by name.
+std::vector<int> reference_word_encode(const WordTokenizer::Vocabulary& vocab, std::string_view text) {
+    const auto id_of = [&](const std::string& token) {
+        const auto it = vocab.token_to_id.find(token);
+        return it != vocab.token_to_id.end() ? it->second : vocab.token_to_id.at("<unk>");
+    };
+    std::vector<int> ids{vocab.token_to_id.at("<bos>")};
+    for (std::size_t i = 0; i < text.size();) {
+        const unsigned char lead = static_cast<unsigned char>(text[i]);
+        std::size_t length = 0;
+        char32_t code = 0;
+        if (lead < 0x80) {
+            length = 1;
+            code = lead;
+        } else if ((lead & 0xE0) == 0xC0) {
+            length = 2;
+            code = lead & 0x1F;
+        } else if ((lead & 0xF0) == 0xE0) {
+            length = 3;
+            code = lead & 0x0F;
+        } else if ((lead & 0xF8) == 0xF0) {
+            length = 4;
+            code = lead & 0x07;
+        }
+        if (length == 0 || i + length > text.size()) {
+            ++i;
+            continue;
+        }
+        for (std::size_t j = 1; j < length; ++j) {
+            code = (code << 6) | (static_cast<unsigned char>(text[i + j]) & 0x3F);
+        }
+        i += length;
+        if (code == 0x2018 || code == 0x2019) {
+            code = U'\'';
+        }
+        if (vocab.config.lowercase && code >= U'A' && code <= U'Z') {
+            code += U'a' - U'A';
+        }
+        std::string token;
+        if (code < 0x80) {
+            token.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            token += static_cast<char>(0xC0 | (code >> 6));
+            token += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            token += static_cast<char>(0xE0 | (code >> 12));
+            token += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            token += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            token += static_cast<char>(0xF0 | (code >> 18));
+            token += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            token += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            token += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        ids.push_back(id_of(token));
+    }
+    ids.push_back(vocab.token_to_id.at("<eos>"));
+    return ids;
+}
+
+void check_word_encode(std::mt19937& rng) {
+    // ASCII, Latin-1, CJK and astral pieces, curly apostrophes, and malformed
+    // sequences: stray continuation bytes, invalid leads, and truncated 2-, 3-
+    // and 4-byte sequences.
+    static const char* kPieces[] = {
+        "a", "Z", "q", " ", "'", "\xe2\x80\x98", "\xe2\x80\x99", "\xc3\xa9", "\xc3\x89", "\xc3\x9f",
+        "\xe4\xb8\xad", "\xe6\x96\x87", "\xf0\x9f\x98\x80", "\xf0\x9d\x84\x9e", "\x80", "\xbf", "\xff",
+        "\xf8", "\xc3", "\xe4\xb8", "\xf0\x9f\x98",
+    };
+    std::uniform_int_distribution<std::size_t> piece(0, std::size(kPieces) - 1);
+    std::uniform_int_distribution<std::size_t> letter(0, 51);
+    const auto ascii = [&](std::size_t count) {
+        std::string run;
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::size_t value = letter(rng);
+            run += static_cast<char>(value < 26 ? 'a' + value : 'A' + value - 26);
+        }
+        return run;
+    };
+
+    std::vector<std::string> texts;
+    // ASCII runs either side of the 16-byte vector width, starting after each
+    // kind of non-ASCII piece and ending before one or at the end of the text.
+    for (std::size_t run : {0u, 1u, 15u, 16u, 17u, 31u, 32u, 33u, 48u}) {
+        for (const char* before : {"", "\xc3\xa9", "\xe4\xb8\xad", "\xf0\x9f\x98\x80", "\x80"}) {
+            for (const char* after : {"", "\xc3\xa9", "\xf0\x9d\x84\x9e", "\xe2\x80\x99", "\xe4\xb8", "\xf0\x9f\x98"}) {
+                texts.push_back(std::string(before) + ascii(run) + after);
+                texts.push_back(ascii(run) + after + ascii(run));
+            }
+        }
+    }
+    for (int i = 0; i < 300; ++i) {
+        std::string text;
+        for (std::size_t count = 1 + i % 40; count > 0; --count) {
+            text += i % 3 == 0 ? ascii(1 + letter(rng) % 20) : std::string(kPieces[piece(rng)]);
+        }
+        texts.push_back(std::move(text));
+    }
+
+    for (const bool lowercase : {false, true}) {
+        // Lower-case letters, some accents and one CJK character are known;
+        // upper case, the rest and the astral pieces fall to <unk> unless
+        // folded.
+        WordTokenizer tokenizer;
+        tokenizer.set_config(TokenizerConfig{lowercase, false});
+        tokenizer.build_vocab({"abcdefghijklmnopqrstuvwxyz '\xc3\xa9\xe4\xb8\xad"});
+        const auto vocab = tokenizer.snapshot();
+        ALMOND_CHECK(vocab->config.lowercase == lowercase);
+        for (const auto& text : texts) {
+            ALMOND_CHECK(tokenizer.encode(text) == reference_word_encode(*vocab, text));
+        }
+        const auto folded = tokenizer.encode("A\xe2\x80\x99");
+        ALMOND_CHECK(folded.size() == 4);
+        ALMOND_CHECK((folded[1] == vocab->token_to_id.at("a")) == lowercase);
+        ALMOND_CHECK(folded[2] == vocab->token_to_id.at("'"));
+
+        // With every piece in the vocabulary nothing falls to <unk>.
+        tokenizer.build_vocab(texts);
+        const auto full = tokenizer.snapshot();
+        for (const auto& text : texts) {
+            const auto ids = tokenizer.encode(text);
+            ALMOND_CHECK(ids == reference_word_encode(*full, text));
+            ALMOND_CHECK(std::count(ids.begin(), ids.end(), full->token_to_id.at("<unk>")) == 0);
+        }
+    }
+}
+
+void check_ingest_parity(std::mt19937& rng) {
+    // Enough texts to span several parallel windows, with new words and
+    // whitespace runs still turning up late in the corpus.
+    std::vector<std::string> texts;
+    for (int i = 0; i < 6000; ++i) {
+        std::string text = random_text(rng, 1, 6) + " " + std::to_string(i % 700);
+        if (i % 500 == 0) {
+            text += "\t\t" + random_text(rng, 1, 3);
+        }
+        texts.push_back(std::move(text));
+    }
+    const std::vector<std::string_view> views(texts.begin(), texts.end());
+    ThreadPool pool(3);
+
+    BpeTokenizer serial_bpe;
+    BpeTokenizer bulk_bpe;
+    serial_bpe.load("");
+    bulk_bpe.load("");
+    std::size_t serial_added = 0;
+    for (const auto& text : texts) {
+        serial_added += serial_bpe.ingest_training_pair(text, std::string_view());
+    }
+    ALMOND_CHECK(bulk_bpe.ingest_texts(views, pool) == serial_added);
+    ALMOND_CHECK(bulk_bpe.snapshot()->id_to_token == serial_bpe.snapshot()->id_to_token);
+    ALMOND_CHECK(bulk_bpe.snapshot()->merges == serial_bpe.snapshot()->merges);
+
+    WordTokenizer serial_word;
+    WordTokenizer bulk_word;
+    serial_added = 0;
+    for (const auto& text : texts) {
+        serial_added += serial_word.ingest_training_pair(text, std::string_view());
+    }
+    ALMOND_CHECK(bulk_word.ingest_texts(views, pool) == serial_added);
+    ALMOND_CHECK(bulk_word.snapshot()->id_to_token == serial_word.snapshot()->id_to_token);
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(31);
+    check_trie(rng);
+    check_encode(rng);
+    check_word_encode(rng);
+    check_ingest_parity(rng);
+    return test::finish("tokenizer_test");
+}
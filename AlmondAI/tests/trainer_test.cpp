@@ -0,0 +1,118 @@
+#include "almondai/trainer.hpp"
+
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Trainer keeps a running context window per sequence, evicting tokens once
+// prompt plus targets exceed context_length and re-summing after a full
+// window of evictions. Its loss must match the straightforward path: truncate
+// the context to the last context_length tokens and call forward() on it for
+// every target. train_on_batch must also report its token throughput.
+
+using namespace almondai;
+
+namespace {
+
+constexpr double kLabelSmoothing = 0.1;
+
+// Smoothed cross-entropy as Trainer computes it.
+double token_loss(const std::vector<double>& logits, int target) {
+    const double max_logit = *std::max_element(logits.begin(), logits.end());
+    double sum = 0.0;
+    for (double logit : logits) {
+        sum += std::exp(logit - max_logit);
+    }
+    const double off = kLabelSmoothing / static_cast<double>(logits.size() - 1);
+    double loss = 0.0;
+    for (std::size_t i = 0; i < logits.size(); ++i) {
+        const double p = std::max(std::exp(logits[i] - max_logit) / sum, 1e-12);
+        const double target_prob = static_cast<int>(i) == target ? 1.0 - kLabelSmoothing : off;
+        loss += -target_prob * std::log(p);
+    }
+    return loss;
+}
+
+struct Reference {
+    double loss = 0.0;
+    std::size_t tokens = 0;
+};
+
+Reference reference_loss(const StudentModel& model,
+                         const BpeTokenizer& tokenizer,
+                         const std::vector<TrainingExample>& batch) {
+    const std::size_t limit = model.base().config().context_length;
+    Reference reference;
+    for (const auto& example : batch) {
+        std::vector<int> context = tokenizer.encode(example.prompt);
+        auto targets = tokenizer.encode(example.teacher_output);
+        targets.erase(std::remove(targets.begin(), targets.end(), BpeTokenizer::EOS_ID), targets.end());
+        targets.push_back(BpeTokenizer::EOS_ID);
+        for (int target : targets) {
+            if (context.size() > limit) {
+                context.erase(context.begin(), context.end() - static_cast<std::ptrdiff_t>(limit));
+            }
+            reference.loss += token_loss(model.forward(context).logits, target);
+            ++reference.tokens;
+            context.push_back(target);
+        }
+    }
+    reference.loss /= static_cast<double>(reference.tokens);
+    return reference;
+}
+
+} // namespace
+
+int main() {
+    // Prompts and replies of different lengths, so the batch pads and masks,
+    // and all far longer than the window so it evicts and re-sums repeatedly.
+    const std::vector<TrainingExample> batch{
+        {Json(), "explain the context window", Json(), "the window keeps the most recent tokens and drops older ones"},
+        {Json(), "why", Json(), "because re-pooling every prefix costs time proportional to its length"},
+        {Json(), "a much longer prompt about sliding windows over tokens", Json(), "short reply"},
+    };
+
+    BpeTokenizer tokenizer;
+    tokenizer.load("");
+    for (const auto& example : batch) {
+        tokenizer.ingest_training_pair(example.prompt, example.teacher_output);
+    }
+
+    ModelConfig config;
+    config.vocab_size = tokenizer.vocab_size();
+    config.hidden_size = 16;
+    config.num_layers = 2;
+    config.context_length = 6;
+    StudentModel model{BaseDecoder(config)};
+
+    Trainer trainer(model, tokenizer, AdamWOptimizer(), WarmupCosineScheduler());
+    Trainer::Options options;
+    options.label_smoothing = kLabelSmoothing;
+    options.save_every = 0;
+    trainer.set_options(options);
+
+    const auto expected = reference_loss(model, tokenizer, batch);
+    ALMOND_CHECK(expected.tokens > 4 * config.context_length);
+
+    const auto evaluation = trainer.evaluate(batch);
+    ALMOND_CHECK(evaluation.tokens == expected.tokens);
+    ALMOND_CHECK_NEAR(evaluation.loss, expected.loss, 1e-12 * expected.loss);
+
+    // The reported loss is taken before the optimizer step.
+    const auto report = trainer.train_on_batch(batch);
+    ALMOND_CHECK(report.step == 1);
+    ALMOND_CHECK(report.tokens == expected.tokens);
+    ALMOND_CHECK_NEAR(report.loss, expected.loss, 1e-12 * expected.loss);
+    ALMOND_CHECK_NEAR(report.perplexity, std::exp(expected.loss), 1e-9 * std::exp(expected.loss));
+    ALMOND_CHECK(report.tokens_per_second > 0.0 && std::isfinite(report.tokens_per_second));
+
+    // The step moved the weights, and the windowed path still tracks them.
+    const auto after = reference_loss(model, tokenizer, batch);
+    ALMOND_CHECK(after.loss != expected.loss);
+    ALMOND_CHECK_NEAR(trainer.evaluate(batch).loss, after.loss, 1e-12 * after.loss);
+
+    return test::finish("trainer_test");
+}
@@ -138,7 +138,7 @@ int main() {
     tokenizers.set_persistence({vocab_path, bpe_vocab_path, bpe_merges_path});
 
     ModelConfig config;
-    config.vocab_size = tokenizer.vocab().size();
+    config.vocab_size = tokenizer.vocab_size();
     config.hidden_size = 64;
     config.num_layers = 2;
 
@@ -1191,8 +1191,8 @@ int main() {
   reader [file] [limit] [offset]
                           Preview JSONL records (defaults to data/training_data.jsonl).
   directory [training]    Show absolute paths for the data/training files.
-  train <file> [epochs=1] [batch=32]
-                          Run batched training against a JSONL file.
+  train <file> [epochs=1] [batch=32] [threads]
+                          Run batched training against a JSONL file (threads>0 trains data-parallel).
   self-learn [loops=1] [delay_ms=0] [options]
                           Loop through seed prompts, ask the teacher, and train automatically.
                           Options: shuffle/random, ordered, force, keep/dedupe, tags=tag1,tag2.
@@ -2241,10 +2241,10 @@ int main() {
                     args.push_back(token);
                 }
                 if (args.empty()) {
-                    std::cout << "Usage: train <file> [epochs=1] [batch=32]\n";
+                    std::cout << "Usage: train <file> [epochs=1] [batch=32] [threads]\n";
                     continue;
                 }
-                if (args.size() > 3) {
+                if (args.size() > 4) {
                     std::cout << "Too many arguments for train command.\n";
                     continue;
                 }
@@ -2276,7 +2276,7 @@ int main() {
                         continue;
                     }
                 }
-                if (args.size() == 3) {
+                if (args.size() >= 3) {
                     if (auto parsed = parse_positive(args[2], "batch")) {
                         batch = *parsed;
                     }
@@ -2284,11 +2284,21 @@ int main() {
                         continue;
                     }
                 }
+                std::optional<int> threads;
+                if (args.size() == 4) {
+                    threads = parse_positive(args[3], "threads");
+                    if (!threads) {
+                        continue;
+                    }
+                }
 
                 JsonObject params;
                 params["file"] = Json(file);
                 params["epochs"] = Json(epochs);
                 params["batch"] = Json(batch);
+                if (threads) {
+                    params["threads"] = Json(*threads);
+                }
 
                 if (!invoke_service_streaming("trainer.fit", Json(params), nullptr)) {
                     if (!invoke_service_streaming("train", Json(params), nullptr)) {